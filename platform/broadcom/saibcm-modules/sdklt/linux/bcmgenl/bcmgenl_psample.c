@@ -25,10 +25,13 @@
 #include <ngknet_linux.h>
 
 #include <linux/if_vlan.h>
+#include <linux/log2.h>
 #include <linux/namei.h>
 #include <linux/netdevice.h>
+#include <linux/percpu.h>
 #include <linux/skbuff.h>
 #include <linux/sched.h>
+#include <linux/vmalloc.h>
 
 /*! \cond */
 MODULE_AUTHOR("Broadcom Corporation");
@@ -60,12 +63,19 @@ static int debug;
 static int psample_size = PSAMPLE_SIZE_DFLT;
 MODULE_PARAM(psample_size, int, 0);
 MODULE_PARM_DESC(psample_size,
-"psample pkt size (default 128 bytes)");
+"psample pkt size, the most bytes kept for a sample (default 128 bytes)");
 
 #define BCMGENL_PSAMPLE_QLEN_DFLT 1024
 static int bcmgenl_psample_qlen = BCMGENL_PSAMPLE_QLEN_DFLT;
 MODULE_PARAM(bcmgenl_psample_qlen, int, 0);
-MODULE_PARM_DESC(bcmgenl_psample_qlen, "psample queue length (default 1024 buffers)");
+MODULE_PARM_DESC(bcmgenl_psample_qlen,
+"psample queue length per CPU, rounded up to a power of 2 (default 1024 buffers)");
+
+#define BCMGENL_PSAMPLE_BUDGET_DFLT 256
+static int bcmgenl_psample_budget = BCMGENL_PSAMPLE_BUDGET_DFLT;
+MODULE_PARAM(bcmgenl_psample_budget, int, 0);
+MODULE_PARM_DESC(bcmgenl_psample_budget,
+"psample pkts sent per CPU queue in one run of the work (default 256)");
 
 #ifndef BCMGENL_PSAMPLE_METADATA
 #if (LINUX_VERSION_CODE >= KERNEL_VERSION(5,13,0))
@@ -107,7 +117,6 @@ typedef struct psample_stats_s {
     unsigned long pkts_c_qlen_cur;
     unsigned long pkts_c_qlen_hi;
     unsigned long pkts_d_qlen_max;
-    unsigned long pkts_d_no_mem;
     unsigned long pkts_d_no_group;
     unsigned long pkts_d_sampling_disabled;
     unsigned long pkts_d_not_ready;
@@ -119,7 +128,10 @@ typedef struct psample_stats_s {
     unsigned long pkts_d_invalid_size;
     unsigned long pkts_d_psample_only;
 } bcmgenl_psample_stats_t;
-static bcmgenl_psample_stats_t g_bcmgenl_psample_stats = {0};
+
+/* Counted per CPU, as samples are taken on all Rx CPUs concurrently */
+static DEFINE_PER_CPU(bcmgenl_psample_stats_t, g_bcmgenl_psample_stats);
+#define PSAMPLE_STATS_INC(_f) this_cpu_inc(g_bcmgenl_psample_stats._f)
 
 typedef struct psample_meta_s {
     int trunc_size;
@@ -129,19 +141,46 @@ typedef struct psample_meta_s {
     int sample_type;
 } psample_meta_t;
 
-typedef struct psample_pkt_s {
-    struct list_head list;
+/* Sample descriptor, data of psample_size bytes is kept in the ring */
+typedef struct psample_slot_s {
     psample_meta_t meta;
-    struct sk_buff *skb;
+    int pkt_len;                    /* Original size for PSAMPLE_ATTR_ORIGSIZE */
     struct psample_group *group;
-} psample_pkt_t;
+} psample_slot_t;
+
+/*
+ * Per CPU ring of sample descriptors.
+ * Filled by the Rx CPU it belongs to and drained by the work.
+ */
+typedef struct psample_ring_s {
+    unsigned int head;              /* Next slot to fill */
+    unsigned int tail;              /* Next slot to drain */
+    unsigned int hi;                /* High watermark */
+    psample_slot_t *slots;
+    uint8_t *data;
+} psample_ring_t;
 
 typedef struct bcmgenl_psample_work_s {
-    struct list_head pkt_list;
+    psample_ring_t __percpu *rings;
+    unsigned int ring_size;         /* Power of 2 */
+    struct sk_buff *skb;            /* Reused to send samples */
+    unsigned int skb_headroom;
     struct work_struct wq;
-    spinlock_t lock;
 } bcmgenl_psample_work_t;
-static bcmgenl_psample_work_t g_bcmgenl_psample_work = {{0}};
+static bcmgenl_psample_work_t g_bcmgenl_psample_work = {0};
+
+/*
+ * Netif attributes indexed by port, to look up samples w/o the lock.
+ * Ports beyond PSAMPLE_PORT_MAX fall back to the netif list.
+ */
+#define PSAMPLE_PORT_MAX 1024
+
+typedef struct psample_port_s {
+    int ifindex;                    /* 0 if no netif on the port */
+    uint32_t sample_rate;
+    uint32_t sample_size;
+} psample_port_t;
+static psample_port_t g_psample_ports[PSAMPLE_PORT_MAX];
 
 /* driver proc entry root */
 static struct proc_dir_entry *psample_proc_root = NULL;
@@ -168,24 +207,62 @@ psample_netif_lookup_by_ifindex(int ifindex)
     return (NULL);
 }
 
-static bcmgenl_netif_t *
-psample_netif_lookup_by_port(int port)
+/*
+ * Update the port entry from the netif list, under g_bcmgenl_psample_info.lock.
+ * The netif with the lowest ID on the port is used, as with the list walk.
+ */
+static void
+psample_port_sync(int port)
 {
     struct list_head *list;
-    bcmgenl_netif_t *bcmgenl_netif = NULL;
+    bcmgenl_netif_t *bcmgenl_netif;
+    psample_port_t *psample_port;
+
+    if (port < 0 || port >= PSAMPLE_PORT_MAX) {
+        return;
+    }
+    psample_port = &g_psample_ports[port];
+
+    list_for_each(list, &g_bcmgenl_psample_info.netif_list) {
+        bcmgenl_netif = (bcmgenl_netif_t*)list;
+        if (bcmgenl_netif->port == port) {
+            WRITE_ONCE(psample_port->sample_rate, bcmgenl_netif->sample_rate);
+            WRITE_ONCE(psample_port->sample_size, bcmgenl_netif->sample_size);
+            WRITE_ONCE(psample_port->ifindex, bcmgenl_netif->dev->ifindex);
+            return;
+        }
+    }
+    WRITE_ONCE(psample_port->ifindex, 0);
+}
+
+static int
+psample_port_lookup(int port, psample_port_t *psample_port)
+{
+    struct list_head *list;
+    bcmgenl_netif_t *bcmgenl_netif;
     unsigned long flags;
 
+    if (port >= 0 && port < PSAMPLE_PORT_MAX) {
+        psample_port->ifindex = READ_ONCE(g_psample_ports[port].ifindex);
+        psample_port->sample_rate = READ_ONCE(g_psample_ports[port].sample_rate);
+        psample_port->sample_size = READ_ONCE(g_psample_ports[port].sample_size);
+        return psample_port->ifindex ? 0 : -1;
+    }
+
     /* look for port from list of available net_devices */
     spin_lock_irqsave(&g_bcmgenl_psample_info.lock, flags);
     list_for_each(list, &g_bcmgenl_psample_info.netif_list) {
         bcmgenl_netif = (bcmgenl_netif_t*)list;
         if (bcmgenl_netif->port == port) {
+            psample_port->ifindex = bcmgenl_netif->dev->ifindex;
+            psample_port->sample_rate = bcmgenl_netif->sample_rate;
+            psample_port->sample_size = bcmgenl_netif->sample_size;
             spin_unlock_irqrestore(&g_bcmgenl_psample_info.lock, flags);
-            return bcmgenl_netif;
+            return 0;
         }
     }
     spin_unlock_irqrestore(&g_bcmgenl_psample_info.lock, flags);
-    return (NULL);
+    return (-1);
 }
 
 static int
@@ -195,7 +272,7 @@ bcmgenl_psample_meta_get(struct sk_buff *skb, bcmgenl_pkt_t *bcmgenl_pkt, psampl
     int src_ifindex = 0, dst_ifindex = 0;
     int sample_rate = 1;
     int sample_size = PSAMPLE_SIZE_DFLT;
-    bcmgenl_netif_t *psample_netif = NULL;
+    psample_port_t psample_port;
     const struct ngknet_callback_desc *cbd;
 
     if (!skb || !sflow_meta) {
@@ -214,12 +291,12 @@ bcmgenl_psample_meta_get(struct sk_buff *skb, bcmgenl_pkt_t *bcmgenl_pkt, psampl
     }
 
     /* find src port netif */
-    if ((psample_netif = psample_netif_lookup_by_port(srcport))) {
-        src_ifindex = psample_netif->dev->ifindex;
-        sample_rate = psample_netif->sample_rate;
-        sample_size = psample_netif->sample_size;
+    if (psample_port_lookup(srcport, &psample_port) == 0) {
+        src_ifindex = psample_port.ifindex;
+        sample_rate = psample_port.sample_rate;
+        sample_size = psample_port.sample_size;
     } else {
-        g_bcmgenl_psample_stats.pkts_d_meta_srcport++;
+        PSAMPLE_STATS_INC(pkts_d_meta_srcport);
         GENL_DBG_VERB("%s: could not find psample netif for src dev %s (ifidx %d)\n",
                       __func__, cbd->net_dev->name, src_ifindex);
     }
@@ -233,19 +310,19 @@ bcmgenl_psample_meta_get(struct sk_buff *skb, bcmgenl_pkt_t *bcmgenl_pkt, psampl
 
     /* set generic dst type for MC pkts */
     if (dstport_type == DSTPORT_TYPE_MC) {
-        g_bcmgenl_psample_stats.pkts_f_dst_mc++;
+        PSAMPLE_STATS_INC(pkts_f_dst_mc);
     } else if ((dstport != 0) &&
-               (psample_netif = psample_netif_lookup_by_port(dstport))) {
+               (psample_port_lookup(dstport, &psample_port) == 0)) {
         /* find dst port netif for UC pkts (no need to lookup CPU port) */
-        dst_ifindex = psample_netif->dev->ifindex;
+        dst_ifindex = psample_port.ifindex;
     } else if (bcmgenl_pkt->meta.sample_type != SAMPLE_TYPE_NONE) {
         dst_ifindex = 0xffff;
-        g_bcmgenl_psample_stats.pkts_d_psample_only++;
+        PSAMPLE_STATS_INC(pkts_d_psample_only);
     } else if (dstport == 0) {
         dst_ifindex = 0;
-        g_bcmgenl_psample_stats.pkts_f_dst_cpu++;
+        PSAMPLE_STATS_INC(pkts_f_dst_cpu);
     } else {
-        g_bcmgenl_psample_stats.pkts_d_meta_dstport++;
+        PSAMPLE_STATS_INC(pkts_d_meta_dstport);
         GENL_DBG_VERB("%s: could not find dstport(%d)\n", __func__, dstport);
     }
     GENL_DBG_VERB
@@ -275,13 +352,13 @@ bcmgenl_psample_filter_cb(struct sk_buff *skb, ngknet_filter_t **filt)
     psample_meta_t meta;
     bcmgenl_pkt_t bcmgenl_pkt;
     bool strip_tag = false;
-    static uint32_t last_drop, last_alloc, last_skb;
+    static uint32_t last_drop;
     uint8_t *pkt;
     struct psample_group *group;
 
     if (!skb) {
         GENL_DBG_WARN("%s: skb is NULL\n", __func__);
-        g_bcmgenl_psample_stats.pkts_d_skb++;
+        PSAMPLE_STATS_INC(pkts_d_skb);
         return (NULL);
     }
     cbd = NGKNET_SKB_CB(skb);
@@ -292,7 +369,7 @@ bcmgenl_psample_filter_cb(struct sk_buff *skb, ngknet_filter_t **filt)
     if (!cbd || !match_filt) {
         GENL_DBG_WARN("%s: cbd(0x%p) or match_filt(0x%p) is NULL\n",
                       __func__, cbd, match_filt);
-        g_bcmgenl_psample_stats.pkts_d_skb_cbd++;
+        PSAMPLE_STATS_INC(pkts_d_skb_cbd);
         return (skb);
     }
 
@@ -312,11 +389,11 @@ bcmgenl_psample_filter_cb(struct sk_buff *skb, ngknet_filter_t **filt)
         ("filter user data: 0x%08x\n", *(uint32_t *)match_filt->user_data);
     GENL_DBG_VERB
         ("filter_cb for dev %d: %s\n", dev_no, cbd->dinfo->type_str);
-    g_bcmgenl_psample_stats.pkts_f_psample_cb++;
+    PSAMPLE_STATS_INC(pkts_f_psample_cb);
 
     /* Adjust original pkt_len to remove 4B FCS */
     if (pkt_len < FCS_SZ) {
-        g_bcmgenl_psample_stats.pkts_d_invalid_size++;
+        PSAMPLE_STATS_INC(pkts_d_invalid_size);
         goto PSAMPLE_FILTER_CB_PKT_HANDLED;
     } else {
        pkt_len -= FCS_SZ;
@@ -326,7 +403,7 @@ bcmgenl_psample_filter_cb(struct sk_buff *skb, ngknet_filter_t **filt)
     group = psample_group_get(g_bcmgenl_psample_info.netns, match_filt->dest_id);
     if (!group) {
         printk("%s: Could not find psample genetlink group %d\n", __func__, match_filt->dest_id);
-        g_bcmgenl_psample_stats.pkts_d_no_group++;
+        PSAMPLE_STATS_INC(pkts_d_no_group);
         goto PSAMPLE_FILTER_CB_PKT_HANDLED;
     }
     /* get packet metadata */
@@ -335,7 +412,7 @@ bcmgenl_psample_filter_cb(struct sk_buff *skb, ngknet_filter_t **filt)
                              &bcmgenl_pkt);
     if (rv < 0) {
         GENL_DBG_WARN("%s: Could not parse pkt metadata\n", __func__);
-        g_bcmgenl_psample_stats.pkts_d_metadata++;
+        PSAMPLE_STATS_INC(pkts_d_metadata);
         goto PSAMPLE_FILTER_CB_PKT_HANDLED;
     }
 
@@ -351,7 +428,7 @@ bcmgenl_psample_filter_cb(struct sk_buff *skb, ngknet_filter_t **filt)
     rv = bcmgenl_psample_meta_get(skb, &bcmgenl_pkt, &meta);
     if (rv < 0) {
         GENL_DBG_WARN("%s: Could not parse pkt metadata\n", __func__);
-        g_bcmgenl_psample_stats.pkts_d_metadata++;
+        PSAMPLE_STATS_INC(pkts_d_metadata);
         goto PSAMPLE_FILTER_CB_PKT_HANDLED;
     }
 
@@ -365,7 +442,7 @@ bcmgenl_psample_filter_cb(struct sk_buff *skb, ngknet_filter_t **filt)
            ((proto == 0x8100) || (proto == 0x88a8) || (proto == 0x9100))) {
             if (PSAMPLE_FILTER_TAG_ORIGINAL == cbd->filt->user_data[0]) {
                 if (bcmgenl_pkt.meta.tag_status < 0) {
-                    g_bcmgenl_psample_stats.pkts_f_tag_checked++;
+                    PSAMPLE_STATS_INC(pkts_f_tag_checked);
                 } else if (bcmgenl_pkt.meta.tag_status < 2){
                     strip_tag = 1;
                 }
@@ -376,7 +453,7 @@ bcmgenl_psample_filter_cb(struct sk_buff *skb, ngknet_filter_t **filt)
         if (strip_tag) {
             pkt_len -= 4;
         }
-        g_bcmgenl_psample_stats.pkts_f_tag_checked++;
+        PSAMPLE_STATS_INC(pkts_f_tag_checked);
     }
 
     /* Account for padding in libnl used by psample */
@@ -393,123 +470,137 @@ bcmgenl_psample_filter_cb(struct sk_buff *skb, ngknet_filter_t **filt)
 
     /* drop if configured sample rate is 0 */
     if (meta.sample_rate > 0) {
-        unsigned long flags;
-        psample_pkt_t *psample_pkt;
-        struct sk_buff *skb_psample;
-
-        if (g_bcmgenl_psample_stats.pkts_c_qlen_cur >= bcmgenl_psample_qlen) {
-            g_bcmgenl_psample_stats.pkts_d_qlen_max++;
-            last_drop = 0;
-            bcmgenl_limited_gprintk
-                (last_drop, "%s: tail drop due to max qlen %d reached: %lu\n",
-                 __func__, bcmgenl_psample_qlen,
-                 g_bcmgenl_psample_stats.pkts_d_qlen_max);
-            goto PSAMPLE_FILTER_CB_PKT_HANDLED;
-        }
-
-        if ((psample_pkt = kmalloc(sizeof(psample_pkt_t), GFP_ATOMIC)) == NULL) {
-            g_bcmgenl_psample_stats.pkts_d_no_mem++;
-            last_alloc = 0;
-            bcmgenl_limited_gprintk
-                (last_alloc, "%s: failed to alloc generic mem for pkt: %lu\n",
-                 __func__, g_bcmgenl_psample_stats.pkts_d_no_mem);
-            goto PSAMPLE_FILTER_CB_PKT_HANDLED;
+        psample_ring_t *ring;
+        psample_slot_t *slot;
+        uint8_t *data;
+        unsigned int head, tail, qlen, idx;
+
+        /* samples are kept in slots of psample_size bytes */
+        if (meta.trunc_size > psample_size) {
+            meta.trunc_size = psample_size;
         }
 
-        /* psample_pkt start */
-        memcpy(&psample_pkt->meta, &meta, sizeof(psample_meta_t));
-        psample_pkt->group = group;
-        if ((skb_psample = dev_alloc_skb(meta.trunc_size)) == NULL) {
-            g_bcmgenl_psample_stats.pkts_d_no_mem++;
-            last_skb = 0;
+        /*
+         * Called from the Rx softirq only, so the ring of this CPU has a
+         * single producer. The tail is moved by the work.
+         */
+        ring = this_cpu_ptr(g_bcmgenl_psample_work.rings);
+        head = ring->head;
+        tail = smp_load_acquire(&ring->tail);
+        qlen = head - tail;
+        if (qlen >= g_bcmgenl_psample_work.ring_size) {
+            PSAMPLE_STATS_INC(pkts_d_qlen_max);
             bcmgenl_limited_gprintk
-                (last_skb, "%s: failed to alloc generic mem for pkt skb: %lu\n",
-                 __func__, g_bcmgenl_psample_stats.pkts_d_no_mem);
+                (last_drop, "%s: tail drop due to max qlen %u reached on cpu %d\n",
+                 __func__, g_bcmgenl_psample_work.ring_size, smp_processor_id());
             goto PSAMPLE_FILTER_CB_PKT_HANDLED;
         }
 
-        /* setup skb to point to pkt */
+        /* psample slot start */
+        idx = head & (g_bcmgenl_psample_work.ring_size - 1);
+        slot = &ring->slots[idx];
+        data = ring->data + idx * psample_size;
+        memcpy(&slot->meta, &meta, sizeof(psample_meta_t));
+        slot->group = group;
         if (strip_tag) {
-            memcpy(skb_psample->data, pkt, 12);
-            memcpy(skb_psample->data + 12, pkt + 16, meta.trunc_size - 12);
-            g_bcmgenl_psample_stats.pkts_f_tag_stripped++;
+            memcpy(data, pkt, 12);
+            memcpy(data + 12, pkt + 16, meta.trunc_size - 12);
+            PSAMPLE_STATS_INC(pkts_f_tag_stripped);
         } else {
-            memcpy(skb_psample->data, pkt, meta.trunc_size);
+            memcpy(data, pkt, meta.trunc_size);
         }
-        skb_put(skb_psample, meta.trunc_size);
-        /* save original size for PSAMPLE_ATTR_ORIGSIZE in skb->len */
-        skb_psample->len = pkt_len;
-        psample_pkt->skb = skb_psample;
-        if (debug & GENL_DBG_LVL_PDMP) {
-            dump_skb(skb_psample);
-        }
-        /* psample_pkt end */
-
-        spin_lock_irqsave(&g_bcmgenl_psample_work.lock, flags);
-        list_add_tail(&psample_pkt->list, &g_bcmgenl_psample_work.pkt_list);
+        /* save original size for PSAMPLE_ATTR_ORIGSIZE */
+        slot->pkt_len = pkt_len;
+        /* psample slot end */
 
-        g_bcmgenl_psample_stats.pkts_c_qlen_cur++;
-        if (g_bcmgenl_psample_stats.pkts_c_qlen_cur > g_bcmgenl_psample_stats.pkts_c_qlen_hi) {
-            g_bcmgenl_psample_stats.pkts_c_qlen_hi = g_bcmgenl_psample_stats.pkts_c_qlen_cur;
+        smp_store_release(&ring->head, head + 1);
+        if (qlen + 1 > __this_cpu_read(g_bcmgenl_psample_stats.pkts_c_qlen_hi)) {
+            __this_cpu_write(g_bcmgenl_psample_stats.pkts_c_qlen_hi, qlen + 1);
         }
 
         schedule_work(&g_bcmgenl_psample_work.wq);
-        spin_unlock_irqrestore(&g_bcmgenl_psample_work.lock, flags);
     } else {
-        g_bcmgenl_psample_stats.pkts_d_sampling_disabled++;
+        PSAMPLE_STATS_INC(pkts_d_sampling_disabled);
     }
 
 PSAMPLE_FILTER_CB_PKT_HANDLED:
     if (bcmgenl_pkt.meta.sample_type != SAMPLE_TYPE_NONE) {
-        g_bcmgenl_psample_stats.pkts_f_handled++;
+        PSAMPLE_STATS_INC(pkts_f_handled);
         /* Not sending to network protocol stack */
         skb = NULL;
     } else {
-        g_bcmgenl_psample_stats.pkts_f_pass_through++;
+        PSAMPLE_STATS_INC(pkts_f_pass_through);
     }
     return skb;
 }
 
+/*
+ * Deliver up to bcmgenl_psample_budget samples from the ring of each CPU.
+ * The work is scheduled again if any ring is left with samples, so that
+ * the samples of one CPU can not hold the work of the system queue.
+ */
 static void
 bcmgenl_psample_task(struct work_struct *work)
 {
     bcmgenl_psample_work_t *psample_work =
         container_of(work, bcmgenl_psample_work_t, wq);
-    unsigned long flags;
-    struct list_head *list_ptr, *list_next;
-    psample_pkt_t *pkt;
-
-    spin_lock_irqsave(&psample_work->lock, flags);
-    list_for_each_safe(list_ptr, list_next, &psample_work->pkt_list) {
-        /* dequeue pkt from list */
-        pkt = list_entry(list_ptr, psample_pkt_t, list);
-        list_del(list_ptr);
-        g_bcmgenl_psample_stats.pkts_c_qlen_cur--;
-        spin_unlock_irqrestore(&psample_work->lock, flags);
-
-        /* send generic_pkt to generic netlink */
-        if (pkt) {
+    unsigned int mask = psample_work->ring_size - 1;
+    struct sk_buff *skb = psample_work->skb;
+    psample_ring_t *ring;
+    psample_slot_t *slot;
+    unsigned int head, tail, done;
+    bool pending = false;
+    int cpu;
+
+    for_each_possible_cpu(cpu) {
+        ring = per_cpu_ptr(psample_work->rings, cpu);
+        head = smp_load_acquire(&ring->head);
+        tail = ring->tail;
+
+        for (done = 0; tail != head && done < bcmgenl_psample_budget; done++) {
+            slot = &ring->slots[tail & mask];
+
+            /* reuse the skb for each sample, psample takes a copy */
+            skb->data = skb->head + psample_work->skb_headroom;
+            skb->len = 0;
+            skb_reset_tail_pointer(skb);
+            memcpy(skb_put(skb, slot->meta.trunc_size),
+                   ring->data + (tail & mask) * psample_size,
+                   slot->meta.trunc_size);
+            if (debug & GENL_DBG_LVL_PDMP) {
+                dump_skb(skb);
+            }
+            /* save original size for PSAMPLE_ATTR_ORIGSIZE in skb->len */
+            skb->len = slot->pkt_len;
+
             GENL_DBG_VERB
                 ("%s: trunc_size %d, sample_rate %d,"
                  "src_ifindex %d, dst_ifindex %d\n",
-                 __func__, pkt->meta.trunc_size, pkt->meta.sample_rate,
-                 pkt->meta.src_ifindex, pkt->meta.dst_ifindex);
+                 __func__, slot->meta.trunc_size, slot->meta.sample_rate,
+                 slot->meta.src_ifindex, slot->meta.dst_ifindex);
             GENL_DBG_VERB
-                ("%s: group 0x%x\n", __func__, pkt->group->group_num);
-            bcmgenl_sample_packet(pkt->group,
-                                  pkt->skb,
-                                  pkt->meta.trunc_size,
-                                  pkt->meta.src_ifindex,
-                                  pkt->meta.dst_ifindex,
-                                  pkt->meta.sample_rate);
-            g_bcmgenl_psample_stats.pkts_f_psample_mod++;
-
-            dev_kfree_skb_any(pkt->skb);
-            kfree(pkt);
+                ("%s: group 0x%x\n", __func__, slot->group->group_num);
+            bcmgenl_sample_packet(slot->group,
+                                  skb,
+                                  slot->meta.trunc_size,
+                                  slot->meta.src_ifindex,
+                                  slot->meta.dst_ifindex,
+                                  slot->meta.sample_rate);
+            PSAMPLE_STATS_INC(pkts_f_psample_mod);
+            tail++;
+        }
+
+        /* release the slots to the producer */
+        smp_store_release(&ring->tail, tail);
+        if (tail != head) {
+            pending = true;
         }
-        spin_lock_irqsave(&psample_work->lock, flags);
+        cond_resched();
+    }
+
+    if (pending) {
+        schedule_work(&psample_work->wq);
     }
-    spin_unlock_irqrestore(&psample_work->lock, flags);
 }
 
 static int
@@ -560,6 +651,7 @@ bcmgenl_psample_netif_create_cb(ngknet_dev_info_t *dinfo, ngknet_netif_t *netif)
         list_add_tail(&new_netif->list, &g_bcmgenl_psample_info.netif_list);
     }
     g_bcmgenl_psample_info.netif_count++;
+    psample_port_sync(new_netif->port);
     spin_unlock_irqrestore(&g_bcmgenl_psample_info.lock, flags);
 
     GENL_DBG_VERB
@@ -590,6 +682,7 @@ bcmgenl_psample_netif_destroy_cb(ngknet_dev_info_t *dinfo, ngknet_netif_t *netif
         if (netif->id == lbcmgenl_netif->id) {
             found = true;
             list_del(&lbcmgenl_netif->list);
+            psample_port_sync(lbcmgenl_netif->port);
             GENL_DBG_VERB
                 ("%s: removing psample netif '%s'\n", __func__, netif->name);
             kfree(lbcmgenl_netif);
@@ -687,6 +780,7 @@ bcmgenl_psample_proc_rate_write(
         psample_netif = (bcmgenl_netif_t*)list;
         if (strcmp(psample_netif->dev->name, sample_str) == 0) {
             psample_netif->sample_rate = simple_strtol(ptr, NULL, 10);
+            psample_port_sync(psample_netif->port);
             found = true;
             break;
         }
@@ -758,6 +852,7 @@ bcmgenl_psample_proc_size_write(
     bcmgenl_netif_t *bcmgenl_netif;
     char sample_str[40], *ptr, *newline;
     unsigned long flags;
+    int size;
 
     if (count > sizeof(sample_str)) {
         count = sizeof(sample_str) - 1;
@@ -780,13 +875,21 @@ bcmgenl_psample_proc_size_write(
     }
     *ptr++ = 0;
 
+    size = simple_strtol(ptr, NULL, 10);
+    if (size < 0 || size > psample_size) {
+        printk("Error: Pkt sample size %d is not within psample_size %d\n",
+               size, psample_size);
+        return count;
+    }
+
     spin_lock_irqsave(&g_bcmgenl_psample_info.lock, flags);
 
     found = false;
     list_for_each(list, &g_bcmgenl_psample_info.netif_list) {
         bcmgenl_netif = (bcmgenl_netif_t*)list;
         if (strcmp(bcmgenl_netif->dev->name, sample_str) == 0) {
-            bcmgenl_netif->sample_size = simple_strtol(ptr, NULL, 10);
+            bcmgenl_netif->sample_size = size;
+            psample_port_sync(bcmgenl_netif->port);
             found = true;
             break;
         }
@@ -859,7 +962,9 @@ bcmgenl_psample_proc_debug_show(struct seq_file *m, void *v)
     seq_printf(m, "BCM KNET %s Callback Config\n", BCMGENL_PSAMPLE_NAME);
     seq_printf(m, "  debug:           0x%x\n", debug);
     seq_printf(m, "  netif_count:     %d\n",   g_bcmgenl_psample_info.netif_count);
-    seq_printf(m, "  queue length:    %d\n",   bcmgenl_psample_qlen);
+    seq_printf(m, "  queue length:    %u per cpu\n", g_bcmgenl_psample_work.ring_size);
+    seq_printf(m, "  queue budget:    %d\n",   bcmgenl_psample_budget);
+    seq_printf(m, "  sample size:     %d\n",   psample_size);
 
     return 0;
 }
@@ -916,31 +1021,61 @@ struct proc_ops bcmgenl_psample_proc_debug_file_ops = {
     .proc_release =    single_release,
 };
 
+/* Sum up the counters of all CPUs */
+static void
+psample_stats_get(bcmgenl_psample_stats_t *stats)
+{
+    bcmgenl_psample_stats_t *cpu_stats;
+    unsigned long *sum = (unsigned long *)stats;
+    unsigned long *val, qlen_hi = 0;
+    psample_ring_t *ring;
+    int cpu, idx;
+
+    memset(stats, 0, sizeof(*stats));
+    for_each_possible_cpu(cpu) {
+        cpu_stats = per_cpu_ptr(&g_bcmgenl_psample_stats, cpu);
+        val = (unsigned long *)cpu_stats;
+        for (idx = 0; idx < sizeof(*stats) / sizeof(unsigned long); idx++) {
+            sum[idx] += READ_ONCE(val[idx]);
+        }
+        qlen_hi = max(qlen_hi, READ_ONCE(cpu_stats->pkts_c_qlen_hi));
+        if (g_bcmgenl_psample_work.rings) {
+            ring = per_cpu_ptr(g_bcmgenl_psample_work.rings, cpu);
+            stats->pkts_c_qlen_cur += READ_ONCE(ring->head) - READ_ONCE(ring->tail);
+        }
+    }
+    /* the high queue length is the highest of all rings */
+    stats->pkts_c_qlen_hi = qlen_hi;
+}
+
 static int
 bcmgenl_psample_proc_stats_show(struct seq_file *m, void *v)
 {
+    bcmgenl_psample_stats_t stats;
+
+    psample_stats_get(&stats);
+
     seq_printf(m, "BCM KNET %s Callback Stats\n", BCMGENL_PSAMPLE_NAME);
-    seq_printf(m, "  pkts filter psample cb         %10lu\n", g_bcmgenl_psample_stats.pkts_f_psample_cb);
-    seq_printf(m, "  pkts sent to psample module    %10lu\n", g_bcmgenl_psample_stats.pkts_f_psample_mod);
-    seq_printf(m, "  pkts handled by psample        %10lu\n", g_bcmgenl_psample_stats.pkts_f_handled);
-    seq_printf(m, "  pkts pass through              %10lu\n", g_bcmgenl_psample_stats.pkts_f_pass_through);
-    seq_printf(m, "  pkts with vlan tag checked     %10lu\n", g_bcmgenl_psample_stats.pkts_f_tag_checked);
-    seq_printf(m, "  pkts with vlan tag stripped    %10lu\n", g_bcmgenl_psample_stats.pkts_f_tag_stripped);
-    seq_printf(m, "  pkts with mc destination       %10lu\n", g_bcmgenl_psample_stats.pkts_f_dst_mc);
-    seq_printf(m, "  pkts current queue length      %10lu\n", g_bcmgenl_psample_stats.pkts_c_qlen_cur);
-    seq_printf(m, "  pkts high queue length         %10lu\n", g_bcmgenl_psample_stats.pkts_c_qlen_hi);
-    seq_printf(m, "  pkts drop max queue length     %10lu\n", g_bcmgenl_psample_stats.pkts_d_qlen_max);
-    seq_printf(m, "  pkts drop no memory            %10lu\n", g_bcmgenl_psample_stats.pkts_d_no_mem);
-    seq_printf(m, "  pkts drop no psample group     %10lu\n", g_bcmgenl_psample_stats.pkts_d_no_group);
-    seq_printf(m, "  pkts drop sampling disabled    %10lu\n", g_bcmgenl_psample_stats.pkts_d_sampling_disabled);
-    seq_printf(m, "  pkts drop psample not ready    %10lu\n", g_bcmgenl_psample_stats.pkts_d_not_ready);
-    seq_printf(m, "  pkts drop metadata parse error %10lu\n", g_bcmgenl_psample_stats.pkts_d_metadata);
-    seq_printf(m, "  pkts drop skb error            %10lu\n", g_bcmgenl_psample_stats.pkts_d_skb);
-    seq_printf(m, "  pkts drop skb cbd error        %10lu\n", g_bcmgenl_psample_stats.pkts_d_skb_cbd);
-    seq_printf(m, "  pkts with invalid src port     %10lu\n", g_bcmgenl_psample_stats.pkts_d_meta_srcport);
-    seq_printf(m, "  pkts with invalid dst port     %10lu\n", g_bcmgenl_psample_stats.pkts_d_meta_dstport);
-    seq_printf(m, "  pkts with invalid orig pkt sz  %10lu\n", g_bcmgenl_psample_stats.pkts_d_invalid_size);
-    seq_printf(m, "  pkts with psample only reason  %10lu\n", g_bcmgenl_psample_stats.pkts_d_psample_only);
+    seq_printf(m, "  pkts filter psample cb         %10lu\n", stats.pkts_f_psample_cb);
+    seq_printf(m, "  pkts sent to psample module    %10lu\n", stats.pkts_f_psample_mod);
+    seq_printf(m, "  pkts handled by psample        %10lu\n", stats.pkts_f_handled);
+    seq_printf(m, "  pkts pass through              %10lu\n", stats.pkts_f_pass_through);
+    seq_printf(m, "  pkts with vlan tag checked     %10lu\n", stats.pkts_f_tag_checked);
+    seq_printf(m, "  pkts with vlan tag stripped    %10lu\n", stats.pkts_f_tag_stripped);
+    seq_printf(m, "  pkts with mc destination       %10lu\n", stats.pkts_f_dst_mc);
+    seq_printf(m, "  pkts current queue length      %10lu\n", stats.pkts_c_qlen_cur);
+    seq_printf(m, "  pkts high queue length         %10lu\n", stats.pkts_c_qlen_hi);
+    seq_printf(m, "  pkts drop max queue length     %10lu\n", stats.pkts_d_qlen_max);
+    seq_printf(m, "  pkts drop no psample group     %10lu\n", stats.pkts_d_no_group);
+    seq_printf(m, "  pkts drop sampling disabled    %10lu\n", stats.pkts_d_sampling_disabled);
+    seq_printf(m, "  pkts drop psample not ready    %10lu\n", stats.pkts_d_not_ready);
+    seq_printf(m, "  pkts drop metadata parse error %10lu\n", stats.pkts_d_metadata);
+    seq_printf(m, "  pkts drop skb error            %10lu\n", stats.pkts_d_skb);
+    seq_printf(m, "  pkts drop skb cbd error        %10lu\n", stats.pkts_d_skb_cbd);
+    seq_printf(m, "  pkts with invalid src port     %10lu\n", stats.pkts_d_meta_srcport);
+    seq_printf(m, "  pkts with invalid dst port     %10lu\n", stats.pkts_d_meta_dstport);
+    seq_printf(m, "  pkts with invalid orig pkt sz  %10lu\n", stats.pkts_d_invalid_size);
+    seq_printf(m, "  pkts with psample only reason  %10lu\n", stats.pkts_d_psample_only);
     return 0;
 }
 
@@ -960,14 +1095,13 @@ static ssize_t
 bcmgenl_psample_proc_stats_write(struct file *file, const char *buf,
                     size_t count, loff_t *loff)
 {
-    int qlen_cur = 0;
-    unsigned long flags;
+    int cpu;
 
-    spin_lock_irqsave(&g_bcmgenl_psample_work.lock, flags);
-    qlen_cur = g_bcmgenl_psample_stats.pkts_c_qlen_cur;
-    memset(&g_bcmgenl_psample_stats, 0, sizeof(bcmgenl_psample_stats_t));
-    g_bcmgenl_psample_stats.pkts_c_qlen_cur = qlen_cur;
-    spin_unlock_irqrestore(&g_bcmgenl_psample_work.lock, flags);
+    /* the current queue length is taken from the rings */
+    for_each_possible_cpu(cpu) {
+        memset(per_cpu_ptr(&g_bcmgenl_psample_stats, cpu), 0,
+               sizeof(bcmgenl_psample_stats_t));
+    }
 
     return count;
 }
@@ -1051,19 +1185,62 @@ psample_cb_proc_init(void)
     return 0;
 }
 
+static void
+psample_rings_free(void)
+{
+    psample_ring_t *ring;
+    int cpu;
+
+    if (!g_bcmgenl_psample_work.rings) {
+        return;
+    }
+    for_each_possible_cpu(cpu) {
+        ring = per_cpu_ptr(g_bcmgenl_psample_work.rings, cpu);
+        vfree(ring->slots);
+        vfree(ring->data);
+    }
+    free_percpu(g_bcmgenl_psample_work.rings);
+    g_bcmgenl_psample_work.rings = NULL;
+}
+
 static int
-psample_cb_cleanup(void)
+psample_rings_alloc(void)
 {
-    psample_pkt_t *pkt;
+    psample_ring_t *ring;
+    unsigned int size = g_bcmgenl_psample_work.ring_size;
+    int cpu;
 
+    g_bcmgenl_psample_work.rings = alloc_percpu(psample_ring_t);
+    if (!g_bcmgenl_psample_work.rings) {
+        return (-1);
+    }
+    for_each_possible_cpu(cpu) {
+        ring = per_cpu_ptr(g_bcmgenl_psample_work.rings, cpu);
+        ring->slots = vzalloc_node(size * sizeof(psample_slot_t), cpu_to_node(cpu));
+        ring->data = vmalloc_node(size * psample_size, cpu_to_node(cpu));
+        if (!ring->slots || !ring->data) {
+            psample_rings_free();
+            return (-1);
+        }
+    }
+    return 0;
+}
+
+static int
+psample_cb_cleanup(void)
+{
+    /*
+     * Wait for filter callbacks still running on Rx CPUs, which fill the
+     * rings and schedule the work, before the work and rings go away.
+     */
+    synchronize_net();
     cancel_work_sync(&g_bcmgenl_psample_work.wq);
 
-    while (!list_empty(&g_bcmgenl_psample_work.pkt_list)) {
-        pkt = list_entry(g_bcmgenl_psample_work.pkt_list.next,
-                         psample_pkt_t, list);
-        list_del(&pkt->list);
-        dev_kfree_skb_any(pkt->skb);
-        kfree(pkt);
+    /* samples left in the rings are dropped */
+    psample_rings_free();
+    if (g_bcmgenl_psample_work.skb) {
+        dev_kfree_skb_any(g_bcmgenl_psample_work.skb);
+        g_bcmgenl_psample_work.skb = NULL;
     }
 
     return 0;
@@ -1072,18 +1249,44 @@ psample_cb_cleanup(void)
 static int
 psample_cb_init(void)
 {
+    int cpu;
+
     /* clear data structs */
-    memset(&g_bcmgenl_psample_stats, 0, sizeof(bcmgenl_psample_stats_t));
+    for_each_possible_cpu(cpu) {
+        memset(per_cpu_ptr(&g_bcmgenl_psample_stats, cpu), 0,
+               sizeof(bcmgenl_psample_stats_t));
+    }
     memset(&g_bcmgenl_psample_info, 0, sizeof(bcmgenl_info_t));
     memset(&g_bcmgenl_psample_work, 0, sizeof(bcmgenl_psample_work_t));
+    memset(g_psample_ports, 0, sizeof(g_psample_ports));
 
     /* setup psample_info struct */
     INIT_LIST_HEAD(&g_bcmgenl_psample_info.netif_list);
     spin_lock_init(&g_bcmgenl_psample_info.lock);
 
     /* setup psample work queue */
-    spin_lock_init(&g_bcmgenl_psample_work.lock);
-    INIT_LIST_HEAD(&g_bcmgenl_psample_work.pkt_list);
+    if (psample_size <= 0) {
+        psample_size = PSAMPLE_SIZE_DFLT;
+    }
+    if (bcmgenl_psample_qlen <= 0) {
+        bcmgenl_psample_qlen = BCMGENL_PSAMPLE_QLEN_DFLT;
+    }
+    if (bcmgenl_psample_budget <= 0) {
+        bcmgenl_psample_budget = BCMGENL_PSAMPLE_BUDGET_DFLT;
+    }
+    g_bcmgenl_psample_work.ring_size = roundup_pow_of_two(bcmgenl_psample_qlen);
+    if (psample_rings_alloc() < 0) {
+        printk("%s: failed to alloc psample rings of %u samples\n",
+               __func__, g_bcmgenl_psample_work.ring_size);
+        return (-1);
+    }
+    g_bcmgenl_psample_work.skb = dev_alloc_skb(psample_size);
+    if (!g_bcmgenl_psample_work.skb) {
+        printk("%s: failed to alloc psample skb\n", __func__);
+        psample_rings_free();
+        return (-1);
+    }
+    g_bcmgenl_psample_work.skb_headroom = skb_headroom(g_bcmgenl_psample_work.skb);
     INIT_WORK(&g_bcmgenl_psample_work.wq, bcmgenl_psample_task);
 
     /* get net namespace */
@@ -1091,11 +1294,13 @@ psample_cb_init(void)
     if (!g_bcmgenl_psample_info.netns) {
         GENL_DBG_WARN("%s: Could not get network namespace for pid %d\n",
                       __func__, current->pid);
+        psample_cb_cleanup();
         return (-1);
     }
     GENL_DBG_VERB
-        ("%s: current->pid %d, netns 0x%p, sample_size %d\n",
-         __func__, current->pid, g_bcmgenl_psample_info.netns, psample_size);
+        ("%s: current->pid %d, netns 0x%p, sample_size %d, ring_size %u\n",
+         __func__, current->pid, g_bcmgenl_psample_info.netns, psample_size,
+         g_bcmgenl_psample_work.ring_size);
     return 0;
 }
 
@@ -1112,12 +1317,16 @@ int bcmgenl_psample_cleanup(void)
 
 int bcmgenl_psample_init(void)
 {
+    /* rings are set up before samples may come in */
+    if (psample_cb_init() < 0) {
+        return (-1);
+    }
     ngknet_netif_create_cb_register(bcmgenl_psample_netif_create_cb);
     ngknet_netif_destroy_cb_register(bcmgenl_psample_netif_destroy_cb);
     ngknet_filter_cb_register_by_name
         (bcmgenl_psample_filter_cb, BCMGENL_PSAMPLE_NAME);
     psample_cb_proc_init();
-    return psample_cb_init();
+    return 0;
 }
 #else
 int bcmgenl_psample_cleanup(void)
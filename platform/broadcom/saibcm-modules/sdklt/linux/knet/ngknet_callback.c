@@ -394,6 +394,10 @@ ngknet_filter_cb_unregister(ngknet_filter_cb_f filter_cb)
     if (!found || filter_cb == callback_ctrl.filter_cb) {
         callback_ctrl.filter_cb = NULL;
     }
+
+    /* Rx filtering calls back w/o the device lock, wait for it to finish */
+    synchronize_rcu();
+
     return 0;
 }
 
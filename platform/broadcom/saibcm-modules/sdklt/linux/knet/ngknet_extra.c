@@ -43,6 +43,10 @@
 #include <linux/delay.h>
 #include <linux/bitops.h>
 #include <linux/time.h>
+#include <linux/jhash.h>
+#include <linux/log2.h>
+#include <linux/percpu.h>
+#include <linux/rcupdate.h>
 
 #include <lkm/ngknet_dev.h>
 #include <lkm/ngknet_kapi.h>
@@ -52,15 +56,281 @@
 #include "ngknet_callback.h"
 #include "ngknet_ptp.h"
 
-/*! Defalut Rx tick for Rx rate limit control. */
-#define NGKNET_EXTRA_RATE_LIMIT_DEFAULT_RX_TICK 10
+/*! Default burst of Rx rate limit, in milliseconds at the rate. */
+#define NGKNET_EXTRA_RATE_LIMIT_DEFAULT_BURST_MS 100
 
-static struct ngknet_rl_ctrl rl_ctrl;
+static struct ngknet_rl_ctrl rl_ctrl[NUM_PDMA_DEV_MAX];
+
+/*!
+ * Configure token bucket. The bucket starts full.
+ *
+ * The lock only serializes configurations, packets take tokens w/o it.
+ */
+static void
+ngknet_rl_bucket_config(struct ngknet_rl_bucket *rb, uint32_t rate, uint32_t burst)
+{
+    unsigned long flags;
+
+    spin_lock_irqsave(&rb->lock, flags);
+    if (rate) {
+        if (!burst) {
+            burst = rate / (1000 / NGKNET_EXTRA_RATE_LIMIT_DEFAULT_BURST_MS);
+        }
+        /* Leave room for every priority */
+        burst = max_t(uint32_t, burst, NGKNET_RL_PRIO_MAX);
+        WRITE_ONCE(rb->cost, max_t(uint64_t, NSEC_PER_SEC / rate, 1));
+        WRITE_ONCE(rb->depth, rb->cost * burst);
+        atomic64_set(&rb->tat, kal_time_nsecs());
+    } else {
+        burst = 0;
+    }
+    rb->burst = burst;
+    smp_wmb();
+    WRITE_ONCE(rb->rate, rate);
+    spin_unlock_irqrestore(&rb->lock, flags);
+}
+
+/*!
+ * Take the cost of one packet from token bucket.
+ * Credit reserved for higher priorities than prio is left alone.
+ *
+ * The bucket is kept as the theoretical arrival time (TAT) of the next
+ * packet: the credit is the depth less the time TAT is ahead of now. Taking
+ * the cost moves TAT forward by a compare-and-swap, so Rx queues serviced
+ * on different CPUs do not serialize on the bucket.
+ */
+static bool
+ngknet_rl_bucket_take(struct ngknet_rl_bucket *rb, uint32_t prio, uint64_t now)
+{
+    uint64_t cost, limit, tat, next;
+    int64_t old, cur;
+
+    if (!READ_ONCE(rb->rate)) {
+        return true;
+    }
+    smp_rmb();
+    cost = READ_ONCE(rb->cost);
+    limit = READ_ONCE(rb->depth);
+    if (prio < NGKNET_RL_PRIO_MAX - 1) {
+        limit -= div_u64(limit, NGKNET_RL_PRIO_MAX) *
+                 (NGKNET_RL_PRIO_MAX - 1 - prio);
+    }
+
+    old = atomic64_read(&rb->tat);
+    while (1) {
+        tat = max_t(uint64_t, (uint64_t)old, now);
+        next = tat + cost;
+        if (next - now > limit) {
+            return false;
+        }
+        cur = atomic64_cmpxchg(&rb->tat, old, next);
+        if (cur == old) {
+            break;
+        }
+        old = cur;
+    }
+
+    return true;
+}
+
+/*!
+ * Give back the cost of one packet taken from token bucket.
+ */
+static inline void
+ngknet_rl_bucket_refund(struct ngknet_rl_bucket *rb)
+{
+    if (READ_ONCE(rb->rate)) {
+        atomic64_sub(READ_ONCE(rb->cost), &rb->tat);
+    }
+}
+
+/*!
+ * Charge packet to the bucket of the filter.
+ */
+static inline bool
+ngknet_filter_rate_limit(struct filt_ctrl *fc)
+{
+    if (!READ_ONCE(fc->rl.rate)) {
+        return true;
+    }
+
+    if (ngknet_rl_bucket_take(&fc->rl, NGKNET_RL_PRIO_MAX - 1,
+                              kal_time_nsecs())) {
+        this_cpu_inc(fc->rl_stats->passed);
+        return true;
+    }
+    this_cpu_inc(fc->rl_stats->dropped);
+
+    return false;
+}
+
+/*! Max entries of a filter group to be walked instead of hashed. */
+#define NGKNET_FILT_GROUP_WALK_MAX 4
+
+/*! Number of hash buckets of compiled filter table. */
+#define NGKNET_FILT_TBL_BUCKETS roundup_pow_of_two(NUM_FILTER_MAX * 2)
+
+static struct filt_tbl *
+ngknet_filter_tbl_alloc(void)
+{
+    struct filt_tbl *tbl;
+
+    tbl = kzalloc(sizeof(*tbl) +
+                  NGKNET_FILT_TBL_BUCKETS * sizeof(struct filt_entry *),
+                  GFP_KERNEL);
+    if (tbl) {
+        tbl->bucket_mask = NGKNET_FILT_TBL_BUCKETS - 1;
+    }
+
+    return tbl;
+}
+
+static inline uint32_t
+ngknet_filter_tbl_hash(struct filt_tbl *tbl, const uint32_t *data,
+                       int wsize, int group)
+{
+    return jhash2(data, wsize, group) & tbl->bucket_mask;
+}
+
+/*!
+ * Compile the filter list into the table.
+ * Called with dev->lock held.
+ */
+static void
+ngknet_filter_tbl_fill(struct ngknet_dev *dev, struct filt_tbl *tbl)
+{
+    struct filt_ctrl *fc = NULL;
+    struct list_head *list = NULL;
+    struct filt_entry *ent = NULL;
+    struct filt_group *grp = NULL;
+    ngknet_filter_t *filt = NULL;
+    uint32_t hash;
+    int wsize, gi, idx;
+
+    list_for_each(list, &dev->filt_list) {
+        fc = (struct filt_ctrl *)list;
+        filt = &fc->filt;
+        ent = &tbl->entries[tbl->num_entries];
+        ent->fc = fc;
+        ent->rank = tbl->num_entries++;
+        ent->group = -1;
+        if (filt->flags & NGKNET_FILTER_F_ANY_DATA) {
+            if (!tbl->any) {
+                tbl->any = ent;
+            }
+            continue;
+        }
+
+        wsize = NGKNET_BYTES2WORDS(filt->oob_data_size + filt->pkt_data_size);
+        for (gi = 0; gi < tbl->num_groups; gi++) {
+            grp = &tbl->groups[gi];
+            if (grp->oob_data_offset == filt->oob_data_offset &&
+                grp->oob_data_size == filt->oob_data_size &&
+                grp->pkt_data_offset == filt->pkt_data_offset &&
+                grp->pkt_data_size == filt->pkt_data_size &&
+                !memcmp(grp->mask, filt->mask.w, wsize * sizeof(uint32_t))) {
+                break;
+            }
+        }
+        if (gi == tbl->num_groups) {
+            grp = &tbl->groups[tbl->num_groups++];
+            grp->min_rank = ent->rank;
+            grp->oob_data_offset = filt->oob_data_offset;
+            grp->oob_data_size = filt->oob_data_size;
+            grp->pkt_data_offset = filt->pkt_data_offset;
+            grp->pkt_data_size = filt->pkt_data_size;
+            grp->wsize = wsize;
+            grp->mask = filt->mask.w;
+        }
+        ent->group = gi;
+        grp->num_entries++;
+    }
+
+    /* Chain from the highest rank, so that chains are in rank order */
+    for (idx = tbl->num_entries - 1; idx >= 0; idx--) {
+        ent = &tbl->entries[idx];
+        if (ent->group < 0) {
+            continue;
+        }
+        grp = &tbl->groups[ent->group];
+        if (grp->num_entries <= NGKNET_FILT_GROUP_WALK_MAX) {
+            ent->gnext = grp->head;
+            grp->head = ent;
+            continue;
+        }
+        hash = ngknet_filter_tbl_hash(tbl, ent->fc->filt.data.w,
+                                      tbl->groups[ent->group].wsize, ent->group);
+        ent->next = tbl->buckets[hash];
+        tbl->buckets[hash] = ent;
+    }
+}
+
+/*!
+ * Publish table compiled from the filter list.
+ * Called with dev->lock held. Old table is returned to be freed
+ * once readers are done.
+ */
+static struct filt_tbl *
+ngknet_filter_tbl_publish(struct ngknet_dev *dev, struct filt_tbl *tbl)
+{
+    struct filt_tbl *old;
+
+    if (tbl) {
+        ngknet_filter_tbl_fill(dev, tbl);
+    }
+    old = rcu_dereference_protected(dev->filt_tbl, lockdep_is_held(&dev->lock));
+    rcu_assign_pointer(dev->filt_tbl, tbl);
+
+    return old;
+}
+
+static void
+ngknet_filter_tbl_free_rcu(struct rcu_head *rcu)
+{
+    kfree(container_of(rcu, struct filt_tbl, rcu));
+}
+
+static void
+ngknet_filter_free(struct filt_ctrl *fc)
+{
+    free_percpu(fc->rl_stats);
+    free_percpu(fc->hits);
+    kfree(fc);
+}
+
+/*!
+ * Unlink filter from device.
+ * Called with dev->lock held.
+ */
+static struct filt_ctrl *
+ngknet_filter_unlink(struct ngknet_dev *dev, int id)
+{
+    struct filt_ctrl *fc = (struct filt_ctrl *)dev->fc[id];
+    int num;
+
+    if (!fc) {
+        return NULL;
+    }
+
+    list_del(&fc->list);
+
+    dev->fc[id] = NULL;
+    num = (long)dev->fc[0];
+    while (num-- == id--) {
+        if (dev->fc[id]) {
+            dev->fc[0] = (void *)(long)num;
+            break;
+        }
+    }
+
+    return fc;
+}
 
 int
 ngknet_filter_create(struct ngknet_dev *dev, ngknet_filter_t *filter)
 {
     struct filt_ctrl *fc = NULL;
+    struct filt_tbl *tbl = NULL, *old = NULL;
     struct list_head *list = NULL;
     ngknet_filter_t *filt = NULL;
     filter_cb_t *filter_cb;
@@ -84,10 +354,23 @@ ngknet_filter_create(struct ngknet_dev *dev, ngknet_filter_t *filter)
         return SHR_E_UNAVAIL;
     }
 
+    if (filter->oob_data_size + filter->pkt_data_size > NGKNET_FILTER_BYTES_MAX) {
+        return SHR_E_PARAM;
+    }
+
     fc = kzalloc(sizeof(*fc), GFP_KERNEL);
     if (!fc) {
         return SHR_E_MEMORY;
     }
+    fc->hits = alloc_percpu(uint64_t);
+    fc->rl_stats = alloc_percpu(struct ngknet_rl_stats);
+    spin_lock_init(&fc->rl.lock);
+    tbl = ngknet_filter_tbl_alloc();
+    if (!fc->hits || !fc->rl_stats || !tbl) {
+        kfree(tbl);
+        ngknet_filter_free(fc);
+        return SHR_E_MEMORY;
+    }
 
     spin_lock_irqsave(&dev->lock, flags);
 
@@ -99,7 +382,8 @@ ngknet_filter_create(struct ngknet_dev *dev, ngknet_filter_t *filter)
     }
     if (id > NUM_FILTER_MAX) {
         spin_unlock_irqrestore(&dev->lock, flags);
-        kfree(fc);
+        kfree(tbl);
+        ngknet_filter_free(fc);
         return SHR_E_RESOURCE;
     }
 
@@ -150,8 +434,14 @@ ngknet_filter_create(struct ngknet_dev *dev, ngknet_filter_t *filter)
 
     filter->id = fc->filt.id;
 
+    old = ngknet_filter_tbl_publish(dev, tbl);
+
     spin_unlock_irqrestore(&dev->lock, flags);
 
+    if (old) {
+        call_rcu(&old->rcu, ngknet_filter_tbl_free_rcu);
+    }
+
     return SHR_E_NONE;
 }
 
@@ -159,51 +449,70 @@ int
 ngknet_filter_destroy(struct ngknet_dev *dev, int id)
 {
     struct filt_ctrl *fc = NULL;
+    struct filt_tbl *tbl = NULL, *old = NULL;
     unsigned long flags;
-    int num;
 
     if (id <= 0 || id > NUM_FILTER_MAX) {
         return SHR_E_PARAM;
     }
 
+    tbl = ngknet_filter_tbl_alloc();
+    if (!tbl) {
+        return SHR_E_MEMORY;
+    }
+
     spin_lock_irqsave(&dev->lock, flags);
 
-    fc = (struct filt_ctrl *)dev->fc[id];
+    fc = ngknet_filter_unlink(dev, id);
     if (!fc) {
         spin_unlock_irqrestore(&dev->lock, flags);
+        kfree(tbl);
         return SHR_E_NOT_FOUND;
     }
 
-    list_del(&fc->list);
-    kfree(fc);
-
-    dev->fc[id] = NULL;
-    num = (long)dev->fc[0];
-    while (num-- == id--) {
-        if (dev->fc[id]) {
-            dev->fc[0] = (void *)(long)num;
-            break;
-        }
-    }
+    old = ngknet_filter_tbl_publish(dev, tbl);
 
     spin_unlock_irqrestore(&dev->lock, flags);
 
+    /* Wait for Rx filtering on the old table, which refers to the filter */
+    synchronize_rcu();
+    kfree(old);
+    ngknet_filter_free(fc);
+
     return SHR_E_NONE;
 }
 
 int
 ngknet_filter_destroy_all(struct ngknet_dev *dev)
 {
+    struct filt_ctrl *fc = NULL;
+    struct filt_tbl *old = NULL;
+    struct list_head *list, *list2;
+    unsigned long flags;
     int id;
-    int rv;
+    LIST_HEAD(filt_list);
+
+    spin_lock_irqsave(&dev->lock, flags);
 
     for (id = 1; id <= NUM_FILTER_MAX; id++) {
-        rv = ngknet_filter_destroy(dev, id);
-        if (SHR_FAILURE(rv)) {
-            return rv;
+        fc = ngknet_filter_unlink(dev, id);
+        if (fc) {
+            list_add_tail(&fc->list, &filt_list);
         }
     }
 
+    old = ngknet_filter_tbl_publish(dev, NULL);
+
+    spin_unlock_irqrestore(&dev->lock, flags);
+
+    synchronize_rcu();
+    kfree(old);
+    list_for_each_safe(list, list2, &filt_list) {
+        fc = (struct filt_ctrl *)list;
+        list_del(&fc->list);
+        ngknet_filter_free(fc);
+    }
+
     return SHR_E_NONE;
 }
 
@@ -262,6 +571,92 @@ ngknet_filter_get_next(struct ngknet_dev *dev, ngknet_filter_t *filter)
     return ngknet_filter_get(dev, filter->next, filter);
 }
 
+uint64_t
+ngknet_filter_hits(struct filt_ctrl *fc)
+{
+    uint64_t hits = 0;
+    int cpu;
+
+    if (!fc || !fc->hits) {
+        return 0;
+    }
+
+    for_each_possible_cpu(cpu) {
+        hits += *per_cpu_ptr(fc->hits, cpu);
+    }
+
+    return hits;
+}
+
+/*!
+ * Look up the lowest ranked filter matching the packet.
+ * Called within RCU read-side critical section.
+ */
+static struct filt_ctrl *
+ngknet_filter_lookup(struct filt_tbl *tbl, struct pkt_buf *pkb, int chan_id)
+{
+    struct filt_entry *best = tbl->any, *ent = NULL;
+    struct filt_group *grp = NULL;
+    ngknet_filter_t *filt = NULL;
+    uint8_t *oob = &pkb->data;
+    uint8_t *pkt = &pkb->data + pkb->pkh.meta_len;
+    uint32_t key[NGKNET_FILTER_WORDS_MAX];
+    int best_rank = best ? best->rank : INT_MAX;
+    int gi, idx;
+
+    for (gi = 0; gi < tbl->num_groups; gi++) {
+        grp = &tbl->groups[gi];
+        if (grp->min_rank >= best_rank) {
+            break;
+        }
+        if (grp->wsize) {
+            key[grp->wsize - 1] = 0;
+        }
+        memcpy(key, &oob[grp->oob_data_offset], grp->oob_data_size);
+        memcpy((uint8_t *)key + grp->oob_data_size,
+               pkt + grp->pkt_data_offset, grp->pkt_data_size);
+
+        if (grp->head) {
+            for (ent = grp->head; ent && ent->rank < best_rank; ent = ent->gnext) {
+                filt = &ent->fc->filt;
+                if (filt->flags & NGKNET_FILTER_F_MATCH_CHAN && filt->chan != chan_id) {
+                    continue;
+                }
+                for (idx = 0; idx < grp->wsize; idx++) {
+                    if ((key[idx] & grp->mask[idx]) != filt->data.w[idx]) {
+                        break;
+                    }
+                }
+                if (idx == grp->wsize) {
+                    best = ent;
+                    best_rank = ent->rank;
+                    break;
+                }
+            }
+            continue;
+        }
+
+        for (idx = 0; idx < grp->wsize; idx++) {
+            key[idx] &= grp->mask[idx];
+        }
+
+        ent = tbl->buckets[ngknet_filter_tbl_hash(tbl, key, grp->wsize, gi)];
+        for (; ent && ent->rank < best_rank; ent = ent->next) {
+            filt = &ent->fc->filt;
+            if (ent->group != gi ||
+                (filt->flags & NGKNET_FILTER_F_MATCH_CHAN && filt->chan != chan_id) ||
+                memcmp(key, filt->data.w, grp->wsize * sizeof(uint32_t))) {
+                continue;
+            }
+            best = ent;
+            best_rank = ent->rank;
+            break;
+        }
+    }
+
+    return best ? best->fc : NULL;
+}
+
 int
 ngknet_rx_pkt_filter(struct ngknet_dev *dev,
                      struct sk_buff **oskb, struct net_device **ndev,
@@ -271,15 +666,13 @@ ngknet_rx_pkt_filter(struct ngknet_dev *dev,
     struct net_device *dest_ndev = NULL, *mirror_ndev = NULL;
     struct ngknet_private *priv = NULL;
     struct filt_ctrl *fc = NULL;
-    struct list_head *list = NULL;
-    ngknet_filter_t scratch, *filt = NULL;
+    struct filt_tbl *tbl = NULL;
+    ngknet_filter_t *filt = NULL;
     struct pkt_buf *pkb = (struct pkt_buf *)skb->data;
-    uint8_t *oob = &pkb->data, *data = NULL;
+    uint8_t *data = NULL;
     uint16_t tpid;
-    unsigned long flags;
-    int wsize;
     int chan_id;
-    int rv, idx, match = 0;
+    int rv;
     int eth_offset = 0;
     int cust_hdr_len = 0;
     ngknet_filter_cb_f filter_cb;
@@ -290,59 +683,46 @@ ngknet_rx_pkt_filter(struct ngknet_dev *dev,
         return rv;
     }
 
-    spin_lock_irqsave(&dev->lock, flags);
+    /*
+     * Network interfaces and filters are looked up w/o the lock, and stay
+     * valid till unlock. A network interface is held by its users count
+     * beyond that, see ngknet_netif_destroy().
+     */
+    rcu_read_lock();
 
-    dest_ndev = dev->bdev[chan_id];
+    dest_ndev = rcu_dereference(dev->bdev[chan_id]);
     if (dest_ndev) {
         skb->dev = dest_ndev;
         priv = netdev_priv(dest_ndev);
-        priv->users++;
+        atomic_inc(&priv->users);
         *ndev = dest_ndev;
-        spin_unlock_irqrestore(&dev->lock, flags);
+        rcu_read_unlock();
         return SHR_E_NONE;
     }
 
-    if (list_empty(&dev->filt_list)) {
-        spin_unlock_irqrestore(&dev->lock, flags);
+    tbl = rcu_dereference(dev->filt_tbl);
+    if (!tbl || !tbl->num_entries) {
+        rcu_read_unlock();
         return SHR_E_NO_HANDLER;
     }
 
-    list_for_each(list, &dev->filt_list) {
-        fc = (struct filt_ctrl *)list;
+    fc = ngknet_filter_lookup(tbl, pkb, chan_id);
+    if (fc) {
         filt = &fc->filt;
-        if (filt->flags & NGKNET_FILTER_F_ANY_DATA) {
-            match = 1;
-            break;
+        this_cpu_inc(*fc->hits);
+        if (!ngknet_filter_rate_limit(fc)) {
+            rcu_read_unlock();
+            return SHR_E_RESOURCE;
         }
-        if (filt->flags & NGKNET_FILTER_F_MATCH_CHAN && filt->chan != chan_id) {
-            continue;
-        }
-        memcpy(&scratch.data.b[0],
-               &oob[filt->oob_data_offset], filt->oob_data_size);
-        memcpy(&scratch.data.b[filt->oob_data_size],
-               &pkb->data + pkb->pkh.meta_len + filt->pkt_data_offset,
-               filt->pkt_data_size);
-        wsize = NGKNET_BYTES2WORDS(filt->oob_data_size + filt->pkt_data_size);
-        for (idx = 0; idx < wsize; idx++) {
-            scratch.data.w[idx] &= filt->mask.w[idx];
-            if (scratch.data.w[idx] != filt->data.w[idx]) {
-                break;
-            }
-        }
-        if (idx == wsize) {
-            match = 1;
-            break;
-        }
-    }
-
-    if (match) {
-        fc->hits++;
         if (filt->dest_type == NGKNET_FILTER_DEST_T_CB) {
             struct ngknet_callback_desc *cbd = NGKNET_SKB_CB(skb);
             struct pkt_hdr *pkh = (struct pkt_hdr *)skb->data;
-            filter_cb = fc->filter_cb ? fc->filter_cb : dev->cbc->filter_cb;
+            filter_cb = READ_ONCE(fc->filter_cb);
+            if (!filter_cb) {
+                filter_cb = READ_ONCE(dev->cbc->filter_cb);
+            }
             if (!filter_cb) {
-                spin_unlock_irqrestore(&dev->lock, flags);
+                rcu_read_unlock();
                 return SHR_E_UNAVAIL;
             }
             cbd->dinfo = &dev->dev_info;
@@ -353,7 +733,7 @@ ngknet_rx_pkt_filter(struct ngknet_dev *dev,
             skb = filter_cb(skb, &filt);
             if (!skb) {
                 *oskb = NULL;
-                spin_unlock_irqrestore(&dev->lock, flags);
+                rcu_read_unlock();
                 return SHR_E_NONE;
             }
             if (skb != *oskb) {
@@ -361,7 +741,7 @@ ngknet_rx_pkt_filter(struct ngknet_dev *dev,
                 pkb = (struct pkt_buf *)skb->data;
             }
             if (!filt) {
-                spin_unlock_irqrestore(&dev->lock, flags);
+                rcu_read_unlock();
                 return SHR_E_NO_HANDLER;
             }
         }
@@ -370,7 +750,7 @@ ngknet_rx_pkt_filter(struct ngknet_dev *dev,
             if (filt->dest_id == 0) {
                 dest_ndev = dev->net_dev;
             } else {
-                dest_ndev = dev->vdev[filt->dest_id];
+                dest_ndev = rcu_dereference(dev->vdev[filt->dest_id]);
             }
             if (dest_ndev) {
                 skb->dev = dest_ndev;
@@ -379,23 +759,22 @@ ngknet_rx_pkt_filter(struct ngknet_dev *dev,
                     skb->protocol = filt->dest_proto;
                 }
                 priv = netdev_priv(dest_ndev);
-                priv->users++;
+                atomic_inc(&priv->users);
             }
             break;
         case NGKNET_FILTER_DEST_T_VNET:
             pkb->pkh.attrs |= PDMA_RX_TO_VNET;
-            spin_unlock_irqrestore(&dev->lock, flags);
+            rcu_read_unlock();
             return SHR_E_NONE;
         case NGKNET_FILTER_DEST_T_NULL:
         default:
-            spin_unlock_irqrestore(&dev->lock, flags);
+            rcu_read_unlock();
             return SHR_E_NO_HANDLER;
         }
     }
 
-    spin_unlock_irqrestore(&dev->lock, flags);
-
     if (!dest_ndev) {
+        rcu_read_unlock();
         return SHR_E_NO_HANDLER;
     } else {
         *ndev = dest_ndev;
@@ -423,11 +802,10 @@ ngknet_rx_pkt_filter(struct ngknet_dev *dev,
     }
 
     if (filt->mirror_type == NGKNET_FILTER_DEST_T_NETIF) {
-        spin_lock_irqsave(&dev->lock, flags);
         if (filt->mirror_id == 0) {
             mirror_ndev = dev->net_dev;
         } else {
-            mirror_ndev = dev->vdev[filt->mirror_id];
+            mirror_ndev = rcu_dereference(dev->vdev[filt->mirror_id]);
         }
         if (mirror_ndev) {
             mirror_skb = pskb_copy(skb, GFP_ATOMIC);
@@ -441,112 +819,210 @@ ngknet_rx_pkt_filter(struct ngknet_dev *dev,
                     NGKNET_SKB_CB(mirror_skb)->filt = filt;
                 }
                 priv = netdev_priv(mirror_ndev);
-                priv->users++;
+                atomic_inc(&priv->users);
                 *mndev = mirror_ndev;
                 *mskb = mirror_skb;
             }
         }
-        spin_unlock_irqrestore(&dev->lock, flags);
     }
 
+    rcu_read_unlock();
+
     return SHR_E_NONE;
 }
 
-static void
-ngknet_rl_process(timer_context_t data)
+void
+ngknet_rx_rate_limit_init(struct ngknet_dev *devs)
 {
-    struct ngknet_rl_ctrl *rc = timer_arg(rc, data, timer);
-    struct ngknet_dev *dev;
-    unsigned long flags;
-    int idx;
-
-    spin_lock_irqsave(&rc->lock, flags);
-    rc->rx_pkts = 0;
-    for (idx = 0; idx < NUM_PDMA_DEV_MAX; idx++) {
-        dev = &rc->devs[idx];
-        if (rc->dev_active[idx] && rc->dev_paused[idx]) {
-            bcmcnet_pdma_dev_rx_resume(&dev->pdma_dev);
-            rl_ctrl.dev_paused[dev->dev_info.dev_no] = 0;
+    struct ngknet_rl_ctrl *rc;
+    int di, qi;
+
+    sal_memset(rl_ctrl, 0, sizeof(rl_ctrl));
+    for (di = 0; di < NUM_PDMA_DEV_MAX; di++) {
+        rc = &rl_ctrl[di];
+        spin_lock_init(&rc->dev_rb.lock);
+        rc->dev_rb.prio = NGKNET_RL_PRIO_MAX - 1;
+        for (qi = 0; qi < NUM_Q_MAX; qi++) {
+            spin_lock_init(&rc->rxq_rb[qi].lock);
+            rc->rxq_rb[qi].prio = min(qi, NGKNET_RL_PRIO_MAX - 1);
         }
     }
-    spin_unlock_irqrestore(&rc->lock, flags);
+}
+
+void
+ngknet_rx_rate_limit_cleanup(void)
+{
+    int di;
 
-    rc->timer.expires = jiffies + HZ / rc->rx_ticks;
-    add_timer(&rc->timer);
+    for (di = 0; di < NUM_PDMA_DEV_MAX; di++) {
+        free_percpu(rl_ctrl[di].stats);
+        rl_ctrl[di].stats = NULL;
+    }
 }
 
 void
-ngknet_rx_rate_limit_init(struct ngknet_dev *devs)
+ngknet_rx_rate_limit_start(struct ngknet_dev *dev)
 {
-    sal_memset(&rl_ctrl, 0, sizeof(rl_ctrl));
-    rl_ctrl.rx_ticks = NGKNET_EXTRA_RATE_LIMIT_DEFAULT_RX_TICK;
-    setup_timer(&rl_ctrl.timer, ngknet_rl_process, (timer_context_t)&rl_ctrl);
-    spin_lock_init(&rl_ctrl.lock);
-    rl_ctrl.devs = devs;
+    struct ngknet_rl_ctrl *rc = &rl_ctrl[dev->dev_info.dev_no];
+    struct ngknet_rl_stats __percpu *stats;
+
+    if (!rc->stats) {
+        stats = __alloc_percpu(sizeof(*stats) * (NUM_Q_MAX + 1),
+                               __alignof__(*stats));
+        if (!stats) {
+            printk(KERN_WARNING "ngknet: no memory for rate limit of dev%d\n",
+                   dev->dev_info.dev_no);
+            return;
+        }
+        if (cmpxchg(&rc->stats, NULL, stats)) {
+            free_percpu(stats);
+        }
+    }
+
+    WRITE_ONCE(rc->active, 1);
 }
 
 void
-ngknet_rx_rate_limit_cleanup(void)
+ngknet_rx_rate_limit_stop(struct ngknet_dev *dev)
 {
-    del_timer_sync(&rl_ctrl.timer);
+    WRITE_ONCE(rl_ctrl[dev->dev_info.dev_no].active, 0);
 }
 
 int
-ngknet_rx_rate_limit_started(void)
+ngknet_rx_rate_limit(struct ngknet_dev *dev, int queue, int limit)
 {
-    return rl_ctrl.started;
+    struct ngknet_rl_ctrl *rc = &rl_ctrl[dev->dev_info.dev_no];
+    struct ngknet_rl_bucket *rb;
+    uint32_t rate = limit > 0 ? limit : 0;
+    uint64_t now;
+
+    if (!READ_ONCE(rc->active) || queue < 0 || queue >= NUM_Q_MAX) {
+        return SHR_E_NONE;
+    }
+
+    /* Follow the module parameter */
+    if (READ_ONCE(rc->dev_rb.rate) != rate) {
+        ngknet_rl_bucket_config(&rc->dev_rb, rate, 0);
+    }
+
+    rb = &rc->rxq_rb[queue];
+    if (READ_ONCE(rb->rate) || rate) {
+        now = kal_time_nsecs();
+        if (!ngknet_rl_bucket_take(rb, NGKNET_RL_PRIO_MAX - 1, now)) {
+            this_cpu_inc(rc->stats[queue].dropped);
+            return SHR_E_RESOURCE;
+        }
+        if (!ngknet_rl_bucket_take(&rc->dev_rb, READ_ONCE(rb->prio), now)) {
+            /* The packet is not delivered, so it does not use the queue */
+            ngknet_rl_bucket_refund(rb);
+            this_cpu_inc(rc->stats[NUM_Q_MAX].dropped);
+            return SHR_E_RESOURCE;
+        }
+    }
+    this_cpu_inc(rc->stats[queue].passed);
+    this_cpu_inc(rc->stats[NUM_Q_MAX].passed);
+
+    return SHR_E_NONE;
 }
 
-void
-ngknet_rx_rate_limit_start(struct ngknet_dev *dev)
+int
+ngknet_rx_queue_rate_limit_set(struct ngknet_dev *dev, int queue,
+                               uint32_t rate, uint32_t burst, int prio)
 {
-    unsigned long flags;
+    struct ngknet_rl_bucket *rb;
 
-    spin_lock_irqsave(&rl_ctrl.lock, flags);
-    rl_ctrl.dev_active[dev->dev_info.dev_no] = 1;
-    spin_unlock_irqrestore(&rl_ctrl.lock, flags);
+    if (queue < 0 || queue >= NUM_Q_MAX ||
+        prio < -1 || prio >= NGKNET_RL_PRIO_MAX) {
+        return SHR_E_PARAM;
+    }
 
-    if (!rl_ctrl.started) {
-        rl_ctrl.started = 1;
-        rl_ctrl.timer.expires = jiffies + HZ / rl_ctrl.rx_ticks;
-        add_timer(&rl_ctrl.timer);
+    rb = &rl_ctrl[dev->dev_info.dev_no].rxq_rb[queue];
+    if (prio >= 0) {
+        WRITE_ONCE(rb->prio, prio);
     }
+    ngknet_rl_bucket_config(rb, rate, burst);
+
+    return SHR_E_NONE;
 }
 
-void
-ngknet_rx_rate_limit_stop(struct ngknet_dev *dev)
+int
+ngknet_rx_queue_rate_limit_get(struct ngknet_dev *dev, int queue,
+                               struct ngknet_rl_info *info)
 {
-    unsigned long flags;
+    struct ngknet_rl_ctrl *rc = &rl_ctrl[dev->dev_info.dev_no];
+    struct ngknet_rl_bucket *rb;
+    struct ngknet_rl_stats *stats;
+    int cpu;
+
+    if (queue < -1 || queue >= NUM_Q_MAX) {
+        return SHR_E_PARAM;
+    }
+    if (queue < 0) {
+        rb = &rc->dev_rb;
+        queue = NUM_Q_MAX;
+    } else {
+        rb = &rc->rxq_rb[queue];
+    }
+
+    sal_memset(info, 0, sizeof(*info));
+    info->rate = READ_ONCE(rb->rate);
+    info->burst = READ_ONCE(rb->burst);
+    info->prio = READ_ONCE(rb->prio);
+    if (rc->stats) {
+        for_each_possible_cpu(cpu) {
+            stats = per_cpu_ptr(rc->stats, cpu);
+            info->passed += stats[queue].passed;
+            info->dropped += stats[queue].dropped;
+        }
+    }
 
-    spin_lock_irqsave(&rl_ctrl.lock, flags);
-    rl_ctrl.dev_active[dev->dev_info.dev_no] = 0;
-    spin_unlock_irqrestore(&rl_ctrl.lock, flags);
+    return SHR_E_NONE;
 }
 
-void
-ngknet_rx_rate_limit(struct ngknet_dev *dev, int limit)
+int
+ngknet_filter_rate_limit_set(struct ngknet_dev *dev, int id,
+                             uint32_t rate, uint32_t burst)
 {
+    struct filt_ctrl *fc = NULL;
     unsigned long flags;
 
-    /* To support lower rate, we should use smaller tick (larger interval). */
-    if (limit < 1000) {
-        rl_ctrl.rx_ticks = (limit + 99) / 100;
-    } else {
-        rl_ctrl.rx_ticks = NGKNET_EXTRA_RATE_LIMIT_DEFAULT_RX_TICK;
+    if (id <= 0 || id > NUM_FILTER_MAX) {
+        return SHR_E_PARAM;
     }
 
-    spin_lock_irqsave(&rl_ctrl.lock, flags);
-    if ((++rl_ctrl.rx_pkts + rl_ctrl.rx_overruns > limit / rl_ctrl.rx_ticks) &&
-        !rl_ctrl.dev_paused[dev->dev_info.dev_no] &&
-        rl_ctrl.dev_active[dev->dev_info.dev_no]) {
-        rl_ctrl.dev_paused[dev->dev_info.dev_no] = 1;
-        rl_ctrl.rx_overruns = 0;
-        bcmcnet_pdma_dev_rx_suspend(&dev->pdma_dev);
+    spin_lock_irqsave(&dev->lock, flags);
+
+    fc = (struct filt_ctrl *)dev->fc[id];
+    if (!fc) {
+        spin_unlock_irqrestore(&dev->lock, flags);
+        return SHR_E_NOT_FOUND;
+    }
+
+    ngknet_rl_bucket_config(&fc->rl, rate, burst);
+
+    spin_unlock_irqrestore(&dev->lock, flags);
+
+    return SHR_E_NONE;
+}
+
+void
+ngknet_filter_rate_limit_get(struct filt_ctrl *fc, struct ngknet_rl_info *info)
+{
+    struct ngknet_rl_stats *stats;
+    int cpu;
+
+    sal_memset(info, 0, sizeof(*info));
+    if (!fc) {
+        return;
     }
-    if (rl_ctrl.dev_paused[dev->dev_info.dev_no]) {
-        rl_ctrl.rx_overruns++;
+    info->rate = READ_ONCE(fc->rl.rate);
+    info->burst = READ_ONCE(fc->rl.burst);
+    info->prio = fc->filt.priority;
+    for_each_possible_cpu(cpu) {
+        stats = per_cpu_ptr(fc->rl_stats, cpu);
+        info->passed += stats->passed;
+        info->dropped += stats->dropped;
     }
-    spin_unlock_irqrestore(&rl_ctrl.lock, flags);
 }
 
 void
@@ -25,6 +25,51 @@
 
 #include <lkm/ngknet_kapi.h>
 
+/*! Number of Rx rate limit priorities */
+#define NGKNET_RL_PRIO_MAX      8
+
+/*!
+ * \brief Rx rate limit counters.
+ */
+struct ngknet_rl_stats {
+    /*! Passed packets */
+    uint64_t passed;
+
+    /*! Dropped packets */
+    uint64_t dropped;
+};
+
+/*!
+ * \brief Rx rate limit token bucket.
+ *
+ * Credit is kept in nanoseconds. It grows with the elapsed time up to the
+ * depth of the bucket, and each packet takes the cost of one packet at the
+ * configured rate. The credit is not stored but derived from the theoretical
+ * arrival time of the next packet, which packets move forward lock-free.
+ */
+struct ngknet_rl_bucket {
+    /*! Rate in packets per second, 0 for no limit */
+    uint32_t rate;
+
+    /*! Burst in packets */
+    uint32_t burst;
+
+    /*! Priority, higher one may take the credit reserved for it */
+    uint32_t prio;
+
+    /*! Cost of one packet in nanoseconds */
+    uint64_t cost;
+
+    /*! Depth of the bucket in nanoseconds */
+    uint64_t depth;
+
+    /*! Theoretical arrival time of the next packet in nanoseconds */
+    atomic64_t tat;
+
+    /*! Configuration lock */
+    spinlock_t lock;
+};
+
 /*!
  * \brief Filter control.
  */
@@ -35,14 +80,110 @@ struct filt_ctrl {
     /*! Device number */
     int dev_no;
 
-    /*! Number of hits */
-    uint64_t hits;
+    /*! Number of hits, per CPU as Rx queues filter concurrently */
+    uint64_t __percpu *hits;
 
     /*! Filter description */
     ngknet_filter_t filt;
 
     /*! Filter callback */
     ngknet_filter_cb_f filter_cb;
+
+    /*! Rate limit bucket */
+    struct ngknet_rl_bucket rl;
+
+    /*! Rate limit counters per CPU */
+    struct ngknet_rl_stats __percpu *rl_stats;
+};
+
+/*!
+ * \brief Compiled filter entry.
+ */
+struct filt_entry {
+    /*! Next entry in hash bucket, in rank order */
+    struct filt_entry *next;
+
+    /*! Next entry of a small group, in rank order */
+    struct filt_entry *gnext;
+
+    /*! Filter control */
+    struct filt_ctrl *fc;
+
+    /*! Position in filter list, lower one wins */
+    int rank;
+
+    /*! Filter group, -1 for filter matching any data */
+    int group;
+};
+
+/*!
+ * \brief Filter group.
+ *
+ * Filters extracting the same data with the same mask.
+ */
+struct filt_group {
+    /*! Lowest rank of the group */
+    int min_rank;
+
+    /*! Out band data offset */
+    uint16_t oob_data_offset;
+
+    /*! Out band data size */
+    uint16_t oob_data_size;
+
+    /*! Packet data offset */
+    uint16_t pkt_data_offset;
+
+    /*! Packet data size */
+    uint16_t pkt_data_size;
+
+    /*! Data size in words */
+    int wsize;
+
+    /*! Filtering mask, of the first filter in the group */
+    const uint32_t *mask;
+
+    /*! Number of entries */
+    int num_entries;
+
+    /*! Entries of a small group, which is walked instead of hashed */
+    struct filt_entry *head;
+};
+
+/*!
+ * \brief Compiled filter table.
+ *
+ * The filter list is compiled into this table on every filter change and
+ * published by RCU, so that Rx filtering does not take the device lock.
+ * Entries of all groups are hashed by group and filtering data, except for
+ * groups of a few entries, which are compared in turn as hashing the packet
+ * data costs more than that. A packet is looked up once per group, in order of the lowest rank of groups, until
+ * no group can give a lower rank than the one matched.
+ */
+struct filt_tbl {
+    /*! RCU head */
+    struct rcu_head rcu;
+
+    /*! Number of entries */
+    int num_entries;
+
+    /*! Number of groups */
+    int num_groups;
+
+    /*! Lowest ranked filter matching any data */
+    struct filt_entry *any;
+
+    /*! Entries in rank order */
+    struct filt_entry entries[NUM_FILTER_MAX];
+
+    /*! Groups in order of the lowest rank */
+    struct filt_group groups[NUM_FILTER_MAX];
+
+    /*! Hash bucket mask */
+    uint32_t bucket_mask;
+
+    /*! Hash buckets */
+    struct filt_entry *buckets[];
 };
 
 /*!
@@ -105,6 +246,16 @@ ngknet_filter_get(struct ngknet_dev *dev, int id, ngknet_filter_t *filter);
 extern int
 ngknet_filter_get_next(struct ngknet_dev *dev, ngknet_filter_t *filter);
 
+/*!
+ * \brief Get number of filter hits.
+ *
+ * \param [in] fc Filter control.
+ *
+ * \retval Number of hits on all CPUs.
+ */
+extern uint64_t
+ngknet_filter_hits(struct filt_ctrl *fc);
+
 /*!
  * \brief Filter packet.
  *
@@ -125,47 +276,58 @@ ngknet_rx_pkt_filter(struct ngknet_dev *dev,
 /*!
  * \brief Rx rate limit control.
  *
- * This contains all the control information for Rx rate limit such as
- * the number of Rx packets, status related to Rx rate limit, etc.
+ * This contains the token buckets of a device for Rx rate limit.
  *
- * The rate limit is kernel-oriented, i.e. all the Rx packets from any
- * device/channel will be accounted for. Once the received packets reach
- * the limit value in an 1-Sec interval, the driver API XXXX_rx_suspend()
- * will be called to suspend Rx. The 1-Sec basis timer will call the driver
- * API XXXX_rx_resume() to resume Rx and reset rate-related status/counters
- * at the begin of the next 1-Sec interval.
+ * Every Rx queue has its own bucket and the device has an aggregate one.
+ * A packet sent up to a network interface is charged to the bucket of its
+ * queue, then to the aggregate bucket. Packets to callbacks or virtual
+ * network devices are not charged, as before. A packet matching a filter
+ * with a rate is also charged to the bucket of the filter, whatever its
+ * destination. It is dropped if any of them runs out of credit, so the
+ * device is never suspended and Rx queues do not block each other.
+ *
+ * The aggregate bucket is priority-aware. Part of its depth is reserved in
+ * proportion to NGKNET_RL_PRIO_MAX - 1 - prio, where prio is the priority of
+ * the Rx queue, so low priority packets are dropped first when the device
+ * is congested. By default the priority of a queue is its number.
  *
  * The NGKNET module parameter 'rx_rate_limit' is used to decide the maximum
- * Rx rate. Disable Rx rate limit if set 0. It can be set when inserting
- * NGKNET module or modified using its SYSFS attributions.
+ * Rx rate of each device. Disable it if set -1 or 0. It can be set when
+ * inserting NGKNET module or modified using its SYSFS attributions. Buckets
+ * of Rx queues and filters are configured through PROCFS.
  */
 struct ngknet_rl_ctrl {
-    /*! Rx packets */
-    int rx_pkts;
+    /*! Aggregate bucket */
+    struct ngknet_rl_bucket dev_rb;
 
-    /*! Rx overruns */
-    int rx_overruns;
+    /*! Rx queue buckets */
+    struct ngknet_rl_bucket rxq_rb[NUM_Q_MAX];
 
-    /*! Rx ticks */
-    int rx_ticks;
+    /*! Counters of aggregate bucket and Rx queue buckets per CPU */
+    struct ngknet_rl_stats __percpu *stats;
 
-    /*! Active devices under rate control */
-    int dev_active[NUM_PDMA_DEV_MAX];
+    /*! Device under rate control */
+    int active;
+};
 
-    /*! Paused devices due to no Rx credit */
-    int dev_paused[NUM_PDMA_DEV_MAX];
+/*!
+ * \brief Rx rate limit information.
+ */
+struct ngknet_rl_info {
+    /*! Rate in packets per second, 0 for no limit */
+    uint32_t rate;
 
-    /*! Rate limit timer */
-    struct timer_list timer;
+    /*! Burst in packets */
+    uint32_t burst;
 
-    /*! Rate limit lock */
-    spinlock_t lock;
+    /*! Priority */
+    uint32_t prio;
 
-    /*! Devices */
-    struct ngknet_dev *devs;
+    /*! Passed packets */
+    uint64_t passed;
 
-    /*! Rate limit status indicator */
-    int started;
+    /*! Dropped packets */
+    uint64_t dropped;
 };
 
 /*!
@@ -182,12 +344,6 @@ ngknet_rx_rate_limit_init(struct ngknet_dev *devs);
 extern void
 ngknet_rx_rate_limit_cleanup(void);
 
-/*!
- * \brief Get Rx rate limit state.
- */
-extern int
-ngknet_rx_rate_limit_started(void);
-
 /*!
  * \brief Start Rx rate limit.
  *
@@ -208,9 +364,68 @@ ngknet_rx_rate_limit_stop(struct ngknet_dev *dev);
  * \brief Limit Rx rate.
  *
  * \param [in] dev Device structure point.
+ * \param [in] queue Rx queue number.
+ * \param [in] limit Rx rate limit of the device, -1 for no limit.
+ *
+ * \retval SHR_E_NONE Packet is allowed.
+ * \retval SHR_E_RESOURCE Packet is to be dropped.
+ */
+extern int
+ngknet_rx_rate_limit(struct ngknet_dev *dev, int queue, int limit);
+
+/*!
+ * \brief Set Rx queue rate limit.
+ *
+ * \param [in] dev Device structure point.
+ * \param [in] queue Rx queue number.
+ * \param [in] rate Rate in packets per second, 0 for no limit.
+ * \param [in] burst Burst in packets, 0 for default.
+ * \param [in] prio Priority, -1 to keep the current one.
+ *
+ * \retval SHR_E_NONE No errors.
+ * \retval SHR_E_XXXX Operation failed.
+ */
+extern int
+ngknet_rx_queue_rate_limit_set(struct ngknet_dev *dev, int queue,
+                               uint32_t rate, uint32_t burst, int prio);
+
+/*!
+ * \brief Get Rx rate limit information.
+ *
+ * \param [in] dev Device structure point.
+ * \param [in] queue Rx queue number, -1 for the aggregate bucket.
+ * \param [out] info Rate limit information.
+ *
+ * \retval SHR_E_NONE No errors.
+ * \retval SHR_E_XXXX Operation failed.
+ */
+extern int
+ngknet_rx_queue_rate_limit_get(struct ngknet_dev *dev, int queue,
+                               struct ngknet_rl_info *info);
+
+/*!
+ * \brief Set filter rate limit.
+ *
+ * \param [in] dev Device structure point.
+ * \param [in] id Filter ID.
+ * \param [in] rate Rate in packets per second, 0 for no limit.
+ * \param [in] burst Burst in packets, 0 for default.
+ *
+ * \retval SHR_E_NONE No errors.
+ * \retval SHR_E_XXXX Operation failed.
+ */
+extern int
+ngknet_filter_rate_limit_set(struct ngknet_dev *dev, int id,
+                             uint32_t rate, uint32_t burst);
+
+/*!
+ * \brief Get filter rate limit information.
+ *
+ * \param [in] fc Filter control.
+ * \param [out] info Rate limit information.
  */
 extern void
-ngknet_rx_rate_limit(struct ngknet_dev *dev, int limit);
+ngknet_filter_rate_limit_get(struct filt_ctrl *fc, struct ngknet_rl_info *info);
 
 /*!
  * \brief Schedule Tx queue.
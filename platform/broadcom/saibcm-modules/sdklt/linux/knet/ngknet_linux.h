@@ -197,6 +197,12 @@ kal_time_usecs(void)
 }
 #endif /* KERNEL_VERSION(3,17,0) */
 
+static inline u64
+kal_time_nsecs(void)
+{
+    return ktime_to_ns(ktime_get());
+}
+
 static inline unsigned long
 kal_copy_from_user(void *to, const void __user *from,
                    unsigned int dl, unsigned int sl)
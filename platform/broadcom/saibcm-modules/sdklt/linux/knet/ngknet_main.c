@@ -158,7 +158,7 @@ MODULE_PARM_DESC(rx_buffer_size,
 static int rx_rate_limit = -1;
 MODULE_PARAM(rx_rate_limit, int, 0);
 MODULE_PARM_DESC(rx_rate_limit,
-"Rx rate limit in packets per second (default -1 for no limit)");
+"Rx rate limit of each device in packets per second to network interfaces (default -1 for no limit)");
 /*! \endcond */
 
 /*! \cond */
@@ -458,6 +458,21 @@ ngknet_rx_frame_process(struct net_device *ndev, struct sk_buff **oskb)
     return SHR_E_NONE;
 }
 
+/*!
+ * \brief Release network interface taken by Rx filter.
+ *
+ * \param [in] dev Device structure point.
+ * \param [in] priv Private data of the network interface.
+ */
+static inline void
+ngknet_netif_put(struct ngknet_dev *dev, struct ngknet_private *priv)
+{
+    /* Pairs with the barrier in ngknet_netif_destroy() */
+    if (atomic_dec_and_test(&priv->users) && READ_ONCE(priv->wait)) {
+        wake_up(&dev->wq);
+    }
+}
+
 /*!
  * \brief Network interface Rx function.
  *
@@ -478,6 +493,14 @@ ngknet_netif_recv(struct net_device *ndev, struct sk_buff *skb)
     uint16_t proto;
     int rv;
 
+    /* Rate limit, packets to network interfaces only */
+    rv = ngknet_rx_rate_limit(dev, pkh->queue_id, rx_rate_limit);
+    if (SHR_FAILURE(rv)) {
+        DBG_VERB(("Rx packet dropped by rate limit on queue %d.\n",
+                  pkh->queue_id));
+        return rv;
+    }
+
     /* Handle one incoming packet */
     rv = ngknet_rx_frame_process(ndev, &skb);
     if (!skb) {
@@ -517,14 +540,6 @@ ngknet_netif_recv(struct net_device *ndev, struct sk_buff *skb)
 
     netif_receive_skb(skb);
 
-    /* Rate limit */
-    if (rx_rate_limit >= 0) {
-        if (!ngknet_rx_rate_limit_started()) {
-            ngknet_rx_rate_limit_start(dev);
-        }
-        ngknet_rx_rate_limit(dev, rx_rate_limit);
-    }
-
     return SHR_E_NONE;
 }
 
@@ -546,7 +561,6 @@ ngknet_frame_recv(struct pdma_dev *pdev, int queue, void *buf)
     struct sk_buff *skb = (struct sk_buff *)buf, *mskb = NULL;
     struct net_device *ndev = NULL, *mndev = NULL;
     struct ngknet_private *priv = NULL;
-    unsigned long flags;
     int rv;
 
     DBG_VERB(("Rx packet (%d bytes).\n", skb->len));
@@ -581,12 +595,7 @@ ngknet_frame_recv(struct pdma_dev *pdev, int queue, void *buf)
         dev_kfree_skb_any(skb);
     }
 
-    spin_lock_irqsave(&dev->lock, flags);
-    priv->users--;
-    if (!priv->users && priv->wait) {
-        wake_up(&dev->wq);
-    }
-    spin_unlock_irqrestore(&dev->lock, flags);
+    ngknet_netif_put(dev, priv);
 
     /* Handle mirrored packet */
     if (mndev && mskb) {
@@ -601,12 +610,7 @@ ngknet_frame_recv(struct pdma_dev *pdev, int queue, void *buf)
         } else {
             dev_kfree_skb_any(mskb);
         }
-        spin_lock_irqsave(&dev->lock, flags);
-        priv->users--;
-        if (!priv->users && priv->wait) {
-            wake_up(&dev->wq);
-        }
-        spin_unlock_irqrestore(&dev->lock, flags);
+        ngknet_netif_put(dev, priv);
     }
 
     /* Measure speed */
@@ -1315,9 +1319,7 @@ ngknet_enet_open(struct net_device *ndev)
         }
 
         /* Start rate limit */
-        if (rx_rate_limit >= 0) {
-            ngknet_rx_rate_limit_start(dev);
-        }
+        ngknet_rx_rate_limit_start(dev);
 
         /* Notify the stack of the actual queue counts. */
         rv = netif_set_real_num_rx_queues(dev->net_dev, pdev->ctrl.nb_rxq);
@@ -1386,9 +1388,7 @@ ngknet_enet_stop(struct net_device *ndev)
 
     if (priv->netif.id <= 0) {
         /* Stop rate limit */
-        if (rx_rate_limit >= 0) {
-            ngknet_rx_rate_limit_stop(dev);
-        }
+        ngknet_rx_rate_limit_stop(dev);
 
         for (gi = 0; gi < pdev->num_groups; gi++) {
             if (!pdev->ctrl.grp[gi].attached) {
@@ -2050,6 +2050,7 @@ ngknet_dev_probe(int dn, ngknet_netif_t *netif)
     ngknet_callback_control_get(&dev->cbc);
 
     INIT_LIST_HEAD(&dev->filt_list);
+    RCU_INIT_POINTER(dev->filt_tbl, NULL);
     spin_lock_init(&dev->lock);
     init_waitqueue_head(&dev->wq);
     if (pdev->mode == DEV_MODE_HNET) {
@@ -2254,14 +2255,6 @@ ngknet_netif_create(struct ngknet_dev *dev, ngknet_netif_t *netif)
         return rv;
     }
 
-    dev->vdev[id] = ndev;
-    if (id > num) {
-        num = id;
-    }
-    dev->vdev[0] = (struct net_device *)(long)num;
-
-    spin_unlock_irqrestore(&dev->lock, flags);
-
     priv = netdev_priv(ndev);
     priv->net_dev = ndev;
     priv->bkn_dev = dev;
@@ -2272,10 +2265,19 @@ ngknet_netif_create(struct ngknet_dev *dev, ngknet_netif_t *netif)
     memcpy(netif->name, ndev->name, sizeof(netif->name) - 1);
     memcpy(&priv->netif, netif, sizeof(priv->netif));
 
+    /* Rx looks up the network interface w/o the lock once published */
+    rcu_assign_pointer(dev->vdev[id], ndev);
+    if (id > num) {
+        num = id;
+    }
+    dev->vdev[0] = (struct net_device *)(long)num;
+
     if (priv->netif.flags & NGKNET_NETIF_F_BIND_CHAN) {
-        dev->bdev[priv->netif.chan] = ndev;
+        rcu_assign_pointer(dev->bdev[priv->netif.chan], ndev);
     }
 
+    spin_unlock_irqrestore(&dev->lock, flags);
+
     /* Optional netif create callback handle */
     list_for_each(list, &dev->cbc->netif_create_cb_list) {
         netif_create_cb = list_entry(list, netif_cb_t, list);
@@ -2300,7 +2302,6 @@ ngknet_netif_destroy(struct ngknet_dev *dev, int id)
     int num;
     struct list_head *list;
     netif_cb_t *netif_destroy_cb;
-    DECLARE_WAITQUEUE(wait, current);
 
     if (id <= 0 || id > NUM_VDEV_MAX) {
         return SHR_E_PARAM;
@@ -2315,23 +2316,11 @@ ngknet_netif_destroy(struct ngknet_dev *dev, int id)
     }
     priv = netdev_priv(ndev);
 
-    add_wait_queue(&dev->wq, &wait);
-
-    while (priv->users) {
-        priv->wait = 1;
-        set_current_state(TASK_INTERRUPTIBLE);
-        spin_unlock_irqrestore(&dev->lock, flags);
-        schedule();
-        spin_lock_irqsave(&dev->lock, flags);
-        priv->wait = 0;
-        set_current_state(TASK_RUNNING);
-    }
-
     if (priv->netif.flags & NGKNET_NETIF_F_BIND_CHAN) {
-        dev->bdev[priv->netif.chan] = NULL;
+        RCU_INIT_POINTER(dev->bdev[priv->netif.chan], NULL);
     }
 
-    dev->vdev[id] = NULL;
+    RCU_INIT_POINTER(dev->vdev[id], NULL);
     num = (long)dev->vdev[0];
     while (num-- == id--) {
         if (dev->vdev[id]) {
@@ -2342,7 +2331,14 @@ ngknet_netif_destroy(struct ngknet_dev *dev, int id)
 
     spin_unlock_irqrestore(&dev->lock, flags);
 
-    remove_wait_queue(&dev->wq, &wait);
+    /*
+     * Rx filter takes the network interface under RCU. Once no one can find
+     * it, wait for the packets which already took it to be sent up.
+     */
+    synchronize_net();
+    WRITE_ONCE(priv->wait, 1);
+    smp_mb();
+    wait_event(dev->wq, !atomic_read(&priv->users));
 
     /* Optional netif destroy callback handle */
     list_for_each(list, &dev->cbc->netif_destroy_cb_list) {
@@ -2686,9 +2682,7 @@ ngknet_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
         break;
     case NGKNET_DEV_SUSPEND:
         DBG_CMD(("NGKNET_DEV_SUSPEND\n"));
-        if (rx_rate_limit >= 0) {
-            ngknet_rx_rate_limit_stop(dev);
-        }
+        ngknet_rx_rate_limit_stop(dev);
         if (ioc.iarg[0]) {
             /* Graceful suspend */
             ioc.rc = bcmcnet_pdma_dev_suspend(pdev);
@@ -2700,9 +2694,7 @@ ngknet_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
     case NGKNET_DEV_RESUME:
         DBG_CMD(("NGKNET_DEV_RESUME\n"));
         ioc.rc = bcmcnet_pdma_dev_resume(pdev);
-        if (rx_rate_limit >= 0) {
-            ngknet_rx_rate_limit_start(dev);
-        }
+        ngknet_rx_rate_limit_start(dev);
         break;
     case NGKNET_DEV_VNET_WAIT:
         DBG_CMD(("NGKNET_DEV_VNET_WAIT\n"));
@@ -2993,9 +2985,6 @@ ngknet_exit_module(void)
     /* Cleanup Callback control */
     ngknet_callback_cleanup();
 
-    /* Cleanup Rx rate limit */
-    ngknet_rx_rate_limit_cleanup();
-
     /* Cleanup procfs */
     ngknet_procfs_cleanup();
 
@@ -3004,6 +2993,9 @@ ngknet_exit_module(void)
         ngknet_dev_remove(idx);
     }
 
+    /* Cleanup Rx rate limit */
+    ngknet_rx_rate_limit_cleanup();
+
     unregister_chrdev(NGKNET_MODULE_MAJOR, NGKNET_MODULE_NAME);
 }
 
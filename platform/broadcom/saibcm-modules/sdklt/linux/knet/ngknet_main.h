@@ -63,6 +63,8 @@
 #define SAI_FIXUP           1
 #define KNET_SVTAG_HOTFIX   1
 
+struct filt_tbl;
+
 /*!
  * Device description
  */
@@ -97,6 +99,9 @@ struct ngknet_dev {
     /*! Filter control, 0 is reserved */
     void *fc[NUM_FILTER_MAX + 1];
 
+    /*! Compiled filter list for Rx */
+    struct filt_tbl __rcu *filt_tbl;
+
     /*! Callback control */
     struct ngknet_callback_ctrl *cbc;
 
@@ -155,8 +160,8 @@ struct ngknet_private {
     /*! Network interface */
     ngknet_netif_t netif;
 
-    /*! Users of this network interface */
-    int users;
+    /*! Users of this network interface, taken by Rx filter under RCU */
+    atomic_t users;
 
     /*! Wait for this network interface free */
     int wait;
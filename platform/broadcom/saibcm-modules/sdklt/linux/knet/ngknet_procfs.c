@@ -230,7 +230,7 @@ proc_filter_info_show(struct seq_file *m, void *v)
             proc_data_show(m, filt.mask.b, filt.oob_data_size + filt.pkt_data_size);
             seq_printf(m, "user_data:      ");
             proc_data_show(m, filt.user_data, NGKNET_FILTER_USER_DATA);
-            seq_printf(m, "hits:           %llu\n", ((struct filt_ctrl *)dev->fc[filt.id])->hits);
+            seq_printf(m, "hits:           %llu\n", ngknet_filter_hits((struct filt_ctrl *)dev->fc[filt.id]));
         } while (filt.next);
     }
 
@@ -435,8 +435,44 @@ static struct proc_ops proc_pkt_stats_fops = {
 static int
 proc_rate_limit_show(struct seq_file *m, void *v)
 {
+    struct ngknet_dev *dev;
+    struct ngknet_rl_info info;
+    ngknet_filter_t filt = {0};
+    int di, qi, rv;
+
     seq_printf(m, "Rx rate limit: %d pps\n", ngknet_rx_rate_limit_get());
 
+    for (di = 0; di < NUM_PDMA_DEV_MAX; di++) {
+        dev = &ngknet_devices[di];
+        if (!(dev->flags & NGKNET_DEV_ACTIVE)) {
+            continue;
+        }
+        seq_printf(m, "%s-%d\n", "Unit", di);
+        ngknet_rx_queue_rate_limit_get(dev, -1, &info);
+        seq_printf(m, "  device:    rate %u pps, burst %u, passed %llu, dropped %llu\n",
+                   info.rate, info.burst,
+                   (unsigned long long)info.passed, (unsigned long long)info.dropped);
+        for (qi = 0; qi < dev->pdma_dev.ctrl.nb_rxq; qi++) {
+            ngknet_rx_queue_rate_limit_get(dev, qi, &info);
+            seq_printf(m, "  queue %-3d: rate %u pps, burst %u, prio %u, passed %llu, dropped %llu\n",
+                       qi, info.rate, info.burst, info.prio,
+                       (unsigned long long)info.passed, (unsigned long long)info.dropped);
+        }
+        do {
+            rv = ngknet_filter_get_next(dev, &filt);
+            if (SHR_FAILURE(rv)) {
+                break;
+            }
+            ngknet_filter_rate_limit_get((struct filt_ctrl *)dev->fc[filt.id], &info);
+            if (!info.rate && !info.passed && !info.dropped) {
+                continue;
+            }
+            seq_printf(m, "  filter %-2d: rate %u pps, burst %u, passed %llu, dropped %llu\n",
+                       filt.id, info.rate, info.burst,
+                       (unsigned long long)info.passed, (unsigned long long)info.dropped);
+        } while (filt.next);
+    }
+
     return 0;
 }
 
@@ -446,20 +482,60 @@ proc_rate_limit_open(struct inode *inode, struct file *file)
     return single_open(file, proc_rate_limit_show, NULL);
 }
 
+/*!
+ * Set Rx rate limit.
+ *
+ *   <pps>                                       Rx rate limit of each device
+ *   <unit> queue <queue> <pps> [burst] [prio]   Rx rate limit of a queue
+ *   <unit> filter <id> <pps> [burst]            Rx rate limit of a filter
+ *
+ * Rate limit of queues and filters is removed if pps is 0.
+ */
 static ssize_t
 proc_rate_limit_write(struct file *file, const char *buf,
                       size_t count, loff_t *loff)
 {
-    char limit_str[9] = {0};
+    char limit_str[64] = {0};
+    char type[8] = {0};
+    unsigned int rate, burst = 0;
+    int unit, id, prio = -1;
     int rate_limit;
+    int num, rv;
 
-    if (copy_from_user(limit_str, buf, sizeof(limit_str) - 1)) {
+    if (copy_from_user(limit_str, buf, min(count, sizeof(limit_str) - 1))) {
         return -EFAULT;
     }
-    rate_limit = simple_strtol(limit_str, NULL, 10);
 
-    ngknet_rx_rate_limit_set(rate_limit);
-    printk("Rx rate limit set to: %d pps\n", rate_limit);
+    num = sscanf(limit_str, "%d %7s %d %u %u %d",
+                 &unit, type, &id, &rate, &burst, &prio);
+    if (num < 2) {
+        rate_limit = simple_strtol(limit_str, NULL, 10);
+
+        ngknet_rx_rate_limit_set(rate_limit);
+        printk("Rx rate limit set to: %d pps\n", rate_limit);
+
+        return count;
+    }
+
+    if (num < 4 || unit < 0 || unit >= NUM_PDMA_DEV_MAX ||
+        !(ngknet_devices[unit].flags & NGKNET_DEV_ACTIVE)) {
+        return -EINVAL;
+    }
+
+    if (!strcmp(type, "queue")) {
+        rv = ngknet_rx_queue_rate_limit_set(&ngknet_devices[unit], id,
+                                            rate, burst, prio);
+    } else if (!strcmp(type, "filter")) {
+        rv = ngknet_filter_rate_limit_set(&ngknet_devices[unit], id,
+                                          rate, burst);
+    } else {
+        return -EINVAL;
+    }
+    if (SHR_FAILURE(rv)) {
+        return -EINVAL;
+    }
+    printk("Unit %d %s %d Rx rate limit set to: %u pps\n",
+           unit, type, id, rate);
 
     return count;
 }
@@ -0,0 +1,430 @@
+/*! \file ngknet_filter_test.c
+ *
+ * Userspace test harness for the NGKNET Rx filter table.
+ *
+ * The table compile and lookup routines of ngknet_extra.c are built as they
+ * are and checked against the former linear walk of the filter list, which
+ * copied and masked the packet data once per filter. Random filter sets mix
+ * data layouts, masks, channel matching and filters matching any data, and
+ * random packets are built from the filters so that most of them hit.
+ *
+ */
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * A copy of the GNU General Public License version 2 (GPLv2) can
+ * be found in the LICENSES folder.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+
+#include <lkm/ngknet_dev.h>
+
+/*! Number of Rx queues, as bcmcnet */
+#define NUM_Q_MAX               64
+
+/*! Packet header, the part of bcmcnet's the filter looks at */
+struct pkt_hdr {
+    /*! Packet data length */
+    uint16_t data_len;
+
+    /*! Meta data length */
+    uint8_t meta_len;
+
+    /*! Queue ID */
+    uint8_t queue_id;
+
+    /*! Attributes */
+    uint32_t attrs;
+};
+
+/*! Packet buffer, meta data and packet data follow the header */
+struct pkt_buf {
+    /*! Packet header */
+    struct pkt_hdr pkh;
+
+    /*! Packet data */
+    uint8_t data;
+};
+
+/*! Device, the part the table compile looks at */
+struct ngknet_dev {
+    /*! Filter list */
+    struct list_head filt_list;
+};
+
+#include "ngknet_extra.h"
+
+#include "ngknet_filter_tbl.inc"
+
+/*! Size of test packets, meta data included */
+#define TEST_PKT_SIZE           512
+
+/*! Max meta data length of test packets */
+#define TEST_META_MAX           64
+
+/*! Number of channels filters match on */
+#define TEST_CHAN_MAX           4
+
+/*! Test packet */
+struct test_pkt {
+    /*! Packet buffer */
+    union {
+        struct pkt_buf pkb;
+        uint8_t raw[sizeof(struct pkt_hdr) + TEST_PKT_SIZE];
+    } u;
+
+    /*! Rx channel */
+    int chan;
+};
+
+/*! Data layout of a filter group */
+struct test_layout {
+    uint16_t oob_data_offset;
+    uint16_t oob_data_size;
+    uint16_t pkt_data_offset;
+    uint16_t pkt_data_size;
+    uint8_t mask[NGKNET_FILTER_BYTES_MAX];
+};
+
+static struct ngknet_dev test_dev;
+static struct filt_ctrl test_fc[NUM_FILTER_MAX];
+static struct filt_tbl *test_tbl;
+
+static uint32_t
+test_rand(void)
+{
+    return (uint32_t)random();
+}
+
+/*
+ * The former filter walk, from ngknet_rx_pkt_filter() before the table.
+ */
+static struct filt_ctrl *
+test_walk_lookup(struct ngknet_dev *dev, struct pkt_buf *pkb, int chan_id)
+{
+    struct filt_ctrl *fc = NULL;
+    struct list_head *list = NULL;
+    ngknet_filter_t scratch, *filt = NULL;
+    uint8_t *oob = &pkb->data;
+    int wsize;
+    int idx;
+
+    list_for_each(list, &dev->filt_list) {
+        fc = (struct filt_ctrl *)list;
+        filt = &fc->filt;
+        if (filt->flags & NGKNET_FILTER_F_ANY_DATA) {
+            return fc;
+        }
+        if (filt->flags & NGKNET_FILTER_F_MATCH_CHAN && filt->chan != chan_id) {
+            continue;
+        }
+        memcpy(&scratch.data.b[0],
+               &oob[filt->oob_data_offset], filt->oob_data_size);
+        memcpy(&scratch.data.b[filt->oob_data_size],
+               &pkb->data + pkb->pkh.meta_len + filt->pkt_data_offset,
+               filt->pkt_data_size);
+        wsize = NGKNET_BYTES2WORDS(filt->oob_data_size + filt->pkt_data_size);
+        for (idx = 0; idx < wsize; idx++) {
+            scratch.data.w[idx] &= filt->mask.w[idx];
+            if (scratch.data.w[idx] != filt->data.w[idx]) {
+                break;
+            }
+        }
+        if (idx == wsize) {
+            return fc;
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * Random data layout. A plain one always has some data to match.
+ */
+static void
+test_layout_init(struct test_layout *lo, int plain)
+{
+    int size, idx;
+
+    memset(lo, 0, sizeof(*lo));
+    lo->oob_data_offset = test_rand() % 16;
+    lo->oob_data_size = test_rand() % 3 ? test_rand() % 12 : 0;
+    lo->pkt_data_offset = test_rand() % 64;
+    lo->pkt_data_size = test_rand() % 24;
+    if (plain) {
+        lo->oob_data_size += 4;
+        lo->pkt_data_size += 2;
+    }
+    size = lo->oob_data_size + lo->pkt_data_size;
+    for (idx = 0; idx < size; idx++) {
+        switch (test_rand() % 4) {
+        case 0:
+            if (plain) {
+                lo->mask[idx] = 0xff;
+                break;
+            }
+            lo->mask[idx] = 0;
+            break;
+        case 1:
+            lo->mask[idx] = test_rand();
+            break;
+        default:
+            lo->mask[idx] = 0xff;
+            break;
+        }
+    }
+}
+
+/*
+ * Build num filters over num_layouts data layouts, in list order, and
+ * compile them. Plain filters match on data only, and all can be hit.
+ */
+static void
+test_filters_init(int num, int num_layouts, int plain)
+{
+    static struct test_layout layouts[NUM_FILTER_MAX];
+    struct list_head *prev = &test_dev.filt_list;
+    ngknet_filter_t *filt;
+    struct test_layout *lo;
+    int fi, idx, size;
+
+    for (idx = 0; idx < num_layouts; idx++) {
+        test_layout_init(&layouts[idx], plain);
+    }
+
+    memset(test_fc, 0, sizeof(test_fc));
+    for (fi = 0; fi < num; fi++) {
+        filt = &test_fc[fi].filt;
+        filt->id = fi + 1;
+        filt->priority = fi;
+        filt->dest_type = NGKNET_FILTER_DEST_T_NETIF;
+        if (!plain && test_rand() % 50 == 0) {
+            filt->flags |= NGKNET_FILTER_F_ANY_DATA;
+        }
+        if (!plain && test_rand() % 5 == 0) {
+            filt->flags |= NGKNET_FILTER_F_MATCH_CHAN;
+            filt->chan = test_rand() % TEST_CHAN_MAX;
+        }
+        lo = &layouts[test_rand() % num_layouts];
+        filt->oob_data_offset = lo->oob_data_offset;
+        filt->oob_data_size = lo->oob_data_size;
+        filt->pkt_data_offset = lo->pkt_data_offset;
+        filt->pkt_data_size = lo->pkt_data_size;
+        size = lo->oob_data_size + lo->pkt_data_size;
+        memcpy(filt->mask.b, lo->mask, size);
+        for (idx = 0; idx < size; idx++) {
+            filt->data.b[idx] = test_rand() & filt->mask.b[idx];
+        }
+        /* A few filters never match, with data out of the mask */
+        if (!plain && size && test_rand() % 20 == 0) {
+            filt->data.b[test_rand() % size] |= ~filt->mask.b[0];
+        }
+
+        prev->next = &test_fc[fi].list;
+        test_fc[fi].list.prev = prev;
+        prev = &test_fc[fi].list;
+    }
+    prev->next = &test_dev.filt_list;
+    test_dev.filt_list.prev = prev;
+
+    memset(test_tbl, 0, sizeof(*test_tbl) +
+           NGKNET_FILT_TBL_BUCKETS * sizeof(struct filt_entry *));
+    test_tbl->bucket_mask = NGKNET_FILT_TBL_BUCKETS - 1;
+    ngknet_filter_tbl_fill(&test_dev, test_tbl);
+}
+
+/*
+ * Build a packet, mostly carrying the data of one of the filters.
+ */
+static void
+test_pkt_init(struct test_pkt *tp, int num)
+{
+    ngknet_filter_t *filt;
+    uint8_t *oob, *pkt;
+    int idx;
+
+    tp->u.pkb.pkh.meta_len = test_rand() % (TEST_META_MAX + 1);
+    tp->chan = test_rand() % TEST_CHAN_MAX;
+    for (idx = 0; idx < TEST_PKT_SIZE; idx++) {
+        tp->u.raw[sizeof(struct pkt_hdr) + idx] = test_rand();
+    }
+    if (!num || test_rand() % 8 == 0) {
+        return;
+    }
+
+    filt = &test_fc[test_rand() % num].filt;
+    oob = &tp->u.pkb.data;
+    pkt = oob + tp->u.pkb.pkh.meta_len;
+    for (idx = 0; idx < filt->oob_data_size; idx++) {
+        oob[filt->oob_data_offset + idx] =
+            (oob[filt->oob_data_offset + idx] & ~filt->mask.b[idx]) |
+            filt->data.b[idx];
+    }
+    for (idx = 0; idx < filt->pkt_data_size; idx++) {
+        pkt[filt->pkt_data_offset + idx] =
+            (pkt[filt->pkt_data_offset + idx] &
+             ~filt->mask.b[filt->oob_data_size + idx]) |
+            filt->data.b[filt->oob_data_size + idx];
+    }
+    if (filt->flags & NGKNET_FILTER_F_MATCH_CHAN && test_rand() % 4) {
+        tp->chan = filt->chan;
+    }
+}
+
+static int
+test_check(int rounds, int pkts)
+{
+    struct test_pkt tp;
+    struct filt_ctrl *exp, *got;
+    int round, pi, num, layouts;
+    long hits = 0, total = 0, errors = 0;
+
+    for (round = 0; round < rounds; round++) {
+        num = test_rand() % (NUM_FILTER_MAX + 1);
+        layouts = 1 + test_rand() % (num ? num : 1);
+        test_filters_init(num, layouts, 0);
+        for (pi = 0; pi < pkts; pi++) {
+            test_pkt_init(&tp, num);
+            exp = test_walk_lookup(&test_dev, &tp.u.pkb, tp.chan);
+            got = num ? ngknet_filter_lookup(test_tbl, &tp.u.pkb, tp.chan) :
+                  NULL;
+            total++;
+            if (exp) {
+                hits++;
+            }
+            if (exp != got) {
+                if (errors++ < 10) {
+                    printf("round %d: %d filters, %d layouts, chan %d: "
+                           "expected filter %d, got %d\n",
+                           round, num, layouts, tp.chan,
+                           exp ? exp->filt.id : 0, got ? got->filt.id : 0);
+                }
+            }
+        }
+    }
+
+    printf("%ld packets, %ld hits, %ld mismatches\n", total, hits, errors);
+
+    return errors ? 1 : 0;
+}
+
+static double
+test_nsecs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void
+test_bench_one(int num, int layouts, int pkts)
+{
+    static struct test_pkt tps[1024];
+    volatile struct filt_ctrl *sink;
+    double start, walk, tbl;
+    int pi;
+
+    test_filters_init(num, layouts, 1);
+    for (pi = 0; pi < 1024; pi++) {
+        test_pkt_init(&tps[pi], num);
+    }
+
+    start = test_nsecs();
+    for (pi = 0; pi < pkts; pi++) {
+        sink = test_walk_lookup(&test_dev, &tps[pi & 1023].u.pkb,
+                                tps[pi & 1023].chan);
+    }
+    walk = (test_nsecs() - start) / pkts;
+
+    start = test_nsecs();
+    for (pi = 0; pi < pkts; pi++) {
+        sink = ngknet_filter_lookup(test_tbl, &tps[pi & 1023].u.pkb,
+                                    tps[pi & 1023].chan);
+    }
+    tbl = (test_nsecs() - start) / pkts;
+    (void)sink;
+
+    printf("%8d %8d %8d %12.1f %12.1f %8.1fx\n",
+           num, layouts, test_tbl->num_groups, walk, tbl, walk / tbl);
+}
+
+static void
+test_bench(int pkts)
+{
+    printf("%8s %8s %8s %12s %12s %9s\n",
+           "filters", "layouts", "groups", "walk ns/pkt", "table ns/pkt",
+           "speedup");
+    test_bench_one(16, 1, pkts);
+    test_bench_one(16, 4, pkts);
+    test_bench_one(NUM_FILTER_MAX, 1, pkts);
+    test_bench_one(NUM_FILTER_MAX, 4, pkts);
+    test_bench_one(NUM_FILTER_MAX, 16, pkts);
+    test_bench_one(NUM_FILTER_MAX, NUM_FILTER_MAX, pkts);
+}
+
+static void
+usage(const char *prog)
+{
+    printf("Usage: %s [-b] [-s seed] [-r rounds] [-n packets]\n"
+           "  -b  benchmark instead of checking\n"
+           "  -s  random seed (default: time)\n"
+           "  -r  filter sets to check (default: 2000)\n"
+           "  -n  packets per filter set, or to time (default: 1000, 2000000)\n",
+           prog);
+}
+
+int
+main(int argc, char *argv[])
+{
+    unsigned int seed = (unsigned int)time(NULL);
+    int rounds = 2000, pkts = 0, bench = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "bs:r:n:h")) != -1) {
+        switch (opt) {
+        case 'b':
+            bench = 1;
+            break;
+        case 's':
+            seed = strtoul(optarg, NULL, 0);
+            break;
+        case 'r':
+            rounds = atoi(optarg);
+            break;
+        case 'n':
+            pkts = atoi(optarg);
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 2;
+        }
+    }
+
+    test_tbl = malloc(sizeof(*test_tbl) +
+                      NGKNET_FILT_TBL_BUCKETS * sizeof(struct filt_entry *));
+    if (!test_tbl) {
+        return 1;
+    }
+
+    printf("seed %u\n", seed);
+    srandom(seed);
+
+    if (bench) {
+        test_bench(pkts > 0 ? pkts : 2000000);
+        return 0;
+    }
+
+    return test_check(rounds, pkts > 0 ? pkts : 1000);
+}
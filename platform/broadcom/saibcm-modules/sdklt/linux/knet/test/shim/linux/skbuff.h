@@ -0,0 +1,29 @@
+/*! \file skbuff.h
+ *
+ * Userspace stand-in for the kernel socket buffer declarations, for the
+ * test harness only.
+ *
+ */
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * A copy of the GNU General Public License version 2 (GPLv2) can
+ * be found in the LICENSES folder.
+ */
+
+#ifndef NGKNET_TEST_LINUX_SKBUFF_H
+#define NGKNET_TEST_LINUX_SKBUFF_H
+
+#include <linux/types.h>
+
+struct sk_buff;
+struct net_device;
+
+#endif /* NGKNET_TEST_LINUX_SKBUFF_H */
@@ -0,0 +1,116 @@
+/*! \file types.h
+ *
+ * Userspace stand-in for the kernel types used by the NGKNET filter
+ * table, for the test harness only.
+ *
+ */
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * A copy of the GNU General Public License version 2 (GPLv2) can
+ * be found in the LICENSES folder.
+ */
+
+#ifndef NGKNET_TEST_LINUX_TYPES_H
+#define NGKNET_TEST_LINUX_TYPES_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+#include <limits.h>
+
+#define __percpu
+#define __rcu
+
+typedef uint64_t dma_addr_t;
+
+typedef struct {
+    int locked;
+} spinlock_t;
+
+typedef struct {
+    int64_t counter;
+} atomic64_t;
+
+struct list_head {
+    struct list_head *next, *prev;
+};
+
+#define list_for_each(pos, head) \
+    for (pos = (head)->next; pos != (head); pos = pos->next)
+
+struct rcu_head {
+    struct rcu_head *next;
+    void (*func)(struct rcu_head *head);
+};
+
+static inline uint32_t
+roundup_pow_of_two(uint32_t n)
+{
+    uint32_t v = 1;
+
+    while (v < n) {
+        v <<= 1;
+    }
+    return v;
+}
+
+/* Bob Jenkins' lookup3, as the kernel's jhash2() */
+#define __jhash_rol32(w, s) (((w) << (s)) | ((w) >> (32 - (s))))
+
+#define __jhash_mix(a, b, c)                                    \
+    do {                                                        \
+        a -= c;  a ^= __jhash_rol32(c, 4);  c += b;             \
+        b -= a;  b ^= __jhash_rol32(a, 6);  a += c;             \
+        c -= b;  c ^= __jhash_rol32(b, 8);  b += a;             \
+        a -= c;  a ^= __jhash_rol32(c, 16); c += b;             \
+        b -= a;  b ^= __jhash_rol32(a, 19); a += c;             \
+        c -= b;  c ^= __jhash_rol32(b, 4);  b += a;             \
+    } while (0)
+
+#define __jhash_final(a, b, c)                                  \
+    do {                                                        \
+        c ^= b; c -= __jhash_rol32(b, 14);                      \
+        a ^= c; a -= __jhash_rol32(c, 11);                      \
+        b ^= a; b -= __jhash_rol32(a, 25);                      \
+        c ^= b; c -= __jhash_rol32(b, 16);                      \
+        a ^= c; a -= __jhash_rol32(c, 4);                       \
+        b ^= a; b -= __jhash_rol32(a, 14);                      \
+        c ^= b; c -= __jhash_rol32(b, 24);                      \
+    } while (0)
+
+static inline uint32_t
+jhash2(const uint32_t *k, uint32_t length, uint32_t initval)
+{
+    uint32_t a, b, c;
+
+    a = b = c = 0xdeadbeef + (length << 2) + initval;
+    while (length > 3) {
+        a += k[0];
+        b += k[1];
+        c += k[2];
+        __jhash_mix(a, b, c);
+        length -= 3;
+        k += 3;
+    }
+    switch (length) {
+    case 3: c += k[2]; /* fall through */
+    case 2: b += k[1]; /* fall through */
+    case 1: a += k[0];
+        __jhash_final(a, b, c);
+        /* fall through */
+    case 0:
+        break;
+    }
+    return c;
+}
+
+#endif /* NGKNET_TEST_LINUX_TYPES_H */
@@ -44,22 +44,48 @@
 #include <linux/netdevice.h>
 #include "bcm-genl-netif.h"
 
+/* Ports beyond this are looked up from the netif list */
+#define GENL_NETIF_PORT_MAX 1024
+
+typedef struct {
+    struct list_head list;
+    bcmgenl_netif_t netif;
+} genl_netif_t;
+
 /* generic netlink interface info */
 typedef struct {
     struct list_head netif_list;
     int netif_count;
     spinlock_t lock;
+    /* netif of the lowest ID on each port, for lookup by port per packet */
+    genl_netif_t *port_netif[GENL_NETIF_PORT_MAX];
 } genl_netif_info_t;
 static genl_netif_info_t g_netif_info;
 
-typedef struct {
-    struct list_head list;
-    bcmgenl_netif_t netif;
-} genl_netif_t;
-
 static uint32 g_sample_rate;
 static uint32 g_sample_size;
 
+/* Update the netif of the port, called with g_netif_info.lock held */
+static void
+genl_netif_port_update(int port)
+{
+    struct list_head *list_ptr;
+    genl_netif_t *genl_netif;
+
+    if (port >= GENL_NETIF_PORT_MAX) {
+        return;
+    }
+
+    g_netif_info.port_netif[port] = NULL;
+    list_for_each(list_ptr, &g_netif_info.netif_list) {
+        genl_netif = list_entry(list_ptr, genl_netif_t, list);
+        if (genl_netif->netif.port == port) {
+            g_netif_info.port_netif[port] = genl_netif;
+            break;
+        }
+    }
+}
+
 static int
 knet_netif_create_cb(struct net_device *dev, int dev_no, kcom_netif_t *netif)
 {
@@ -103,6 +129,7 @@ knet_netif_create_cb(struct net_device *dev, int dev_no, kcom_netif_t *netif)
         list_add_tail(&genl_netif->list, &g_netif_info.netif_list);
     }
     g_netif_info.netif_count++;
+    genl_netif_port_update(netif->port);
 
     spin_unlock_irqrestore(&g_netif_info.lock, flags);
 
@@ -131,6 +158,7 @@ knet_netif_destroy_cb(struct net_device *dev, int dev_no, kcom_netif_t *netif)
             found = 1;
             list_del(list_ptr);
             g_netif_info.netif_count--;
+            genl_netif_port_update(bcmgenl_netif->port);
             break;
         }
     }
@@ -231,8 +259,17 @@ bcmgenl_netif_get_by_port(int port, bcmgenl_netif_t *bcmgenl_netif)
         return -1;
     }
 
-    /* look for port from list of available net_devices */
     spin_lock_irqsave(&g_netif_info.lock, flags);
+    if (port >= 0 && port < GENL_NETIF_PORT_MAX) {
+        genl_netif = g_netif_info.port_netif[port];
+        if (genl_netif) {
+            memcpy(bcmgenl_netif, &genl_netif->netif, sizeof(bcmgenl_netif_t));
+        }
+        spin_unlock_irqrestore(&g_netif_info.lock, flags);
+        return genl_netif ? 0 : -1;
+    }
+
+    /* look for port from list of available net_devices */
     list_for_each(list_ptr, &g_netif_info.netif_list) {
         genl_netif = list_entry(list_ptr, genl_netif_t, list);
         netif = &genl_netif->netif;
@@ -288,6 +325,7 @@ bcmgenl_netif_cleanup(void)
         list_del(&genl_netif->list);
         kfree(genl_netif);
     }
+    memset(g_netif_info.port_netif, 0, sizeof(g_netif_info.port_netif));
 
     return 0;
 }
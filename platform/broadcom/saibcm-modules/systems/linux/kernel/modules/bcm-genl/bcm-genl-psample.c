@@ -52,6 +52,9 @@
 #include <linux/skbuff.h>
 #include <linux/sched.h>
 #include <linux/netdevice.h>
+#include <linux/log2.h>
+#include <linux/percpu.h>
+#include <linux/vmalloc.h>
 #include <net/net_namespace.h>
 #include "bcm-genl-psample.h"
 #include "bcm-genl-dev.h"
@@ -79,13 +82,19 @@ static int debug;
 static int psample_size = PSAMPLE_SIZE_DFLT;
 LKM_MOD_PARAM(psample_size, "i", int, 0);
 MODULE_PARM_DESC(psample_size,
-"psample pkt size (default 128 bytes)");
+"psample pkt size, the most bytes kept for a sample (default 128 bytes)");
 
 #define PSAMPLE_QLEN_DFLT 1024
 static int psample_qlen = PSAMPLE_QLEN_DFLT;
 LKM_MOD_PARAM(psample_qlen, "i", int, 0);
 MODULE_PARM_DESC(psample_qlen,
-"psample queue length (default 1024 buffers)");
+"psample queue length per CPU, rounded up to a power of 2 (default 1024 buffers)");
+
+#define PSAMPLE_BUDGET_DFLT 256
+static int psample_budget = PSAMPLE_BUDGET_DFLT;
+LKM_MOD_PARAM(psample_budget, "i", int, 0);
+MODULE_PARM_DESC(psample_budget,
+"psample pkts sent per CPU queue in one run of the work (default 256)");
 
 #if (LINUX_VERSION_CODE >= KERNEL_VERSION(5,13,0))
 static inline void
@@ -135,7 +144,6 @@ typedef struct psample_stats_s {
     unsigned long pkts_c_qlen_cur;
     unsigned long pkts_c_qlen_hi;
     unsigned long pkts_d_qlen_max;
-    unsigned long pkts_d_no_mem;
     unsigned long pkts_d_no_group;
     unsigned long pkts_d_sampling_disabled;
     unsigned long pkts_d_not_ready;
@@ -144,7 +152,10 @@ typedef struct psample_stats_s {
     unsigned long pkts_d_meta_dstport;
     unsigned long pkts_d_invalid_size;
 } psample_stats_t;
-static psample_stats_t g_psample_stats;
+
+/* Counted per CPU, as samples are taken on all Rx CPUs concurrently */
+static DEFINE_PER_CPU(psample_stats_t, g_psample_stats);
+#define PSAMPLE_STATS_INC(_f) this_cpu_inc(g_psample_stats._f)
 
 /*! Sampling type */
 #define SAMPLE_TYPE_NONE     0
@@ -159,17 +170,30 @@ typedef struct psample_meta_s {
     int sample_type;
 } psample_meta_t;
 
-typedef struct psample_pkt_s {
-    struct list_head list;
+/* Sample descriptor, data of psample_size bytes is kept in the ring */
+typedef struct psample_slot_s {
     struct psample_group *group;
     psample_meta_t meta;
-    struct sk_buff *skb;
-} psample_pkt_t;
+    int pkt_len;                    /* Original size for PSAMPLE_ATTR_ORIGSIZE */
+} psample_slot_t;
+
+/*
+ * Per CPU ring of sample descriptors.
+ * Filled by the Rx CPU it belongs to and drained by the work.
+ */
+typedef struct psample_ring_s {
+    unsigned int head;              /* Next slot to fill */
+    unsigned int tail;              /* Next slot to drain */
+    psample_slot_t *slots;
+    uint8_t *data;
+} psample_ring_t;
 
 typedef struct psample_work_s {
-    struct list_head pkt_list;
+    psample_ring_t __percpu *rings;
+    unsigned int ring_size;         /* Power of 2 */
+    struct sk_buff *skb;            /* Reused to send samples */
+    unsigned int skb_headroom;
     struct work_struct wq;
-    spinlock_t lock;
 } psample_work_t;
 static psample_work_t g_psample_work;
 
@@ -296,20 +320,20 @@ psample_meta_get(int dev_no, kcom_filter_t *kf, void *pkt_meta,
             sample_rate = bcmgenl_netif.sample_rate;
             sample_size = bcmgenl_netif.sample_size;
         } else {
-            g_psample_stats.pkts_d_meta_srcport++;
+            PSAMPLE_STATS_INC(pkts_d_meta_srcport);
             PSAMPLE_CB_DBG_PRINT("%s: could not find srcport(%d)\n", __func__, srcport);
         }
     }
 
     /* set sFlow dst type for MC pkts */
     if (mcast) {
-        g_psample_stats.pkts_f_dst_mc++;
+        PSAMPLE_STATS_INC(pkts_f_dst_mc);
     /* find dst port netif for UC pkts (no need to lookup CPU port) */
     } else if (dstport != 0) {
         if (bcmgenl_netif_get_by_port(dstport, &bcmgenl_netif) == 0) {
             dst_ifindex = bcmgenl_netif.dev->ifindex;
         } else {
-            g_psample_stats.pkts_d_meta_dstport++;
+            PSAMPLE_STATS_INC(pkts_d_meta_dstport);
             PSAMPLE_CB_DBG_PRINT("%s: could not find dstport(%d)\n", __func__, dstport);
         }
     }
@@ -325,44 +349,68 @@ psample_meta_get(int dev_no, kcom_filter_t *kf, void *pkt_meta,
     return 0;
 }
 
+/*
+ * Deliver up to psample_budget samples from the ring of each CPU.
+ * The work is scheduled again if any ring is left with samples, so that
+ * the samples of one CPU can not hold the work of the system queue.
+ */
 static void
 psample_task(struct work_struct *work)
 {
     psample_work_t *psample_work = container_of(work, psample_work_t, wq);
-    unsigned long flags;
-    struct list_head *list_ptr, *list_next;
-    psample_pkt_t *pkt;
-
-    spin_lock_irqsave(&psample_work->lock, flags);
-    list_for_each_safe(list_ptr, list_next, &psample_work->pkt_list) {
-        /* dequeue pkt from list */
-        pkt = list_entry(list_ptr, psample_pkt_t, list);
-        list_del(list_ptr);
-        g_psample_stats.pkts_c_qlen_cur--;
-        spin_unlock_irqrestore(&psample_work->lock, flags);
-
-        /* send to psample */
-        if (pkt) {
-            PSAMPLE_CB_DBG_PRINT("%s: group 0x%x, trunc_size %d, src_ifdx 0x%x, dst_ifdx 0x%x, sample_rate %d\n",
-                    __func__, pkt->group->group_num,
-                    pkt->meta.trunc_size, pkt->meta.src_ifindex,
-                    pkt->meta.dst_ifindex, pkt->meta.sample_rate);
+    unsigned int mask = psample_work->ring_size - 1;
+    struct sk_buff *skb = psample_work->skb;
+    psample_ring_t *ring;
+    psample_slot_t *slot;
+    unsigned int head, tail, done;
+    bool pending = false;
+    int cpu;
+
+    for_each_possible_cpu(cpu) {
+        ring = per_cpu_ptr(psample_work->rings, cpu);
+        head = smp_load_acquire(&ring->head);
+        tail = ring->tail;
+
+        for (done = 0; tail != head && done < psample_budget; done++) {
+            slot = &ring->slots[tail & mask];
+
+            /* reuse the skb for each sample, psample takes a copy */
+            skb->data = skb->head + psample_work->skb_headroom;
+            skb->len = 0;
+            skb_reset_tail_pointer(skb);
+            memcpy(skb_put(skb, slot->meta.trunc_size),
+                   ring->data + (tail & mask) * psample_size,
+                   slot->meta.trunc_size);
+            /* save original size for PSAMPLE_ATTR_ORIGSIZE in skb->len */
+            skb->len = slot->pkt_len;
 
-            bcmgenl_sample_packet(pkt->group,
-                                  pkt->skb,
-                                  pkt->meta.trunc_size,
-                                  pkt->meta.src_ifindex,
-                                  pkt->meta.dst_ifindex,
-                                  pkt->meta.sample_rate);
-
-            g_psample_stats.pkts_f_psample_mod++;
+            PSAMPLE_CB_DBG_PRINT("%s: group 0x%x, trunc_size %d, src_ifdx 0x%x, dst_ifdx 0x%x, sample_rate %d\n",
+                    __func__, slot->group->group_num,
+                    slot->meta.trunc_size, slot->meta.src_ifindex,
+                    slot->meta.dst_ifindex, slot->meta.sample_rate);
+
+            bcmgenl_sample_packet(slot->group,
+                                  skb,
+                                  slot->meta.trunc_size,
+                                  slot->meta.src_ifindex,
+                                  slot->meta.dst_ifindex,
+                                  slot->meta.sample_rate);
+
+            PSAMPLE_STATS_INC(pkts_f_psample_mod);
+            tail++;
+        }
 
-            dev_kfree_skb_any(pkt->skb);
-            kfree(pkt);
+        /* release the slots to the producer */
+        smp_store_release(&ring->tail, tail);
+        if (tail != head) {
+            pending = true;
         }
-        spin_lock_irqsave(&psample_work->lock, flags);
+        cond_resched();
+    }
+
+    if (pending) {
+        schedule_work(&psample_work->wq);
     }
-    spin_unlock_irqrestore(&psample_work->lock, flags);
 }
 
 static int
@@ -377,13 +425,13 @@ psample_filter_cb(uint8_t *pkt, int size, int dev_no, void *pkt_meta,
 
     PSAMPLE_CB_DBG_PRINT("%s: pkt size %d, kf->dest_id %d, kf->cb_user_data %d\n",
             __func__, size, kf->dest_id, kf->cb_user_data);
-    g_psample_stats.pkts_f_psample_cb++;
+    PSAMPLE_STATS_INC(pkts_f_psample_cb);
 
     /* get psample group info. psample genetlink group ID passed in kf->dest_id */
     group = psample_group_get_from_list(kf->dest_id);
     if (!group) {
         gprintk("%s: Could not find psample genetlink group %d\n", __func__, kf->cb_user_data);
-        g_psample_stats.pkts_d_no_group++;
+        PSAMPLE_STATS_INC(pkts_d_no_group);
         goto PSAMPLE_FILTER_CB_PKT_HANDLED;
     }
 
@@ -391,13 +439,13 @@ psample_filter_cb(uint8_t *pkt, int size, int dev_no, void *pkt_meta,
     rv = psample_meta_get(dev_no, kf, pkt_meta, &meta);
     if (rv < 0) {
         gprintk("%s: Could not parse pkt metadata\n", __func__);
-        g_psample_stats.pkts_d_metadata++;
+        PSAMPLE_STATS_INC(pkts_d_metadata);
         goto PSAMPLE_FILTER_CB_PKT_HANDLED;
     }
 
     /* Adjust original pkt size to remove 4B FCS */
     if (size < FCS_SZ) {
-        g_psample_stats.pkts_d_invalid_size++;
+        PSAMPLE_STATS_INC(pkts_d_invalid_size);
         goto PSAMPLE_FILTER_CB_PKT_HANDLED;
     } else {
        size -= FCS_SZ;
@@ -407,65 +455,66 @@ psample_filter_cb(uint8_t *pkt, int size, int dev_no, void *pkt_meta,
     if (meta.trunc_size >= size) {
         meta.trunc_size = size - PSAMPLE_NLA_PADDING;
     }
+    if (meta.trunc_size < 0) {
+        PSAMPLE_STATS_INC(pkts_d_invalid_size);
+        goto PSAMPLE_FILTER_CB_PKT_HANDLED;
+    }
 
     PSAMPLE_CB_DBG_PRINT("%s: group 0x%x, trunc_size %d, src_ifdx 0x%x, dst_ifdx 0x%x, sample_rate %d\n",
             __func__, group->group_num, meta.trunc_size, meta.src_ifindex, meta.dst_ifindex, meta.sample_rate);
 
     /* drop if configured sample rate is 0 */
     if (meta.sample_rate > 0) {
-        unsigned long flags;
-        psample_pkt_t *psample_pkt;
-        struct sk_buff *skb;
-
-        if (g_psample_stats.pkts_c_qlen_cur >= psample_qlen) {
-            gprintk("%s: tail drop due to max qlen %d reached\n", __func__, psample_qlen);
-            g_psample_stats.pkts_d_qlen_max++;
-            goto PSAMPLE_FILTER_CB_PKT_HANDLED;
-        }
+        psample_ring_t *ring;
+        psample_slot_t *slot;
+        unsigned int head, tail, qlen, idx;
 
-        if ((psample_pkt = kmalloc(sizeof(psample_pkt_t), GFP_ATOMIC)) == NULL) {
-            gprintk("%s: failed to alloc psample mem for pkt\n", __func__);
-            g_psample_stats.pkts_d_no_mem++;
-            goto PSAMPLE_FILTER_CB_PKT_HANDLED;
+        /* samples are kept in slots of psample_size bytes */
+        if (meta.trunc_size > psample_size) {
+            meta.trunc_size = psample_size;
         }
-        memcpy(&psample_pkt->meta, &meta, sizeof(psample_meta_t));
-        psample_pkt->group = group;
 
-        if ((skb = dev_alloc_skb(meta.trunc_size)) == NULL) {
-            gprintk("%s: failed to alloc psample mem for pkt skb\n", __func__);
-            g_psample_stats.pkts_d_no_mem++;
+        /*
+         * Called from the Rx path of KNET only, so the ring of this CPU has
+         * a single producer. The tail is moved by the work.
+         */
+        ring = this_cpu_ptr(g_psample_work.rings);
+        head = ring->head;
+        tail = smp_load_acquire(&ring->tail);
+        qlen = head - tail;
+        if (qlen >= g_psample_work.ring_size) {
+            PSAMPLE_CB_DBG_PRINT("%s: tail drop due to max qlen %u reached\n",
+                                 __func__, g_psample_work.ring_size);
+            PSAMPLE_STATS_INC(pkts_d_qlen_max);
             goto PSAMPLE_FILTER_CB_PKT_HANDLED;
         }
 
-        /* setup skb to point to pkt */
-        memcpy(skb->data, pkt, meta.trunc_size);
-        skb_put(skb, meta.trunc_size);
-        /* save original size for PSAMPLE_ATTR_ORIGSIZE in skb->len */
-        skb->len = size;
-        psample_pkt->skb = skb;
-
-        spin_lock_irqsave(&g_psample_work.lock, flags);
-        list_add_tail(&psample_pkt->list, &g_psample_work.pkt_list);
-
-        g_psample_stats.pkts_c_qlen_cur++;
-        if (g_psample_stats.pkts_c_qlen_cur > g_psample_stats.pkts_c_qlen_hi) {
-            g_psample_stats.pkts_c_qlen_hi = g_psample_stats.pkts_c_qlen_cur;
+        idx = head & (g_psample_work.ring_size - 1);
+        slot = &ring->slots[idx];
+        memcpy(&slot->meta, &meta, sizeof(psample_meta_t));
+        slot->group = group;
+        memcpy(ring->data + idx * psample_size, pkt, meta.trunc_size);
+        /* save original size for PSAMPLE_ATTR_ORIGSIZE */
+        slot->pkt_len = size;
+
+        smp_store_release(&ring->head, head + 1);
+        if (qlen + 1 > __this_cpu_read(g_psample_stats.pkts_c_qlen_hi)) {
+            __this_cpu_write(g_psample_stats.pkts_c_qlen_hi, qlen + 1);
         }
 
         schedule_work(&g_psample_work.wq);
-        spin_unlock_irqrestore(&g_psample_work.lock, flags);
     } else {
-        g_psample_stats.pkts_d_sampling_disabled++;
+        PSAMPLE_STATS_INC(pkts_d_sampling_disabled);
     }
 
 PSAMPLE_FILTER_CB_PKT_HANDLED:
     /* if sample reason only, consume pkt. else pass through */
     if (meta.sample_type == SAMPLE_TYPE_INGRESS ||
         meta.sample_type == SAMPLE_TYPE_EGRESS) {
-        g_psample_stats.pkts_f_handled++;
+        PSAMPLE_STATS_INC(pkts_f_handled);
         return 1;
     }
-    g_psample_stats.pkts_f_pass_through++;
+    PSAMPLE_STATS_INC(pkts_f_pass_through);
     return 0;
 }
 
@@ -611,7 +660,7 @@ static ssize_t
 psample_proc_size_write(struct file *file, const char *buf,
                     size_t count, loff_t *loff)
 {
-    int netif_cnt;
+    int netif_cnt, size;
     char sample_str[40], *ptr, *newline;
 
     if (count > sizeof(sample_str)) {
@@ -635,8 +684,15 @@ psample_proc_size_write(struct file *file, const char *buf,
     }
     *ptr++ = 0;
 
+    size = simple_strtol(ptr, NULL, 10);
+    if (size < 0 || size > psample_size) {
+        gprintk("Error: Pkt sample size %d is not within psample_size %d\n",
+                size, psample_size);
+        return count;
+    }
+
     netif_cnt = bcmgenl_netif_search(sample_str, proc_size_write,
-                                     (void *)(uintptr_t)simple_strtol(ptr, NULL, 10));
+                                     (void *)(uintptr_t)size);
     if (netif_cnt <= 0) {
         gprintk("Warning: Failed setting psample size on "
                 "unknown network interface: '%s'\n", sample_str);
@@ -663,7 +719,9 @@ psample_proc_debug_show(struct seq_file *m, void *v)
     seq_printf(m, "BCM KNET %s Callback Config\n", PSAMPLE_GENL_NAME);
     seq_printf(m, "  debug:           0x%x\n", debug);
     seq_printf(m, "  netif_count:     %d\n",   bcmgenl_netif_num_get());
-    seq_printf(m, "  queue length:    %d\n",   psample_qlen);
+    seq_printf(m, "  queue length:    %u per cpu\n", g_psample_work.ring_size);
+    seq_printf(m, "  queue budget:    %d\n",   psample_budget);
+    seq_printf(m, "  sample size:     %d\n",   psample_size);
 
     return 0;
 }
@@ -719,26 +777,56 @@ struct proc_ops psample_proc_debug_file_ops = {
     .proc_release =    single_release,
 };
 
+/* Sum up the counters of all CPUs */
+static void
+psample_stats_get(psample_stats_t *stats)
+{
+    psample_stats_t *cpu_stats;
+    unsigned long *sum = (unsigned long *)stats;
+    unsigned long *val, qlen_hi = 0;
+    psample_ring_t *ring;
+    int cpu, idx;
+
+    memset(stats, 0, sizeof(*stats));
+    for_each_possible_cpu(cpu) {
+        cpu_stats = per_cpu_ptr(&g_psample_stats, cpu);
+        val = (unsigned long *)cpu_stats;
+        for (idx = 0; idx < sizeof(*stats) / sizeof(unsigned long); idx++) {
+            sum[idx] += READ_ONCE(val[idx]);
+        }
+        qlen_hi = max(qlen_hi, READ_ONCE(cpu_stats->pkts_c_qlen_hi));
+        if (g_psample_work.rings) {
+            ring = per_cpu_ptr(g_psample_work.rings, cpu);
+            stats->pkts_c_qlen_cur += READ_ONCE(ring->head) - READ_ONCE(ring->tail);
+        }
+    }
+    /* the high queue length is the highest of all rings */
+    stats->pkts_c_qlen_hi = qlen_hi;
+}
+
 static int
 psample_proc_stats_show(struct seq_file *m, void *v)
 {
+    psample_stats_t stats;
+
+    psample_stats_get(&stats);
+
     seq_printf(m, "BCM KNET %s Callback Stats\n", PSAMPLE_GENL_NAME);
-    seq_printf(m, "  pkts filter psample cb         %10lu\n", g_psample_stats.pkts_f_psample_cb);
-    seq_printf(m, "  pkts sent to psample module    %10lu\n", g_psample_stats.pkts_f_psample_mod);
-    seq_printf(m, "  pkts handled by psample        %10lu\n", g_psample_stats.pkts_f_handled);
-    seq_printf(m, "  pkts pass through              %10lu\n", g_psample_stats.pkts_f_pass_through);
-    seq_printf(m, "  pkts with mc destination       %10lu\n", g_psample_stats.pkts_f_dst_mc);
-    seq_printf(m, "  pkts current queue length      %10lu\n", g_psample_stats.pkts_c_qlen_cur);
-    seq_printf(m, "  pkts high queue length         %10lu\n", g_psample_stats.pkts_c_qlen_hi);
-    seq_printf(m, "  pkts drop max queue length     %10lu\n", g_psample_stats.pkts_d_qlen_max);
-    seq_printf(m, "  pkts drop no memory            %10lu\n", g_psample_stats.pkts_d_no_mem);
-    seq_printf(m, "  pkts drop no psample group     %10lu\n", g_psample_stats.pkts_d_no_group);
-    seq_printf(m, "  pkts drop sampling disabled    %10lu\n", g_psample_stats.pkts_d_sampling_disabled);
-    seq_printf(m, "  pkts drop psample not ready    %10lu\n", g_psample_stats.pkts_d_not_ready);
-    seq_printf(m, "  pkts drop metadata parse error %10lu\n", g_psample_stats.pkts_d_metadata);
-    seq_printf(m, "  pkts with invalid src port     %10lu\n", g_psample_stats.pkts_d_meta_srcport);
-    seq_printf(m, "  pkts with invalid dst port     %10lu\n", g_psample_stats.pkts_d_meta_dstport);
-    seq_printf(m, "  pkts with invalid orig pkt sz  %10lu\n", g_psample_stats.pkts_d_invalid_size);
+    seq_printf(m, "  pkts filter psample cb         %10lu\n", stats.pkts_f_psample_cb);
+    seq_printf(m, "  pkts sent to psample module    %10lu\n", stats.pkts_f_psample_mod);
+    seq_printf(m, "  pkts handled by psample        %10lu\n", stats.pkts_f_handled);
+    seq_printf(m, "  pkts pass through              %10lu\n", stats.pkts_f_pass_through);
+    seq_printf(m, "  pkts with mc destination       %10lu\n", stats.pkts_f_dst_mc);
+    seq_printf(m, "  pkts current queue length      %10lu\n", stats.pkts_c_qlen_cur);
+    seq_printf(m, "  pkts high queue length         %10lu\n", stats.pkts_c_qlen_hi);
+    seq_printf(m, "  pkts drop max queue length     %10lu\n", stats.pkts_d_qlen_max);
+    seq_printf(m, "  pkts drop no psample group     %10lu\n", stats.pkts_d_no_group);
+    seq_printf(m, "  pkts drop sampling disabled    %10lu\n", stats.pkts_d_sampling_disabled);
+    seq_printf(m, "  pkts drop psample not ready    %10lu\n", stats.pkts_d_not_ready);
+    seq_printf(m, "  pkts drop metadata parse error %10lu\n", stats.pkts_d_metadata);
+    seq_printf(m, "  pkts with invalid src port     %10lu\n", stats.pkts_d_meta_srcport);
+    seq_printf(m, "  pkts with invalid dst port     %10lu\n", stats.pkts_d_meta_dstport);
+    seq_printf(m, "  pkts with invalid orig pkt sz  %10lu\n", stats.pkts_d_invalid_size);
     return 0;
 }
 
@@ -758,14 +846,12 @@ static ssize_t
 psample_proc_stats_write(struct file *file, const char *buf,
                     size_t count, loff_t *loff)
 {
-    int qlen_cur = 0;
-    unsigned long flags;
+    int cpu;
 
-    spin_lock_irqsave(&g_psample_work.lock, flags);
-    qlen_cur = g_psample_stats.pkts_c_qlen_cur;
-    memset(&g_psample_stats, 0, sizeof(psample_stats_t));
-    g_psample_stats.pkts_c_qlen_cur = qlen_cur;
-    spin_unlock_irqrestore(&g_psample_work.lock, flags);
+    /* the current queue length is taken from the rings */
+    for_each_possible_cpu(cpu) {
+        memset(per_cpu_ptr(&g_psample_stats, cpu), 0, sizeof(psample_stats_t));
+    }
 
     return count;
 }
@@ -838,19 +924,59 @@ psample_proc_cleanup(void)
     return 0;
 }
 
+static void
+psample_rings_free(void)
+{
+    psample_ring_t *ring;
+    int cpu;
+
+    if (!g_psample_work.rings) {
+        return;
+    }
+    for_each_possible_cpu(cpu) {
+        ring = per_cpu_ptr(g_psample_work.rings, cpu);
+        vfree(ring->slots);
+        vfree(ring->data);
+    }
+    free_percpu(g_psample_work.rings);
+    g_psample_work.rings = NULL;
+}
+
+static int
+psample_rings_alloc(void)
+{
+    psample_ring_t *ring;
+    unsigned int size = g_psample_work.ring_size;
+    int cpu;
+
+    g_psample_work.rings = alloc_percpu(psample_ring_t);
+    if (!g_psample_work.rings) {
+        return -1;
+    }
+    for_each_possible_cpu(cpu) {
+        ring = per_cpu_ptr(g_psample_work.rings, cpu);
+        ring->slots = vzalloc_node(size * sizeof(psample_slot_t), cpu_to_node(cpu));
+        ring->data = vmalloc_node(size * psample_size, cpu_to_node(cpu));
+        if (!ring->slots || !ring->data) {
+            psample_rings_free();
+            return -1;
+        }
+    }
+    return 0;
+}
+
 static int
 psample_cleanup(void)
 {
-    psample_pkt_t *pkt;
     psample_group_data_t *grp;
 
     cancel_work_sync(&g_psample_work.wq);
 
-    while (!list_empty(&g_psample_work.pkt_list)) {
-        pkt = list_entry(g_psample_work.pkt_list.next, psample_pkt_t, list);
-        list_del(&pkt->list);
-        dev_kfree_skb_any(pkt->skb);
-        kfree(pkt);
+    /* samples left in the rings are dropped */
+    psample_rings_free();
+    if (g_psample_work.skb) {
+        dev_kfree_skb_any(g_psample_work.skb);
+        g_psample_work.skb = NULL;
     }
 
     while (!list_empty(&g_psample_info.group_list)) {
@@ -867,8 +993,12 @@ psample_cleanup(void)
 static int
 psample_init(void)
 {
+    int cpu;
+
     /* clear data structs */
-    memset(&g_psample_stats, 0, sizeof(psample_stats_t));
+    for_each_possible_cpu(cpu) {
+        memset(per_cpu_ptr(&g_psample_stats, cpu), 0, sizeof(psample_stats_t));
+    }
     memset(&g_psample_info, 0, sizeof(psample_info_t));
     memset(&g_psample_work, 0, sizeof(psample_work_t));
 
@@ -876,8 +1006,28 @@ psample_init(void)
     INIT_LIST_HEAD(&g_psample_info.group_list);
 
     /* setup psample work queue */
-    spin_lock_init(&g_psample_work.lock);
-    INIT_LIST_HEAD(&g_psample_work.pkt_list);
+    if (psample_size <= 0) {
+        psample_size = PSAMPLE_SIZE_DFLT;
+    }
+    if (psample_qlen <= 0) {
+        psample_qlen = PSAMPLE_QLEN_DFLT;
+    }
+    if (psample_budget <= 0) {
+        psample_budget = PSAMPLE_BUDGET_DFLT;
+    }
+    g_psample_work.ring_size = roundup_pow_of_two(psample_qlen);
+    if (psample_rings_alloc() < 0) {
+        gprintk("%s: failed to alloc psample rings of %u samples\n",
+                __func__, g_psample_work.ring_size);
+        return -1;
+    }
+    g_psample_work.skb = dev_alloc_skb(psample_size);
+    if (!g_psample_work.skb) {
+        gprintk("%s: failed to alloc psample skb\n", __func__);
+        psample_rings_free();
+        return -1;
+    }
+    g_psample_work.skb_headroom = skb_headroom(g_psample_work.skb);
     INIT_WORK(&g_psample_work.wq, psample_task);
 
     /* get net namespace */
@@ -885,30 +1035,36 @@ psample_init(void)
     if (!g_psample_info.netns) {
         gprintk("%s: Could not get network namespace for pid %d\n",
                 __func__, current->pid);
+        psample_cleanup();
         return -1;
     }
-    PSAMPLE_CB_DBG_PRINT("%s: current->pid %d, netns 0x%p, sample_size %d\n",
+    PSAMPLE_CB_DBG_PRINT("%s: current->pid %d, netns 0x%p, sample_size %d, ring_size %u\n",
                          __func__,
-                         current->pid, g_psample_info.netns, psample_size);
+                         current->pid, g_psample_info.netns, psample_size,
+                         g_psample_work.ring_size);
 
     return 0;
 }
 
 int bcmgenl_psample_cleanup(void)
 {
+    bkn_filter_cb_unregister(psample_filter_cb);
     psample_cleanup();
     psample_proc_cleanup();
-    bkn_filter_cb_unregister(psample_filter_cb);
     return 0;
 }
 
 int
 bcmgenl_psample_init(char *procfs_path)
 {
+    /* rings are set up before samples may come in */
+    if (psample_init() < 0) {
+        return -1;
+    }
     bkn_filter_cb_register_by_name(psample_filter_cb, PSAMPLE_GENL_NAME);
     bcmgenl_netif_default_sample_set(PSAMPLE_RATE_DFLT, PSAMPLE_SIZE_DFLT);
     psample_proc_init(procfs_path);
-    return psample_init();
+    return 0;
 }
 
 #else
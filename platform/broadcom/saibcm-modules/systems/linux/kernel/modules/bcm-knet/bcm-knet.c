@@ -80,6 +80,8 @@
 #include <linux/seq_file.h>
 #include <linux/if_vlan.h>
 #include <linux/nsproxy.h>
+#include <linux/jhash.h>
+#include <linux/percpu.h>
 
 
 MODULE_AUTHOR("Broadcom Corporation");
@@ -647,6 +649,7 @@ typedef struct bkn_switch_info_s {
     struct net_device **ndevs;  /* Indexed array of ndev_list */
     int ndev_max;               /* Size of indexed array */
     struct list_head rxpf_list; /* Associated Rx packet filters */
+    struct bkn_filter_tbl_s *rxpf_tbl; /* Compiled Rx packet filters */
     volatile void *base_addr;   /* Base address for PCI register access */
     struct BKN_DMA_DEV *dma_dev;    /* Required for DMA memory control */
     struct pci_dev *pdev;       /* Required for DMA memory control */
@@ -1071,11 +1074,52 @@ typedef struct bkn_priv_s {
 typedef struct bkn_filter_s {
     struct list_head list;
     int dev_no;
-    unsigned long hits;
+    unsigned long __percpu *hits;   /* Per CPU, see bkn_filter_hits */
     kcom_filter_t kf;
     knet_filter_cb_f cb;
 } bkn_filter_t;
 
+/*
+ * Compiled Rx packet filters
+ *
+ * Filters extracting the same OOB and packet data with the same mask are
+ * grouped, and hashed on their data. A packet is then looked up once per
+ * group instead of once per filter. Entries are ranked by their position
+ * in rxpf_list, and the lowest ranked match wins as with the list walk.
+ * The Rx channels each filter applies to are resolved from its priority
+ * when compiling.
+ *
+ * The table is rebuilt in place under sinfo->lock whenever rxpf_list or
+ * the number of Rx channels changes.
+ */
+#define BKN_FILTER_TBL_BUCKETS  (2 * KCOM_FILTER_MAX)
+
+typedef struct bkn_filter_ent_s {
+    struct bkn_filter_ent_s *next;  /* Next in hash bucket, in rank order */
+    bkn_filter_t *filter;
+    int rank;                       /* Position in rxpf_list */
+    int group;
+    uint32_t chans;                 /* Rx channels the filter applies to */
+} bkn_filter_ent_t;
+
+typedef struct bkn_filter_grp_s {
+    int min_rank;                   /* Rank of first entry in group */
+    int oob_data_offset;
+    int oob_data_size;
+    int pkt_data_offset;
+    int pkt_data_size;
+    int wsize;
+    uint32_t *mask;
+} bkn_filter_grp_t;
+
+typedef struct bkn_filter_tbl_s {
+    int num_ents;
+    int num_grps;
+    bkn_filter_ent_t ent[KCOM_FILTER_MAX];
+    bkn_filter_grp_t grp[KCOM_FILTER_MAX];  /* In order of min_rank */
+    bkn_filter_ent_t *bucket[BKN_FILTER_TBL_BUCKETS];
+} bkn_filter_tbl_t;
+
 
 /*
  * Multiple instance support in KNET
@@ -3063,99 +3107,224 @@ device_is_sand(bkn_switch_info_t *sinfo)
     return (is_dpp | is_dnx);
 }
 
-static bkn_filter_t *
-bkn_match_rx_pkt(bkn_switch_info_t *sinfo, uint8_t *pkt, int pktlen,
-                 void *meta, int chan, bkn_filter_t *cbf)
+static unsigned long
+bkn_filter_hits(bkn_filter_t *filter)
+{
+    unsigned long hits = 0;
+    int cpu;
+
+    for_each_possible_cpu(cpu) {
+        hits += *per_cpu_ptr(filter->hits, cpu);
+    }
+    return hits;
+}
+
+static void
+bkn_filter_hits_clear(bkn_filter_t *filter)
+{
+    int cpu;
+
+    for_each_possible_cpu(cpu) {
+        *per_cpu_ptr(filter->hits, cpu) = 0;
+    }
+}
+
+static void
+bkn_filter_free(bkn_filter_t *filter)
+{
+    free_percpu(filter->hits);
+    kfree(filter);
+}
+
+static int
+bkn_filter_chan_match(bkn_switch_info_t *sinfo, kcom_filter_t *kf, int chan)
+{
+    if (device_is_dnx(sinfo) && kf->priority == 0) {
+        /*
+         * Mutliple RX channels are enabled on JR2 and above devices
+         * Bind between priority 0 and RX channel 0 is not checked, then all enabled RX channels can receive packets.
+         */
+        return 1;
+    }
+    if (kf->priority < (num_rx_prio * sinfo->rx_chans)) {
+        if (kf->priority < (num_rx_prio * chan) ||
+            kf->priority >= (num_rx_prio * (chan + 1))) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static inline uint32_t
+bkn_filter_hash(uint32_t *data, int wsize, int group)
+{
+    return jhash2(data, wsize, group) & (BKN_FILTER_TBL_BUCKETS - 1);
+}
+
+/*
+ * Compile rxpf_list into the filter table.
+ * Called with sinfo->lock held.
+ */
+static void
+bkn_filter_tbl_build(bkn_switch_info_t *sinfo)
 {
+    bkn_filter_tbl_t *tbl = sinfo->rxpf_tbl;
     struct list_head *list;
     bkn_filter_t *filter;
-    kcom_filter_t scratch, *kf;
-    uint8_t *oob = (uint8_t *)meta;
-    int size, wsize;
-    int idx, match;
-    knet_filter_cb_f filter_cb;
+    bkn_filter_ent_t *ent;
+    bkn_filter_grp_t *grp;
+    kcom_filter_t *kf;
+    uint32_t hash;
+    int chan, gi, idx, wsize;
+
+    if (tbl == NULL) {
+        return;
+    }
+    memset(tbl, 0, sizeof(*tbl));
 
     list_for_each(list, &sinfo->rxpf_list) {
+        if (tbl->num_ents >= KCOM_FILTER_MAX) {
+            break;
+        }
         filter = (bkn_filter_t *)list;
         kf = &filter->kf;
-        if (kf->pkt_data_offset + kf->pkt_data_size > pktlen) {
-            continue;
+        ent = &tbl->ent[tbl->num_ents];
+        ent->filter = filter;
+        ent->rank = tbl->num_ents++;
+        for (chan = 0; chan < NUM_RX_CHAN; chan++) {
+            if (bkn_filter_chan_match(sinfo, kf, chan)) {
+                ent->chans |= 1 << chan;
+            }
+        }
+
+        wsize = BYTES2WORDS(kf->oob_data_size + kf->pkt_data_size);
+        for (gi = 0; gi < tbl->num_grps; gi++) {
+            grp = &tbl->grp[gi];
+            if (grp->oob_data_offset == kf->oob_data_offset &&
+                grp->oob_data_size == kf->oob_data_size &&
+                grp->pkt_data_offset == kf->pkt_data_offset &&
+                grp->pkt_data_size == kf->pkt_data_size &&
+                memcmp(grp->mask, kf->mask.w, wsize * sizeof(uint32_t)) == 0) {
+                break;
+            }
+        }
+        if (gi == tbl->num_grps) {
+            grp = &tbl->grp[tbl->num_grps++];
+            grp->min_rank = ent->rank;
+            grp->oob_data_offset = kf->oob_data_offset;
+            grp->oob_data_size = kf->oob_data_size;
+            grp->pkt_data_offset = kf->pkt_data_offset;
+            grp->pkt_data_size = kf->pkt_data_size;
+            grp->wsize = wsize;
+            grp->mask = kf->mask.w;
         }
-        memcpy(&scratch.data.b[0],
-               &oob[kf->oob_data_offset], kf->oob_data_size);
-        memcpy(&scratch.data.b[kf->oob_data_size],
-               &pkt[kf->pkt_data_offset], kf->pkt_data_size);
-        size = kf->oob_data_size + kf->pkt_data_size;
-        wsize = BYTES2WORDS(size);
-        DBG_VERB(("Filter: size = %d (%d), data = 0x%08x, mask = 0x%08x\n",
-                  size, wsize, kf->data.w[0], kf->mask.w[0]));
+        ent->group = gi;
+    }
 
-        if (device_is_sand(sinfo)) {
-            DBG_DUNE(("Filter: size = %d (wsize %d)\n", size, wsize));
-            for (idx = 0; idx < wsize; idx++)
-            {
-                DBG_DUNE(("OOB[%d]: 0x%08x [0x%08x]\n", idx, kf->data.w[idx], kf->mask.w[idx]));
+    /* Chain from the highest rank, so that buckets are in rank order */
+    for (idx = tbl->num_ents - 1; idx >= 0; idx--) {
+        ent = &tbl->ent[idx];
+        hash = bkn_filter_hash(ent->filter->kf.data.w,
+                               tbl->grp[ent->group].wsize, ent->group);
+        ent->next = tbl->bucket[hash];
+        tbl->bucket[hash] = ent;
+    }
+}
+
+static bkn_filter_t *
+bkn_match_rx_pkt(bkn_switch_info_t *sinfo, uint8_t *pkt, int pktlen,
+                 void *meta, int chan, bkn_filter_t *cbf)
+{
+    bkn_filter_tbl_t *tbl = sinfo->rxpf_tbl;
+    bkn_filter_ent_t *ent, *best;
+    bkn_filter_grp_t *grp;
+    bkn_filter_t *filter;
+    kcom_filter_t *kf;
+    uint32_t scratch[KCOM_FILTER_WORDS_MAX];
+    uint8_t *oob = (uint8_t *)meta;
+    uint32_t chan_bit;
+    int gi, idx, last = -1;
+    knet_filter_cb_f filter_cb;
+
+    if (tbl == NULL || chan < 0 || chan >= NUM_RX_CHAN) {
+        return NULL;
+    }
+    chan_bit = 1 << chan;
+
+    /* Lowest ranked match after the last one refused by callback */
+    while (1) {
+        best = NULL;
+        for (gi = 0; gi < tbl->num_grps; gi++) {
+            grp = &tbl->grp[gi];
+            if (best && grp->min_rank > best->rank) {
+                break;
             }
-            DBG_DUNE(("Meta Data [+ Selected Raw packet data]\n"));
-            for (idx = 0; idx < wsize; idx++)
-            {
-                DBG_DUNE(("Scratch[%d]: 0x%08x\n", idx, scratch.data.w[idx]));
+            if (grp->pkt_data_offset + grp->pkt_data_size > pktlen) {
+                continue;
             }
-        }
+            if (grp->wsize) {
+                scratch[grp->wsize - 1] = 0;
+            }
+            memcpy((uint8_t *)scratch,
+                   &oob[grp->oob_data_offset], grp->oob_data_size);
+            memcpy((uint8_t *)scratch + grp->oob_data_size,
+                   &pkt[grp->pkt_data_offset], grp->pkt_data_size);
+            DBG_VERB(("Filter group %d: size = %d (%d), mask = 0x%08x\n",
+                      gi, grp->oob_data_size + grp->pkt_data_size,
+                      grp->wsize, grp->mask[0]));
 
-        match = 1;
-        if (match) {
-            if (device_is_dnx(sinfo))
-            {
-                /*
-                 * Mutliple RX channels are enabled on JR2 and above devices
-                 * Bind between priority 0 and RX channel 0 is not checked, then all enabled RX channels can receive packets.
-                 */
-                if (kf->priority && (kf->priority < (num_rx_prio * sinfo->rx_chans))) {
-                    if (kf->priority < (num_rx_prio * chan) ||
-                        kf->priority >= (num_rx_prio * (chan + 1))) {
-                        match = 0;
-                    }
+            if (device_is_sand(sinfo)) {
+                DBG_DUNE(("Meta Data [+ Selected Raw packet data]\n"));
+                for (idx = 0; idx < grp->wsize; idx++)
+                {
+                    DBG_DUNE(("Scratch[%d]: 0x%08x [0x%08x]\n", idx, scratch[idx], grp->mask[idx]));
                 }
             }
-            else {
-                if (kf->priority < (num_rx_prio * sinfo->rx_chans)) {
-                    if (kf->priority < (num_rx_prio * chan) ||
-                        kf->priority >= (num_rx_prio * (chan + 1))) {
-                        match = 0;
-                    }
-                }
+
+            for (idx = 0; idx < grp->wsize; idx++) {
+                scratch[idx] &= grp->mask[idx];
             }
-        }
-        if (match) {
-            for (idx = 0; idx < wsize; idx++) {
-                scratch.data.w[idx] &= kf->mask.w[idx];
-                if (scratch.data.w[idx] != kf->data.w[idx]) {
-                    match = 0;
+            ent = tbl->bucket[bkn_filter_hash(scratch, grp->wsize, gi)];
+            for (; ent != NULL; ent = ent->next) {
+                if (best && ent->rank > best->rank) {
+                    break;
+                }
+                if (ent->group != gi || ent->rank <= last ||
+                    !(ent->chans & chan_bit)) {
+                    continue;
+                }
+                if (memcmp(scratch, ent->filter->kf.data.w,
+                           grp->wsize * sizeof(uint32_t)) == 0) {
+                    best = ent;
                     break;
                 }
             }
         }
-        if (match) {
-            if (kf->dest_type == KCOM_DEST_T_CB) {
-                /* Check for custom filters */
-                filter_cb = filter->cb ? filter->cb : knet_filter_cb;
-                if (filter_cb != NULL && cbf != NULL) {
-                    memset(cbf, 0, sizeof(*cbf));
-                    memcpy(&cbf->kf, kf, sizeof(cbf->kf));
-                    if (filter_cb(pkt, pktlen, sinfo->dev_no,
-                                  meta, chan, &cbf->kf)) {
-                        filter->hits++;
-                        return cbf;
-                    }
-                } else {
-                    DBG_FLTR(("Match, but not filter callback\n"));
+        if (best == NULL) {
+            break;
+        }
+
+        filter = best->filter;
+        kf = &filter->kf;
+        if (kf->dest_type == KCOM_DEST_T_CB) {
+            /* Check for custom filters */
+            filter_cb = filter->cb ? filter->cb : knet_filter_cb;
+            if (filter_cb != NULL && cbf != NULL) {
+                memset(cbf, 0, sizeof(*cbf));
+                memcpy(&cbf->kf, kf, sizeof(cbf->kf));
+                if (filter_cb(pkt, pktlen, sinfo->dev_no,
+                              meta, chan, &cbf->kf)) {
+                    this_cpu_inc(*filter->hits);
+                    return cbf;
                 }
             } else {
-                filter->hits++;
-                return filter;
+                DBG_FLTR(("Match, but not filter callback\n"));
             }
+        } else {
+            this_cpu_inc(*filter->hits);
+            return filter;
         }
+        last = best->rank;
     }
 
     return NULL;
@@ -7491,6 +7660,7 @@ bkn_destroy_sinfo(bkn_switch_info_t *sinfo)
 {
     list_del(&sinfo->list);
     bkn_free_dcbs(sinfo);
+    kfree(sinfo->rxpf_tbl);
     kfree(sinfo);
 }
 
@@ -7504,6 +7674,10 @@ bkn_create_sinfo(int dev_no)
         return NULL;
     }
     memset(sinfo, 0, sizeof(*sinfo));
+    if ((sinfo->rxpf_tbl = kzalloc(sizeof(*sinfo->rxpf_tbl), GFP_KERNEL)) == NULL) {
+        kfree(sinfo);
+        return NULL;
+    }
     INIT_LIST_HEAD(&sinfo->ndev_list);
     INIT_LIST_HEAD(&sinfo->rxpf_list);
     sinfo->base_addr = lkbde_get_dev_virt(dev_no);
@@ -8467,7 +8641,7 @@ bkn_proc_stats_show(struct seq_file *m, void *v)
             filter = (bkn_filter_t *)flist;
 
             seq_printf(m, "  Filter %d stats:\n", filter->kf.id);
-            seq_printf(m, "    Hits      %10lu\n", filter->hits);
+            seq_printf(m, "    Hits      %10lu\n", bkn_filter_hits(filter));
         }
 
         unit++;
@@ -8543,7 +8717,7 @@ bkn_proc_stats_write(struct file *file, const char *buf,
         sinfo->napi_not_done = 0;
         list_for_each(flist, &sinfo->rxpf_list) {
             filter = (bkn_filter_t *)flist;
-            filter->hits = 0;
+            bkn_filter_hits_clear(filter);
         }
     }
 
@@ -9388,6 +9562,8 @@ bkn_knet_hw_init(kcom_msg_hw_init_t *kmsg, int len)
     if (sinfo->rx_chans > NUM_RX_CHAN) {
         sinfo->rx_chans = NUM_RX_CHAN;
     }
+    /* Channels of filters depend on device type and Rx channels */
+    bkn_filter_tbl_build(sinfo);
 
     DBG_DUNE(("CMIC:%c DCB:%d WSIZE:%d DMA HI: 0x%08x HDR size: %d\n",
         sinfo->cmic_type, sinfo->dcb_type, sinfo->dcb_wsize,
@@ -10023,6 +10199,12 @@ bkn_knet_filter_create(kcom_msg_filter_create_t *kmsg, int len)
         return sizeof(kcom_msg_hdr_t);
     }
     memset(filter, 0, sizeof(*filter));
+    filter->hits = alloc_percpu(unsigned long);
+    if (filter->hits == NULL) {
+        kfree(filter);
+        kmsg->hdr.status = KCOM_E_RESOURCE;
+        return sizeof(kcom_msg_hdr_t);
+    }
     memcpy(&filter->kf, &kmsg->filter, sizeof(filter->kf));
     filter->kf.id = id;
     /* Check for filter-specific callback */
@@ -10051,6 +10233,7 @@ bkn_knet_filter_create(kcom_msg_filter_create_t *kmsg, int len)
     if (!found) {
         list_add_tail(&filter->list, &sinfo->rxpf_list);
     }
+    bkn_filter_tbl_build(sinfo);
 
     kmsg->filter.id = filter->kf.id;
 
@@ -10114,11 +10297,12 @@ bkn_knet_filter_destroy(kcom_msg_filter_destroy_t *kmsg, int len)
     }
 
     list_del(&filter->list);
+    bkn_filter_tbl_build(sinfo);
 
     cfg_api_unlock(sinfo, &flags);
 
     DBG_VERB(("Removing filter ID %d.\n", filter->kf.id));
-    kfree(filter);
+    bkn_filter_free(filter);
 
     return sizeof(kcom_msg_hdr_t);
 }
@@ -10542,7 +10726,7 @@ _cleanup(void)
             filter = list_entry(sinfo->rxpf_list.next, bkn_filter_t, list);
             list_del(&filter->list);
             DBG_VERB(("Removing filter ID %d.\n", filter->kf.id));
-            kfree(filter);
+            bkn_filter_free(filter);
         }
 
         /* Destroy all associated virtual net devices */
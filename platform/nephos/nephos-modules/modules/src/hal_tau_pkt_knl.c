@@ -147,8 +147,58 @@ static HAL_TAU_PKT_INTR_VEC_T           _hal_tau_pkt_intr_vec[] =
 
 #define HAL_TAU_PKT_NET_PROFILE_NUM_MAX         (256)
 
+/* Compiled profile table Definitions */
+#define HAL_TAU_PKT_PROF_BITMAP_SIZE            (NPS_BITMAP_SIZE(HAL_TAU_PKT_NET_PROFILE_NUM_MAX))
+#define HAL_TAU_PKT_PROF_PATTERN_WORD_NUM       (NPS_NETIF_PROFILE_PATTERN_LEN / sizeof(UI32_T))
+#define HAL_TAU_PKT_PROF_IPP_COPY2CPU_BIT_NUM   (16) /* width of itmh_eth.cp_to_cpu_bmap  */
+#define HAL_TAU_PKT_PROF_IPP_RSN_NUM            (16) /* width of itmh_eth.cp_to_cpu_code  */
+#define HAL_TAU_PKT_PROF_EPP_COPY2CPU_BIT_NUM   (8)  /* width of etmh_eth.cp_to_cpu_bmap  */
+
+/* Bitmap of profiles, indexed by the rank of profile */
+typedef UI32_T HAL_TAU_PKT_PROF_BITMAP_T[HAL_TAU_PKT_PROF_BITMAP_SIZE];
+
+typedef struct
+{
+    UI32_T                              offset;
+    UI32_T                              pattern[HAL_TAU_PKT_PROF_PATTERN_WORD_NUM]; /* masked */
+    UI32_T                              mask[HAL_TAU_PKT_PROF_PATTERN_WORD_NUM];
+
+} HAL_TAU_PKT_PROF_PATTERN_T;
+
+typedef struct
+{
+    HAL_TAU_PKT_NETIF_PROFILE_T         *ptr_profile;
+    UI32_T                              pattern_num;
+    HAL_TAU_PKT_PROF_PATTERN_T          pattern[NPS_NETIF_PROFILE_PATTERN_NUM];
+
+} HAL_TAU_PKT_PROF_RULE_T;
+
+/* The profiles compiled for Rx lookup.
+ * Profiles are ranked in the order of the profile lists of ports, i.e. by priority and then
+ * by creation, so that the lowest rank in a bitmap is the first profile to be checked.
+ * The reason bitmaps give the profiles hit by each Rx reason of a GPD.
+ */
+typedef struct
+{
+    UI32_T                              rule_num;
+    HAL_TAU_PKT_PROF_RULE_T             rule[HAL_TAU_PKT_NET_PROFILE_NUM_MAX];
+    UI32_T                              rank[HAL_TAU_PKT_NET_PROFILE_NUM_MAX]; /* indexed by id */
+    HAL_TAU_PKT_PROF_BITMAP_T           port_bitmap[HAL_TAU_PKT_MAX_PORT_NUM];
+    HAL_TAU_PKT_PROF_BITMAP_T           any_bitmap; /* the reason doesn't matter */
+    HAL_TAU_PKT_PROF_BITMAP_T           ipp_excpt[HAL_EXCPT_CPU_NUM];
+    HAL_TAU_PKT_PROF_BITMAP_T           ipp_l3_excpt[HAL_EXCPT_CPU_NUM];
+    HAL_TAU_PKT_PROF_BITMAP_T           ipp_copy2cpu[HAL_TAU_PKT_PROF_IPP_COPY2CPU_BIT_NUM];
+    HAL_TAU_PKT_PROF_BITMAP_T           ipp_rsn[HAL_TAU_PKT_PROF_IPP_RSN_NUM];
+    HAL_TAU_PKT_PROF_BITMAP_T           epp_excpt[HAL_TAU_PKT_EPP_EXCPT_LAST];
+    HAL_TAU_PKT_PROF_BITMAP_T           epp_copy2cpu[HAL_TAU_PKT_PROF_EPP_COPY2CPU_BIT_NUM];
+
+} HAL_TAU_PKT_PROF_TBL_T;
+
 static HAL_TAU_PKT_NETIF_PROFILE_T              *_ptr_hal_tau_pkt_profile_entry[HAL_TAU_PKT_NET_PROFILE_NUM_MAX] = {0};
+static UI32_T                                   _hal_tau_pkt_profile_seq[HAL_TAU_PKT_NET_PROFILE_NUM_MAX];
+static UI32_T                                   _hal_tau_pkt_profile_seq_next;
 static HAL_TAU_PKT_NETIF_PORT_DB_T              _hal_tau_pkt_port_db[HAL_TAU_PKT_MAX_PORT_NUM];
+static HAL_TAU_PKT_PROF_TBL_T                   _hal_tau_pkt_prof_tbl;
 
 /*****************************************************************************
  * MACRO VLAUE DECLARATIONS
@@ -2021,36 +2071,40 @@ _hal_tau_pkt_strictTxDeQueue(
     return (rc);
 }
 
+static void
+_hal_tau_pkt_orProfBitmap(
+    HAL_TAU_PKT_PROF_BITMAP_T       dst_bitmap,
+    const HAL_TAU_PKT_PROF_BITMAP_T src_bitmap)
+{
+    UI32_T                          idx;
+
+    for (idx=0; idx<HAL_TAU_PKT_PROF_BITMAP_SIZE; idx++)
+    {
+        dst_bitmap[idx] |= src_bitmap[idx];
+    }
+}
+
 /* FUNCTION NAME: _hal_tau_pkt_rxCheckReason
  * PURPOSE:
- *      To check the packets to linux kernel/user.
+ *      To get the profiles hit by the Rx reasons of the packet.
  * INPUT:
  *      ptr_rx_gpd      -- Pointer of the RX GPD
- *      ptr_hit_prof    -- Pointer of the hit flag
  * OUTPUT:
- *      None
+ *      prof_bitmap     -- The profiles hit by reason are added to it
  * RETURN:
- *      NPS_E_OK        -- Successfully dispatch the packets.
+ *      None
  * NOTES:
  *      Reference to pkt_srv.
  */
 static void
 _hal_tau_pkt_rxCheckReason(
     volatile HAL_TAU_PKT_RX_GPD_T   *ptr_rx_gpd,
-    HAL_TAU_PKT_NETIF_PROFILE_T     *ptr_profile,
-    BOOL_T                          *ptr_hit_prof)
+    HAL_TAU_PKT_PROF_BITMAP_T       prof_bitmap)
 {
-    HAL_PKT_RX_REASON_BITMAP_T      *ptr_reason_bitmap = &ptr_profile->reason_bitmap;
+    HAL_TAU_PKT_PROF_TBL_T          *ptr_tbl = &_hal_tau_pkt_prof_tbl;
     UI32_T                          bitval = 0;
     UI32_T                          bitmap = 0x0;
 
-    if (0 == (ptr_profile->flags & HAL_TAU_PKT_NETIF_PROFILE_FLAGS_REASON))
-    {
-        /* It means that reason doesn't metters */
-        *ptr_hit_prof = TRUE;
-        return;
-    }
-
 #define HAL_TAU_PKT_DI_NON_L3_CPU_MIN   (HAL_EXCPT_CPU_BASE_ID + HAL_EXCPT_CPU_NON_L3_MIN)
 #define HAL_TAU_PKT_DI_NON_L3_CPU_MAX   (HAL_EXCPT_CPU_BASE_ID + HAL_EXCPT_CPU_NON_L3_MAX)
 #define HAL_TAU_PKT_DI_L3_CPU_MIN       (HAL_EXCPT_CPU_BASE_ID + HAL_EXCPT_CPU_L3_MIN)
@@ -2061,46 +2115,34 @@ _hal_tau_pkt_rxCheckReason(
         case HAL_TAU_PKT_TMH_TYPE_ITMH_ETH:
 
             /* IPP non-L3 exception */
-            if (ptr_rx_gpd->itmh_eth.dst_idx >= HAL_TAU_PKT_DI_NON_L3_CPU_MIN &&
-                ptr_rx_gpd->itmh_eth.dst_idx <= HAL_TAU_PKT_DI_NON_L3_CPU_MAX)
+            bitval = ptr_rx_gpd->itmh_eth.dst_idx;
+            if (bitval >= HAL_TAU_PKT_DI_NON_L3_CPU_MIN &&
+                bitval <= HAL_TAU_PKT_DI_NON_L3_CPU_MAX)
             {
-                bitval = ptr_rx_gpd->itmh_eth.dst_idx - HAL_TAU_PKT_DI_NON_L3_CPU_MIN;
-                bitmap = 1UL << (bitval % 32);
-                if (0 != (ptr_reason_bitmap->ipp_excpt_bitmap[bitval / 32] & bitmap))
-                {
-                    *ptr_hit_prof = TRUE;
-                    break;
-                }
+                _hal_tau_pkt_orProfBitmap(prof_bitmap,
+                    ptr_tbl->ipp_excpt[bitval - HAL_TAU_PKT_DI_NON_L3_CPU_MIN]);
             }
 
             /* IPP L3 exception */
-            if (ptr_rx_gpd->itmh_eth.dst_idx >= HAL_TAU_PKT_DI_L3_CPU_MIN &&
-                ptr_rx_gpd->itmh_eth.dst_idx <= HAL_TAU_PKT_DI_L3_CPU_MAX)
+            if (bitval >= HAL_TAU_PKT_DI_L3_CPU_MIN &&
+                bitval <= HAL_TAU_PKT_DI_L3_CPU_MAX)
             {
-                bitmap = ptr_rx_gpd->itmh_eth.dst_idx - HAL_TAU_PKT_DI_L3_CPU_MIN;
-                if (0 != (ptr_reason_bitmap->ipp_l3_excpt_bitmap[0] & bitmap))
-                {
-                    *ptr_hit_prof = TRUE;
-                    break;
-                }
+                _hal_tau_pkt_orProfBitmap(prof_bitmap,
+                    ptr_tbl->ipp_l3_excpt[bitval - HAL_TAU_PKT_DI_L3_CPU_MIN]);
             }
 
             /* IPP cp_to_cpu_bmap */
             bitmap = ptr_rx_gpd->itmh_eth.cp_to_cpu_bmap;
-            if (0 != (ptr_reason_bitmap->ipp_copy2cpu_bitmap[0] & bitmap))
+            while (0 != bitmap)
             {
-                *ptr_hit_prof = TRUE;
-                break;
+                bitval = __ffs(bitmap);
+                bitmap &= bitmap - 1;
+                _hal_tau_pkt_orProfBitmap(prof_bitmap, ptr_tbl->ipp_copy2cpu[bitval]);
             }
 
             /* IPP cp_to_cpu_rsn */
-            bitval = ptr_rx_gpd->itmh_eth.cp_to_cpu_code;
-            bitmap = 1UL << (bitval % 32);
-            if (0 != (ptr_reason_bitmap->ipp_rsn_bitmap[bitval / 32] & bitmap))
-            {
-                *ptr_hit_prof = TRUE;
-                break;
-            }
+            _hal_tau_pkt_orProfBitmap(prof_bitmap,
+                ptr_tbl->ipp_rsn[ptr_rx_gpd->itmh_eth.cp_to_cpu_code]);
             break;
 
         case HAL_TAU_PKT_TMH_TYPE_ITMH_FAB:
@@ -2113,145 +2155,130 @@ _hal_tau_pkt_rxCheckReason(
             if (1 == ptr_rx_gpd->etmh_eth.redir)
             {
                 bitval = ptr_rx_gpd->etmh_eth.excpt_code_mir_bmap;
-                bitmap = 1UL << (bitval % 32);
-                if (0 != (ptr_reason_bitmap->epp_excpt_bitmap[bitval / 32] & bitmap))
+                if (bitval < HAL_TAU_PKT_EPP_EXCPT_LAST)
                 {
-                    *ptr_hit_prof = TRUE;
-                    break;
+                    _hal_tau_pkt_orProfBitmap(prof_bitmap, ptr_tbl->epp_excpt[bitval]);
                 }
             }
 
             /* EPP cp_to_cpu_bmap */
             bitmap = ((ptr_rx_gpd->etmh_eth.cp_to_cpu_bmap_w0 << 7) |
                       (ptr_rx_gpd->etmh_eth.cp_to_cpu_bmap_w1));
-            if (0 != (ptr_reason_bitmap->epp_copy2cpu_bitmap[0] & bitmap))
+            while (0 != bitmap)
             {
-                *ptr_hit_prof = TRUE;
-                break;
+                bitval = __ffs(bitmap);
+                bitmap &= bitmap - 1;
+                _hal_tau_pkt_orProfBitmap(prof_bitmap, ptr_tbl->epp_copy2cpu[bitval]);
             }
             break;
 
         default:
-            *ptr_hit_prof = FALSE;
             break;
     }
 }
 
 static BOOL_T
-_hal_tau_pkt_comparePatternWithPayload(
-    volatile HAL_TAU_PKT_RX_GPD_T   *ptr_rx_gpd,
-    const UI8_T                     *ptr_pattern,
-    const UI8_T                     *ptr_mask,
-    const UI32_T                    offset)
-{
-    NPS_ADDR_T                      phy_addr = 0;
-    UI8_T                           *ptr_virt_addr = NULL;
-    UI32_T                          idx;
-
-    /* Get the packet payload */
-    phy_addr = NPS_ADDR_32_TO_64(ptr_rx_gpd->data_buf_addr_hi, ptr_rx_gpd->data_buf_addr_lo);
-    ptr_virt_addr = (C8_T *) osal_dma_convertPhyToVirt(phy_addr);
-
-    for (idx=0; idx<NPS_NETIF_PROFILE_PATTERN_LEN; idx++)
-    {
-        /* per-byte comparison  */
-        if ((ptr_virt_addr[offset+idx] & ptr_mask[idx]) != (ptr_pattern[idx] & ptr_mask[idx]))
-        {
-            HAL_TAU_PKT_DBG(HAL_TAU_PKT_DBG_PROFILE,
-                            "prof match failed, byte idx=%d, pattern=0x%02X != 0x%02X, mask=0x%02X\n",
-                            offset+idx, ptr_pattern[idx], ptr_virt_addr[offset+idx], ptr_mask[idx]);
-            return (FALSE);
-        }
-    }
-
-    return (TRUE);
-}
-
-
-static void
 _hal_tau_pkt_rxCheckPattern(
-    volatile HAL_TAU_PKT_RX_GPD_T   *ptr_rx_gpd,
-    HAL_TAU_PKT_NETIF_PROFILE_T     *ptr_profile,
-    BOOL_T                          *ptr_hit_prof)
+    const UI8_T                     *ptr_payload,
+    const HAL_TAU_PKT_PROF_RULE_T   *ptr_rule)
 {
-    UI32_T      idx;
-    BOOL_T      match;
-
-    /* Check if need to compare pattern */
-    if ((ptr_profile->flags & (HAL_TAU_PKT_NETIF_PROFILE_FLAGS_PATTERN_0 |
-                               HAL_TAU_PKT_NETIF_PROFILE_FLAGS_PATTERN_1 |
-                               HAL_TAU_PKT_NETIF_PROFILE_FLAGS_PATTERN_2 |
-                               HAL_TAU_PKT_NETIF_PROFILE_FLAGS_PATTERN_3)) != 0)
-    {
-        /* Need to compare the payload with at least one of the four patterns */
-        /* Pre-assume that the result is positive */
-        *ptr_hit_prof = TRUE;
+    const HAL_TAU_PKT_PROF_PATTERN_T    *ptr_pattern;
+    UI32_T                              data[HAL_TAU_PKT_PROF_PATTERN_WORD_NUM];
+    UI32_T                              idx, word;
 
-        /* If any of the following comparison fails, the result will be changed to negtive */
-    }
-    else
+    for (idx=0; idx<ptr_rule->pattern_num; idx++)
     {
-        return;
-    }
+        ptr_pattern = &ptr_rule->pattern[idx];
 
-    for (idx=0; idx<NPS_NETIF_PROFILE_PATTERN_NUM; idx++)
-    {
-        HAL_TAU_PKT_DBG(HAL_TAU_PKT_DBG_PROFILE,
-                        "compare pattern id=%d\n", idx);
-        if (0 != (ptr_profile->flags & (HAL_TAU_PKT_NETIF_PROFILE_FLAGS_PATTERN_0 << idx)))
+        /* per-word comparison, the payload may not be aligned */
+        osal_memcpy(data, ptr_payload + ptr_pattern->offset, sizeof(data));
+        for (word=0; word<HAL_TAU_PKT_PROF_PATTERN_WORD_NUM; word++)
         {
-            match = _hal_tau_pkt_comparePatternWithPayload(ptr_rx_gpd,
-                                                           ptr_profile->pattern[idx],
-                                                           ptr_profile->mask[idx],
-                                                           ptr_profile->offset[idx]);
-            if (TRUE == match)
+            if ((data[word] & ptr_pattern->mask[word]) != ptr_pattern->pattern[word])
             {
-                /* Do nothing */
-            }
-            else
-            {
-                /* Change the result to negtive */
-                *ptr_hit_prof = FALSE;
-                break;
+                HAL_TAU_PKT_DBG(HAL_TAU_PKT_DBG_PROFILE,
+                                "prof match failed, byte idx=%d, pattern=0x%08X != 0x%08X, mask=0x%08X\n",
+                                (UI32_T)(ptr_pattern->offset + word * sizeof(UI32_T)),
+                                ptr_pattern->pattern[word], data[word], ptr_pattern->mask[word]);
+                return (FALSE);
             }
         }
     }
+
+    return (TRUE);
 }
 
+/* FUNCTION NAME: _hal_tau_pkt_matchUserProfile
+ * PURPOSE:
+ *      To find the first profile matching the packet.
+ * INPUT:
+ *      ptr_rx_gpd      -- Pointer of the RX GPD
+ *      port            -- The ingress port of the packet
+ * OUTPUT:
+ *      pptr_profile_hit -- The hit profile, NULL if none
+ * RETURN:
+ *      None
+ * NOTES:
+ *      The candidates are the profiles of the port hit by reason, and the patterns are only
+ *      compared for them in the order of rank. The payload address is converted once.
+ */
 static void
 _hal_tau_pkt_matchUserProfile(
     volatile HAL_TAU_PKT_RX_GPD_T   *ptr_rx_gpd,
-    HAL_TAU_PKT_PROFILE_NODE_T      *ptr_profile_list,
+    const UI32_T                    port,
     HAL_TAU_PKT_NETIF_PROFILE_T     **pptr_profile_hit)
 {
-    HAL_TAU_PKT_PROFILE_NODE_T      *ptr_curr_node = ptr_profile_list;
-    BOOL_T                          hit;
+    HAL_TAU_PKT_PROF_TBL_T          *ptr_tbl = &_hal_tau_pkt_prof_tbl;
+    HAL_TAU_PKT_PROF_BITMAP_T       prof_bitmap;
+    HAL_TAU_PKT_PROF_RULE_T         *ptr_rule;
+    NPS_ADDR_T                      phy_addr = 0;
+    UI8_T                           *ptr_virt_addr = NULL;
+    UI32_T                          idx, bitmap, rank;
 
     *pptr_profile_hit = NULL;
 
-    while (NULL != ptr_curr_node)
+    if ((0 == ptr_tbl->rule_num) || (port >= HAL_TAU_PKT_MAX_PORT_NUM))
+    {
+        return;
+    }
+
+    /* 1st match reason */
+    osal_memcpy(prof_bitmap, ptr_tbl->any_bitmap, sizeof(HAL_TAU_PKT_PROF_BITMAP_T));
+    _hal_tau_pkt_rxCheckReason(ptr_rx_gpd, prof_bitmap);
+
+    for (idx=0; idx<NPS_BITMAP_SIZE(ptr_tbl->rule_num); idx++)
     {
-        /* 1st match reason */
-        _hal_tau_pkt_rxCheckReason(ptr_rx_gpd, ptr_curr_node->ptr_profile, &hit);
-        if (TRUE == hit)
+        bitmap = prof_bitmap[idx] & ptr_tbl->port_bitmap[port][idx];
+        while (0 != bitmap)
         {
+            rank = idx * 32 + __ffs(bitmap);
+            bitmap &= bitmap - 1;
+            ptr_rule = &ptr_tbl->rule[rank];
+
             HAL_TAU_PKT_DBG(HAL_TAU_PKT_DBG_PROFILE,
-                            "rx prof matched by reason\n");
+                            "rx prof id=%d matched by reason\n", ptr_rule->ptr_profile->id);
 
             /* Then, check pattern */
-            _hal_tau_pkt_rxCheckPattern(ptr_rx_gpd, ptr_curr_node->ptr_profile, &hit);
-            if (TRUE == hit)
+            if (0 != ptr_rule->pattern_num)
             {
+                if (NULL == ptr_virt_addr)
+                {
+                    /* Get the packet payload */
+                    phy_addr = NPS_ADDR_32_TO_64(ptr_rx_gpd->data_buf_addr_hi, ptr_rx_gpd->data_buf_addr_lo);
+                    ptr_virt_addr = (UI8_T *) osal_dma_convertPhyToVirt(phy_addr);
+                }
+                if (FALSE == _hal_tau_pkt_rxCheckPattern(ptr_virt_addr, ptr_rule))
+                {
+                    /* Seach the next profile (priority lower) */
+                    continue;
+                }
                 HAL_TAU_PKT_DBG(HAL_TAU_PKT_DBG_PROFILE,
                                 "rx prof matched by pattern\n");
-
-                *pptr_profile_hit = ptr_curr_node->ptr_profile;
-                break;
             }
-        }
 
-        /* Seach the next profile (priority lower) */
-        ptr_curr_node = ptr_curr_node->ptr_next_node;
+            *pptr_profile_hit = ptr_rule->ptr_profile;
+            return;
+        }
     }
 }
 
@@ -2262,14 +2289,12 @@ _hal_tau_pkt_getPacketDest(
     void                            **pptr_cookie)
 {
     UI32_T                          port;
-    HAL_TAU_PKT_PROFILE_NODE_T      *ptr_profile_list;
     HAL_TAU_PKT_NETIF_PROFILE_T     *ptr_profile_hit;
 
     port = ptr_rx_gpd->itmh_eth.igr_phy_port;
-    ptr_profile_list = HAL_TAU_PKT_GET_PORT_PROFILE_LIST(port);
 
     _hal_tau_pkt_matchUserProfile(ptr_rx_gpd,
-                                  ptr_profile_list,
+                                  port,
                                   &ptr_profile_hit);
     if (NULL != ptr_profile_hit)
     {
@@ -5059,6 +5084,162 @@ _hal_tau_pkt_freeProfEntry(
     return (ptr_profile);
 }
 
+#define HAL_TAU_PKT_PROF_BITMAP_SET(bitmap, bit)    ((bitmap)[(bit) / 32] |= (1UL << ((bit) % 32)))
+#define HAL_TAU_PKT_PROF_BITMAP_CHK(bitmap, bit)    (0 != ((bitmap)[(bit) / 32] & (1UL << ((bit) % 32))))
+
+static void
+_hal_tau_pkt_compileProfReason(
+    HAL_TAU_PKT_NETIF_PROFILE_T         *ptr_profile,
+    const UI32_T                        rank)
+{
+    HAL_TAU_PKT_PROF_TBL_T              *ptr_tbl = &_hal_tau_pkt_prof_tbl;
+    HAL_PKT_RX_REASON_BITMAP_T          *ptr_reason_bitmap = &ptr_profile->reason_bitmap;
+    UI32_T                              bitval;
+
+    if (0 == (ptr_profile->flags & HAL_TAU_PKT_NETIF_PROFILE_FLAGS_REASON))
+    {
+        /* It means that reason doesn't metters */
+        HAL_TAU_PKT_PROF_BITMAP_SET(ptr_tbl->any_bitmap, rank);
+        return;
+    }
+
+    for (bitval=0; bitval<HAL_EXCPT_CPU_NUM; bitval++)
+    {
+        if ((bitval < HAL_TAU_PKT_IPP_EXCPT_LAST) &&
+            HAL_TAU_PKT_PROF_BITMAP_CHK(ptr_reason_bitmap->ipp_excpt_bitmap, bitval))
+        {
+            HAL_TAU_PKT_PROF_BITMAP_SET(ptr_tbl->ipp_excpt[bitval], rank);
+        }
+        /* The L3 exception code is tested against the bitmap as a value */
+        if (0 != (ptr_reason_bitmap->ipp_l3_excpt_bitmap[0] & bitval))
+        {
+            HAL_TAU_PKT_PROF_BITMAP_SET(ptr_tbl->ipp_l3_excpt[bitval], rank);
+        }
+    }
+    for (bitval=0; bitval<HAL_TAU_PKT_PROF_IPP_COPY2CPU_BIT_NUM; bitval++)
+    {
+        if (HAL_TAU_PKT_PROF_BITMAP_CHK(ptr_reason_bitmap->ipp_copy2cpu_bitmap, bitval))
+        {
+            HAL_TAU_PKT_PROF_BITMAP_SET(ptr_tbl->ipp_copy2cpu[bitval], rank);
+        }
+    }
+    for (bitval=0; bitval<HAL_TAU_PKT_PROF_IPP_RSN_NUM; bitval++)
+    {
+        if (HAL_TAU_PKT_PROF_BITMAP_CHK(ptr_reason_bitmap->ipp_rsn_bitmap, bitval))
+        {
+            HAL_TAU_PKT_PROF_BITMAP_SET(ptr_tbl->ipp_rsn[bitval], rank);
+        }
+    }
+    for (bitval=0; bitval<HAL_TAU_PKT_EPP_EXCPT_LAST; bitval++)
+    {
+        if (HAL_TAU_PKT_PROF_BITMAP_CHK(ptr_reason_bitmap->epp_excpt_bitmap, bitval))
+        {
+            HAL_TAU_PKT_PROF_BITMAP_SET(ptr_tbl->epp_excpt[bitval], rank);
+        }
+    }
+    for (bitval=0; bitval<HAL_TAU_PKT_PROF_EPP_COPY2CPU_BIT_NUM; bitval++)
+    {
+        if (HAL_TAU_PKT_PROF_BITMAP_CHK(ptr_reason_bitmap->epp_copy2cpu_bitmap, bitval))
+        {
+            HAL_TAU_PKT_PROF_BITMAP_SET(ptr_tbl->epp_copy2cpu[bitval], rank);
+        }
+    }
+}
+
+static void
+_hal_tau_pkt_compileProfPattern(
+    HAL_TAU_PKT_NETIF_PROFILE_T         *ptr_profile,
+    HAL_TAU_PKT_PROF_RULE_T             *ptr_rule)
+{
+    HAL_TAU_PKT_PROF_PATTERN_T          *ptr_pattern;
+    UI32_T                              idx, word;
+
+    for (idx=0; idx<NPS_NETIF_PROFILE_PATTERN_NUM; idx++)
+    {
+        if (0 == (ptr_profile->flags & (HAL_TAU_PKT_NETIF_PROFILE_FLAGS_PATTERN_0 << idx)))
+        {
+            continue;
+        }
+        ptr_pattern = &ptr_rule->pattern[ptr_rule->pattern_num++];
+        ptr_pattern->offset = ptr_profile->offset[idx];
+        osal_memcpy(ptr_pattern->pattern, ptr_profile->pattern[idx], NPS_NETIF_PROFILE_PATTERN_LEN);
+        osal_memcpy(ptr_pattern->mask, ptr_profile->mask[idx], NPS_NETIF_PROFILE_PATTERN_LEN);
+        for (word=0; word<HAL_TAU_PKT_PROF_PATTERN_WORD_NUM; word++)
+        {
+            ptr_pattern->pattern[word] &= ptr_pattern->mask[word];
+        }
+    }
+}
+
+/* FUNCTION NAME: _hal_tau_pkt_compileProfile
+ * PURPOSE:
+ *      To compile the profiles and the profile lists of ports for Rx lookup.
+ * INPUT:
+ *      None
+ * OUTPUT:
+ *      None
+ * RETURN:
+ *      None
+ * NOTES:
+ *      Shall be called whenever a profile or a profile list changes, with all Rx tasks locked.
+ */
+static void
+_hal_tau_pkt_compileProfile(void)
+{
+    HAL_TAU_PKT_PROF_TBL_T              *ptr_tbl = &_hal_tau_pkt_prof_tbl;
+    HAL_TAU_PKT_NETIF_PROFILE_T         *ptr_profile;
+    HAL_TAU_PKT_PROFILE_NODE_T          *ptr_curr_node;
+    UI32_T                              id, port, rank, pos;
+
+    osal_memset(ptr_tbl, 0x0, sizeof(HAL_TAU_PKT_PROF_TBL_T));
+
+    /* Rank the profiles by priority and then by creation, as they are inserted to the lists */
+    for (id=0; id<HAL_TAU_PKT_NET_PROFILE_NUM_MAX; id++)
+    {
+        ptr_profile = _ptr_hal_tau_pkt_profile_entry[id];
+        if (NULL == ptr_profile)
+        {
+            continue;
+        }
+        for (pos = ptr_tbl->rule_num; pos > 0; pos--)
+        {
+            HAL_TAU_PKT_NETIF_PROFILE_T *ptr_prev = ptr_tbl->rule[pos - 1].ptr_profile;
+
+            if ((ptr_prev->priority < ptr_profile->priority) ||
+                ((ptr_prev->priority == ptr_profile->priority) &&
+                 (_hal_tau_pkt_profile_seq[ptr_prev->id] < _hal_tau_pkt_profile_seq[id])))
+            {
+                break;
+            }
+            ptr_tbl->rule[pos].ptr_profile = ptr_prev;
+        }
+        ptr_tbl->rule[pos].ptr_profile = ptr_profile;
+        ptr_tbl->rule_num++;
+    }
+
+    for (rank=0; rank<ptr_tbl->rule_num; rank++)
+    {
+        ptr_profile = ptr_tbl->rule[rank].ptr_profile;
+        ptr_tbl->rank[ptr_profile->id] = rank;
+        _hal_tau_pkt_compileProfReason(ptr_profile, rank);
+        _hal_tau_pkt_compileProfPattern(ptr_profile, &ptr_tbl->rule[rank]);
+    }
+
+    for (port=0; port<HAL_TAU_PKT_MAX_PORT_NUM; port++)
+    {
+        ptr_curr_node = HAL_TAU_PKT_GET_PORT_PROFILE_LIST(port);
+        while (NULL != ptr_curr_node)
+        {
+            HAL_TAU_PKT_PROF_BITMAP_SET(ptr_tbl->port_bitmap[port],
+                                        ptr_tbl->rank[ptr_curr_node->ptr_profile->id]);
+            ptr_curr_node = ptr_curr_node->ptr_next_node;
+        }
+    }
+
+    HAL_TAU_PKT_DBG(HAL_TAU_PKT_DBG_PROFILE,
+                    "compile prof done, num=%d\n", ptr_tbl->rule_num);
+}
+
 static NPS_ERROR_NO_T
 _hal_tau_pkt_destroyAllIntf(
     const UI32_T                        unit)
@@ -5092,6 +5273,8 @@ _hal_tau_pkt_destroyAllIntf(
         }
     }
 
+    _hal_tau_pkt_compileProfile();
+
     return (NPS_E_OK);
 }
 
@@ -5120,6 +5303,7 @@ _hal_tau_pkt_delProfListOnAllIntf(
                 osal_free(ptr_curr_node);
                 ptr_curr_node = ptr_next_node;
             }
+            ptr_port_db->ptr_profile_list = NULL;
         }
     }
 
@@ -5151,6 +5335,8 @@ _hal_tau_pkt_destroyAllProfile(
         }
     }
 
+    _hal_tau_pkt_compileProfile();
+
     return (NPS_E_OK);
 }
 
@@ -5771,6 +5957,7 @@ _hal_tau_pkt_destroyIntf(
                 /* _hal_tau_pkt_destroyProfList(ptr_port_db->ptr_profile_list); */
 
                 osal_memset(ptr_port_db, 0x0, sizeof(HAL_TAU_PKT_NETIF_PORT_DB_T));
+                _hal_tau_pkt_compileProfile();
                 rc = NPS_E_OK;
                 break;
             }
@@ -5884,6 +6071,8 @@ _hal_tau_pkt_createProfile(
     rc = _hal_tau_pkt_allocProfEntry(ptr_profile);
     if (NPS_E_OK == rc)
     {
+        _hal_tau_pkt_profile_seq[ptr_profile->id] = _hal_tau_pkt_profile_seq_next++;
+
         /* Insert the profile to the corresponding (port) interface */
         if ((ptr_profile->flags & HAL_TAU_PKT_NETIF_PROFILE_FLAGS_PORT) != 0)
         {
@@ -5898,6 +6087,7 @@ _hal_tau_pkt_createProfile(
                             "u=%u, bind prof to all intf\n", unit);
             _hal_tau_pkt_addProfToAllIntf(ptr_profile);
         }
+        _hal_tau_pkt_compileProfile();
 
         /* Copy the ptr_profile->id to user space */
         osal_io_copyToUser(&ptr_cookie->net_profile, ptr_profile, sizeof(HAL_TAU_PKT_NETIF_PROFILE_T));
@@ -5947,6 +6137,7 @@ _hal_tau_pkt_destroyProfile(
                         ptr_profile->flags);
         osal_free(ptr_profile);
     }
+    _hal_tau_pkt_compileProfile();
 
     osal_io_copyToUser(&ptr_cookie->rc, &rc, sizeof(NPS_ERROR_NO_T));
 
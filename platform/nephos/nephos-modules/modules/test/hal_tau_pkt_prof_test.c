@@ -0,0 +1,712 @@
+/* Copyright (C) 2020  MediaTek, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2 of the GNU General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program.
+ */
+
+/* FILE NAME:  hal_tau_pkt_prof_test.c
+ * PURPOSE:
+ *      Userspace test harness for the Rx profile lookup of hal_tau_pkt_knl.c.
+ *
+ * NOTES:
+ *      The profile list, compile and lookup routines of the module are built as they are
+ *      and replayed against the former walk of the profile list of the port, which checked
+ *      the reasons of each profile bit by bit and compared the patterns byte by byte.
+ *      Random profile sets mix priorities, port bound and all-port profiles, reasons and
+ *      patterns, and are churned so that ids are reused; random GPDs carry payloads built
+ *      from the patterns of the profiles so that most of them hit, at unaligned addresses.
+ *
+ *      The former walk is kept as it was except for two things the lookup fixed on purpose:
+ *      the hit flag is cleared for each profile, as it was left stale when a profile with
+ *      reasons was not hit by any, and EPP exception codes beyond the bitmap never hit.
+ */
+
+/*****************************************************************************
+ * INCLUDE FILE DECLARATIONS
+ *****************************************************************************
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include <nps_types.h>
+#include <nps_error.h>
+
+struct net_device;
+
+#include <hal_tau_pkt_knl.h>
+
+/* The OS abstraction used by the profile routines */
+#define osal_alloc(__size__)                    malloc(__size__)
+#define osal_free(__ptr__)                      free(__ptr__)
+#define osal_memcpy(__dst__, __src__, __len__)  memcpy(__dst__, __src__, __len__)
+#define osal_memset(__dst__, __val__, __len__)  memset(__dst__, __val__, __len__)
+#define osal_printf(...)                        printf(__VA_ARGS__)
+#define osal_dma_convertPhyToVirt(__phy__)      ((void *)(uintptr_t)(__phy__))
+
+static inline UI32_T
+__ffs(UI32_T word)
+{
+    return (__builtin_ctz(word));
+}
+
+#include "hal_tau_pkt_prof.inc"
+
+/*****************************************************************************
+ * NAMING CONSTANT DECLARATIONS
+ *****************************************************************************
+ */
+#define TEST_PORT_NUM               (8)     /* ports the packets come from, CPU port included */
+#define TEST_CODE_NUM               (16)    /* most reason codes are drawn below it */
+#define TEST_PAYLOAD_LEN            (128)
+#define TEST_PKT_POOL_NUM           (1024)
+
+typedef struct
+{
+    HAL_TAU_PKT_RX_GPD_T            gpd;
+    UI32_T                          port;
+    UI8_T                           buf[TEST_PAYLOAD_LEN + sizeof(UI32_T)];
+
+} TEST_PKT_T;
+
+/*****************************************************************************
+ * THE FORMER LOOKUP
+ *****************************************************************************
+ */
+static void
+_test_rxCheckReason(
+    volatile HAL_TAU_PKT_RX_GPD_T   *ptr_rx_gpd,
+    HAL_TAU_PKT_NETIF_PROFILE_T     *ptr_profile,
+    BOOL_T                          *ptr_hit_prof)
+{
+    HAL_PKT_RX_REASON_BITMAP_T      *ptr_reason_bitmap = &ptr_profile->reason_bitmap;
+    UI32_T                          bitval = 0;
+    UI32_T                          bitmap = 0x0;
+
+    if (0 == (ptr_profile->flags & HAL_TAU_PKT_NETIF_PROFILE_FLAGS_REASON))
+    {
+        /* It means that reason doesn't metters */
+        *ptr_hit_prof = TRUE;
+        return;
+    }
+
+    switch (ptr_rx_gpd->itmh_eth.typ)
+    {
+        case HAL_TAU_PKT_TMH_TYPE_ITMH_ETH:
+
+            /* IPP non-L3 exception */
+            if (ptr_rx_gpd->itmh_eth.dst_idx >= HAL_TAU_PKT_DI_NON_L3_CPU_MIN &&
+                ptr_rx_gpd->itmh_eth.dst_idx <= HAL_TAU_PKT_DI_NON_L3_CPU_MAX)
+            {
+                bitval = ptr_rx_gpd->itmh_eth.dst_idx - HAL_TAU_PKT_DI_NON_L3_CPU_MIN;
+                bitmap = 1UL << (bitval % 32);
+                if (0 != (ptr_reason_bitmap->ipp_excpt_bitmap[bitval / 32] & bitmap))
+                {
+                    *ptr_hit_prof = TRUE;
+                    break;
+                }
+            }
+
+            /* IPP L3 exception */
+            if (ptr_rx_gpd->itmh_eth.dst_idx >= HAL_TAU_PKT_DI_L3_CPU_MIN &&
+                ptr_rx_gpd->itmh_eth.dst_idx <= HAL_TAU_PKT_DI_L3_CPU_MAX)
+            {
+                bitmap = ptr_rx_gpd->itmh_eth.dst_idx - HAL_TAU_PKT_DI_L3_CPU_MIN;
+                if (0 != (ptr_reason_bitmap->ipp_l3_excpt_bitmap[0] & bitmap))
+                {
+                    *ptr_hit_prof = TRUE;
+                    break;
+                }
+            }
+
+            /* IPP cp_to_cpu_bmap */
+            bitmap = ptr_rx_gpd->itmh_eth.cp_to_cpu_bmap;
+            if (0 != (ptr_reason_bitmap->ipp_copy2cpu_bitmap[0] & bitmap))
+            {
+                *ptr_hit_prof = TRUE;
+                break;
+            }
+
+            /* IPP cp_to_cpu_rsn */
+            bitval = ptr_rx_gpd->itmh_eth.cp_to_cpu_code;
+            bitmap = 1UL << (bitval % 32);
+            if (0 != (ptr_reason_bitmap->ipp_rsn_bitmap[bitval / 32] & bitmap))
+            {
+                *ptr_hit_prof = TRUE;
+                break;
+            }
+            break;
+
+        case HAL_TAU_PKT_TMH_TYPE_ITMH_FAB:
+        case HAL_TAU_PKT_TMH_TYPE_ETMH_FAB:
+            break;
+
+        case HAL_TAU_PKT_TMH_TYPE_ETMH_ETH:
+
+            /* EPP exception, the code is bounded to the bitmap */
+            if (1 == ptr_rx_gpd->etmh_eth.redir)
+            {
+                bitval = ptr_rx_gpd->etmh_eth.excpt_code_mir_bmap;
+                bitmap = 1UL << (bitval % 32);
+                if ((bitval < HAL_TAU_PKT_EPP_EXCPT_LAST) &&
+                    (0 != (ptr_reason_bitmap->epp_excpt_bitmap[bitval / 32] & bitmap)))
+                {
+                    *ptr_hit_prof = TRUE;
+                    break;
+                }
+            }
+
+            /* EPP cp_to_cpu_bmap */
+            bitmap = ((ptr_rx_gpd->etmh_eth.cp_to_cpu_bmap_w0 << 7) |
+                      (ptr_rx_gpd->etmh_eth.cp_to_cpu_bmap_w1));
+            if (0 != (ptr_reason_bitmap->epp_copy2cpu_bitmap[0] & bitmap))
+            {
+                *ptr_hit_prof = TRUE;
+                break;
+            }
+            break;
+
+        default:
+            *ptr_hit_prof = FALSE;
+            break;
+    }
+}
+
+static BOOL_T
+_test_comparePatternWithPayload(
+    volatile HAL_TAU_PKT_RX_GPD_T   *ptr_rx_gpd,
+    const UI8_T                     *ptr_pattern,
+    const UI8_T                     *ptr_mask,
+    const UI32_T                    offset)
+{
+    NPS_ADDR_T                      phy_addr = 0;
+    UI8_T                           *ptr_virt_addr = NULL;
+    UI32_T                          idx;
+
+    /* Get the packet payload */
+    phy_addr = NPS_ADDR_32_TO_64(ptr_rx_gpd->data_buf_addr_hi, ptr_rx_gpd->data_buf_addr_lo);
+    ptr_virt_addr = (UI8_T *) osal_dma_convertPhyToVirt(phy_addr);
+
+    for (idx=0; idx<NPS_NETIF_PROFILE_PATTERN_LEN; idx++)
+    {
+        /* per-byte comparison  */
+        if ((ptr_virt_addr[offset+idx] & ptr_mask[idx]) != (ptr_pattern[idx] & ptr_mask[idx]))
+        {
+            return (FALSE);
+        }
+    }
+
+    return (TRUE);
+}
+
+static void
+_test_rxCheckPattern(
+    volatile HAL_TAU_PKT_RX_GPD_T   *ptr_rx_gpd,
+    HAL_TAU_PKT_NETIF_PROFILE_T     *ptr_profile,
+    BOOL_T                          *ptr_hit_prof)
+{
+    UI32_T      idx;
+
+    /* Check if need to compare pattern */
+    if ((ptr_profile->flags & (HAL_TAU_PKT_NETIF_PROFILE_FLAGS_PATTERN_0 |
+                               HAL_TAU_PKT_NETIF_PROFILE_FLAGS_PATTERN_1 |
+                               HAL_TAU_PKT_NETIF_PROFILE_FLAGS_PATTERN_2 |
+                               HAL_TAU_PKT_NETIF_PROFILE_FLAGS_PATTERN_3)) == 0)
+    {
+        return;
+    }
+
+    /* Pre-assume that the result is positive */
+    *ptr_hit_prof = TRUE;
+
+    for (idx=0; idx<NPS_NETIF_PROFILE_PATTERN_NUM; idx++)
+    {
+        if ((0 != (ptr_profile->flags & (HAL_TAU_PKT_NETIF_PROFILE_FLAGS_PATTERN_0 << idx))) &&
+            (FALSE == _test_comparePatternWithPayload(ptr_rx_gpd,
+                                                      ptr_profile->pattern[idx],
+                                                      ptr_profile->mask[idx],
+                                                      ptr_profile->offset[idx])))
+        {
+            /* Change the result to negtive */
+            *ptr_hit_prof = FALSE;
+            break;
+        }
+    }
+}
+
+static void
+_test_matchUserProfile(
+    volatile HAL_TAU_PKT_RX_GPD_T   *ptr_rx_gpd,
+    HAL_TAU_PKT_PROFILE_NODE_T      *ptr_profile_list,
+    HAL_TAU_PKT_NETIF_PROFILE_T     **pptr_profile_hit)
+{
+    HAL_TAU_PKT_PROFILE_NODE_T      *ptr_curr_node = ptr_profile_list;
+    BOOL_T                          hit;
+
+    *pptr_profile_hit = NULL;
+
+    while (NULL != ptr_curr_node)
+    {
+        /* 1st match reason */
+        hit = FALSE;
+        _test_rxCheckReason(ptr_rx_gpd, ptr_curr_node->ptr_profile, &hit);
+        if (TRUE == hit)
+        {
+            /* Then, check pattern */
+            _test_rxCheckPattern(ptr_rx_gpd, ptr_curr_node->ptr_profile, &hit);
+            if (TRUE == hit)
+            {
+                *pptr_profile_hit = ptr_curr_node->ptr_profile;
+                break;
+            }
+        }
+
+        /* Seach the next profile (priority lower) */
+        ptr_curr_node = ptr_curr_node->ptr_next_node;
+    }
+}
+
+/*****************************************************************************
+ * PROFILES AND PACKETS
+ *****************************************************************************
+ */
+static UI32_T
+_test_rand(void)
+{
+    return ((UI32_T)random());
+}
+
+static UI32_T
+_test_randPort(void)
+{
+    UI32_T      port = _test_rand() % TEST_PORT_NUM;
+
+    return ((TEST_PORT_NUM - 1 == port) ? (HAL_TAU_PKT_MAX_PORT_NUM - 1) : port);
+}
+
+static UI32_T
+_test_randCode(
+    const UI32_T                    max)
+{
+    return ((0 != _test_rand() % 8) ? (_test_rand() % TEST_CODE_NUM) : (_test_rand() % max));
+}
+
+/* As _hal_tau_pkt_createProfile */
+static void
+_test_createProfile(
+    const HAL_TAU_PKT_NETIF_PROFILE_T   *ptr_template)
+{
+    HAL_TAU_PKT_NETIF_PROFILE_T         *ptr_profile;
+    HAL_TAU_PKT_NETIF_PORT_DB_T         *ptr_port_db;
+
+    ptr_profile = osal_alloc(sizeof(HAL_TAU_PKT_NETIF_PROFILE_T));
+    osal_memcpy(ptr_profile, ptr_template, sizeof(HAL_TAU_PKT_NETIF_PROFILE_T));
+
+    if (NPS_E_OK != _hal_tau_pkt_allocProfEntry(ptr_profile))
+    {
+        osal_free(ptr_profile);
+        return;
+    }
+    _hal_tau_pkt_profile_seq[ptr_profile->id] = _hal_tau_pkt_profile_seq_next++;
+
+    if ((ptr_profile->flags & HAL_TAU_PKT_NETIF_PROFILE_FLAGS_PORT) != 0)
+    {
+        ptr_port_db = HAL_TAU_PKT_GET_PORT_DB(ptr_profile->port);
+        _hal_tau_pkt_addProfToList(ptr_profile, &ptr_port_db->ptr_profile_list);
+    }
+    else
+    {
+        _hal_tau_pkt_addProfToAllIntf(ptr_profile);
+    }
+    _hal_tau_pkt_compileProfile();
+}
+
+/* As _hal_tau_pkt_destroyProfile */
+static void
+_test_destroyProfile(
+    const UI32_T                    id)
+{
+    _hal_tau_pkt_delProfFromAllIntfById(id);
+    osal_free(_hal_tau_pkt_freeProfEntry(id));
+    _hal_tau_pkt_compileProfile();
+}
+
+static void
+_test_destroyAllProfile(void)
+{
+    UI32_T      id;
+
+    for (id=0; id<HAL_TAU_PKT_NET_PROFILE_NUM_MAX; id++)
+    {
+        if (NULL != _ptr_hal_tau_pkt_profile_entry[id])
+        {
+            _test_destroyProfile(id);
+        }
+    }
+}
+
+static void
+_test_initProfile(
+    HAL_TAU_PKT_NETIF_PROFILE_T     *ptr_profile)
+{
+    HAL_PKT_RX_REASON_BITMAP_T      *ptr_reason_bitmap = &ptr_profile->reason_bitmap;
+    UI32_T                          idx, byte, bitval, num;
+
+    osal_memset(ptr_profile, 0x0, sizeof(HAL_TAU_PKT_NETIF_PROFILE_T));
+    ptr_profile->priority = _test_rand() % 8;
+
+    if (0 == _test_rand() % 2)
+    {
+        ptr_profile->flags |= HAL_TAU_PKT_NETIF_PROFILE_FLAGS_PORT;
+        ptr_profile->port = _test_randPort();
+    }
+
+    if (0 != _test_rand() % 3)
+    {
+        ptr_profile->flags |= HAL_TAU_PKT_NETIF_PROFILE_FLAGS_REASON;
+        for (num = 1 + _test_rand() % 3; num > 0; num--)
+        {
+            switch (_test_rand() % 6)
+            {
+                case 0:
+                    bitval = _test_randCode(HAL_TAU_PKT_IPP_EXCPT_LAST);
+                    ptr_reason_bitmap->ipp_excpt_bitmap[bitval / 32] |= 1UL << (bitval % 32);
+                    break;
+                case 1:
+                    ptr_reason_bitmap->ipp_l3_excpt_bitmap[0] |= 1UL << (_test_rand() % 8);
+                    break;
+                case 2:
+                    bitval = _test_rand() % HAL_TAU_PKT_IPP_COPY2CPU_LAST;
+                    ptr_reason_bitmap->ipp_copy2cpu_bitmap[0] |= 1UL << bitval;
+                    break;
+                case 3:
+                    bitval = _test_rand() % HAL_TAU_PKT_IPP_RSN_LAST;
+                    ptr_reason_bitmap->ipp_rsn_bitmap[0] |= 1UL << bitval;
+                    break;
+                case 4:
+                    bitval = _test_randCode(HAL_TAU_PKT_EPP_EXCPT_LAST);
+                    ptr_reason_bitmap->epp_excpt_bitmap[bitval / 32] |= 1UL << (bitval % 32);
+                    break;
+                default:
+                    bitval = _test_rand() % HAL_TAU_PKT_EPP_COPY2CPU_LAST;
+                    ptr_reason_bitmap->epp_copy2cpu_bitmap[0] |= 1UL << bitval;
+                    break;
+            }
+        }
+    }
+
+    for (idx=0; idx<NPS_NETIF_PROFILE_PATTERN_NUM; idx++)
+    {
+        if (0 != _test_rand() % 3)
+        {
+            continue;
+        }
+        ptr_profile->flags |= HAL_TAU_PKT_NETIF_PROFILE_FLAGS_PATTERN_0 << idx;
+        ptr_profile->offset[idx] = _test_rand() % (TEST_PAYLOAD_LEN - NPS_NETIF_PROFILE_PATTERN_LEN + 1);
+        for (byte=0; byte<NPS_NETIF_PROFILE_PATTERN_LEN; byte++)
+        {
+            ptr_profile->pattern[idx][byte] = _test_rand();
+            switch (_test_rand() % 4)
+            {
+                case 0:
+                    ptr_profile->mask[idx][byte] = 0x0;
+                    break;
+                case 1:
+                    ptr_profile->mask[idx][byte] = _test_rand();
+                    break;
+                default:
+                    ptr_profile->mask[idx][byte] = 0xFF;
+                    break;
+            }
+        }
+    }
+}
+
+/* A profile set of the given size, churned so that the ids of destroyed profiles are reused */
+static void
+_test_initProfileSet(
+    const UI32_T                    num)
+{
+    HAL_TAU_PKT_NETIF_PROFILE_T     profile;
+    UI32_T                          idx;
+
+    _test_destroyAllProfile();
+    _hal_tau_pkt_profile_seq_next = 0;
+
+    for (idx=0; idx<num; idx++)
+    {
+        _test_initProfile(&profile);
+        _test_createProfile(&profile);
+    }
+    for (idx=0; idx<num / 4; idx++)
+    {
+        _test_destroyProfile(_test_rand() % num);
+    }
+    for (idx=0; idx<num / 4; idx++)
+    {
+        _test_initProfile(&profile);
+        _test_createProfile(&profile);
+    }
+}
+
+static void
+_test_initPkt(
+    TEST_PKT_T                      *ptr_pkt)
+{
+    HAL_TAU_PKT_RX_GPD_T            *ptr_gpd = &ptr_pkt->gpd;
+    HAL_TAU_PKT_NETIF_PROFILE_T     *ptr_profile = NULL;
+    UI8_T                           *ptr_payload;
+    NPS_ADDR_T                      addr;
+    UI32_T                          idx, byte, typ, offset, rand = 0;
+
+    osal_memset(ptr_gpd, 0x0, sizeof(HAL_TAU_PKT_RX_GPD_T));
+    ptr_pkt->port = _test_randPort();
+
+    /* Payload at an unaligned address, with the patterns of a profile most of the time */
+    ptr_payload = ptr_pkt->buf + _test_rand() % sizeof(UI32_T);
+    for (byte=0; byte<TEST_PAYLOAD_LEN; byte++)
+    {
+        rand = (0 == byte % 3) ? _test_rand() : (rand >> 8);
+        ptr_payload[byte] = rand;
+    }
+    if (0 != _test_rand() % 4)
+    {
+        ptr_profile = _ptr_hal_tau_pkt_profile_entry[_test_rand() % HAL_TAU_PKT_NET_PROFILE_NUM_MAX];
+    }
+    for (idx=0; (NULL != ptr_profile) && (idx<NPS_NETIF_PROFILE_PATTERN_NUM); idx++)
+    {
+        if (0 == (ptr_profile->flags & (HAL_TAU_PKT_NETIF_PROFILE_FLAGS_PATTERN_0 << idx)))
+        {
+            continue;
+        }
+        offset = ptr_profile->offset[idx];
+        for (byte=0; byte<NPS_NETIF_PROFILE_PATTERN_LEN; byte++)
+        {
+            ptr_payload[offset + byte] =
+                (ptr_payload[offset + byte] & ~ptr_profile->mask[idx][byte]) |
+                (ptr_profile->pattern[idx][byte] & ptr_profile->mask[idx][byte]);
+        }
+    }
+    addr = (NPS_ADDR_T)(uintptr_t)ptr_payload;
+    ptr_gpd->data_buf_addr_lo = NPS_ADDR_64_LOW(addr);
+    ptr_gpd->data_buf_addr_hi = NPS_ADDR_64_HI(addr);
+
+    /* Reasons, mostly drawn from the codes the profiles are given */
+    typ = _test_rand() % 8;
+    if (typ < 4)
+    {
+        typ = HAL_TAU_PKT_TMH_TYPE_ITMH_ETH;
+        switch (_test_rand() % 3)
+        {
+            case 0:
+                ptr_gpd->itmh_eth.dst_idx = HAL_TAU_PKT_DI_NON_L3_CPU_MIN +
+                                            _test_randCode(HAL_EXCPT_CPU_NUM);
+                break;
+            case 1:
+                ptr_gpd->itmh_eth.dst_idx = HAL_TAU_PKT_DI_L3_CPU_MIN +
+                                            _test_randCode(HAL_EXCPT_CPU_NUM);
+                break;
+            default:
+                ptr_gpd->itmh_eth.dst_idx = _test_rand();
+                break;
+        }
+        if (0 == _test_rand() % 2)
+        {
+            ptr_gpd->itmh_eth.cp_to_cpu_bmap = 1UL << (_test_rand() % HAL_TAU_PKT_IPP_COPY2CPU_LAST);
+        }
+        ptr_gpd->itmh_eth.cp_to_cpu_code = _test_rand();
+    }
+    else if (typ < 7)
+    {
+        typ = HAL_TAU_PKT_TMH_TYPE_ETMH_ETH;
+        ptr_gpd->etmh_eth.redir = _test_rand();
+        ptr_gpd->etmh_eth.excpt_code_mir_bmap = _test_randCode(256);
+        if (0 == _test_rand() % 2)
+        {
+            ptr_gpd->etmh_eth.cp_to_cpu_bmap_w0 = _test_rand();
+            ptr_gpd->etmh_eth.cp_to_cpu_bmap_w1 = 1UL << (_test_rand() % 7);
+        }
+    }
+    else
+    {
+        typ = (0 == _test_rand() % 2) ? HAL_TAU_PKT_TMH_TYPE_ITMH_FAB : HAL_TAU_PKT_TMH_TYPE_ETMH_FAB;
+        ptr_gpd->itmh_eth.dst_idx = _test_rand();
+    }
+    ptr_gpd->itmh_eth.typ = typ;
+}
+
+/*****************************************************************************
+ * CHECK AND BENCHMARK
+ *****************************************************************************
+ */
+static I32_T
+_test_profileId(
+    const HAL_TAU_PKT_NETIF_PROFILE_T   *ptr_profile)
+{
+    return ((NULL != ptr_profile) ? (I32_T)ptr_profile->id : -1);
+}
+
+static int
+_test_check(
+    const UI32_T                    rounds,
+    const UI32_T                    pkts)
+{
+    static TEST_PKT_T               pkt;
+    HAL_TAU_PKT_NETIF_PROFILE_T     *ptr_exp, *ptr_got;
+    UI32_T                          round, idx, num;
+    UI32_T                          hits = 0, total = 0, errors = 0;
+
+    for (round=0; round<rounds; round++)
+    {
+        num = (0 == round % 250) ? HAL_TAU_PKT_NET_PROFILE_NUM_MAX : _test_rand() % 33;
+        _test_initProfileSet(num);
+        for (idx=0; idx<pkts; idx++)
+        {
+            _test_initPkt(&pkt);
+            _test_matchUserProfile(&pkt.gpd, HAL_TAU_PKT_GET_PORT_PROFILE_LIST(pkt.port), &ptr_exp);
+            _hal_tau_pkt_matchUserProfile(&pkt.gpd, pkt.port, &ptr_got);
+            total++;
+            if (NULL != ptr_exp)
+            {
+                hits++;
+            }
+            if ((ptr_exp != ptr_got) && (errors++ < 10))
+            {
+                printf("round %u: %u profiles, port %u, tmh type %u: "
+                       "expected profile %d, got %d\n",
+                       round, _hal_tau_pkt_prof_tbl.rule_num, pkt.port,
+                       (UI32_T)pkt.gpd.itmh_eth.typ,
+                       _test_profileId(ptr_exp), _test_profileId(ptr_got));
+            }
+        }
+    }
+    _test_destroyAllProfile();
+
+    printf("%u packets, %u hits, %u mismatches\n", total, hits, errors);
+
+    return ((0 != errors) ? 1 : 0);
+}
+
+static double
+_test_nsecs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * 1e9 + ts.tv_nsec);
+}
+
+static void
+_test_benchOne(
+    const UI32_T                    num,
+    const UI32_T                    pkts)
+{
+    static TEST_PKT_T                       pkt[TEST_PKT_POOL_NUM];
+    HAL_TAU_PKT_NETIF_PROFILE_T * volatile  ptr_sink;
+    double                                  start, walk, tbl;
+    UI32_T                                  idx;
+
+    _test_initProfileSet(num);
+    for (idx=0; idx<TEST_PKT_POOL_NUM; idx++)
+    {
+        _test_initPkt(&pkt[idx]);
+    }
+
+    start = _test_nsecs();
+    for (idx=0; idx<pkts; idx++)
+    {
+        _test_matchUserProfile(&pkt[idx % TEST_PKT_POOL_NUM].gpd,
+                               HAL_TAU_PKT_GET_PORT_PROFILE_LIST(pkt[idx % TEST_PKT_POOL_NUM].port),
+                               (HAL_TAU_PKT_NETIF_PROFILE_T **)&ptr_sink);
+    }
+    walk = (_test_nsecs() - start) / pkts;
+
+    start = _test_nsecs();
+    for (idx=0; idx<pkts; idx++)
+    {
+        _hal_tau_pkt_matchUserProfile(&pkt[idx % TEST_PKT_POOL_NUM].gpd,
+                                      pkt[idx % TEST_PKT_POOL_NUM].port,
+                                      (HAL_TAU_PKT_NETIF_PROFILE_T **)&ptr_sink);
+    }
+    tbl = (_test_nsecs() - start) / pkts;
+
+    printf("%8u %12.1f %12.1f %8.1fx\n",
+           _hal_tau_pkt_prof_tbl.rule_num, walk, tbl, walk / tbl);
+}
+
+static void
+_test_bench(
+    const UI32_T                    pkts)
+{
+    printf("%8s %12s %12s %9s\n", "profiles", "walk ns/pkt", "table ns/pkt", "speedup");
+    _test_benchOne(4, pkts);
+    _test_benchOne(16, pkts);
+    _test_benchOne(64, pkts);
+    _test_benchOne(HAL_TAU_PKT_NET_PROFILE_NUM_MAX, pkts);
+    _test_destroyAllProfile();
+}
+
+static void
+_test_usage(
+    const C8_T                      *ptr_prog)
+{
+    printf("Usage: %s [-b] [-s seed] [-r rounds] [-n packets]\n"
+           "  -b  benchmark instead of checking\n"
+           "  -s  random seed (default: time)\n"
+           "  -r  profile sets to check (default: 2000)\n"
+           "  -n  packets per profile set, or to time (default: 1000, 2000000)\n",
+           ptr_prog);
+}
+
+int
+main(int argc, char *argv[])
+{
+    unsigned int    seed = (unsigned int)time(NULL);
+    int             rounds = 2000, pkts = 0, bench = 0;
+    int             opt;
+
+    while ((opt = getopt(argc, argv, "bs:r:n:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'b':
+                bench = 1;
+                break;
+            case 's':
+                seed = strtoul(optarg, NULL, 0);
+                break;
+            case 'r':
+                rounds = atoi(optarg);
+                break;
+            case 'n':
+                pkts = atoi(optarg);
+                break;
+            default:
+                _test_usage(argv[0]);
+                return ((opt == 'h') ? 0 : 2);
+        }
+    }
+
+    printf("seed %u\n", seed);
+    srandom(seed);
+
+    if (bench)
+    {
+        _test_bench((pkts > 0) ? pkts : 2000000);
+        return (0);
+    }
+
+    return (_test_check(rounds, (pkts > 0) ? pkts : 1000));
+}
@@ -228,6 +228,10 @@ struct ionic_desc_info {
 	struct ionic_buf_info bufs[MAX_SKB_FRAGS + 1];
 	ionic_desc_cb cb;
 	void *cb_arg;
+#ifdef HAVE_XDP_RX
+	struct xdp_frame *xdpf;
+	enum xdp_action act;
+#endif
 };
 
 #define IONIC_QUEUE_NAME_MAX_SZ		16
@@ -276,9 +280,21 @@ struct ionic_queue {
 	unsigned int sg_desc_size;
 	unsigned int pid;
 	struct ionic_page_cache *page_cache;
+#ifdef HAVE_PAGE_POOL_RX
+	struct page_pool *page_pool;
+#endif
+#ifdef HAVE_XDP_RX
+	struct bpf_prog *xdp_prog;
+	struct ionic_queue *partner;	/* txq for XDP_TX */
+	unsigned int xdp_flush;
+	struct xdp_rxq_info xdp_rxq_info;
+#endif
 	char name[IONIC_QUEUE_NAME_MAX_SZ];
 } ____cacheline_aligned_in_smp;
 
+#define IONIC_XDP_FLUSH_TX		BIT(0)
+#define IONIC_XDP_FLUSH_REDIRECT	BIT(1)
+
 #define IONIC_INTR_INDEX_NOT_ASSIGNED	-1
 #define IONIC_INTR_NAME_MAX_SZ		32
 
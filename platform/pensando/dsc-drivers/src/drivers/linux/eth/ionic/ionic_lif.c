@@ -454,6 +454,9 @@ static void ionic_qcq_free(struct ionic_lif *lif, struct ionic_qcq *qcq)
 
 	vfree(qcq->cq.info);
 	qcq->cq.info = NULL;
+#ifdef HAVE_PAGE_POOL_RX
+	ionic_rx_page_pool_destroy(&qcq->q);
+#endif
 	vfree(qcq->q.page_cache);
 	qcq->q.page_cache = NULL;
 	vfree(qcq->q.info);
@@ -618,6 +621,7 @@ static int ionic_qcq_alloc(struct ionic_lif *lif, unsigned int type,
 		}
 	}
 
+#ifndef HAVE_PAGE_POOL_RX
 	if (type == IONIC_QTYPE_RXQ) {
 		new->q.page_cache = vzalloc_node(sizeof(*new->q.page_cache),
 						 dev_to_node(dev));
@@ -631,6 +635,7 @@ static int ionic_qcq_alloc(struct ionic_lif *lif, unsigned int type,
 			}
 		}
 	}
+#endif
 
 	new->q.type = type;
 	new->q.max_sg_elems = lif->qtype_info[type].max_sg_elems;
@@ -642,6 +647,16 @@ static int ionic_qcq_alloc(struct ionic_lif *lif, unsigned int type,
 		goto err_out_free_q_page_cache;
 	}
 
+#ifdef HAVE_PAGE_POOL_RX
+	if (type == IONIC_QTYPE_RXQ) {
+		err = ionic_rx_page_pool_create(&new->q);
+		if (err) {
+			netdev_err(lif->netdev, "Cannot create page pool\n");
+			goto err_out_free_q_page_cache;
+		}
+	}
+#endif
+
 	err = ionic_alloc_qcq_interrupt(lif, new);
 	if (err)
 		goto err_out;
@@ -782,6 +797,9 @@ err_out_free_irq:
 		ionic_intr_free(lif->ionic, new->intr.index);
 	}
 err_out_free_q_page_cache:
+#ifdef HAVE_PAGE_POOL_RX
+	ionic_rx_page_pool_destroy(&new->q);
+#endif
 	vfree(new->q.page_cache);
 err_out_free_q_info:
 	vfree(new->q.info);
@@ -1958,6 +1976,14 @@ static int ionic_change_mtu(struct net_device *netdev, int new_mtu)
 	if (err)
 		return err;
 
+#ifdef HAVE_XDP_RX
+	if (lif->xdp_prog && new_mtu > IONIC_XDP_MAX_LINEAR_MTU) {
+		netdev_err(netdev, "MTU %d is too large for XDP, max %lu\n",
+			   new_mtu, IONIC_XDP_MAX_LINEAR_MTU);
+		return -EINVAL;
+	}
+#endif
+
 	err = ionic_adminq_post_wait(lif, &ctx);
 	if (err)
 		return err;
@@ -2321,6 +2347,10 @@ static int ionic_txrx_init(struct ionic_lif *lif)
 		if (err)
 			goto err_out;
 
+#ifdef HAVE_XDP_RX
+		lif->rxqcqs[i]->q.xdp_prog = lif->xdp_prog;
+		lif->rxqcqs[i]->q.partner = &lif->txqcqs[i]->q;
+#endif
 		err = ionic_lif_rxq_init(lif, lif->rxqcqs[i]);
 		if (err) {
 			ionic_lif_qcq_deinit(lif, lif->txqcqs[i]);
@@ -2863,6 +2893,65 @@ static void ionic_vf_attr_replay(struct ionic_lif *lif)
 	ionic_vf_start(ionic);
 }
 
+#ifdef HAVE_XDP_RX
+static int ionic_xdp_config(struct net_device *netdev, struct netdev_bpf *bpf)
+{
+	struct ionic_lif *lif = netdev_priv(netdev);
+	struct bpf_prog *old_prog;
+	int err = 0;
+
+	if (bpf->prog && netdev->mtu > IONIC_XDP_MAX_LINEAR_MTU) {
+		NL_SET_ERR_MSG_MOD(bpf->extack, "MTU is too large for XDP");
+		netdev_info(netdev, "MTU %d is too large for XDP, max %lu\n",
+			    netdev->mtu, IONIC_XDP_MAX_LINEAR_MTU);
+		return -EOPNOTSUPP;
+	}
+
+	/* The Rx buffers are laid out for the program, with or without the
+	 * XDP headroom, so a running device refills them on the change.
+	 */
+	if (!netif_running(netdev)) {
+		old_prog = xchg(&lif->xdp_prog, bpf->prog);
+	} else {
+		mutex_lock(&lif->queue_lock);
+		ionic_stop_queues_reconfig(lif);
+		old_prog = xchg(&lif->xdp_prog, bpf->prog);
+		err = ionic_start_queues_reconfig(lif);
+		if (err) {
+			netdev_warn(netdev,
+				    "XDP reconfig failed, restoring program: %d\n",
+				    err);
+
+			/* Back out the change, keeping the error code */
+			ionic_stop_queues_reconfig(lif);
+			xchg(&lif->xdp_prog, old_prog);
+			ionic_start_queues_reconfig(lif);
+		}
+		mutex_unlock(&lif->queue_lock);
+	}
+
+	if (err) {
+		NL_SET_ERR_MSG_MOD(bpf->extack, "Failed to restart the queues");
+		return err;
+	}
+
+	if (old_prog)
+		bpf_prog_put(old_prog);
+
+	return 0;
+}
+
+static int ionic_xdp(struct net_device *netdev, struct netdev_bpf *bpf)
+{
+	switch (bpf->command) {
+	case XDP_SETUP_PROG:
+		return ionic_xdp_config(netdev, bpf);
+	default:
+		return -EINVAL;
+	}
+}
+#endif /* HAVE_XDP_RX */
+
 static const struct net_device_ops ionic_netdev_ops = {
 	.ndo_open               = ionic_open,
 	.ndo_stop               = ionic_stop,
@@ -2881,6 +2970,10 @@ static const struct net_device_ops ionic_netdev_ops = {
 	.ndo_tx_timeout         = ionic_tx_timeout,
 	.ndo_vlan_rx_add_vid    = ionic_vlan_rx_add_vid,
 	.ndo_vlan_rx_kill_vid   = ionic_vlan_rx_kill_vid,
+#ifdef HAVE_XDP_RX
+	.ndo_bpf		= ionic_xdp,
+	.ndo_xdp_xmit		= ionic_xdp_xmit,
+#endif
 
 #ifdef HAVE_RHEL7_NET_DEVICE_OPS_EXT
 #ifdef HAVE_RHEL7_NETDEV_OPS_EXT_NDO_SET_VF_VLAN
@@ -3302,10 +3395,16 @@ int ionic_lif_alloc(struct ionic *ionic)
 	ionic->lif = lif;
 	lif->ionic = ionic;
 
-	if (ionic->is_mgmt_nic || ionic->pfdev)
+	if (ionic->is_mgmt_nic || ionic->pfdev) {
 		netdev->netdev_ops = &ionic_mnic_netdev_ops;
-	else
+	} else {
 		netdev->netdev_ops = &ionic_netdev_ops;
+#ifdef HAVE_XDP_FEATURES
+		netdev->xdp_features = NETDEV_XDP_ACT_BASIC |
+				       NETDEV_XDP_ACT_REDIRECT |
+				       NETDEV_XDP_ACT_NDO_XMIT;
+#endif
+	}
 
 	ionic_ethtool_set_ops(netdev);
 	netdev->watchdog_timeo = 2 * HZ;
@@ -3571,6 +3670,13 @@ void ionic_lif_free(struct ionic_lif *lif)
 
 	ionic_lif_free_phc(lif);
 
+#ifdef HAVE_XDP_RX
+	if (lif->xdp_prog) {
+		bpf_prog_put(lif->xdp_prog);
+		lif->xdp_prog = NULL;
+	}
+#endif
+
 	/* free rss indirection table */
 	dma_free_coherent(dev, lif->rss_ind_tbl_sz, lif->rss_ind_tbl,
 			  lif->rss_ind_tbl_pa);
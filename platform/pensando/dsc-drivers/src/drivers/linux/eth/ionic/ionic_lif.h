@@ -32,6 +32,16 @@
 #define IONIC_RX_COPYBREAK_DEFAULT	256
 #define IONIC_TX_BUDGET_DEFAULT		256
 
+#ifdef HAVE_XDP_RX
+/* XDP runs on a single Rx buffer, leaving room for the XDP headroom and
+ * for the skb_shared_info of a frame built from it after a redirect
+ */
+#define IONIC_XDP_MAX_LINEAR_MTU	(IONIC_PAGE_SIZE -			\
+					 (XDP_PACKET_HEADROOM +			\
+					  SKB_DATA_ALIGN(sizeof(struct skb_shared_info)) + \
+					  ETH_HLEN + VLAN_HLEN))
+#endif
+
 struct ionic_tx_stats {
 	u64 pkts;
 	u64 bytes;
@@ -50,6 +60,9 @@ struct ionic_tx_stats {
 	u64 dma_map_err;
 	u64 hwstamp_valid;
 	u64 hwstamp_invalid;
+#ifdef HAVE_XDP_RX
+	u64 xdp_frames;
+#endif
 };
 
 struct ionic_rx_stats {
@@ -75,6 +88,13 @@ struct ionic_rx_stats {
 	u64 buf_reused;
 	u64 buf_exhausted;
 	u64 buf_not_reusable;
+#ifdef HAVE_XDP_RX
+	u64 xdp_drop;
+	u64 xdp_aborted;
+	u64 xdp_pass;
+	u64 xdp_tx;
+	u64 xdp_redirect;
+#endif
 };
 
 #define IONIC_QCQ_F_INITED		BIT(0)
@@ -285,6 +305,10 @@ struct ionic_lif {
 
 	struct ionic_phc *phc;
 
+#ifdef HAVE_XDP_RX
+	struct bpf_prog *xdp_prog;
+#endif
+
 	/* TODO: Make this a list if more than one child is supported */
 	struct ionic_lif_cfg child_lif_cfg;
 
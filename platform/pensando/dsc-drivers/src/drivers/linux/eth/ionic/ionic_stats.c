@@ -163,6 +163,9 @@ static const struct ionic_stat_desc ionic_tx_stats_desc[] = {
 	IONIC_TX_STAT_DESC(tso_bytes),
 	IONIC_TX_STAT_DESC(hwstamp_valid),
 	IONIC_TX_STAT_DESC(hwstamp_invalid),
+#ifdef HAVE_XDP_RX
+	IONIC_TX_STAT_DESC(xdp_frames),
+#endif
 #ifdef IONIC_DEBUG_STATS
 	IONIC_TX_STAT_DESC(vlan_inserted),
 	IONIC_TX_STAT_DESC(frags),
@@ -193,6 +196,13 @@ static const struct ionic_stat_desc ionic_rx_stats_desc[] = {
 	IONIC_RX_STAT_DESC(buf_exhausted),
 	IONIC_RX_STAT_DESC(buf_not_reusable),
 	IONIC_RX_STAT_DESC(buf_reused),
+#ifdef HAVE_XDP_RX
+	IONIC_RX_STAT_DESC(xdp_drop),
+	IONIC_RX_STAT_DESC(xdp_aborted),
+	IONIC_RX_STAT_DESC(xdp_pass),
+	IONIC_RX_STAT_DESC(xdp_tx),
+	IONIC_RX_STAT_DESC(xdp_redirect),
+#endif
 };
 
 #ifdef IONIC_DEBUG_STATS
@@ -96,9 +96,12 @@ static inline struct netdev_queue *q_to_ndq(struct ionic_queue *q)
 	return netdev_get_tx_queue(q->lif->netdev, q->index);
 }
 
-static inline void *ionic_rx_buf_va(struct ionic_buf_info *buf_info)
+static inline void ionic_write_cmb_desc(struct ionic_queue *q,
+					void __iomem *cmb_desc,
+					void *desc)
 {
-	return page_address(buf_info->page) + buf_info->page_offset;
+	if (q_to_qcq(q)->flags & IONIC_QCQ_F_CMB_RINGS)
+		memcpy_toio(cmb_desc, desc, q->desc_size);
 }
 
 static inline dma_addr_t ionic_rx_buf_pa(struct ionic_buf_info *buf_info)
@@ -111,6 +114,131 @@ static inline unsigned int ionic_rx_buf_size(struct ionic_buf_info *buf_info)
 	return min_t(u32, IONIC_MAX_BUF_LEN, IONIC_PAGE_SIZE - buf_info->page_offset);
 }
 
+#ifdef HAVE_PAGE_POOL_RX
+int ionic_rx_page_pool_create(struct ionic_queue *q)
+{
+	struct page_pool_params pp_params = {
+		.flags = PP_FLAG_DMA_MAP | PP_FLAG_DMA_SYNC_DEV,
+		.order = IONIC_PAGE_ORDER,
+		.pool_size = q->num_descs,
+		.nid = dev_to_node(q->dev),
+		.dev = q->dev,
+		.dma_dir = DMA_BIDIRECTIONAL,
+		.offset = 0,
+		.max_len = IONIC_PAGE_SIZE,
+	};
+	struct page_pool *page_pool;
+#ifdef HAVE_XDP_RX
+	int err;
+#endif
+
+	page_pool = page_pool_create(&pp_params);
+	if (IS_ERR(page_pool))
+		return PTR_ERR(page_pool);
+
+	q->page_pool = page_pool;
+
+#ifdef HAVE_XDP_RX
+	err = xdp_rxq_info_reg(&q->xdp_rxq_info, q->lif->netdev, q->index, 0);
+	if (err)
+		goto err_out_destroy;
+
+	err = xdp_rxq_info_reg_mem_model(&q->xdp_rxq_info, MEM_TYPE_PAGE_POOL,
+					 page_pool);
+	if (err) {
+		xdp_rxq_info_unreg(&q->xdp_rxq_info);
+		goto err_out_destroy;
+	}
+#endif
+
+	return 0;
+
+#ifdef HAVE_XDP_RX
+err_out_destroy:
+	page_pool_destroy(page_pool);
+	q->page_pool = NULL;
+	return err;
+#endif
+}
+
+void ionic_rx_page_pool_destroy(struct ionic_queue *q)
+{
+	if (!q->page_pool)
+		return;
+
+#ifdef HAVE_XDP_RX
+	xdp_rxq_info_unreg(&q->xdp_rxq_info);
+#endif
+	page_pool_destroy(q->page_pool);
+	q->page_pool = NULL;
+}
+
+static inline unsigned int ionic_rx_headroom(struct ionic_queue *q)
+{
+#ifdef HAVE_XDP_RX
+	if (q->xdp_prog)
+		return XDP_PACKET_HEADROOM;
+#endif
+	return 0;
+}
+
+/* A page handed to the stack is given back to the pool when the skb is
+ * freed, so a buffer is never split or reused in place.
+ */
+static void ionic_rx_buf_complete(struct ionic_queue *q,
+				  struct ionic_buf_info *buf_info, u32 used)
+{
+	buf_info->page = NULL;
+}
+
+static inline int ionic_rx_page_alloc(struct ionic_queue *q,
+				      struct ionic_buf_info *buf_info)
+{
+	struct net_device *netdev = q->lif->netdev;
+	struct ionic_rx_stats *stats;
+	struct page *page;
+
+	stats = q_to_rx_stats(q);
+
+	if (unlikely(!buf_info)) {
+		net_err_ratelimited("%s: %s invalid buf_info in alloc\n",
+				    netdev->name, q->name);
+		return -EINVAL;
+	}
+
+	page = page_pool_dev_alloc_pages(q->page_pool);
+	if (unlikely(!page)) {
+		net_err_ratelimited("%s: %s page alloc failed\n",
+				    netdev->name, q->name);
+		stats->alloc_err++;
+		return -ENOMEM;
+	}
+
+	buf_info->page = page;
+	buf_info->dma_addr = page_pool_get_dma_addr(page);
+	buf_info->page_offset = ionic_rx_headroom(q);
+
+	return 0;
+}
+
+static inline void ionic_rx_page_free(struct ionic_queue *q,
+				      struct ionic_buf_info *buf_info)
+{
+	struct net_device *netdev = q->lif->netdev;
+
+	if (unlikely(!buf_info)) {
+		net_err_ratelimited("%s: %s invalid buf_info in free\n",
+				    netdev->name, q->name);
+		return;
+	}
+
+	if (!buf_info->page)
+		return;
+
+	page_pool_put_full_page(q->page_pool, buf_info->page, false);
+	buf_info->page = NULL;
+}
+#else
 static bool ionic_rx_cache_put(struct ionic_queue *q,
 			       struct ionic_buf_info *buf_info)
 {
@@ -291,26 +419,33 @@ static inline void ionic_rx_page_free(struct ionic_queue *q,
 	buf_info->page = NULL;
 }
 
+#endif /* HAVE_PAGE_POOL_RX */
+
 static void ionic_rx_add_skb_frag(struct ionic_queue *q,
 				  struct sk_buff *skb,
 				  struct ionic_buf_info *buf_info,
-				  u32 off, u32 len)
+				  u32 page_off, u32 len)
 {
 	dma_sync_single_for_cpu(q->dev,
-				ionic_rx_buf_pa(buf_info) + off,
+				buf_info->dma_addr + page_off,
 				len, DMA_FROM_DEVICE);
 
 	skb_add_rx_frag(skb, skb_shinfo(skb)->nr_frags,
-			buf_info->page, buf_info->page_offset + off,
+			buf_info->page, page_off,
 			len,
 			IONIC_PAGE_SIZE);
 
-	ionic_rx_buf_complete(q, buf_info, off + len);
+	ionic_rx_buf_complete(q, buf_info,
+			      page_off + len - buf_info->page_offset);
 }
 
+/* The packet starts at headroom bytes into the page of the first buffer,
+ * which is its page_offset unless XDP moved the start of the packet.
+ */
 static struct sk_buff *ionic_rx_build_skb(struct ionic_queue *q,
 					  struct ionic_desc_info *desc_info,
-					  struct ionic_rxq_comp *comp)
+					  struct ionic_rxq_comp *comp,
+					  u32 headroom, u16 len)
 {
 	struct net_device *netdev = q->lif->netdev;
 	struct ionic_buf_info *buf_info;
@@ -321,7 +456,6 @@ static struct sk_buff *ionic_rx_build_skb(struct ionic_queue *q,
 	u16 head_len;
 	u16 frag_len;
 	u16 copy_len;
-	u16 len;
 
 	stats = q_to_rx_stats(q);
 
@@ -331,7 +465,6 @@ static struct sk_buff *ionic_rx_build_skb(struct ionic_queue *q,
 
 	prefetchw(buf_info->page);
 
-	len = le16_to_cpu(comp->len);
 	head_len = min_t(u16, q->lif->rx_copybreak, len);
 
 	skb = napi_alloc_skb(&q_to_qcq(q)->napi, head_len);
@@ -341,17 +474,22 @@ static struct sk_buff *ionic_rx_build_skb(struct ionic_queue *q,
 		stats->alloc_err++;
 		return NULL;
 	}
+#ifdef HAVE_PAGE_POOL_RX
+	skb_mark_for_recycle(skb);
+#endif
 
 	copy_len = ALIGN(head_len, sizeof(long)); /* for better memcpy performance */
-	dma_sync_single_for_cpu(dev, ionic_rx_buf_pa(buf_info), copy_len, DMA_FROM_DEVICE);
-	skb_copy_to_linear_data(skb, ionic_rx_buf_va(buf_info), copy_len);
+	dma_sync_single_for_cpu(dev, buf_info->dma_addr + headroom, copy_len, DMA_FROM_DEVICE);
+	skb_copy_to_linear_data(skb, page_address(buf_info->page) + headroom, copy_len);
 	skb_put(skb, head_len);
 
 	if (len > head_len) {
 		len -= head_len;
-		frag_len = min_t(u16, len, ionic_rx_buf_size(buf_info) - head_len);
+		frag_len = min_t(u16, len,
+				 min_t(u32, IONIC_MAX_BUF_LEN, IONIC_PAGE_SIZE - headroom) -
+				 head_len);
 		len -= frag_len;
-		ionic_rx_add_skb_frag(q, skb, buf_info, head_len, frag_len);
+		ionic_rx_add_skb_frag(q, skb, buf_info, headroom + head_len, frag_len);
 		buf_info++;
 		for (i = 0; i < comp->num_sg_elems; i++) {
 			if (len == 0)
@@ -360,12 +498,13 @@ static struct sk_buff *ionic_rx_build_skb(struct ionic_queue *q,
 				goto err_out;
 			frag_len = min_t(u16, len, ionic_rx_buf_size(buf_info));
 			len -= frag_len;
-			ionic_rx_add_skb_frag(q, skb, buf_info, 0, frag_len);
+			ionic_rx_add_skb_frag(q, skb, buf_info,
+					      buf_info->page_offset, frag_len);
 			buf_info++;
 		}
 	} else {
 		dma_sync_single_for_device(dev,
-					   ionic_rx_buf_pa(buf_info),
+					   buf_info->dma_addr + headroom,
 					   len, DMA_FROM_DEVICE);
 	}
 
@@ -379,6 +518,244 @@ err_out:
 	return NULL;
 }
 
+#ifdef HAVE_XDP_RX
+static void ionic_tx_clean(struct ionic_queue *q,
+			   struct ionic_desc_info *desc_info,
+			   struct ionic_cq_info *cq_info,
+			   void *cb_arg);
+
+static int ionic_xdp_post_frame(struct ionic_queue *q, struct xdp_frame *xdpf,
+				enum xdp_action act, struct page *page,
+				bool ring_doorbell)
+{
+	struct ionic_desc_info *desc_info = &q->info[q->head_idx];
+	struct ionic_buf_info *buf_info = desc_info->bufs;
+	struct ionic_tx_stats *stats = q_to_tx_stats(q);
+	struct ionic_txq_desc *desc = desc_info->desc;
+	dma_addr_t dma_addr;
+	u64 cmd;
+
+	if (act == XDP_TX) {
+		/* the page is still mapped by the page_pool of the rxq */
+		dma_addr = page_pool_get_dma_addr(page) +
+			   (xdpf->data - page_address(page));
+		dma_sync_single_for_device(q->dev, dma_addr, xdpf->len,
+					   DMA_BIDIRECTIONAL);
+	} else {
+		dma_addr = dma_map_single(q->dev, xdpf->data, xdpf->len,
+					  DMA_TO_DEVICE);
+		if (dma_mapping_error(q->dev, dma_addr)) {
+			stats->dma_map_err++;
+			return -EIO;
+		}
+	}
+
+	buf_info->dma_addr = dma_addr;
+	buf_info->len = xdpf->len;
+	desc_info->nbufs = 1;
+	desc_info->xdpf = xdpf;
+	desc_info->act = act;
+
+	cmd = encode_txq_desc_cmd(IONIC_TXQ_DESC_OPCODE_CSUM_NONE,
+				  0, 0, dma_addr);
+	desc->cmd = cpu_to_le64(cmd);
+	desc->len = cpu_to_le16(xdpf->len);
+	desc->csum_start = 0;
+	desc->csum_offset = 0;
+
+	ionic_write_cmb_desc(q, desc_info->cmb_desc, desc);
+
+	stats->xdp_frames++;
+	stats->pkts++;
+	stats->bytes += xdpf->len;
+
+	ionic_txq_post(q, ring_doorbell, ionic_tx_clean, NULL);
+
+	return 0;
+}
+
+static void ionic_xdp_tx_desc_clean(struct ionic_queue *q,
+				    struct ionic_desc_info *desc_info)
+{
+	struct ionic_buf_info *buf_info = desc_info->bufs;
+
+	if (desc_info->act != XDP_TX)
+		dma_unmap_single(q->dev, buf_info->dma_addr,
+				 buf_info->len, DMA_TO_DEVICE);
+
+	xdp_return_frame(desc_info->xdpf);
+
+	desc_info->nbufs = 0;
+	desc_info->xdpf = NULL;
+	desc_info->act = 0;
+}
+
+int ionic_xdp_xmit(struct net_device *netdev, int n,
+		   struct xdp_frame **xdp_frames, u32 flags)
+{
+	struct ionic_lif *lif = netdev_priv(netdev);
+	struct netdev_queue *nq;
+	struct ionic_queue *txq;
+	int nxmit;
+	int cpu;
+
+	if (unlikely(!test_bit(IONIC_LIF_F_UP, lif->state)))
+		return -ENETDOWN;
+
+	if (unlikely(flags & ~XDP_XMIT_FLAGS_MASK))
+		return -EINVAL;
+
+	cpu = smp_processor_id();
+	txq = &lif->txqcqs[cpu % lif->nxqs]->q;
+	nq = netdev_get_tx_queue(netdev, txq->index);
+
+	__netif_tx_lock(nq, cpu);
+	txq_trans_cond_update(nq);
+
+	for (nxmit = 0; nxmit < n; nxmit++) {
+		if (!ionic_q_has_space(txq, 1))
+			break;
+		if (ionic_xdp_post_frame(txq, xdp_frames[nxmit],
+					 XDP_REDIRECT, NULL, false))
+			break;
+	}
+
+	if (nxmit && (flags & XDP_XMIT_FLUSH)) {
+		ionic_dbell_ring(lif->kern_dbpage, txq->hw_type,
+				 txq->dbval | txq->head_idx);
+		txq->dbell_jiffies = jiffies;
+	}
+
+	__netif_tx_unlock(nq);
+
+	return nxmit;
+}
+
+/* Returns true if XDP consumed the packet, false to pass it up the stack
+ * starting at the possibly updated headroom and len.
+ */
+static bool ionic_run_xdp(struct ionic_rx_stats *stats,
+			  struct ionic_queue *rxq,
+			  struct bpf_prog *xdp_prog,
+			  struct ionic_buf_info *buf_info,
+			  u32 *headroom, u16 *len)
+{
+	struct net_device *netdev = rxq->lif->netdev;
+	struct ionic_queue *txq = rxq->partner;
+	struct netdev_queue *nq;
+	struct xdp_frame *xdpf;
+	struct xdp_buff xdp;
+	u32 xdp_action;
+	int err;
+
+	if (unlikely(!buf_info->page))
+		return false;
+
+	dma_sync_single_for_cpu(rxq->dev, buf_info->dma_addr + *headroom,
+				*len, DMA_FROM_DEVICE);
+
+	xdp_init_buff(&xdp, IONIC_PAGE_SIZE, &rxq->xdp_rxq_info);
+	xdp_prepare_buff(&xdp, page_address(buf_info->page),
+			 *headroom, *len, false);
+
+	xdp_action = bpf_prog_run_xdp(xdp_prog, &xdp);
+
+	switch (xdp_action) {
+	case XDP_PASS:
+		stats->xdp_pass++;
+		*headroom = xdp.data - xdp.data_hard_start;
+		*len = xdp.data_end - xdp.data;
+		return false;
+
+	case XDP_DROP:
+		stats->xdp_drop++;
+		goto out_recycle;
+
+	case XDP_TX:
+		xdpf = xdp_convert_buff_to_frame(&xdp);
+		if (!xdpf)
+			goto out_xdp_abort;
+
+		nq = netdev_get_tx_queue(netdev, txq->index);
+		__netif_tx_lock(nq, smp_processor_id());
+		txq_trans_cond_update(nq);
+
+		if (!ionic_q_has_space(txq, 1)) {
+			__netif_tx_unlock(nq);
+			goto out_xdp_abort;
+		}
+
+		err = ionic_xdp_post_frame(txq, xdpf, XDP_TX,
+					   buf_info->page, false);
+		__netif_tx_unlock(nq);
+		if (err)
+			goto out_xdp_abort;
+
+		buf_info->page = NULL;
+		rxq->xdp_flush |= IONIC_XDP_FLUSH_TX;
+		stats->xdp_tx++;
+		return true;
+
+	case XDP_REDIRECT:
+		err = xdp_do_redirect(netdev, &xdp, xdp_prog);
+		if (err)
+			goto out_xdp_abort;
+
+		buf_info->page = NULL;
+		rxq->xdp_flush |= IONIC_XDP_FLUSH_REDIRECT;
+		stats->xdp_redirect++;
+		return true;
+
+	default:
+		bpf_warn_invalid_xdp_action(netdev, xdp_prog, xdp_action);
+		fallthrough;
+	case XDP_ABORTED:
+		break;
+	}
+
+out_xdp_abort:
+	trace_xdp_exception(netdev, xdp_prog, xdp_action);
+	stats->xdp_aborted++;
+
+out_recycle:
+	/* the buffer stays on the ring and is posted again */
+	dma_sync_single_for_device(rxq->dev, ionic_rx_buf_pa(buf_info),
+				   ionic_rx_buf_size(buf_info),
+				   DMA_FROM_DEVICE);
+	return true;
+}
+
+/* Ring the XDP_TX doorbell and flush the redirects once per NAPI poll */
+static void ionic_xdp_rx_flush(struct ionic_queue *rxq)
+{
+	struct ionic_queue *txq;
+	struct netdev_queue *nq;
+
+	if (likely(!rxq->xdp_flush))
+		return;
+
+	if (rxq->xdp_flush & IONIC_XDP_FLUSH_REDIRECT)
+		xdp_do_flush();
+
+	if (rxq->xdp_flush & IONIC_XDP_FLUSH_TX) {
+		txq = rxq->partner;
+		nq = netdev_get_tx_queue(rxq->lif->netdev, txq->index);
+
+		__netif_tx_lock(nq, smp_processor_id());
+		ionic_dbell_ring(txq->lif->kern_dbpage, txq->hw_type,
+				 txq->dbval | txq->head_idx);
+		txq->dbell_jiffies = jiffies;
+		__netif_tx_unlock(nq);
+	}
+
+	rxq->xdp_flush = 0;
+}
+#else
+static inline void ionic_xdp_rx_flush(struct ionic_queue *rxq)
+{
+}
+#endif /* HAVE_XDP_RX */
+
 static void ionic_rx_clean(struct ionic_queue *q,
 			   struct ionic_desc_info *desc_info,
 			   struct ionic_cq_info *cq_info,
@@ -389,6 +766,11 @@ static void ionic_rx_clean(struct ionic_queue *q,
 	struct ionic_rx_stats *stats;
 	struct ionic_rxq_comp *comp;
 	struct sk_buff *skb;
+	u32 headroom;
+	u16 len;
+#ifdef HAVE_XDP_RX
+	struct bpf_prog *xdp_prog;
+#endif
 #ifdef CSUM_DEBUG
 	__sum16 csum;
 #endif
@@ -413,7 +795,18 @@ static void ionic_rx_clean(struct ionic_queue *q,
 	stats->pkts++;
 	stats->bytes += le16_to_cpu(comp->len);
 
-	skb = ionic_rx_build_skb(q, desc_info, comp);
+	headroom = desc_info->bufs[0].page_offset;
+	len = le16_to_cpu(comp->len);
+
+#ifdef HAVE_XDP_RX
+	xdp_prog = READ_ONCE(q->xdp_prog);
+	if (xdp_prog &&
+	    ionic_run_xdp(stats, q, xdp_prog, &desc_info->bufs[0],
+			  &headroom, &len))
+		return;
+#endif
+
+	skb = ionic_rx_build_skb(q, desc_info, comp, headroom, len);
 	if (unlikely(!skb)) {
 		stats->dropped++;
 		return;
@@ -528,14 +921,6 @@ bool ionic_rx_service(struct ionic_cq *cq, struct ionic_cq_info *cq_info)
 	return true;
 }
 
-static inline void ionic_write_cmb_desc(struct ionic_queue *q,
-					void __iomem *cmb_desc,
-					void *desc)
-{
-	if (q_to_qcq(q)->flags & IONIC_QCQ_F_CMB_RINGS)
-		memcpy_toio(cmb_desc, desc, q->desc_size);
-}
-
 void ionic_rx_fill(struct ionic_queue *q)
 {
 	struct net_device *netdev = q->lif->netdev;
@@ -652,7 +1037,9 @@ void ionic_rx_empty(struct ionic_queue *q)
 	q->head_idx = 0;
 	q->tail_idx = 0;
 
+#ifndef HAVE_PAGE_POOL_RX
 	ionic_rx_cache_drain(q);
+#endif
 }
 
 static void ionic_dim_update(struct ionic_qcq *qcq, int napi_mode)
@@ -739,6 +1126,8 @@ int ionic_rx_napi(struct napi_struct *napi, int budget)
 	work_done = ionic_cq_service(cq, budget,
 				     ionic_rx_service, NULL, NULL);
 
+	ionic_xdp_rx_flush(cq->bound_q);
+
 	ionic_rx_fill(cq->bound_q);
 
 	if (work_done < budget && napi_complete_done(napi, work_done)) {
@@ -787,6 +1176,8 @@ int ionic_txrx_napi(struct napi_struct *napi, int budget)
 	rx_work_done = ionic_cq_service(rxcq, budget,
 					ionic_rx_service, NULL, NULL);
 
+	ionic_xdp_rx_flush(rxcq->bound_q);
+
 	ionic_rx_fill(rxcq->bound_q);
 
 	if (rx_work_done < budget && napi_complete_done(napi, rx_work_done)) {
@@ -927,6 +1318,14 @@ static void ionic_tx_clean(struct ionic_queue *q,
 	struct sk_buff *skb = cb_arg;
 	u16 qi;
 
+#ifdef HAVE_XDP_RX
+	if (desc_info->xdpf) {
+		ionic_xdp_tx_desc_clean(q, desc_info);
+		stats->clean++;
+		return;
+	}
+#endif
+
 	ionic_tx_desc_unmap_bufs(q, desc_info);
 
 	if (!skb)
@@ -14,6 +14,14 @@ int ionic_rx_napi(struct napi_struct *napi, int budget);
 int ionic_tx_napi(struct napi_struct *napi, int budget);
 int ionic_txrx_napi(struct napi_struct *napi, int budget);
 netdev_tx_t ionic_start_xmit(struct sk_buff *skb, struct net_device *netdev);
+#ifdef HAVE_PAGE_POOL_RX
+int ionic_rx_page_pool_create(struct ionic_queue *q);
+void ionic_rx_page_pool_destroy(struct ionic_queue *q);
+#endif
+#ifdef HAVE_XDP_RX
+int ionic_xdp_xmit(struct net_device *netdev, int n,
+		   struct xdp_frame **xdp_frames, u32 flags);
+#endif
 
 bool ionic_rx_service(struct ionic_cq *cq, struct ionic_cq_info *cq_info);
 bool ionic_tx_service(struct ionic_cq *cq, struct ionic_cq_info *cq_info);
@@ -6816,6 +6816,18 @@ static inline struct devlink *_kc_devlink_alloc(const struct devlink_ops *ops,
 
 #else
 #define HAVE_RINGPARAM_EXTACK
+
+/* Rx buffers come from a page_pool and native XDP runs on them */
+#define HAVE_PAGE_POOL_RX
+#define HAVE_XDP_RX
+#if (KERNEL_VERSION(6, 6, 0) > LINUX_VERSION_CODE)
+#include <net/page_pool.h>
+#else
+#include <net/page_pool/helpers.h>
+#endif
+#include <net/xdp.h>
+#include <linux/filter.h>
+#include <linux/bpf_trace.h>
 #endif /* 5.17 */
 
 /*****************************************************************************/
@@ -6870,6 +6882,7 @@ static inline int skb_inner_tcp_all_headers(const struct sk_buff *skb)
 #if (KERNEL_VERSION(6, 3, 0) > LINUX_VERSION_CODE)
 #else
 #define HAVE_RX_PUSH
+#define HAVE_XDP_FEATURES
 #endif /* 6.3 */
 
 /* We don't support PTP on older RHEL kernels (needs more compat work) */
@@ -32,6 +32,7 @@
 #include <sys/queue.h>
 
 #define OPTION_MAX_LEN 256
+#define MAC_SYNC_WINDOW_DEFAULT 0
 #define MSG_LEN  81
 
 #define CMD_OPTION_PARSER_INIT_VALUE \
@@ -43,6 +44,7 @@
         .mclagdctl_file_path = "/var/run/iccpd/mclagdctl.sock", \
         .console_log = 0, \
         .telnet_port = 2015, \
+        .mac_sync_window = MAC_SYNC_WINDOW_DEFAULT, \
         .init = cmd_option_parser_init, \
         .finalize = cmd_option_parser_finalize, \
         .dump_usage = cmd_option_parser_dump_usage, \
@@ -66,6 +68,7 @@ struct CmdOptionParser
     char *mclagdctl_file_path;
     uint8_t console_log;
     uint16_t telnet_port;
+    int mac_sync_window;
     LIST_HEAD(option_list, CmdOption) option_list;
     int (*parse)(struct CmdOptionParser*, int, char*[]);
     void (*init)(struct CmdOptionParser*);
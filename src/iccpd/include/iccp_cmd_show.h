@@ -24,13 +24,35 @@
 #ifndef _ICCP_CMD_SHOW_H
 #define _ICCP_CMD_SHOW_H
 
+#include "../src/mclagdctl/mclagdctl.h"
+
 #define ICCP_MAX_PORT_NAME 20
 #define ICCP_MAX_IP_STR_LEN 16
 
+/* Max entries looked at per dump chunk, so that a selective filter
+ * does not hold the event loop on a large table */
+#define ICCP_DUMP_SCAN_MAX 4096
+
+/* Position of a MAC/ARP/ND dump streamed in chunks. Dump resumes after
+ * the key of last entry looked at, as table may change between chunks.
+ */
+struct iccp_dump_cursor
+{
+    int mclag_id;
+    struct mclagdctl_dump_filter filter;
+    int started;
+    int done;
+    int count;/*entries dumped so far*/
+    unsigned short vid;/*last MAC*/
+    uint8_t mac_addr[ETHER_ADDR_LEN];
+    uint32_t addr[4];/*last neighbor, IPv4 in addr[0]*/
+    char ifname[ICCP_MAX_PORT_NAME];
+};
+
 extern int iccp_mclag_config_dump(char * *buf, int *num, int mclag_id);
-extern int iccp_arp_dump(char * *buf, int *num, int mclag_id);
-extern int iccp_ndisc_dump(char * *buf, int *num, int mclag_id);
-extern int iccp_mac_dump(char * *buf, int *num, int mclag_id);
+extern int iccp_arp_dump(struct iccp_dump_cursor *cursor, char *buf, int max_num, int *num);
+extern int iccp_ndisc_dump(struct iccp_dump_cursor *cursor, char *buf, int max_num, int *num);
+extern int iccp_mac_dump(struct iccp_dump_cursor *cursor, char *buf, int max_num, int *num);
 extern int iccp_local_if_dump(char * *buf, int *num, int mclag_id);
 extern int iccp_peer_if_dump(char * *buf, int *num, int mclag_id);
 extern int iccp_cmd_dbg_counter_dump(char * *buf, int *data_len, int mclag_id);
@@ -76,6 +76,7 @@ struct Msg
 {
     char* buf;
     size_t len;
+    uint8_t restored;   /* Restored from warm reboot snapshot, not yet confirmed */
     TAILQ_ENTRY(Msg) tail;
 };
 
@@ -112,6 +113,9 @@ struct CSM
     time_t heartbeat_update_time;
     time_t peer_warm_reboot_time;
     time_t warm_reboot_disconn_time;
+    /* Restore from warm reboot snapshot & start of peer resync after it */
+    time_t warm_restore_time;
+    time_t warm_restore_sync_time;
     char peer_itf_name[IFNAMSIZ];
     time_t peer_link_learning_retry_time;
     char peer_ip[INET_ADDRSTRLEN];
@@ -125,6 +129,10 @@ struct CSM
     /* Msg queue */
     TAILQ_HEAD(msg_list, Msg) msg_list;
 
+    /* Bytes read from peer, not yet a complete message */
+    char rx_buf[CSM_BUFFER_SIZE];
+    size_t rx_len;
+
     /* STP role */
     stp_role_type_et role_type;
 
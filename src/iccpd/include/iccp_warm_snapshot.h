@@ -0,0 +1,95 @@
+/*
+ * iccp_warm_snapshot.h
+ *
+ * Copyright(c) 2016-2019 Nephos/Estinet.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ */
+
+#ifndef _ICCP_WARM_SNAPSHOT_H
+#define _ICCP_WARM_SNAPSHOT_H
+
+#include <stdint.h>
+
+struct System;
+struct CSM;
+
+/*
+ * Warm reboot snapshot
+ *
+ * Upon warm reboot exit, MAC, ARP & ND tables, peer interfaces and the
+ * iccpd owned state of local interfaces are saved to a file. Upon warm
+ * start, the file is mapped & the state is restored as each MC-LAG domain
+ * is configured, before its session comes up.
+ *
+ * Restored entries are marked. An entry is unmarked when kernel, mclagsyncd
+ * or peer reports it again. Marked peer MACs & neighbors are removed once
+ * the session has exchanged for ICCP_WARM_RECONCILE_TIME, or after
+ * ICCP_WARM_RESTORE_TIMEOUT if it does not come up.
+ *
+ * File
+ *      [header][record][record]...
+ * Record
+ *      [type][len][payload]
+ *  Payload is in host order, as the file is read by the same build on the
+ *  same switch. Unknown record types are skipped.
+ */
+
+#ifndef ICCPD_WARM_SNAPSHOT_DIR
+#define ICCPD_WARM_SNAPSHOT_DIR "/var/warmboot/iccpd/"
+#endif
+#define ICCPD_WARM_SNAPSHOT_FILE ICCPD_WARM_SNAPSHOT_DIR "iccpd.snapshot"
+
+#define ICCP_WARM_SNAPSHOT_MAGIC    0x49435053  /* ICPS */
+#define ICCP_WARM_SNAPSHOT_VERSION  1
+
+#define ICCP_WARM_RECONCILE_TIME    30
+#define ICCP_WARM_RESTORE_TIMEOUT   180
+
+struct iccp_warm_snapshot_hdr
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t hdr_len;
+    uint32_t data_len;      /* Bytes of records after header */
+    uint32_t checksum;      /* FNV-1a of records */
+    uint32_t num_records;
+    int64_t  created;
+} __attribute__ ((packed));
+
+struct iccp_warm_snapshot_rec
+{
+    uint16_t type;
+    uint16_t len;           /* Bytes of payload after this */
+} __attribute__ ((packed));
+
+enum ICCP_WARM_SNAPSHOT_REC_TYPE
+{
+    ICCP_WARM_REC_LIF = 1,  /* Before first CSM record */
+    ICCP_WARM_REC_CSM,      /* Records upto next CSM record belong to it */
+    ICCP_WARM_REC_PIF,
+    ICCP_WARM_REC_MAC,
+    ICCP_WARM_REC_ARP,
+    ICCP_WARM_REC_NDISC,
+};
+
+int iccp_warm_snapshot_save(struct System* sys);
+int iccp_warm_snapshot_load(struct System* sys);
+void iccp_warm_snapshot_restore(struct CSM* csm);
+void iccp_warm_snapshot_reconcile(struct CSM* csm);
+
+#endif
@@ -121,6 +121,8 @@ enum ICCP_DBG_CNTR_MSG
     ICCP_DBG_CNTR_MSG_STP_PO_PORT_MAP  = 26,
     ICCP_DBG_CNTR_MSG_STP_AGE_OUT      = 27,
     ICCP_DBG_CNTR_MSG_STP_COMMON_MSG   = 28,
+    ICCP_DBG_CNTR_MSG_MAC_SYNC_MARK    = 29,
+    ICCP_DBG_CNTR_MSG_MAC_SYNC_ACK     = 30,
     ICCP_DBG_CNTR_MSG_MAX
 };
 typedef enum ICCP_DBG_CNTR_MSG ICCP_DBG_CNTR_MSG_e;
@@ -143,9 +145,26 @@ do{\
         ++MLACP(csm).dbg_counters.iccp_counters[dbg_type][ICCP_DBG_CNTR_DIR_RX][status];\
 }while(0);
 
+/* MAC resync progress */
+typedef struct mlacp_mac_sync_counter_info
+{
+    uint64_t gen;                   /* Last generation sent to peer */
+    uint64_t acked_gen;             /* Last generation acked by peer */
+    uint64_t peer_gen;              /* Last generation of peer held */
+    uint32_t full_sync;
+    uint32_t delta_sync;
+    uint32_t last_sync_entries;     /* MACs queued by last resync */
+    uint32_t last_sync_total;       /* MACs in table upon last resync */
+    uint32_t tombstones;            /* Deleted MACs pending ack */
+    uint32_t tombstone_drops;       /* Tombstones dropped for limit */
+    uint32_t retain_count;          /* Peer MACs retained upon disconnect */
+    uint64_t tx_entries;
+}mlacp_mac_sync_counter_info_t;
+
 typedef struct mlacp_dbg_counter_info
 {
     uint64_t iccp_counters[ICCP_DBG_CNTR_MSG_MAX][ICCP_DBG_CNTR_DIR_MAX][ICCP_DBG_CNTR_STS_MAX];
+    mlacp_mac_sync_counter_info_t mac_sync;
 }mlacp_dbg_counter_info_t;
 
 struct mLACP
@@ -173,10 +192,28 @@ struct mLACP
     TAILQ_HEAD(mac_msg_list, MACMsg) mac_msg_list;
 
     struct mac_rb_tree mac_rb;
+    /* index of arp_list & ndisc_list by IP address */
+    struct neigh_rb_tree arp_rb;
+    struct neigh_rb_tree ndisc_rb;
 
     LIST_HEAD(lif_list, LocalInterface) lif_list;
     LIST_HEAD(lif_purge_list, LocalInterface) lif_purge_list;
     LIST_HEAD(pif_list, PeerInterface) pif_list;
+    struct pif_name_rb_tree pif_name_rb;
+
+    /* MAC delta resync, as sender */
+    uint32_t mac_sync_epoch;
+    uint64_t mac_sync_gen;
+    uint64_t mac_sync_acked_gen;
+    uint8_t mac_sync_full_needed;
+    uint8_t mac_sync_peer_capable;
+    TAILQ_HEAD(mac_tombstone_list, MACMsg) mac_tombstone_list;
+    uint32_t mac_tombstone_count;
+
+    /* MAC delta resync, as receiver */
+    uint32_t peer_mac_epoch;
+    uint64_t peer_mac_gen;
+    time_t peer_mac_retain_time;
 
     /* ICCP message tx/rx debug counters */
     mlacp_dbg_counter_info_t  dbg_counters;
@@ -188,6 +225,7 @@ void mlacp_fsm_transit(struct CSM* csm);
 void mlacp_enqueue_msg(struct CSM*, struct Msg*);
 struct Msg* mlacp_dequeue_msg(struct CSM*);
 char* mlacp_state(struct CSM* csm);
+void mlacp_mac_sync_release(struct CSM* csm, struct MACMsg* mac_msg);
 
 /* from app_csm*/
 extern int mlacp_bind_local_if(struct CSM* csm, struct LocalInterface* local_if);
@@ -32,6 +32,8 @@
 
 #define ICCP_MLAGSYNCD_SEND_MSG_BUFFER_SIZE MCLAG_MAX_MSG_LEN
 #define ICCP_MLAGSYNCD_RECV_MSG_BUFFER_SIZE (MCLAG_MAX_MSG_LEN * 256)
+/* Max bytes queued to mclagsyncd while socket is not writable */
+#define ICCP_MLAGSYNCD_TX_QUEUE_MAX_SIZE (MCLAG_MAX_MSG_LEN * 4096)
 
 extern char g_iccp_recv_buf[];
 
@@ -42,6 +44,7 @@ extern char g_iccp_recv_buf[];
 void mlacp_portchannel_state_handler(struct CSM* csm, struct LocalInterface* local_if, int po_state);
 void mlacp_peer_conn_handler(struct CSM* csm);
 void mlacp_peer_disconn_handler(struct CSM* csm);
+void mlacp_peer_disconn_fdb_handler(struct CSM* csm);
 void mlacp_peerlink_up_handler(struct CSM* csm);
 void mlacp_peerlink_down_handler(struct CSM* csm);
 void update_stp_peer_link(struct CSM *csm, struct PeerInterface *peer_if, int po_state, int new_create);
@@ -53,6 +56,8 @@ void peerlink_port_isolate_cleanup(struct CSM* csm);
 void update_peerlink_isolate_from_all_csm_lif(struct CSM* csm);
 
 ssize_t iccp_send_to_mclagsyncd(uint8_t msg_type, char *send_buff, uint16_t send_len);
+int iccp_mclagsyncd_tx_flush(struct System *sys);
+void iccp_mclagsyncd_fdb_flush();
 
 void del_mac_from_chip(struct MACMsg* mac_msg);
 void add_mac_to_chip(struct MACMsg* mac_msg, uint8_t mac_type);
@@ -61,6 +66,8 @@ uint8_t set_mac_local_age_flag(struct CSM *csm, struct MACMsg* mac_msg, uint8_t
 extern int mclagd_ctl_sock_create();
 extern int mclagd_ctl_sock_accept(int fd);
 extern int mclagd_ctl_interactive_process(int client_fd);
+extern int mclagd_ctl_dump_handler(struct System *sys, int fd, uint32_t events);
+extern void mclagd_ctl_dump_expire();
 extern int parseMacString(const char *str_mac, uint8_t *bin_mac);
 
 char *show_ip_str(uint32_t ipv4_addr);
@@ -60,4 +60,12 @@ int mlacp_prepare_for_if_up_ack(
     uint8_t           if_type,
     uint16_t          if_id,
     uint8_t           port_isolation_enable);
+int mlacp_prepare_for_mac_sync(
+    struct CSM        *csm,
+    char              *buf,
+    size_t            max_buf_size,
+    uint16_t          tlv_type,
+    uint8_t           flags,
+    uint32_t          epoch,
+    uint64_t          gen);
 #endif
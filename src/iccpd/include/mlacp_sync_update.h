@@ -44,6 +44,10 @@ int mlacp_fsm_update_warmboot(struct CSM* csm, struct mLACPWarmbootTLV* tlv);
 
 void mlacp_enqueue_arp(struct CSM* csm, struct Msg* msg);
 void mlacp_enqueue_ndisc(struct CSM *csm, struct Msg *msg);
+void mlacp_dequeue_arp(struct CSM* csm, struct Msg* msg);
+void mlacp_dequeue_ndisc(struct CSM *csm, struct Msg *msg);
+struct Msg* mlacp_find_arp(struct CSM* csm, char* ifname, uint32_t ipv4_addr);
+struct Msg* mlacp_find_ndisc(struct CSM* csm, char* ifname, uint32_t* ipv6_addr);
 int mlacp_fsm_update_Agg_conf(struct CSM* csm, mLACPAggConfigTLV* portconf);
 int mlacp_fsm_update_port_channel_info(struct CSM* csm, struct mLACPPortChannelInfoTLV* tlv);
 int mlacp_fsm_update_peerlink_info(struct CSM* csm, struct mLACPPeerLinkInfoTLV* tlv);
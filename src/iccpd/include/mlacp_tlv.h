@@ -469,6 +469,23 @@ struct mLACPIfUpAckTLV {
     uint16_t        if_id;                   /* LAG: agg_id */
 }__attribute__ ((packed));
 
+/*
+ * NOS: MAC delta resync
+ * Sender marks the MAC info sent up to a generation, receiver acks the
+ * generation it holds. Upon reconnect, receiver acks the generation it
+ * retained & sender sends only the MACs changed after it.
+ */
+#define MAC_SYNC_MARK_FLAG_FULL     0x1  /* Full sync follows, drop retained MACs */
+#define MAC_SYNC_MARK_FLAG_DELTA    0x2  /* Delta sync follows, keep retained MACs */
+
+struct mLACPMACSyncTLV {
+    ICCParameter    icc_parameter;
+    uint8_t         flags;
+    uint8_t         reserved[3];
+    uint32_t        epoch;                   /* Sender instance, 0 if none */
+    uint64_t        gen;
+}__attribute__ ((packed));
+
 enum NEIGH_OP_TYPE
 {
     NEIGH_SYNC_LIF = 0,
@@ -525,11 +542,36 @@ struct MACMsg
     uint8_t age_flag;/*local or peer is age?*/
     uint8_t pending_local_del;
     uint8_t add_to_syncd;
+    uint8_t restored;/*restored from warm reboot snapshot, not yet confirmed*/
 
     TAILQ_ENTRY(MACMsg) tail;     // entry into mac_msg_list
+
+    /* Last sent to peer, for delta resync. sync_gen 0 if never sent */
+    uint64_t sync_gen;
+    uint8_t  sync_op;
+    uint8_t  sync_fdb_type;
+    char     sync_ifname[MAX_L_PORT_NAME];
+    TAILQ_ENTRY(MACMsg) sync_tail;  // entry into mac_tombstone_list
 };
 
 RB_HEAD(mac_rb_tree, MACMsg);
 RB_PROTOTYPE(mac_rb_tree, MACMsg, mac_entry_rb, MACMsg_compare);
 
+/*
+ * Index of ARP/ND info list entry by IP address & interface,
+ * as the kernel keeps neighbors, e.g. IPv6 link-local ones.
+ * ARPMsg & NDISCMsg are TLV entries, so the index node
+ * refers to the list entry instead of being embedded in it.
+ */
+struct NeighIndex
+{
+    RB_ENTRY(NeighIndex) neigh_entry_rb;
+    uint32_t addr[4];   /*IPv4 in addr[0], rest zero*/
+    char ifname[MAX_L_PORT_NAME];
+    struct Msg* msg;
+};
+
+RB_HEAD(neigh_rb_tree, NeighIndex);
+RB_PROTOTYPE(neigh_rb_tree, NeighIndex, neigh_entry_rb, NeighIndex_compare);
+
 #endif /* MLACP_TLV_H_ */
@@ -105,6 +105,8 @@
 #define TLV_T_MLACP_WARMBOOT_FLAG       0x1039
 #define TLV_T_MLACP_NDISC_INFO          0x103A
 #define TLV_T_MLACP_IF_UP_ACK           0x103B
+#define TLV_T_MLACP_MAC_SYNC_MARK       0x103C
+#define TLV_T_MLACP_MAC_SYNC_ACK        0x103D
 #define TLV_T_MLACP_LIST_END            0x104a //list end
 
 /* Debug */
@@ -187,6 +189,12 @@ static char* get_tlv_type_string(int type)
 
         case TLV_T_MLACP_IF_UP_ACK:
             return "TLV_T_MLACP_IF_UP_ACK";
+
+        case TLV_T_MLACP_MAC_SYNC_MARK:
+            return "TLV_T_MLACP_MAC_SYNC_MARK";
+
+        case TLV_T_MLACP_MAC_SYNC_ACK:
+            return "TLV_T_MLACP_MAC_SYNC_ACK";
     }
 
     return "UNKNOWN";
@@ -121,9 +121,13 @@ struct PeerInterface
     struct CSM* csm;
 
     LIST_ENTRY(PeerInterface) mlacp_next;
+    RB_ENTRY(PeerInterface) name_entry_rb;
     struct vlan_rb_tree vlan_tree;
 };
 
+RB_HEAD(pif_name_rb_tree, PeerInterface);
+RB_PROTOTYPE(pif_name_rb_tree, PeerInterface, name_entry_rb, pif_name_compare);
+
 struct LocalInterface
 {
     int ifindex;
@@ -167,12 +171,25 @@ struct LocalInterface
     LIST_ENTRY(LocalInterface) system_purge_next;
     LIST_ENTRY(LocalInterface) mlacp_next;
     LIST_ENTRY(LocalInterface) mlacp_purge_next;
+
+    /* Indexes of system lif_list */
+    RB_ENTRY(LocalInterface) name_entry_rb;
+    RB_ENTRY(LocalInterface) ifindex_entry_rb;
+    RB_ENTRY(LocalInterface) po_entry_rb;
 };
 
+RB_HEAD(lif_name_rb_tree, LocalInterface);
+RB_PROTOTYPE(lif_name_rb_tree, LocalInterface, name_entry_rb, lif_name_compare);
+RB_HEAD(lif_ifindex_rb_tree, LocalInterface);
+RB_PROTOTYPE(lif_ifindex_rb_tree, LocalInterface, ifindex_entry_rb, lif_ifindex_compare);
+RB_HEAD(lif_po_rb_tree, LocalInterface);
+RB_PROTOTYPE(lif_po_rb_tree, LocalInterface, po_entry_rb, lif_po_compare);
+
 struct LocalInterface* local_if_create(int ifindex, char* ifname, int type, uint8_t state);
 struct LocalInterface* local_if_find_by_name(const char* ifname);
 struct LocalInterface* local_if_find_by_ifindex(int ifindex);
 struct LocalInterface* local_if_find_by_po_id(int po_id);
+void local_if_set_ifindex(struct LocalInterface* local_if, int ifindex);
 
 void local_if_destroy(char *ifname);
 void local_if_change_flag_clear(void);
@@ -184,6 +201,7 @@ void local_if_finalize(struct LocalInterface*);
 
 struct PeerInterface* peer_if_create(struct CSM* csm, int peer_if_number, int type);
 struct PeerInterface* peer_if_find_by_name(struct CSM* csm, char* name);
+void peer_if_set_name(struct PeerInterface* pif, const char* name, int len);
 
 void peer_if_destroy(struct PeerInterface* pif);
 int peer_if_add_vlan(struct PeerInterface* peer_if, uint16_t vlan_id);
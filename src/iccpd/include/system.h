@@ -309,6 +309,13 @@ struct System
     struct nl_sock * genric_event_sock;
     struct nl_sock * route_event_sock;
 
+    /* Messages to mclagsyncd pending socket to be writable */
+    char* sync_tx_buf;
+    size_t sync_tx_size;
+    size_t sync_tx_start;
+    size_t sync_tx_len;
+    int sync_tx_pollout;
+
     int sig_pipe_r;
     int sig_pipe_w;
     int warmboot_start;
@@ -317,6 +324,10 @@ struct System
     /* Info List*/
     LIST_HEAD(csm_list, CSM) csm_list;
     LIST_HEAD(lif_all_list, LocalInterface) lif_list;
+    /* lif_list indexed by name, ifindex & port channel id */
+    struct lif_name_rb_tree lif_name_rb;
+    struct lif_ifindex_rb_tree lif_ifindex_rb;
+    struct lif_po_rb_tree lif_po_rb;
     LIST_HEAD(lif_purge_all_list, LocalInterface) lif_purge_list;
     LIST_HEAD(unq_ip_all_if_list, Unq_ip_If_info) unq_ip_if_list;
     LIST_HEAD(pending_vlan_mbr_if_list, PendingVlanMbrIf) pending_vlan_mbr_if_list;
@@ -328,6 +339,8 @@ struct System
     char* mclagdctl_file_path;
     int pid_file_fd;
     int telnet_port;
+    /* Secs peer MACs are retained after session down for delta resync, 0 disables */
+    int mac_sync_window;
     fd_set readfd; /*record socket need to listen*/
     int readfd_count;
     time_t csm_trans_time;
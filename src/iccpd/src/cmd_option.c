@@ -133,6 +133,7 @@ void cmd_option_parser_init(struct CmdOptionParser* parser)
     cmd_option_register(parser, "-l <LOG_FILE_PATH>", "Set log file path.\n(Default: /var/log/iccpd.log)");
     cmd_option_register(parser, "-p <TCP_PORT>", "Set the port used for telnet listening port.\n(Default: 2015)");
     cmd_option_register(parser, "-c", "Dump log message to console. (Default: No)");
+    cmd_option_register(parser, "-r <SECONDS>", "Set the window to retain peer MACs after session down, for delta resync. 0 disables.\nRetained peer MACs delay the FDB handover on a real peer failure.\n(Default: 0)");
     cmd_option_register(parser, "-h", "Show the usage.");
 }
 
@@ -256,6 +257,12 @@ int cmd_option_parser_parse(struct CmdOptionParser* parser, int argc, char* argv
         }
         else if (strncmp(opt_name, "-c", 2) == 0)
             parser->console_log = 1;
+        else if (strncmp(opt_name, "-r", 2) == 0)
+        {
+            num = atoi(val);
+            if (num >= 0)
+                parser->mac_sync_window = num;
+        }
         else
             fprintf(stderr, "Unknown option name %s, skip it.\n", opt_name);
 
@@ -29,6 +29,7 @@
 #include "../include/iccp_csm.h"
 #include "../include/mlacp_link_handler.h"
 #include "../include/iccp_netlink.h"
+#include "../include/iccp_warm_snapshot.h"
 /*
  * 'id <1-65535>' command
  */
@@ -44,6 +45,9 @@ int set_mc_lag_id( struct CSM *csm, uint16_t id)
     csm->mlag_id = id;
     csm->iccp_info.icc_rg_id = id;
     csm->app_csm.mlacp.id = id;
+
+    /* Restore domain state saved upon warm reboot, if any */
+    iccp_warm_snapshot_restore(csm);
     return 0;
 }
 
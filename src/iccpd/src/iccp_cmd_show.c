@@ -150,201 +150,216 @@ int iccp_mclag_config_dump(char * *buf,  int *num, int mclag_id)
     return EXEC_TYPE_SUCCESS;
 }
 
-int iccp_arp_dump(char * *buf, int *num, int mclag_id)
+static int iccp_dump_match_mac(struct mclagdctl_dump_filter *filter, uint8_t *mac_addr)
 {
-    struct System *sys = NULL;
-    struct CSM *csm = NULL;
-    struct Msg *msg = NULL;
-    struct ARPMsg *iccpd_arp = NULL;
-    struct mclagd_arp_msg mclagd_arp;
-    int arp_num = 0;
-    int id_exist = 0;
-    char * arp_buf = NULL;
-    int arp_buf_size = MCLAGDCTL_CMD_SIZE;
+    return memcmp(mac_addr, filter->mac_prefix, filter->mac_prefix_len) == 0;
+}
 
-    if (!(sys = system_get_instance()))
+/* Neighbors are learned on VLAN interfaces, VLAN filter matches the interface */
+static int iccp_dump_match_neigh(struct mclagdctl_dump_filter *filter, char *ifname, uint8_t *mac_addr)
+{
+    char vlan_name[MCLAGDCTL_MAX_L_PORT_NANE];
+
+    if (filter->ifname[0] && strcmp(ifname, filter->ifname) != 0)
+        return 0;
+
+    if (filter->vid > 0)
     {
-        return EXEC_TYPE_NO_EXIST_SYS;
+        snprintf(vlan_name, sizeof(vlan_name), "%s%d", VLAN_PREFIX, filter->vid);
+        if (strcmp(ifname, vlan_name) != 0)
+            return 0;
     }
 
-    arp_buf = (char*)malloc(arp_buf_size);
-    if (!arp_buf)
-        return EXEC_TYPE_FAILED;
+    return iccp_dump_match_mac(filter, mac_addr);
+}
 
-    LIST_FOREACH(csm, &(sys->csm_list), next)
-    {
-        if (mclag_id > 0)
-        {
-            if (csm->mlag_id == mclag_id)
-                id_exist = 1;
-            else
-                continue;
-        }
+static int iccp_dump_limit_reached(struct iccp_dump_cursor *cursor)
+{
+    return cursor->filter.limit > 0 && cursor->count >= cursor->filter.limit;
+}
 
-        TAILQ_FOREACH(msg, &MLACP(csm).arp_list, tail)
-        {
-            memset(&mclagd_arp, 0, sizeof(struct mclagd_arp_msg));
-            iccpd_arp = (struct ARPMsg*)msg->buf;
+/* First neighbor after the cursor */
+static struct NeighIndex *iccp_dump_neigh_start(struct iccp_dump_cursor *cursor, struct neigh_rb_tree *tree)
+{
+    struct NeighIndex neigh_find;
+    struct NeighIndex *neigh = NULL;
 
-            mclagd_arp.op_type = iccpd_arp->op_type;
-            mclagd_arp.learn_flag = iccpd_arp->learn_flag;
-            memcpy(mclagd_arp.ifname, iccpd_arp->ifname, strlen(iccpd_arp->ifname));
-            memcpy(mclagd_arp.ipv4_addr, show_ip_str(iccpd_arp->ipv4_addr), 16);
-            memcpy(mclagd_arp.mac_addr, iccpd_arp->mac_addr, 6);
+    if (!cursor->started)
+        return RB_MIN(neigh_rb_tree, tree);
 
-            memcpy(arp_buf + MCLAGD_REPLY_INFO_HDR + arp_num * sizeof(struct mclagd_arp_msg),
-                   &mclagd_arp, sizeof(struct mclagd_arp_msg));
+    memset(&neigh_find, 0, sizeof(neigh_find));
+    memcpy(neigh_find.addr, cursor->addr, sizeof(neigh_find.addr));
+    snprintf(neigh_find.ifname, sizeof(neigh_find.ifname), "%s", cursor->ifname);
+    neigh = RB_NFIND(neigh_rb_tree, tree, &neigh_find);
+    if (neigh && memcmp(neigh->addr, neigh_find.addr, sizeof(neigh->addr)) == 0
+        && strcmp(neigh->ifname, neigh_find.ifname) == 0)
+        neigh = RB_NEXT(neigh_rb_tree, neigh);
 
-            arp_num++;
+    return neigh;
+}
 
-            if ((arp_num + 1) * sizeof(struct mclagd_arp_msg) > (arp_buf_size - MCLAGD_REPLY_INFO_HDR))
-            {
-                arp_buf_size += MCLAGDCTL_CMD_SIZE;
-                arp_buf = (char*)realloc(arp_buf, arp_buf_size);
-                if (!arp_buf)
-                    return EXEC_TYPE_FAILED;
-            }
-        }
-    }
+/* Dump upto max_num ARP entries after cursor to buf */
+int iccp_arp_dump(struct iccp_dump_cursor *cursor, char *buf, int max_num, int *num)
+{
+    struct CSM *csm = NULL;
+    struct NeighIndex *neigh = NULL;
+    struct ARPMsg *iccpd_arp = NULL;
+    struct mclagd_arp_msg mclagd_arp;
+    int arp_num = 0;
+    int scan_num = 0;
 
-    *buf = arp_buf;
-    *num = arp_num;
+    *num = 0;
+    if (!system_get_instance())
+        return EXEC_TYPE_NO_EXIST_SYS;
 
-    if (mclag_id > 0 && !id_exist)
+    if (!(csm = system_get_csm_by_mlacp_id(cursor->mclag_id)))
         return EXEC_TYPE_NO_EXIST_MCLAGID;
 
+    for (neigh = iccp_dump_neigh_start(cursor, &MLACP(csm).arp_rb);
+         neigh && arp_num < max_num && scan_num < ICCP_DUMP_SCAN_MAX && !iccp_dump_limit_reached(cursor);
+         neigh = RB_NEXT(neigh_rb_tree, neigh), scan_num++)
+    {
+        memcpy(cursor->addr, neigh->addr, sizeof(cursor->addr));
+        snprintf(cursor->ifname, sizeof(cursor->ifname), "%s", neigh->ifname);
+        cursor->started = 1;
+
+        iccpd_arp = (struct ARPMsg*)neigh->msg->buf;
+        if (!iccp_dump_match_neigh(&cursor->filter, iccpd_arp->ifname, iccpd_arp->mac_addr))
+            continue;
+
+        memset(&mclagd_arp, 0, sizeof(struct mclagd_arp_msg));
+        mclagd_arp.op_type = iccpd_arp->op_type;
+        mclagd_arp.learn_flag = iccpd_arp->learn_flag;
+        memcpy(mclagd_arp.ifname, iccpd_arp->ifname, strlen(iccpd_arp->ifname));
+        memcpy(mclagd_arp.ipv4_addr, show_ip_str(iccpd_arp->ipv4_addr), 16);
+        memcpy(mclagd_arp.mac_addr, iccpd_arp->mac_addr, 6);
+
+        memcpy(buf + arp_num * sizeof(struct mclagd_arp_msg), &mclagd_arp, sizeof(struct mclagd_arp_msg));
+        arp_num++;
+        cursor->count++;
+    }
+
+    if (!neigh || iccp_dump_limit_reached(cursor))
+        cursor->done = 1;
+    *num = arp_num;
+
     return EXEC_TYPE_SUCCESS;
 }
 
-int iccp_ndisc_dump(char * *buf, int *num, int mclag_id)
+/* Dump upto max_num ND entries after cursor to buf */
+int iccp_ndisc_dump(struct iccp_dump_cursor *cursor, char *buf, int max_num, int *num)
 {
-    struct System *sys = NULL;
     struct CSM *csm = NULL;
-    struct Msg *msg = NULL;
+    struct NeighIndex *neigh = NULL;
     struct NDISCMsg *iccpd_ndisc = NULL;
     struct mclagd_ndisc_msg mclagd_ndisc;
     int ndisc_num = 0;
-    int id_exist = 0;
-    char *ndisc_buf = NULL;
-    int ndisc_buf_size = MCLAGDCTL_CMD_SIZE;
+    int scan_num = 0;
 
-    if (!(sys = system_get_instance()))
-    {
+    *num = 0;
+    if (!system_get_instance())
         return EXEC_TYPE_NO_EXIST_SYS;
-    }
 
-    ndisc_buf = (char *)malloc(ndisc_buf_size);
-    if (!ndisc_buf)
-        return EXEC_TYPE_FAILED;
+    if (!(csm = system_get_csm_by_mlacp_id(cursor->mclag_id)))
+        return EXEC_TYPE_NO_EXIST_MCLAGID;
 
-    LIST_FOREACH(csm, &(sys->csm_list), next)
+    for (neigh = iccp_dump_neigh_start(cursor, &MLACP(csm).ndisc_rb);
+         neigh && ndisc_num < max_num && scan_num < ICCP_DUMP_SCAN_MAX && !iccp_dump_limit_reached(cursor);
+         neigh = RB_NEXT(neigh_rb_tree, neigh), scan_num++)
     {
-        if (mclag_id > 0)
-        {
-            if (csm->mlag_id == mclag_id)
-                id_exist = 1;
-            else
-                continue;
-        }
-
-        TAILQ_FOREACH(msg, &MLACP(csm).ndisc_list, tail)
-        {
-            memset(&mclagd_ndisc, 0, sizeof(struct mclagd_ndisc_msg));
-            iccpd_ndisc = (struct NDISCMsg *)msg->buf;
-
-            mclagd_ndisc.op_type = iccpd_ndisc->op_type;
-            mclagd_ndisc.learn_flag = iccpd_ndisc->learn_flag;
-            memcpy(mclagd_ndisc.ifname, iccpd_ndisc->ifname, strlen(iccpd_ndisc->ifname));
-            memcpy(mclagd_ndisc.ipv6_addr, show_ipv6_str((char *)iccpd_ndisc->ipv6_addr), 46);
-            memcpy(mclagd_ndisc.mac_addr, iccpd_ndisc->mac_addr, 6);
-
-            memcpy(ndisc_buf + MCLAGD_REPLY_INFO_HDR + ndisc_num * sizeof(struct mclagd_ndisc_msg), &mclagd_ndisc, sizeof(struct mclagd_ndisc_msg));
-
-            ndisc_num++;
-
-            if ((ndisc_num + 1) * sizeof(struct mclagd_ndisc_msg) > (ndisc_buf_size - MCLAGD_REPLY_INFO_HDR))
-            {
-                ndisc_buf_size += MCLAGDCTL_CMD_SIZE;
-                ndisc_buf = (char *)realloc(ndisc_buf, ndisc_buf_size);
-                if (!ndisc_buf)
-                    return EXEC_TYPE_FAILED;
-            }
-        }
+        memcpy(cursor->addr, neigh->addr, sizeof(cursor->addr));
+        snprintf(cursor->ifname, sizeof(cursor->ifname), "%s", neigh->ifname);
+        cursor->started = 1;
+
+        iccpd_ndisc = (struct NDISCMsg *)neigh->msg->buf;
+        if (!iccp_dump_match_neigh(&cursor->filter, iccpd_ndisc->ifname, iccpd_ndisc->mac_addr))
+            continue;
+
+        memset(&mclagd_ndisc, 0, sizeof(struct mclagd_ndisc_msg));
+        mclagd_ndisc.op_type = iccpd_ndisc->op_type;
+        mclagd_ndisc.learn_flag = iccpd_ndisc->learn_flag;
+        memcpy(mclagd_ndisc.ifname, iccpd_ndisc->ifname, strlen(iccpd_ndisc->ifname));
+        memcpy(mclagd_ndisc.ipv6_addr, show_ipv6_str((char *)iccpd_ndisc->ipv6_addr), 46);
+        memcpy(mclagd_ndisc.mac_addr, iccpd_ndisc->mac_addr, 6);
+
+        memcpy(buf + ndisc_num * sizeof(struct mclagd_ndisc_msg), &mclagd_ndisc, sizeof(struct mclagd_ndisc_msg));
+        ndisc_num++;
+        cursor->count++;
     }
 
-    *buf = ndisc_buf;
+    if (!neigh || iccp_dump_limit_reached(cursor))
+        cursor->done = 1;
     *num = ndisc_num;
 
-    if (mclag_id > 0 && !id_exist)
-        return EXEC_TYPE_NO_EXIST_MCLAGID;
-
     return EXEC_TYPE_SUCCESS;
 }
 
-int iccp_mac_dump(char * *buf, int *num, int mclag_id)
+/* Dump upto max_num MAC entries after cursor to buf */
+int iccp_mac_dump(struct iccp_dump_cursor *cursor, char *buf, int max_num, int *num)
 {
-    struct System *sys = NULL;
     struct CSM *csm = NULL;
-    struct Msg *msg = NULL;
     struct MACMsg *iccpd_mac = NULL;
+    struct MACMsg mac_find;
     struct mclagd_mac_msg mclagd_mac;
+    struct mclagdctl_dump_filter *filter = &cursor->filter;
     int mac_num = 0;
-    int id_exist = 0;
-    char * mac_buf = NULL;
-    int mac_buf_size = MCLAGDCTL_CMD_SIZE;
+    int scan_num = 0;
 
-    if (!(sys = system_get_instance()))
-    {
+    *num = 0;
+    if (!system_get_instance())
         return EXEC_TYPE_NO_EXIST_SYS;
-    }
 
-    mac_buf = (char*)malloc(mac_buf_size);
-    if (!mac_buf)
-        return EXEC_TYPE_FAILED;
+    if (!(csm = system_get_csm_by_mlacp_id(cursor->mclag_id)))
+        return EXEC_TYPE_NO_EXIST_MCLAGID;
 
-    LIST_FOREACH(csm, &(sys->csm_list), next)
+    if (cursor->started)
     {
-        if (mclag_id > 0)
-        {
-            if (csm->mlag_id == mclag_id)
-                id_exist = 1;
-            else
-                continue;
-        }
-
-        RB_FOREACH (iccpd_mac, mac_rb_tree, &MLACP(csm).mac_rb)
-        {
-            memset(&mclagd_mac, 0, sizeof(struct mclagd_mac_msg));
-
-            mclagd_mac.op_type = iccpd_mac->op_type;
-            mclagd_mac.fdb_type = iccpd_mac->fdb_type;
-            memcpy(mclagd_mac.mac_addr, iccpd_mac->mac_addr, ETHER_ADDR_LEN);
-            mclagd_mac.vid = iccpd_mac->vid;
-            memcpy(mclagd_mac.ifname, iccpd_mac->ifname, strlen(iccpd_mac->ifname));
-            memcpy(mclagd_mac.origin_ifname, iccpd_mac->origin_ifname, strlen(iccpd_mac->origin_ifname));
-            mclagd_mac.age_flag = iccpd_mac->age_flag;
-
-            memcpy(mac_buf + MCLAGD_REPLY_INFO_HDR + mac_num * sizeof(struct mclagd_mac_msg),
-                   &mclagd_mac, sizeof(struct mclagd_mac_msg));
-
-            mac_num++;
+        memset(&mac_find, 0, sizeof(struct MACMsg));
+        mac_find.vid = cursor->vid;
+        memcpy(mac_find.mac_addr, cursor->mac_addr, ETHER_ADDR_LEN);
+        iccpd_mac = RB_NFIND(mac_rb_tree, &MLACP(csm).mac_rb, &mac_find);
+        if (iccpd_mac && iccpd_mac->vid == cursor->vid
+            && memcmp(iccpd_mac->mac_addr, cursor->mac_addr, ETHER_ADDR_LEN) == 0)
+            iccpd_mac = RB_NEXT(mac_rb_tree, iccpd_mac);
+    }
+    else
+    {
+        iccpd_mac = RB_MIN(mac_rb_tree, &MLACP(csm).mac_rb);
+    }
 
-            if ((mac_num + 1) * sizeof(struct mclagd_mac_msg) > (mac_buf_size - MCLAGD_REPLY_INFO_HDR))
-            {
-                mac_buf_size += MCLAGDCTL_CMD_SIZE;
-                mac_buf = (char*)realloc(mac_buf, mac_buf_size);
-                if (!mac_buf)
-                    return EXEC_TYPE_FAILED;
-            }
-        }
-        }
+    for (; iccpd_mac && mac_num < max_num && scan_num < ICCP_DUMP_SCAN_MAX && !iccp_dump_limit_reached(cursor);
+         iccpd_mac = RB_NEXT(mac_rb_tree, iccpd_mac), scan_num++)
+    {
+        cursor->vid = iccpd_mac->vid;
+        memcpy(cursor->mac_addr, iccpd_mac->mac_addr, ETHER_ADDR_LEN);
+        cursor->started = 1;
+
+        if (filter->vid > 0 && iccpd_mac->vid != filter->vid)
+            continue;
+        if (filter->ifname[0] && strcmp(iccpd_mac->ifname, filter->ifname) != 0
+            && strcmp(iccpd_mac->origin_ifname, filter->ifname) != 0)
+            continue;
+        if (!iccp_dump_match_mac(filter, iccpd_mac->mac_addr))
+            continue;
+
+        memset(&mclagd_mac, 0, sizeof(struct mclagd_mac_msg));
+        mclagd_mac.op_type = iccpd_mac->op_type;
+        mclagd_mac.fdb_type = iccpd_mac->fdb_type;
+        memcpy(mclagd_mac.mac_addr, iccpd_mac->mac_addr, ETHER_ADDR_LEN);
+        mclagd_mac.vid = iccpd_mac->vid;
+        memcpy(mclagd_mac.ifname, iccpd_mac->ifname, strlen(iccpd_mac->ifname));
+        memcpy(mclagd_mac.origin_ifname, iccpd_mac->origin_ifname, strlen(iccpd_mac->origin_ifname));
+        mclagd_mac.age_flag = iccpd_mac->age_flag;
+
+        memcpy(buf + mac_num * sizeof(struct mclagd_mac_msg), &mclagd_mac, sizeof(struct mclagd_mac_msg));
+        mac_num++;
+        cursor->count++;
+    }
 
-    *buf = mac_buf;
+    if (!iccpd_mac || iccp_dump_limit_reached(cursor))
+        cursor->done = 1;
     *num = mac_num;
 
-    if (mclag_id > 0 && !id_exist)
-        return EXEC_TYPE_NO_EXIST_MCLAGID;
-
     return EXEC_TYPE_SUCCESS;
 }
 
@@ -138,6 +138,7 @@ void iccp_csm_status_reset(struct CSM* csm, int all)
     }
 
     csm->sock_fd = -1;
+    csm->rx_len = 0;
     pthread_mutex_init(&csm->conn_mutex, NULL);
     csm->connTimePrev = 0;
     csm->heartbeat_send_time = 0;
@@ -803,6 +804,7 @@ int iccp_csm_init_msg(struct Msg** msg, char* data, int len)
 
     memcpy(iccp_msg->buf, data, len);
     iccp_msg->len = len;
+    iccp_msg->restored = 0;
     *msg = iccp_msg;
 
     return 0;
@@ -24,6 +24,7 @@
 #include <arpa/inet.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
 #include <linux/if.h>
 #include <linux/netlink.h>
 #include <linux/rtnetlink.h>
@@ -277,19 +278,17 @@ static void do_arp_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], int
     }
 
     /* update lif ARP*/
-    TAILQ_FOREACH(msg, &MLACP(csm).arp_list, tail)
+    msg = mlacp_find_arp(csm, arp_msg->ifname, arp_msg->ipv4_addr);
+    if (msg)
     {
+        msg->restored = 0;
         arp_info = (struct ARPMsg *)msg->buf;
-        if (arp_info->ipv4_addr != arp_msg->ipv4_addr)
-            continue;
 
         entry_exists = 1;
         if (msgtype == RTM_DELNEIGH)
         {
             /* delete ARP*/
-            TAILQ_REMOVE(&MLACP(csm).arp_list, msg, tail);
-            free(msg->buf);
-            free(msg);
+            mlacp_dequeue_arp(csm, msg);
             msg = NULL;
             ICCPD_LOG_DEBUG(__FUNCTION__, "Delete ARP %s", show_ip_str(arp_msg->ipv4_addr));
         }
@@ -307,7 +306,6 @@ static void do_arp_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], int
                 ICCPD_LOG_DEBUG(__FUNCTION__, "Update ARP for %s", show_ip_str(arp_msg->ipv4_addr));
             }
         }
-        break;
     }
 
     if (msg && !arp_update)
@@ -551,20 +549,17 @@ static void do_ndisc_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], i
     }
 
     /* update lif ND */
-    TAILQ_FOREACH(msg, &MLACP(csm).ndisc_list, tail)
+    msg = mlacp_find_ndisc(csm, ndisc_msg->ifname, ndisc_msg->ipv6_addr);
+    if (msg)
     {
+        msg->restored = 0;
         ndisc_info = (struct NDISCMsg *)msg->buf;
 
-        if (memcmp(&ndisc_info->ipv6_addr, &ndisc_msg->ipv6_addr, 16) != 0)
-            continue;
-
         entry_exists = 1;
         if (msgtype == RTM_DELNEIGH)
         {
             /* delete ND */
-            TAILQ_REMOVE(&MLACP(csm).ndisc_list, msg, tail);
-            free(msg->buf);
-            free(msg);
+            mlacp_dequeue_ndisc(csm, msg);
             msg = NULL;
             ICCPD_LOG_DEBUG(__FUNCTION__, "Delete neighbor %s", show_ipv6_str((char *)ndisc_msg->ipv6_addr));
         }
@@ -581,7 +576,6 @@ static void do_ndisc_learn_from_kernel(struct ndmsg *ndm, struct rtattr *tb[], i
                 ICCPD_LOG_DEBUG(__FUNCTION__, "Update neighbor for %s", show_ipv6_str((char *)ndisc_msg->ipv6_addr));
             }
         }
-        break;
     }
 
     if (msg && !neigh_update)
@@ -738,10 +732,14 @@ int do_one_neigh_request(struct nlmsghdr *n)
 }
 
 /*Handle arp received from kernel*/
+/* Count of neighbors in the dump, to report time to converge */
+static uint32_t neigh_dump_count = 0;
+
 static int iccp_neigh_valid_handler(struct nl_msg *msg, void *arg)
 {
     struct nlmsghdr *nlh = nlmsg_hdr(msg);
 
+    neigh_dump_count++;
     do_one_neigh_request(nlh);
 
     return 0;
@@ -757,13 +755,16 @@ int iccp_neigh_get_init()
     };
     int ret;
     int retry = 1;
+    struct timespec start, end;
 
     if (!(sys = system_get_instance()))
         return MCLAG_ERROR;
 
+    clock_gettime(CLOCK_MONOTONIC, &start);
     while (retry)
     {
         retry = 0;
+        neigh_dump_count = 0;
         ret = nl_send_simple(sys->route_sock, RTM_GETNEIGH, NLM_F_DUMP,
                              &rt_hdr, sizeof(rt_hdr));
         if (ret < 0)
@@ -794,6 +795,10 @@ int iccp_neigh_get_init()
             retry = 1;
         }
     }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    ICCPD_LOG_NOTICE(__FUNCTION__, "Neighbor dump of %u entries converged in %ld ms",
+                     neigh_dump_count, (long)((end.tv_sec - start.tv_sec) * 1000 + (end.tv_nsec - start.tv_nsec) / 1000000));
 
     return ret;
 }
@@ -960,11 +965,11 @@ void do_arp_update_from_reply_packet(unsigned int ifindex, unsigned int addr, ui
     }
 
     /* update lif ARP*/
-    TAILQ_FOREACH(msg, &MLACP(csm).arp_list, tail)
+    msg = mlacp_find_arp(csm, arp_msg->ifname, arp_msg->ipv4_addr);
+    if (msg)
     {
+        msg->restored = 0;
         arp_info = (struct ARPMsg*)msg->buf;
-        if (arp_info->ipv4_addr != arp_msg->ipv4_addr)
-            continue;
 
         /* update ARP*/
         if (arp_info->op_type != arp_msg->op_type
@@ -977,7 +982,6 @@ void do_arp_update_from_reply_packet(unsigned int ifindex, unsigned int addr, ui
             ICCPD_LOG_DEBUG(__FUNCTION__, "Update ARP for %s",
                             show_ip_str(arp_msg->ipv4_addr));
         }
-        break;
     }
 
     /* enquene lif_msg (add)*/
@@ -1182,13 +1186,12 @@ void do_ndisc_update_from_reply_packet(unsigned int ifindex, char *ipv6_addr, ui
     }
 
     /* update lif ND */
-    TAILQ_FOREACH(msg, &MLACP(csm).ndisc_list, tail)
+    msg = mlacp_find_ndisc(csm, ndisc_msg->ifname, ndisc_msg->ipv6_addr);
+    if (msg)
     {
+        msg->restored = 0;
         ndisc_info = (struct NDISCMsg *)msg->buf;
 
-        if (memcmp((char *)ndisc_info->ipv6_addr, (char *)ndisc_msg->ipv6_addr, 16) != 0)
-            continue;
-
         /* If MAC addr is NULL, use the old one */
         if (memcmp(mac_addr, null_mac, ETHER_ADDR_LEN) == 0)
         {
@@ -1206,7 +1209,6 @@ void do_ndisc_update_from_reply_packet(unsigned int ifindex, char *ipv6_addr, ui
             memcpy(ndisc_info->mac_addr, ndisc_msg->mac_addr, ETHER_ADDR_LEN);
              ICCPD_LOG_DEBUG(__FUNCTION__, "Update ND for %s", show_ipv6_str((char *)ndisc_msg->ipv6_addr));
         }
-        break;
     }
 
     /* enquene lif_msg (add) */
@@ -259,6 +259,7 @@ int main(int argc, char* argv[])
     sys->mclagdctl_file_path = strdup(parser.mclagdctl_file_path);
     sys->pid_file_fd = pid_file_fd;
     sys->telnet_port = parser.telnet_port;
+    sys->mac_sync_window = parser.mac_sync_window;
     parser.finalize(&parser);
     iccpd_signal_init(sys);
     ICCPD_LOG_INFO(__FUNCTION__, "Iccpd is started, process id = %d.  uid  %d ", getpid(), getuid());
@@ -502,16 +502,7 @@ void iccp_set_interface_ipadd_mac(struct LocalInterface *lif, char * mac_addr )
     /*send msg*/
     if (sys->sync_fd)
     {
-        if (write(sys->sync_fd,msg_buf, msg_hdr->len) == -1)
-        {
-            SYSTEM_SET_SYNCD_TX_DBG_COUNTER(
-                sys, msg_hdr->type, ICCP_DBG_CNTR_STS_ERR);
-        }
-        else
-        {
-            SYSTEM_SET_SYNCD_TX_DBG_COUNTER(
-                sys, msg_hdr->type, ICCP_DBG_CNTR_STS_OK);
-        }
+        iccp_send_to_mclagsyncd(msg_hdr->type, msg_buf, msg_hdr->len);
     }
     return;
 }
@@ -957,7 +948,7 @@ void iccp_event_handler_obj_input_newlink(struct nl_object *obj, void *arg)
 
     if (lif && (lif->ifindex == -1) && (lif->type == IF_T_VLAN))
     {
-        lif->ifindex = ifindex;
+        local_if_set_ifindex(lif, ifindex);
         lif->state = (op_state == IF_OPER_UP) ? PORT_STATE_UP : PORT_STATE_DOWN;
 
         if (addr_type == AF_LLC)
@@ -1226,8 +1217,8 @@ int iccp_del_self_ip_from_neigh_table (struct LocalInterface *lif, int addr_fami
     struct System *sys = NULL;
     struct CSM *csm = NULL;
     struct Msg *msg = NULL;
-    struct ARPMsg *arp_msg = NULL, *arp_info = NULL;
-    struct NDISCMsg *ndisc_msg = NULL, *ndisc_info = NULL;
+    struct ARPMsg *arp_msg = NULL;
+    struct NDISCMsg *ndisc_msg = NULL;
     int err = 0;
 
     if (!(sys = system_get_instance()))
@@ -1239,20 +1230,11 @@ int iccp_del_self_ip_from_neigh_table (struct LocalInterface *lif, int addr_fami
 
         LIST_FOREACH(csm, &(sys->csm_list), next)
         {
-            TAILQ_FOREACH(msg, &MLACP(csm).arp_list, tail)
-            {
-                arp_info = (struct ARPMsg *)msg->buf;
-                if (arp_info->ipv4_addr == lif->ipv4_addr) {
-                    ICCPD_LOG_NOTICE(__FUNCTION__, " Delete ARP %s", show_ip_str(lif->ipv4_addr));
-                    break;
-                }
-            }
-
+            msg = mlacp_find_arp(csm, NULL, lif->ipv4_addr);
             if (msg)
             {
-                TAILQ_REMOVE(&(MLACP(csm).arp_list), msg, tail);
-                free(msg->buf);
-                free(msg);
+                ICCPD_LOG_NOTICE(__FUNCTION__, " Delete ARP %s", show_ip_str(lif->ipv4_addr));
+                mlacp_dequeue_arp(csm, msg);
                 msg = NULL;
                 break;
             }
@@ -1261,21 +1243,11 @@ int iccp_del_self_ip_from_neigh_table (struct LocalInterface *lif, int addr_fami
 
         LIST_FOREACH(csm, &(sys->csm_list), next)
         {
-            TAILQ_FOREACH(msg, &MLACP(csm).ndisc_list, tail)
-            {
-                ndisc_info = (struct NDISCMsg *)msg->buf;
-
-                if (memcmp(&ndisc_info->ipv6_addr, &lif->ipv6_addr, 16) == 0) {
-                    ICCPD_LOG_DEBUG(__FUNCTION__, " Delete neighbor %s", show_ipv6_str((char *)lif->ipv6_addr));
-                    break;
-                }
-            }
-
+            msg = mlacp_find_ndisc(csm, NULL, lif->ipv6_addr);
             if (msg)
             {
-                TAILQ_REMOVE(&MLACP(csm).ndisc_list, msg, tail);
-                free(msg->buf);
-                free(msg);
+                ICCPD_LOG_DEBUG(__FUNCTION__, " Delete neighbor %s", show_ipv6_str((char *)lif->ipv6_addr));
+                mlacp_dequeue_ndisc(csm, msg);
                 msg = NULL;
                 break;
             }
@@ -2203,15 +2175,21 @@ int iccp_handle_events(struct System * sys)
             int client_fd = mclagd_ctl_sock_accept(sys->sync_ctrl_fd);
             if (client_fd > 0)
             {
-                mclagd_ctl_interactive_process(client_fd);
-                close(client_fd);
+                if (mclagd_ctl_interactive_process(client_fd) != 1)
+                    close(client_fd);
             }
             continue;
         }
 
+        if (mclagd_ctl_dump_handler(sys, events[i].data.fd, events[i].events) == 0)
+            continue;
+
         if (events[i].data.fd == sys->sync_fd)
         {
-            iccp_mclagsyncd_msg_handler(sys);
+            if (events[i].events & EPOLLOUT)
+                iccp_mclagsyncd_tx_flush(sys);
+            if (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP))
+                iccp_mclagsyncd_msg_handler(sys);
             continue;
         }
 
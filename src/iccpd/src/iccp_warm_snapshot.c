@@ -0,0 +1,629 @@
+/*
+ * iccp_warm_snapshot.c
+ *
+ * Copyright(c) 2016-2019 Nephos/Estinet.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../include/iccp_warm_snapshot.h"
+#include "../include/system.h"
+#include "../include/logger.h"
+#include "../include/port.h"
+#include "../include/iccp_csm.h"
+#include "../include/iccp_ifm.h"
+#include "../include/mlacp_tlv.h"
+#include "../include/mlacp_fsm.h"
+#include "../include/mlacp_link_handler.h"
+#include "../include/mlacp_sync_update.h"
+
+#define ICCPD_WARM_SNAPSHOT_TMP_FILE ICCPD_WARM_SNAPSHOT_FILE ".tmp"
+
+/* Record payloads */
+struct warm_rec_lif
+{
+    char name[MAX_L_PORT_NAME];
+    uint8_t mac_addr[ETHER_ADDR_LEN];
+    uint8_t mac_addr_ori[ETHER_ADDR_LEN];
+    uint8_t is_traffic_disable;
+    uint8_t isolate_to_peer_link;
+} __attribute__ ((packed));
+
+struct warm_rec_csm
+{
+    int32_t mlag_id;
+} __attribute__ ((packed));
+
+struct warm_rec_pif
+{
+    char name[MAX_L_PORT_NAME];
+    int32_t ifindex;
+    int32_t type;
+    int32_t po_id;
+    uint32_t ipv4_addr;
+    uint8_t mac_addr[ETHER_ADDR_LEN];
+    uint8_t state;
+    uint8_t l3_mode;
+    uint8_t is_peer_link;
+    uint8_t po_active;
+} __attribute__ ((packed));
+
+struct warm_rec_mac
+{
+    uint16_t vid;
+    uint8_t mac_addr[ETHER_ADDR_LEN];
+    uint8_t fdb_type;
+    uint8_t age_flag;
+    uint8_t pending_local_del;
+    uint8_t add_to_syncd;
+    char ifname[MAX_L_PORT_NAME];
+    char origin_ifname[MAX_L_PORT_NAME];
+} __attribute__ ((packed));
+
+/* Snapshot being written */
+struct warm_writer
+{
+    FILE* fp;
+    uint32_t checksum;
+    uint32_t data_len;
+    uint32_t num_records;
+};
+
+/* Snapshot mapped upon warm start */
+static char* warm_map = NULL;
+static size_t warm_map_len = 0;
+static time_t warm_map_time = 0;
+
+#define FNV1A_INIT  0x811c9dc5
+#define FNV1A_PRIME 0x01000193
+
+static uint32_t warm_checksum(uint32_t hash, const void* data, size_t len)
+{
+    const uint8_t* p = (const uint8_t*)data;
+
+    while (len--)
+    {
+        hash ^= *p++;
+        hash *= FNV1A_PRIME;
+    }
+    return hash;
+}
+
+static int warm_write_rec(struct warm_writer* w, uint16_t type, const void* payload, uint16_t len)
+{
+    struct iccp_warm_snapshot_rec rec;
+
+    rec.type = type;
+    rec.len = len;
+    if (fwrite(&rec, sizeof(rec), 1, w->fp) != 1 || fwrite(payload, len, 1, w->fp) != 1)
+        return MCLAG_ERROR;
+
+    w->checksum = warm_checksum(w->checksum, &rec, sizeof(rec));
+    w->checksum = warm_checksum(w->checksum, payload, len);
+    w->data_len += sizeof(rec) + len;
+    w->num_records++;
+    return 0;
+}
+
+static int warm_write_csm(struct warm_writer* w, struct CSM* csm)
+{
+    struct warm_rec_csm csm_rec;
+    struct warm_rec_pif pif_rec;
+    struct warm_rec_mac mac_rec;
+    struct PeerInterface* pif = NULL;
+    struct MACMsg* mac_msg = NULL;
+    struct Msg* msg = NULL;
+    int ret = 0;
+
+    memset(&csm_rec, 0, sizeof(csm_rec));
+    csm_rec.mlag_id = csm->mlag_id;
+    ret |= warm_write_rec(w, ICCP_WARM_REC_CSM, &csm_rec, sizeof(csm_rec));
+
+    LIST_FOREACH(pif, &(MLACP(csm).pif_list), mlacp_next)
+    {
+        memset(&pif_rec, 0, sizeof(pif_rec));
+        memcpy(pif_rec.name, pif->name, MAX_L_PORT_NAME);
+        pif_rec.ifindex = pif->ifindex;
+        pif_rec.type = pif->type;
+        pif_rec.po_id = pif->po_id;
+        pif_rec.ipv4_addr = pif->ipv4_addr;
+        memcpy(pif_rec.mac_addr, pif->mac_addr, ETHER_ADDR_LEN);
+        pif_rec.state = pif->state;
+        pif_rec.l3_mode = pif->l3_mode;
+        pif_rec.is_peer_link = pif->is_peer_link;
+        pif_rec.po_active = pif->po_active;
+        ret |= warm_write_rec(w, ICCP_WARM_REC_PIF, &pif_rec, sizeof(pif_rec));
+    }
+
+    RB_FOREACH (mac_msg, mac_rb_tree, &MLACP(csm).mac_rb)
+    {
+        memset(&mac_rec, 0, sizeof(mac_rec));
+        mac_rec.vid = mac_msg->vid;
+        memcpy(mac_rec.mac_addr, mac_msg->mac_addr, ETHER_ADDR_LEN);
+        mac_rec.fdb_type = mac_msg->fdb_type;
+        mac_rec.age_flag = mac_msg->age_flag;
+        mac_rec.pending_local_del = mac_msg->pending_local_del;
+        mac_rec.add_to_syncd = mac_msg->add_to_syncd;
+        memcpy(mac_rec.ifname, mac_msg->ifname, MAX_L_PORT_NAME);
+        memcpy(mac_rec.origin_ifname, mac_msg->origin_ifname, MAX_L_PORT_NAME);
+        ret |= warm_write_rec(w, ICCP_WARM_REC_MAC, &mac_rec, sizeof(mac_rec));
+    }
+
+    TAILQ_FOREACH(msg, &(MLACP(csm).arp_list), tail)
+    {
+        ret |= warm_write_rec(w, ICCP_WARM_REC_ARP, msg->buf, sizeof(struct ARPMsg));
+    }
+
+    TAILQ_FOREACH(msg, &(MLACP(csm).ndisc_list), tail)
+    {
+        ret |= warm_write_rec(w, ICCP_WARM_REC_NDISC, msg->buf, sizeof(struct NDISCMsg));
+    }
+
+    return ret;
+}
+
+/* Save snapshot upon warm reboot exit. Written to a temp file & renamed,
+ * so that a partial snapshot is never found upon start.
+ */
+int iccp_warm_snapshot_save(struct System* sys)
+{
+    struct warm_writer w;
+    struct iccp_warm_snapshot_hdr hdr;
+    struct warm_rec_lif lif_rec;
+    struct LocalInterface* lif = NULL;
+    struct CSM* csm = NULL;
+    struct timespec start, end;
+    int ret = 0;
+
+    if (!sys)
+        return MCLAG_ERROR;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (mkdir(ICCPD_WARM_SNAPSHOT_DIR, 0755) && errno != EEXIST)
+    {
+        ICCPD_LOG_ERR(__FUNCTION__, "Failed to create directory \"%s\", errno %d",
+                      ICCPD_WARM_SNAPSHOT_DIR, errno);
+        return MCLAG_ERROR;
+    }
+
+    memset(&w, 0, sizeof(w));
+    w.checksum = FNV1A_INIT;
+    w.fp = fopen(ICCPD_WARM_SNAPSHOT_TMP_FILE, "w");
+    if (!w.fp)
+    {
+        ICCPD_LOG_ERR(__FUNCTION__, "Failed to open %s, errno %d", ICCPD_WARM_SNAPSHOT_TMP_FILE, errno);
+        return MCLAG_ERROR;
+    }
+
+    /* Header is rewritten once records are done */
+    memset(&hdr, 0, sizeof(hdr));
+    if (fwrite(&hdr, sizeof(hdr), 1, w.fp) != 1)
+        ret = MCLAG_ERROR;
+
+    LIST_FOREACH(lif, &(sys->lif_list), system_next)
+    {
+        if (lif->type != IF_T_PORT_CHANNEL)
+            continue;
+
+        memset(&lif_rec, 0, sizeof(lif_rec));
+        memcpy(lif_rec.name, lif->name, MAX_L_PORT_NAME);
+        memcpy(lif_rec.mac_addr, lif->mac_addr, ETHER_ADDR_LEN);
+        memcpy(lif_rec.mac_addr_ori, lif->mac_addr_ori, ETHER_ADDR_LEN);
+        lif_rec.is_traffic_disable = lif->is_traffic_disable;
+        lif_rec.isolate_to_peer_link = lif->isolate_to_peer_link;
+        ret |= warm_write_rec(&w, ICCP_WARM_REC_LIF, &lif_rec, sizeof(lif_rec));
+    }
+
+    LIST_FOREACH(csm, &(sys->csm_list), next)
+    {
+        ret |= warm_write_csm(&w, csm);
+    }
+
+    hdr.magic = ICCP_WARM_SNAPSHOT_MAGIC;
+    hdr.version = ICCP_WARM_SNAPSHOT_VERSION;
+    hdr.hdr_len = sizeof(hdr);
+    hdr.data_len = w.data_len;
+    hdr.checksum = w.checksum;
+    hdr.num_records = w.num_records;
+    hdr.created = time(NULL);
+    if (ret == 0)
+    {
+        if (fseek(w.fp, 0, SEEK_SET) != 0 || fwrite(&hdr, sizeof(hdr), 1, w.fp) != 1
+            || fflush(w.fp) != 0 || fsync(fileno(w.fp)) != 0)
+            ret = MCLAG_ERROR;
+    }
+    fclose(w.fp);
+
+    if (ret == 0 && rename(ICCPD_WARM_SNAPSHOT_TMP_FILE, ICCPD_WARM_SNAPSHOT_FILE) != 0)
+        ret = MCLAG_ERROR;
+
+    if (ret != 0)
+    {
+        ICCPD_LOG_ERR(__FUNCTION__, "Failed to write warm reboot snapshot, errno %d", errno);
+        unlink(ICCPD_WARM_SNAPSHOT_TMP_FILE);
+        return MCLAG_ERROR;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    ICCPD_LOG_NOTICE(__FUNCTION__, "Warm reboot snapshot of %u records, %u bytes saved in %ld ms",
+                     hdr.num_records, hdr.data_len,
+                     (long)((end.tv_sec - start.tv_sec) * 1000 + (end.tv_nsec - start.tv_nsec) / 1000000));
+    return 0;
+}
+
+static void warm_restore_lif(struct warm_rec_lif* rec)
+{
+    struct LocalInterface* lif = NULL;
+
+    rec->name[MAX_L_PORT_NAME - 1] = '\0';
+    if (!(lif = local_if_find_by_name(rec->name)))
+        return;
+
+    /* MAC set by iccpd is still on the interface, keep original to recover */
+    if (memcmp(lif->mac_addr, rec->mac_addr, ETHER_ADDR_LEN) == 0)
+        memcpy(lif->mac_addr_ori, rec->mac_addr_ori, ETHER_ADDR_LEN);
+
+    lif->is_traffic_disable = rec->is_traffic_disable;
+    lif->isolate_to_peer_link = rec->isolate_to_peer_link;
+    return;
+}
+
+/* Iterate records of mapped snapshot. Payload is copied out by caller,
+ * as records are not aligned.
+ */
+#define WARM_FOREACH_REC(rec, payload, pos) \
+    for ((pos) = sizeof(struct iccp_warm_snapshot_hdr); \
+         (pos) + sizeof(struct iccp_warm_snapshot_rec) <= warm_map_len \
+         && ((rec) = (struct iccp_warm_snapshot_rec*)(warm_map + (pos)), \
+             (payload) = warm_map + (pos) + sizeof(struct iccp_warm_snapshot_rec), 1) \
+         && (pos) + sizeof(struct iccp_warm_snapshot_rec) + (rec)->len <= warm_map_len; \
+         (pos) += sizeof(struct iccp_warm_snapshot_rec) + (rec)->len)
+
+/* Map snapshot upon warm start; local interfaces are restored right away,
+ * MC-LAG domains as they are configured.
+ */
+int iccp_warm_snapshot_load(struct System* sys)
+{
+    struct iccp_warm_snapshot_hdr hdr;
+    struct iccp_warm_snapshot_rec* rec = NULL;
+    struct warm_rec_lif lif_rec;
+    struct stat st;
+    char* payload = NULL;
+    void* base = NULL;
+    size_t pos = 0;
+    int fd;
+
+    if (!sys)
+        return MCLAG_ERROR;
+
+    fd = open(ICCPD_WARM_SNAPSHOT_FILE, O_RDONLY);
+    if (fd < 0)
+    {
+        ICCPD_LOG_NOTICE(__FUNCTION__, "No warm reboot snapshot, errno %d", errno);
+        return MCLAG_ERROR;
+    }
+
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(hdr))
+    {
+        ICCPD_LOG_WARN(__FUNCTION__, "Warm reboot snapshot is truncated");
+        close(fd);
+        goto out;
+    }
+
+    base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+    {
+        ICCPD_LOG_WARN(__FUNCTION__, "Failed to map warm reboot snapshot, errno %d", errno);
+        goto out;
+    }
+
+    memcpy(&hdr, base, sizeof(hdr));
+    if (hdr.magic != ICCP_WARM_SNAPSHOT_MAGIC || hdr.version != ICCP_WARM_SNAPSHOT_VERSION
+        || hdr.hdr_len != sizeof(hdr) || sizeof(hdr) + hdr.data_len != (size_t)st.st_size
+        || warm_checksum(FNV1A_INIT, (char*)base + sizeof(hdr), hdr.data_len) != hdr.checksum)
+    {
+        ICCPD_LOG_WARN(__FUNCTION__, "Ignore warm reboot snapshot, version %u, %u bytes",
+                       hdr.version, hdr.data_len);
+        munmap(base, st.st_size);
+        goto out;
+    }
+
+    warm_map = (char*)base;
+    warm_map_len = st.st_size;
+    time(&warm_map_time);
+
+    WARM_FOREACH_REC(rec, payload, pos)
+    {
+        if (rec->type == ICCP_WARM_REC_CSM)
+            break;
+        if (rec->type != ICCP_WARM_REC_LIF || rec->len < sizeof(lif_rec))
+            continue;
+
+        memcpy(&lif_rec, payload, sizeof(lif_rec));
+        warm_restore_lif(&lif_rec);
+    }
+
+    ICCPD_LOG_NOTICE(__FUNCTION__, "Warm reboot snapshot of %u records loaded, saved %ld secs ago",
+                     hdr.num_records, (long)(warm_map_time - hdr.created));
+
+ out:
+    /* Snapshot is good for this start only */
+    unlink(ICCPD_WARM_SNAPSHOT_FILE);
+    return warm_map ? 0 : MCLAG_ERROR;
+}
+
+static int warm_restore_pif(struct CSM* csm, struct warm_rec_pif* rec)
+{
+    struct PeerInterface* pif = NULL;
+
+    rec->name[MAX_L_PORT_NAME - 1] = '\0';
+    if (peer_if_find_by_name(csm, rec->name))
+        return 0;
+
+    if (!(pif = peer_if_create(csm, rec->ifindex, rec->type)))
+        return 0;
+
+    peer_if_set_name(pif, rec->name, strlen(rec->name));
+    pif->po_id = rec->po_id;
+    pif->ipv4_addr = rec->ipv4_addr;
+    memcpy(pif->mac_addr, rec->mac_addr, ETHER_ADDR_LEN);
+    pif->state = rec->state;
+    pif->l3_mode = rec->l3_mode;
+    pif->is_peer_link = rec->is_peer_link;
+    pif->po_active = rec->po_active;
+    return 1;
+}
+
+static int warm_restore_mac(struct CSM* csm, struct warm_rec_mac* rec)
+{
+    struct MACMsg mac_data;
+    struct MACMsg* mac_msg = NULL;
+
+    memset(&mac_data, 0, sizeof(mac_data));
+    mac_data.vid = rec->vid;
+    memcpy(mac_data.mac_addr, rec->mac_addr, ETHER_ADDR_LEN);
+    if (RB_FIND(mac_rb_tree, &MLACP(csm).mac_rb, &mac_data))
+        return 0;
+
+    mac_data.op_type = MAC_SYNC_ADD;
+    mac_data.fdb_type = rec->fdb_type;
+    mac_data.age_flag = rec->age_flag;
+    mac_data.pending_local_del = rec->pending_local_del;
+    mac_data.add_to_syncd = rec->add_to_syncd;
+    memcpy(mac_data.ifname, rec->ifname, MAX_L_PORT_NAME);
+    memcpy(mac_data.origin_ifname, rec->origin_ifname, MAX_L_PORT_NAME);
+    mac_data.ifname[MAX_L_PORT_NAME - 1] = '\0';
+    mac_data.origin_ifname[MAX_L_PORT_NAME - 1] = '\0';
+    mac_data.restored = 1;
+
+    /* Chip keeps FDB over warm reboot, no update to mclagsyncd */
+    if (iccp_csm_init_mac_msg(&mac_msg, (char*)&mac_data, sizeof(struct MACMsg)) != 0)
+        return 0;
+
+    RB_INSERT(mac_rb_tree, &MLACP(csm).mac_rb, mac_msg);
+    return 1;
+}
+
+static int warm_restore_neigh(struct CSM* csm, uint16_t type, char* payload)
+{
+    struct Msg* msg = NULL;
+    struct ARPMsg arp_msg;
+    struct NDISCMsg ndisc_msg;
+
+    if (type == ICCP_WARM_REC_ARP)
+    {
+        memcpy(&arp_msg, payload, sizeof(arp_msg));
+        arp_msg.ifname[MAX_L_PORT_NAME - 1] = '\0';
+        if (mlacp_find_arp(csm, arp_msg.ifname, arp_msg.ipv4_addr))
+            return 0;
+
+        if (iccp_csm_init_msg(&msg, (char*)&arp_msg, sizeof(arp_msg)) != 0)
+            return 0;
+        msg->restored = 1;
+        mlacp_enqueue_arp(csm, msg);
+    }
+    else
+    {
+        memcpy(&ndisc_msg, payload, sizeof(ndisc_msg));
+        ndisc_msg.ifname[MAX_L_PORT_NAME - 1] = '\0';
+        if (mlacp_find_ndisc(csm, ndisc_msg.ifname, ndisc_msg.ipv6_addr))
+            return 0;
+
+        if (iccp_csm_init_msg(&msg, (char*)&ndisc_msg, sizeof(ndisc_msg)) != 0)
+            return 0;
+        msg->restored = 1;
+        mlacp_enqueue_ndisc(csm, msg);
+    }
+    return 1;
+}
+
+/* Restore MC-LAG domain upon its config, before session comes up */
+void iccp_warm_snapshot_restore(struct CSM* csm)
+{
+    struct iccp_warm_snapshot_rec* rec = NULL;
+    struct warm_rec_csm csm_rec;
+    struct warm_rec_pif pif_rec;
+    struct warm_rec_mac mac_rec;
+    char* payload = NULL;
+    size_t pos = 0;
+    int in_csm = 0;
+    int num_pif = 0, num_mac = 0, num_neigh = 0;
+
+    if (!csm || !warm_map)
+        return;
+
+    WARM_FOREACH_REC(rec, payload, pos)
+    {
+        if (rec->type == ICCP_WARM_REC_CSM)
+        {
+            if (in_csm)
+                break;
+            if (rec->len >= sizeof(csm_rec))
+            {
+                memcpy(&csm_rec, payload, sizeof(csm_rec));
+                in_csm = (csm_rec.mlag_id == csm->mlag_id);
+            }
+            continue;
+        }
+        if (!in_csm)
+            continue;
+
+        switch (rec->type)
+        {
+            case ICCP_WARM_REC_PIF:
+                if (rec->len < sizeof(pif_rec))
+                    break;
+                memcpy(&pif_rec, payload, sizeof(pif_rec));
+                num_pif += warm_restore_pif(csm, &pif_rec);
+                break;
+
+            case ICCP_WARM_REC_MAC:
+                if (rec->len < sizeof(mac_rec))
+                    break;
+                memcpy(&mac_rec, payload, sizeof(mac_rec));
+                num_mac += warm_restore_mac(csm, &mac_rec);
+                break;
+
+            case ICCP_WARM_REC_ARP:
+                if (rec->len < sizeof(struct ARPMsg))
+                    break;
+                num_neigh += warm_restore_neigh(csm, rec->type, payload);
+                break;
+
+            case ICCP_WARM_REC_NDISC:
+                if (rec->len < sizeof(struct NDISCMsg))
+                    break;
+                num_neigh += warm_restore_neigh(csm, rec->type, payload);
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    if (!in_csm)
+        return;
+
+    time(&csm->warm_restore_time);
+    csm->warm_restore_sync_time = 0;
+    ICCPD_LOG_NOTICE(__FUNCTION__, "mlag-id %d restored from warm reboot snapshot: "
+                     "%d peer interfaces, %d MACs, %d neighbors",
+                     csm->mlag_id, num_pif, num_mac, num_neigh);
+    return;
+}
+
+/* Remove restored entries not reported again since restore. Only peer
+ * MACs are removed, local MACs are aged by chip as usual.
+ */
+static void warm_snapshot_sweep(struct CSM* csm)
+{
+    struct MACMsg* mac_msg = NULL, *mac_temp = NULL;
+    struct Msg* msg = NULL, *msg_temp = NULL;
+    int num_mac = 0, num_arp = 0, num_ndisc = 0;
+
+    /* Confirm neighbors in kernel, as their events may precede config */
+    iccp_neigh_get_init();
+
+    RB_FOREACH_SAFE (mac_msg, mac_rb_tree, &MLACP(csm).mac_rb, mac_temp)
+    {
+        if (!mac_msg->restored)
+            continue;
+
+        mac_msg->restored = 0;
+        if (!(mac_msg->age_flag & MAC_AGE_LOCAL))
+            continue;
+
+        ICCPD_LOG_DEBUG("ICCP_FDB", "Warm restore: del stale MAC %s vlan %d interface %s",
+                        mac_addr_to_str(mac_msg->mac_addr), mac_msg->vid, mac_msg->ifname);
+        del_mac_from_chip(mac_msg);
+        MAC_RB_REMOVE(mac_rb_tree, &MLACP(csm).mac_rb, mac_msg);
+        if (!MAC_IN_MSG_LIST(&(MLACP(csm).mac_msg_list), mac_msg, tail))
+            mlacp_mac_sync_release(csm, mac_msg);
+        num_mac++;
+    }
+
+    for (msg = TAILQ_FIRST(&(MLACP(csm).arp_list)); msg != NULL; msg = msg_temp)
+    {
+        msg_temp = TAILQ_NEXT(msg, tail);
+        if (!msg->restored)
+            continue;
+        mlacp_dequeue_arp(csm, msg);
+        num_arp++;
+    }
+
+    for (msg = TAILQ_FIRST(&(MLACP(csm).ndisc_list)); msg != NULL; msg = msg_temp)
+    {
+        msg_temp = TAILQ_NEXT(msg, tail);
+        if (!msg->restored)
+            continue;
+        mlacp_dequeue_ndisc(csm, msg);
+        num_ndisc++;
+    }
+
+    ICCPD_LOG_NOTICE(__FUNCTION__, "mlag-id %d warm restore reconciled in %ld secs, "
+                     "stale %d MACs, %d ARP, %d ND", csm->mlag_id,
+                     (long)(time(NULL) - csm->warm_restore_time), num_mac, num_arp, num_ndisc);
+    return;
+}
+
+/* Reconcile restored state, once peer has resynced or did not come up */
+void iccp_warm_snapshot_reconcile(struct CSM* csm)
+{
+    time_t now;
+
+    if (!csm)
+        return;
+
+    now = time(NULL);
+    if (warm_map && (now - warm_map_time) >= ICCP_WARM_RESTORE_TIMEOUT)
+    {
+        munmap(warm_map, warm_map_len);
+        warm_map = NULL;
+        warm_map_len = 0;
+    }
+
+    if (csm->warm_restore_time == 0)
+        return;
+
+    if (MLACP(csm).current_state == MLACP_STATE_EXCHANGE)
+    {
+        if (csm->warm_restore_sync_time == 0)
+            csm->warm_restore_sync_time = now;
+        if ((now - csm->warm_restore_sync_time) < ICCP_WARM_RECONCILE_TIME)
+            return;
+    }
+    else if ((now - csm->warm_restore_time) < ICCP_WARM_RESTORE_TIMEOUT)
+    {
+        return;
+    }
+
+    warm_snapshot_sweep(csm);
+    csm->warm_restore_time = 0;
+    csm->warm_restore_sync_time = 0;
+    return;
+}
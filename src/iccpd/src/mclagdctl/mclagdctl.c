@@ -38,6 +38,12 @@
 static int mclagdctl_sock_fd = -1;
 char *mclagdctl_sock_path = "/var/run/iccpd/mclagdctl.sock";
 
+/*MAC/ARP/ND dump filter from command line options*/
+static struct mclagdctl_dump_filter mclagdctl_filter;
+/*Dump is received in chunks, header is printed with first*/
+static int mclagdctl_dump_chunk = 0;
+static int mclagdctl_dump_count = 0;
+
 /*
    Already implemented command:
    mclagdctl -i dump state
@@ -47,6 +53,8 @@ char *mclagdctl_sock_path = "/var/run/iccpd/mclagdctl.sock";
    mclagdctl -i dump unique_ip
    mclagdctl -i dump portlist local
    mclagdctl -i dump portlist peer
+   MAC/ARP/ND dumps can be filtered with --vlan, --interface, --mac
+   and limited with --count
  */
 
 #define ETHER_ADDR_LEN 6
@@ -346,6 +354,7 @@ int mclagdctl_enca_dump_arp(char *msg, int mclag_id, int argc, char **argv)
     memset(&req, 0, sizeof(struct mclagdctl_req_hdr));
     req.info_type = INFO_TYPE_DUMP_ARP;
     req.mclag_id = mclag_id;
+    memcpy(&req.filter, &mclagdctl_filter, sizeof(struct mclagdctl_dump_filter));
     memcpy((struct mclagdctl_req_hdr *)msg, &req, sizeof(struct mclagdctl_req_hdr));
 
     return 1;
@@ -364,6 +373,7 @@ int mclagdctl_enca_dump_ndisc(char *msg, int mclag_id, int argc, char **argv)
     memset(&req, 0, sizeof(struct mclagdctl_req_hdr));
     req.info_type = INFO_TYPE_DUMP_NDISC;
     req.mclag_id = mclag_id;
+    memcpy(&req.filter, &mclagdctl_filter, sizeof(struct mclagdctl_dump_filter));
     memcpy((struct mclagdctl_req_hdr *)msg, &req, sizeof(struct mclagdctl_req_hdr));
 
     return 1;
@@ -375,12 +385,15 @@ int mclagdctl_parse_dump_arp(char *msg, int data_len)
     int len = 0;
     int count = 0;
 
-    fprintf(stdout, "%-6s", "No.");
-    fprintf(stdout, "%-20s", "IP");
-    fprintf(stdout, "%-20s", "MAC");
-    fprintf(stdout, "%-20s", "DEV");
-    fprintf(stdout, "%s", "Flag");
-    fprintf(stdout, "\n");
+    if (mclagdctl_dump_chunk == 0)
+    {
+        fprintf(stdout, "%-6s", "No.");
+        fprintf(stdout, "%-20s", "IP");
+        fprintf(stdout, "%-20s", "MAC");
+        fprintf(stdout, "%-20s", "DEV");
+        fprintf(stdout, "%s", "Flag");
+        fprintf(stdout, "\n");
+    }
 
     len = sizeof(struct mclagd_arp_msg);
 
@@ -388,7 +401,7 @@ int mclagdctl_parse_dump_arp(char *msg, int data_len)
     {
         arp_info = (struct mclagd_arp_msg*)(msg + len * count);
 
-        fprintf(stdout, "%-6d", count + 1);
+        fprintf(stdout, "%-6d", mclagdctl_dump_count + count + 1);
         fprintf(stdout, "%-20s", arp_info->ipv4_addr);
         fprintf(stdout, "%02x:%02x:%02x:%02x:%02x:%02x",
                 arp_info->mac_addr[0], arp_info->mac_addr[1],
@@ -406,6 +419,8 @@ int mclagdctl_parse_dump_arp(char *msg, int data_len)
         fprintf(stdout, "\n");
     }
 
+    mclagdctl_dump_count += count;
+
     return 0;
 }
 
@@ -415,12 +430,15 @@ int mclagdctl_parse_dump_ndisc(char *msg, int data_len)
     int len = 0;
     int count = 0;
 
-    fprintf(stdout, "%-6s", "No.");
-    fprintf(stdout, "%-52s", "IPv6");
-    fprintf(stdout, "%-20s", "MAC");
-    fprintf(stdout, "%-20s", "DEV");
-    fprintf(stdout, "%s", "Flag");
-    fprintf(stdout, "\n");
+    if (mclagdctl_dump_chunk == 0)
+    {
+        fprintf(stdout, "%-6s", "No.");
+        fprintf(stdout, "%-52s", "IPv6");
+        fprintf(stdout, "%-20s", "MAC");
+        fprintf(stdout, "%-20s", "DEV");
+        fprintf(stdout, "%s", "Flag");
+        fprintf(stdout, "\n");
+    }
 
     len = sizeof(struct mclagd_ndisc_msg);
 
@@ -428,7 +446,7 @@ int mclagdctl_parse_dump_ndisc(char *msg, int data_len)
     {
         ndisc_info = (struct mclagd_ndisc_msg *)(msg + len * count);
 
-        fprintf(stdout, "%-6d", count + 1);
+        fprintf(stdout, "%-6d", mclagdctl_dump_count + count + 1);
         fprintf(stdout, "%-52s", ndisc_info->ipv6_addr);
         fprintf(stdout, "%02x:%02x:%02x:%02x:%02x:%02x",
                 ndisc_info->mac_addr[0], ndisc_info->mac_addr[1],
@@ -445,6 +463,8 @@ int mclagdctl_parse_dump_ndisc(char *msg, int data_len)
         fprintf(stdout, "\n");
     }
 
+    mclagdctl_dump_count += count;
+
     return 0;
 }
 
@@ -461,6 +481,7 @@ int mclagdctl_enca_dump_mac(char *msg, int mclag_id, int argc, char **argv)
     memset(&req, 0, sizeof(struct mclagdctl_req_hdr));
     req.info_type = INFO_TYPE_DUMP_MAC;
     req.mclag_id = mclag_id;
+    memcpy(&req.filter, &mclagdctl_filter, sizeof(struct mclagdctl_dump_filter));
     memcpy((struct mclagdctl_req_hdr *)msg, &req, sizeof(struct mclagdctl_req_hdr));
 
     return 1;
@@ -472,16 +493,19 @@ int mclagdctl_parse_dump_mac(char *msg, int data_len)
     int len = 0;
     int count = 0;
 
-    fprintf(stdout, "%-60s\n", "TYPE: S-STATIC, D-DYNAMIC; AGE: L-Local age, P-Peer age");
-
-    fprintf(stdout, "%-6s", "No.");
-    fprintf(stdout, "%-5s", "TYPE");
-    fprintf(stdout, "%-20s", "MAC");
-    fprintf(stdout, "%-5s", "VID");
-    fprintf(stdout, "%-20s", "DEV");
-    fprintf(stdout, "%-20s", "ORIGIN-DEV");
-    fprintf(stdout, "%-5s", "AGE");
-    fprintf(stdout, "\n");
+    if (mclagdctl_dump_chunk == 0)
+    {
+        fprintf(stdout, "%-60s\n", "TYPE: S-STATIC, D-DYNAMIC; AGE: L-Local age, P-Peer age");
+
+        fprintf(stdout, "%-6s", "No.");
+        fprintf(stdout, "%-5s", "TYPE");
+        fprintf(stdout, "%-20s", "MAC");
+        fprintf(stdout, "%-5s", "VID");
+        fprintf(stdout, "%-20s", "DEV");
+        fprintf(stdout, "%-20s", "ORIGIN-DEV");
+        fprintf(stdout, "%-5s", "AGE");
+        fprintf(stdout, "\n");
+    }
 
     len = sizeof(struct mclagd_mac_msg);
 
@@ -489,7 +513,7 @@ int mclagdctl_parse_dump_mac(char *msg, int data_len)
     {
         mac_info = (struct mclagd_mac_msg*)(msg + len * count);
 
-        fprintf(stdout, "%-6d", count + 1);
+        fprintf(stdout, "%-6d", mclagdctl_dump_count + count + 1);
 
         if (mac_info->fdb_type == MAC_TYPE_STATIC_CTL)
             fprintf(stdout, "%-5s", "S");
@@ -513,6 +537,8 @@ int mclagdctl_parse_dump_mac(char *msg, int data_len)
         fprintf(stdout, "\n");
     }
 
+    mclagdctl_dump_count += count;
+
     return 0;
 }
 
@@ -756,6 +782,10 @@ static char *mclagdctl_dbg_counter_iccpid2str(ICCP_DBG_CNTR_MSG_e iccp_cntr_id)
             return "Warmboot";
         case ICCP_DBG_CNTR_MSG_IF_UP_ACK:
             return "IfUpAck";
+        case ICCP_DBG_CNTR_MSG_MAC_SYNC_MARK:
+            return "MacSyncMark";
+        case ICCP_DBG_CNTR_MSG_MAC_SYNC_ACK:
+            return "MacSyncAck";
         default:
             return "Unknown";
     }
@@ -905,6 +935,21 @@ int mclagdctl_parse_dump_dbg_counters(char *msg, int data_len)
                 iccp_counter_p->iccp_counters[j][0][1],
                 iccp_counter_p->iccp_counters[j][1][1]);
         }
+
+        /* MAC resync progress */
+        fprintf(stdout, "\nMAC Sync\n");
+        fprintf(stdout, "--------\n");
+        fprintf(stdout, "Generation sent/acked: %lu/%lu\n",
+            iccp_counter_p->mac_sync.gen, iccp_counter_p->mac_sync.acked_gen);
+        fprintf(stdout, "Peer generation held: %lu\n", iccp_counter_p->mac_sync.peer_gen);
+        fprintf(stdout, "Resync full/delta: %u/%u\n",
+            iccp_counter_p->mac_sync.full_sync, iccp_counter_p->mac_sync.delta_sync);
+        fprintf(stdout, "  Last resync MACs sent/total: %u/%u\n",
+            iccp_counter_p->mac_sync.last_sync_entries, iccp_counter_p->mac_sync.last_sync_total);
+        fprintf(stdout, "MACs sent: %lu\n", iccp_counter_p->mac_sync.tx_entries);
+        fprintf(stdout, "Tombstones/dropped: %u/%u\n",
+            iccp_counter_p->mac_sync.tombstones, iccp_counter_p->mac_sync.tombstone_drops);
+        fprintf(stdout, "Peer MACs retained: %u\n", iccp_counter_p->mac_sync.retain_count);
         fprintf(stdout, "\n");
     }
     /* Netlink counters */
@@ -1058,6 +1103,35 @@ static void mclagdctl_print_cmd(struct command_type *cmd_type)
     fprintf(stdout, "%s", cmd_type->name);
 }
 
+/*Parse MAC prefix of 1 to 6 bytes, like "00:1b" */
+static int mclagdctl_parse_mac_prefix(const char *str, struct mclagdctl_dump_filter *filter)
+{
+    const char *p = str;
+    char *end = NULL;
+    unsigned long byte;
+    int len = 0;
+
+    while (*p && len < MCLAGDCTL_ETHER_ADDR_LEN)
+    {
+        byte = strtoul(p, &end, 16);
+        if (end == p || end - p > 2 || byte > 0xff)
+            return MCLAG_ERROR;
+
+        filter->mac_prefix[len++] = byte;
+        p = end;
+        if (*p == ':')
+            p++;
+        else if (*p)
+            return MCLAG_ERROR;
+    }
+
+    if (*p || len == 0)
+        return MCLAG_ERROR;
+
+    filter->mac_prefix_len = len;
+    return 0;
+}
+
 static void mclagdctl_print_help(const char *argv0)
 {
     int i, j;
@@ -1066,7 +1140,11 @@ static void mclagdctl_print_help(const char *argv0)
     fprintf(stdout, "%s [options] command [command args]\n"
             "    -h --help                Show this help\n"
             "    -i --mclag-id            Specify one mclag id\n"
-            "    -l --level               Specify log level     critical,err,warn,notice,info,debug\n",
+            "    -l --level               Specify log level     critical,err,warn,notice,info,debug\n"
+            "    -v --vlan                Dump MAC/ARP/ND of one vlan only\n"
+            "    -I --interface           Dump MAC/ARP/ND of one interface only\n"
+            "    -m --mac                 Dump MAC/ARP/ND with MAC prefix only, like 00:1b:21\n"
+            "    -c --count               Dump at most count MAC/ARP/ND entries\n",
             argv0);
     fprintf(stdout, "Commands:\n");
 
@@ -1095,6 +1173,10 @@ int main(int argc, char **argv)
         { "help",      no_argument,             NULL,        'h' },
         { "mclag id",  required_argument,       NULL,        'i' },
         { "log level", required_argument,       NULL,        'l' },
+        { "vlan",      required_argument,       NULL,        'v' },
+        { "interface", required_argument,       NULL,        'I' },
+        { "mac",       required_argument,       NULL,        'm' },
+        { "count",     required_argument,       NULL,        'c' },
         { NULL,        0,                       NULL,        0   }
     };
     int opt;
@@ -1107,7 +1189,7 @@ int main(int argc, char **argv)
     char *data;
     struct mclagd_reply_hdr *reply;
 
-    while ((opt = getopt_long(argc, argv, "hi:l:", long_options, NULL)) >= 0)
+    while ((opt = getopt_long(argc, argv, "hi:l:v:I:m:c:", long_options, NULL)) >= 0)
     {
         switch (opt)
         {
@@ -1153,6 +1235,36 @@ int main(int argc, char **argv)
             }
             break;
 
+            case 'v':
+                mclagdctl_filter.vid = atoi(optarg);
+                if (mclagdctl_filter.vid <= 0 || mclagdctl_filter.vid > 4095)
+                {
+                    fprintf(stderr, "Invalid vlan \"%s\".\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+
+            case 'I':
+                snprintf(mclagdctl_filter.ifname, sizeof(mclagdctl_filter.ifname), "%s", optarg);
+                break;
+
+            case 'm':
+                if (mclagdctl_parse_mac_prefix(optarg, &mclagdctl_filter) < 0)
+                {
+                    fprintf(stderr, "Invalid MAC prefix \"%s\".\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+
+            case 'c':
+                mclagdctl_filter.limit = atoi(optarg);
+                if (mclagdctl_filter.limit <= 0)
+                {
+                    fprintf(stderr, "Invalid count \"%s\".\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+
             case '?':
                 fprintf(stderr, "unknown option.\n");
                 mclagdctl_print_help(argv0);
@@ -1204,71 +1316,79 @@ int main(int argc, char **argv)
         goto mclagdctl_disconnect;
     }
 
-    /*read data length*/
-    memset(buf, 0, MCLAGDCTL_CMD_SIZE);
-    ret = mclagdctl_sock_read(mclagdctl_sock_fd, buf, sizeof(int));
-    if (ret <= 0)
+    /*MAC/ARP/ND dump is received in chunks, rendered as each arrives*/
+    do
     {
-        fprintf(stderr, "Failed to read data length from mclagd\n");
-        ret = EXIT_FAILURE;
-        goto mclagdctl_disconnect;
-    }
+        /*read data length*/
+        memset(buf, 0, MCLAGDCTL_CMD_SIZE);
+        ret = mclagdctl_sock_read(mclagdctl_sock_fd, buf, sizeof(int));
+        if (ret <= 0)
+        {
+            fprintf(stderr, "Failed to read data length from mclagd\n");
+            ret = EXIT_FAILURE;
+            goto mclagdctl_disconnect;
+        }
 
-    /*cont length*/
-    len = *((int*)buf);
-    if (len <= 0)
-    {
-        ret = EXIT_FAILURE;
-        fprintf(stderr, "pkt len = %d, error\n", len);
-        goto mclagdctl_disconnect;
-    }
+        /*cont length*/
+        len = *((int*)buf);
+        if (len < (int)sizeof(struct mclagd_reply_hdr))
+        {
+            ret = EXIT_FAILURE;
+            fprintf(stderr, "pkt len = %d, error\n", len);
+            goto mclagdctl_disconnect;
+        }
 
-    rcv_buf = (char *)malloc(len);
-    if (!rcv_buf)
-    {
-        fprintf(stderr, "Failed to malloc rcv_buf for mclagdctl\n");
-        goto mclagdctl_disconnect;
-    }
+        if (rcv_buf)
+            free(rcv_buf);
+        rcv_buf = (char *)malloc(len);
+        if (!rcv_buf)
+        {
+            fprintf(stderr, "Failed to malloc rcv_buf for mclagdctl\n");
+            ret = EXIT_FAILURE;
+            goto mclagdctl_disconnect;
+        }
 
-    /*read data*/
-    ret = mclagdctl_sock_read(mclagdctl_sock_fd, rcv_buf, len);
-    if (ret <= 0)
-    {
-        fprintf(stderr, "Failed to read data from mclagd\n");
-        ret = EXIT_FAILURE;
-        goto mclagdctl_disconnect;
-    }
+        /*read data*/
+        ret = mclagdctl_sock_read(mclagdctl_sock_fd, rcv_buf, len);
+        if (ret <= 0)
+        {
+            fprintf(stderr, "Failed to read data from mclagd\n");
+            ret = EXIT_FAILURE;
+            goto mclagdctl_disconnect;
+        }
 
-    reply = (struct mclagd_reply_hdr *)rcv_buf;
-    if (reply->info_type != cmd_type->info_type)
-    {
-        fprintf(stderr, "Reply info type from mclagd error\n");
-        ret = EXIT_FAILURE;
-        goto mclagdctl_disconnect;
-    }
+        reply = (struct mclagd_reply_hdr *)rcv_buf;
+        if (reply->info_type != cmd_type->info_type)
+        {
+            fprintf(stderr, "Reply info type from mclagd error\n");
+            ret = EXIT_FAILURE;
+            goto mclagdctl_disconnect;
+        }
 
-    if (reply->exec_result == EXEC_TYPE_NO_EXIST_SYS)
-    {
-        fprintf(stderr, "No exist sys in iccpd!\n");
-        ret = EXIT_FAILURE;
-        goto mclagdctl_disconnect;
-    }
+        if (reply->exec_result == EXEC_TYPE_NO_EXIST_SYS)
+        {
+            fprintf(stderr, "No exist sys in iccpd!\n");
+            ret = EXIT_FAILURE;
+            goto mclagdctl_disconnect;
+        }
 
-    if (reply->exec_result == EXEC_TYPE_NO_EXIST_MCLAGID)
-    {
-        fprintf(stderr, "Mclag-id %d hasn't been configured in iccpd!\n", para_int);
-        ret = EXIT_FAILURE;
-        goto mclagdctl_disconnect;
-    }
+        if (reply->exec_result == EXEC_TYPE_NO_EXIST_MCLAGID)
+        {
+            fprintf(stderr, "Mclag-id %d hasn't been configured in iccpd!\n", para_int);
+            ret = EXIT_FAILURE;
+            goto mclagdctl_disconnect;
+        }
 
-    if (reply->exec_result == EXEC_TYPE_FAILED)
-    {
-        fprintf(stderr, "exec error in iccpd!\n");
-        ret = EXIT_FAILURE;
-        goto mclagdctl_disconnect;
-    }
+        if (reply->exec_result == EXEC_TYPE_FAILED)
+        {
+            fprintf(stderr, "exec error in iccpd!\n");
+            ret = EXIT_FAILURE;
+            goto mclagdctl_disconnect;
+        }
 
-    cmd_type->parse_msg((char *)(rcv_buf + sizeof(struct mclagd_reply_hdr)), len - sizeof(struct mclagd_reply_hdr));
+        cmd_type->parse_msg((char *)(rcv_buf + sizeof(struct mclagd_reply_hdr)), len - sizeof(struct mclagd_reply_hdr));
+        mclagdctl_dump_chunk++;
+    } while (reply->exec_result == EXEC_TYPE_CONTINUE);
 
     ret = EXIT_SUCCESS;
 
@@ -17,6 +17,9 @@
  *
  *  Maintainer: Jim Jiang from nephos
  */
+#ifndef _MCLAGDCTL_H
+#define _MCLAGDCTL_H
+
 #include <stdint.h>
 #include <stdbool.h>
 #include "../../include/system.h"
@@ -91,6 +94,16 @@ enum log_level_type
     DEBUG = 5
 };
 
+/*MAC/ARP/ND dump filter, zero or empty field matches all*/
+struct mclagdctl_dump_filter
+{
+    int vid;
+    int limit;/*max entries to dump*/
+    char ifname[MCLAGDCTL_MAX_L_PORT_NANE];
+    uint8_t mac_prefix[MCLAGDCTL_ETHER_ADDR_LEN];
+    uint8_t mac_prefix_len;/*leading bytes of mac_prefix to match*/
+};
+
 struct mclagdctl_req_hdr
 {
     int info_type;
@@ -98,6 +111,7 @@ struct mclagdctl_req_hdr
     char para1[MCLAGDCTL_PARA2_LEN];
     char para2[MCLAGDCTL_PARA2_LEN];
     char para3[MCLAGDCTL_PARA2_LEN];
+    struct mclagdctl_dump_filter filter;
 };
 
 struct mclagd_reply_hdr
@@ -111,6 +125,8 @@ struct mclagd_reply_hdr
 #define EXEC_TYPE_NO_EXIST_SYS  -2
 #define EXEC_TYPE_NO_EXIST_MCLAGID  -3
 #define EXEC_TYPE_FAILED -4
+/*MAC/ARP/ND dump is streamed in chunks, each but the last with this result*/
+#define EXEC_TYPE_CONTINUE -5
 
 #define MCLAG_ERROR -1
 
@@ -245,3 +261,5 @@ extern int mclagdctl_enca_dump_dbg_counters(char *msg, int mclag_id, int argc, c
 extern int mclagdctl_parse_dump_dbg_counters(char *msg, int data_len);
 extern int mclagdctl_enca_dump_unique_ip(char *msg, int mclag_id, int argc, char **argv);
 extern int mclagdctl_parse_dump_unique_ip(char *msg, int data_len);
+
+#endif
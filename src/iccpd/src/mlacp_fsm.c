@@ -25,6 +25,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
+#include <endian.h>
 
 #include <sys/queue.h>
 
@@ -42,6 +43,7 @@
 #include "../include/mlacp_sync_update.h"
 #include "../include/system.h"
 #include "../include/scheduler.h"
+#include "../include/iccp_warm_snapshot.h"
 
 #include <signal.h>
 
@@ -61,18 +63,42 @@
         TAILQ_INIT(&(list)); \
     }
 
-#define MLACP_MAC_MSG_QUEUE_REINIT(list) \
+/* List entries are freed by MLACP_MSG_QUEUE_REINIT */
+#define NEIGH_INDEX_REINIT(tree) \
+    { \
+        struct NeighIndex* neigh = NULL; \
+        while ((neigh = RB_MIN(neigh_rb_tree, &(tree))) != NULL) { \
+            RB_REMOVE(neigh_rb_tree, &(tree), neigh); \
+            free(neigh); \
+        } \
+        RB_INIT(neigh_rb_tree, &(tree)); \
+    }
+
+#define MLACP_MAC_MSG_QUEUE_REINIT(csm, list) \
     { \
         struct MACMsg* mac_msg = NULL; \
         while (!TAILQ_EMPTY(&(list))) { \
             mac_msg = TAILQ_FIRST(&(list)); \
             TAILQ_REMOVE(&(list), mac_msg, tail); \
             if (mac_msg->op_type == MAC_SYNC_DEL) \
-                free(mac_msg); \
+                mlacp_mac_sync_release(csm, mac_msg); \
         } \
         TAILQ_INIT(&(list)); \
     }
 
+#define MAC_TOMBSTONE_QUEUE_REINIT(csm) \
+    { \
+        struct MACMsg* mac_msg = NULL; \
+        while (!TAILQ_EMPTY(&(MLACP(csm).mac_tombstone_list))) { \
+            mac_msg = TAILQ_FIRST(&(MLACP(csm).mac_tombstone_list)); \
+            TAILQ_REMOVE(&(MLACP(csm).mac_tombstone_list), mac_msg, sync_tail); \
+            free(mac_msg); \
+        } \
+        TAILQ_INIT(&(MLACP(csm).mac_tombstone_list)); \
+        MLACP(csm).mac_tombstone_count = 0; \
+        MLACP(csm).dbg_counters.mac_sync.tombstones = 0; \
+    }
+
 #define PIF_QUEUE_REINIT(list) \
     { \
         while (!LIST_EMPTY(&(list))) { \
@@ -134,7 +160,23 @@ static int MACMsg_compare(const struct MACMsg *mac1, const struct MACMsg *mac2)
 
 RB_GENERATE(mac_rb_tree, MACMsg, mac_entry_rb, MACMsg_compare);
 
+/* Entries of an address are adjacent, for lookup on any interface */
+static int NeighIndex_compare(const struct NeighIndex *neigh1, const struct NeighIndex *neigh2)
+{
+    int ret;
+
+    ret = memcmp((char *)neigh1->addr, (char *)neigh2->addr, sizeof(neigh1->addr));
+    if (ret != 0)
+        return ret;
+
+    return strcmp(neigh1->ifname, neigh2->ifname);
+}
+
+RB_GENERATE(neigh_rb_tree, NeighIndex, neigh_entry_rb, NeighIndex_compare);
+
 #define WARM_REBOOT_TIMEOUT 90
+/* Deleted MACs kept for delta resync, beyond which next resync is full */
+#define MAC_SYNC_TOMBSTONE_MAX 16384
 #define PEER_REBOOT_TIMEOUT 300
 
 /*****************************************
@@ -152,6 +194,7 @@ static void mlacp_sync_send_syncArpInfo(struct CSM* csm);
 static void mlacp_sync_send_syncNdiscInfo(struct CSM *csm);
 static void mlacp_sync_send_heartbeat(struct CSM* csm);
 static void mlacp_sync_send_syncDoneData(struct CSM* csm);
+static void mlacp_sync_send_macSync(struct CSM* csm, uint16_t tlv_type, uint8_t flags, uint32_t epoch, uint64_t gen);
 /* Sync Reciever APIs*/
 static void mlacp_sync_recv_sysConf(struct CSM* csm, struct Msg* msg);
 static void mlacp_sync_recv_portConf(struct CSM* csm, struct Msg* msg);
@@ -165,6 +208,13 @@ static void mlacp_sync_recv_portChanInfo(struct CSM* csm, struct Msg* msg);
 static void mlacp_sync_recv_peerLlinkInfo(struct CSM* csm, struct Msg* msg);
 static void mlacp_sync_recv_arpInfo(struct CSM* csm, struct Msg* msg);
 static void mlacp_sync_recv_stpInfo(struct CSM* csm, struct Msg* msg);
+static void mlacp_sync_recv_macSyncMark(struct CSM* csm, struct Msg* msg);
+static void mlacp_sync_recv_macSyncAck(struct CSM* csm, struct Msg* msg);
+
+/* MAC delta resync */
+static void mlacp_mac_sync_stamp(struct CSM* csm, struct MACMsg* mac_msg);
+static void mlacp_mac_sync_prune(struct CSM* csm);
+static void mlacp_mac_sync_retain_end(struct CSM* csm, int flush);
 
 /* Sync Handler*/
 static void mlacp_sync_send_nak_handler(struct CSM* csm,  struct Msg* msg);
@@ -263,6 +313,7 @@ static void mlacp_sync_send_syncMacInfo(struct CSM* csm)
     struct MACMsg* mac_msg = NULL;
     struct MACMsg mac_find;
     int count = 0;
+    int sent = 0;
 
     memset(g_csm_buf, 0, CSM_BUFFER_SIZE);
     memset(&mac_find, 0, sizeof(struct MACMsg));
@@ -274,6 +325,8 @@ static void mlacp_sync_send_syncMacInfo(struct CSM* csm)
 
         msg_len = mlacp_prepare_for_mac_info_to_peer(csm, g_csm_buf, CSM_BUFFER_SIZE, mac_msg, count);
         count++;
+        sent++;
+        mlacp_mac_sync_stamp(csm, mac_msg);
 
         //free mac_msg if marked for delete.
         if (mac_msg->op_type == MAC_SYNC_DEL)
@@ -285,7 +338,7 @@ static void mlacp_sync_send_syncMacInfo(struct CSM* csm)
                 mac_find.vid = mac_msg->vid ;
                 memcpy(mac_find.mac_addr, mac_msg->mac_addr, ETHER_ADDR_LEN);
                 if (!RB_FIND(mac_rb_tree, &MLACP(csm).mac_rb ,&mac_find))
-                    free(mac_msg);
+                    mlacp_mac_sync_release(csm, mac_msg);
             }
         }
 
@@ -301,6 +354,22 @@ static void mlacp_sync_send_syncMacInfo(struct CSM* csm)
     if (count)
         iccp_csm_send(csm, g_csm_buf, msg_len);
 
+    /* Peer acks the generation upon processing MACs above */
+    if (sent && MLACP(csm).mac_sync_peer_capable)
+        mlacp_sync_send_macSync(csm, TLV_T_MLACP_MAC_SYNC_MARK, 0,
+            MLACP(csm).mac_sync_epoch, MLACP(csm).mac_sync_gen);
+
+    return;
+}
+
+static void mlacp_sync_send_macSync(struct CSM* csm, uint16_t tlv_type, uint8_t flags, uint32_t epoch, uint64_t gen)
+{
+    int msg_len = 0;
+
+    msg_len = mlacp_prepare_for_mac_sync(csm, g_csm_buf, CSM_BUFFER_SIZE, tlv_type, flags, epoch, gen);
+    if (msg_len > 0)
+        iccp_csm_send(csm, g_csm_buf, msg_len);
+
     return;
 }
 
@@ -609,6 +678,9 @@ static void mlacp_sync_recv_macInfo(struct CSM* csm, struct Msg* msg)
     struct mLACPMACInfoTLV* mac_info = NULL;
 
     mac_info = (struct mLACPMACInfoTLV *)&(msg->buf[sizeof(ICCHdr)]);
+
+    /* MACs w/o delta mark, retained MACs are stale */
+    mlacp_mac_sync_retain_end(csm, 1);
     mlacp_fsm_update_mac_info_from_peer(csm, mac_info);
     MLACP_SET_ICCP_RX_DBG_COUNTER(csm,
         mac_info->icc_parameter.type, ICCP_DBG_CNTR_STS_OK);
@@ -616,6 +688,70 @@ static void mlacp_sync_recv_macInfo(struct CSM* csm, struct Msg* msg)
     return;
 }
 
+static void mlacp_sync_recv_macSyncMark(struct CSM* csm, struct Msg* msg)
+{
+    struct mLACPMACSyncTLV* tlv = NULL;
+    uint32_t epoch;
+    uint64_t gen;
+
+    tlv = (struct mLACPMACSyncTLV *)&(msg->buf[sizeof(ICCHdr)]);
+    epoch = ntohl(tlv->epoch);
+    gen = be64toh(tlv->gen);
+    MLACP_SET_ICCP_RX_DBG_COUNTER(csm,
+        tlv->icc_parameter.type, ICCP_DBG_CNTR_STS_OK);
+
+    if (tlv->flags & MAC_SYNC_MARK_FLAG_DELTA)
+    {
+        ICCPD_LOG_NOTICE("ICCP_FDB", "Peer resumes MAC sync after generation %llu",
+            (unsigned long long)MLACP(csm).peer_mac_gen);
+        mlacp_mac_sync_retain_end(csm, 0);
+        return;
+    }
+
+    if (tlv->flags & MAC_SYNC_MARK_FLAG_FULL)
+    {
+        mlacp_mac_sync_retain_end(csm, 1);
+        MLACP(csm).peer_mac_epoch = epoch;
+        MLACP(csm).peer_mac_gen = 0;
+        MLACP(csm).dbg_counters.mac_sync.peer_gen = 0;
+        return;
+    }
+
+    /* MACs up to gen are processed, ack them */
+    MLACP(csm).peer_mac_epoch = epoch;
+    MLACP(csm).peer_mac_gen = gen;
+    MLACP(csm).dbg_counters.mac_sync.peer_gen = gen;
+    mlacp_sync_send_macSync(csm, TLV_T_MLACP_MAC_SYNC_ACK, 0, epoch, gen);
+
+    return;
+}
+
+static void mlacp_sync_recv_macSyncAck(struct CSM* csm, struct Msg* msg)
+{
+    struct mLACPMACSyncTLV* tlv = NULL;
+    uint32_t epoch;
+    uint64_t gen;
+
+    tlv = (struct mLACPMACSyncTLV *)&(msg->buf[sizeof(ICCHdr)]);
+    epoch = ntohl(tlv->epoch);
+    gen = be64toh(tlv->gen);
+    MLACP_SET_ICCP_RX_DBG_COUNTER(csm,
+        tlv->icc_parameter.type, ICCP_DBG_CNTR_STS_OK);
+
+    MLACP(csm).mac_sync_peer_capable = 1;
+
+    /* Ack of other instance or of a generation not sent is void */
+    if (epoch == MLACP(csm).mac_sync_epoch && gen <= MLACP(csm).mac_sync_gen)
+        MLACP(csm).mac_sync_acked_gen = gen;
+    else
+        MLACP(csm).mac_sync_acked_gen = 0;
+
+    MLACP(csm).dbg_counters.mac_sync.acked_gen = MLACP(csm).mac_sync_acked_gen;
+    mlacp_mac_sync_prune(csm);
+
+    return;
+}
+
 static void mlacp_sync_recv_arpInfo(struct CSM* csm, struct Msg* msg)
 {
     struct mLACPARPInfoTLV* arp_info = NULL;
@@ -743,7 +879,7 @@ void mlacp_mac_msg_queue_reinit(struct CSM* csm)
 
     struct MACMsg* mac_msg = NULL;
 
-    MLACP_MAC_MSG_QUEUE_REINIT(MLACP(csm).mac_msg_list);
+    MLACP_MAC_MSG_QUEUE_REINIT(csm, MLACP(csm).mac_msg_list);
 
     ICCPD_LOG_NOTICE("ICCP_FDB", "mlacp_mac_msg_queue_reinit clear mac_msg_list pointers in existing MAC entries");
 
@@ -780,15 +916,24 @@ void mlacp_init(struct CSM* csm, int all)
     mlacp_mac_msg_queue_reinit(csm);
 
     PIF_QUEUE_REINIT(MLACP(csm).pif_list);
+    RB_INIT(pif_name_rb_tree, &MLACP(csm).pif_name_rb);
     LIF_PURGE_QUEUE_REINIT(MLACP(csm).lif_purge_list);
 
     if (all != 0)
     {
         /* if no clean all, keep the arp info & local interface info for next connection*/
+        NEIGH_INDEX_REINIT(MLACP(csm).arp_rb);
+        NEIGH_INDEX_REINIT(MLACP(csm).ndisc_rb);
         MLACP_MSG_QUEUE_REINIT(MLACP(csm).arp_list);
         MLACP_MSG_QUEUE_REINIT(MLACP(csm).ndisc_list);
         RB_INIT(mac_rb_tree, &MLACP(csm).mac_rb );
         LIF_QUEUE_REINIT(MLACP(csm).lif_list);
+        TAILQ_INIT(&(MLACP(csm).mac_tombstone_list));
+
+        /* Nonzero, differs across restarts */
+        MLACP(csm).mac_sync_epoch = (((uint32_t)time(NULL)) << 8) ^ (uint32_t)rand();
+        if (MLACP(csm).mac_sync_epoch == 0)
+            MLACP(csm).mac_sync_epoch = 1;
 
         MLACP(csm).node_id = MLACP_SYSCONF_NODEID_MSB_MASK;
         MLACP(csm).node_id |= (((inet_addr(csm->sender_ip) >> 24) << 4) & MLACP_SYSCONF_NODEID_NODEID_MASK);
@@ -812,16 +957,20 @@ void mlacp_finalize(struct CSM* csm)
     MLACP_MSG_QUEUE_REINIT(MLACP(csm).arp_msg_list);
     MLACP_MSG_QUEUE_REINIT(MLACP(csm).ndisc_msg_list);
     mlacp_mac_msg_queue_reinit(csm);
+    NEIGH_INDEX_REINIT(MLACP(csm).arp_rb);
+    NEIGH_INDEX_REINIT(MLACP(csm).ndisc_rb);
     MLACP_MSG_QUEUE_REINIT(MLACP(csm).arp_list);
     MLACP_MSG_QUEUE_REINIT(MLACP(csm).ndisc_list);
 
     RB_INIT(mac_rb_tree, &MLACP(csm).mac_rb );
+    MAC_TOMBSTONE_QUEUE_REINIT(csm);
 
     /* remove lif & lif-purge queue */
     LIF_QUEUE_REINIT(MLACP(csm).lif_list);
     LIF_PURGE_QUEUE_REINIT(MLACP(csm).lif_purge_list);
     /* remove & destroy pif queue */
     PIF_QUEUE_REINIT(MLACP(csm).pif_list);
+    RB_INIT(pif_name_rb_tree, &MLACP(csm).pif_name_rb);
 
     return;
 }
@@ -844,6 +993,9 @@ void mlacp_fsm_transit(struct CSM* csm)
     if ((sys = system_get_instance()) == NULL)
         return;
 
+    /* Remove state restored upon warm start but not confirmed since */
+    iccp_warm_snapshot_reconcile(csm);
+
     /* torn down event */
     if (csm->sock_fd <= 0 || csm->app_csm.current_state != APP_OPERATIONAL)
     {
@@ -862,6 +1014,14 @@ void mlacp_fsm_transit(struct CSM* csm)
                 SYSTEM_INCR_SOCKET_CLEANUP_COUNTER(system_get_instance());
             }
         }
+
+        /* Peer did not reconnect within window, age MACs retained for it */
+        if (MLACP(csm).peer_mac_retain_time
+            && (time(NULL) - MLACP(csm).peer_mac_retain_time) >= sys->mac_sync_window)
+        {
+            ICCPD_LOG_NOTICE(__FUNCTION__, "Peer reconnection timeout, age MACs retained for resync");
+            mlacp_mac_sync_retain_end(csm, 1);
+        }
         return;
     }
 
@@ -903,6 +1063,19 @@ void mlacp_fsm_transit(struct CSM* csm)
                     free(msg);
                     continue;
                 }
+
+                /* MAC sync mark & ack are handled in any state */
+                if (icc_hdr->ldp_hdr.msg_type == MSG_T_RG_APP_DATA
+                    && (icc_param->type == TLV_T_MLACP_MAC_SYNC_MARK || icc_param->type == TLV_T_MLACP_MAC_SYNC_ACK))
+                {
+                    if (icc_param->type == TLV_T_MLACP_MAC_SYNC_MARK)
+                        mlacp_sync_recv_macSyncMark(csm, msg);
+                    else
+                        mlacp_sync_recv_macSyncAck(csm, msg);
+                    free(msg->buf);
+                    free(msg);
+                    continue;
+                }
             }
             else
             {
@@ -924,6 +1097,16 @@ void mlacp_fsm_transit(struct CSM* csm)
             MLACP(csm).current_state = MLACP_STATE_STAGE1;
             mlacp_resync_arp(csm);
             mlacp_resync_ndisc(csm);
+
+            /* Tell peer the MACs retained for it, if any; also
+             * tells peer that MAC delta resync is supported
+             */
+            MLACP(csm).mac_sync_peer_capable = 0;
+            if (MLACP(csm).peer_mac_retain_time)
+                mlacp_sync_send_macSync(csm, TLV_T_MLACP_MAC_SYNC_ACK, 0,
+                    MLACP(csm).peer_mac_epoch, MLACP(csm).peer_mac_gen);
+            else
+                mlacp_sync_send_macSync(csm, TLV_T_MLACP_MAC_SYNC_ACK, 0, 0, 0);
         }
 
         switch (MLACP(csm).current_state)
@@ -1011,11 +1194,199 @@ struct Msg* mlacp_dequeue_msg(struct CSM* csm)
     return msg;
 }
 
+/* Whether peer holds the MAC as advertised last, per acked generation */
+#define MAC_SYNC_PEER_HOLDS(csm, mac_msg, op) \
+    ((mac_msg)->sync_gen != 0 && (mac_msg)->sync_gen <= MLACP(csm).mac_sync_acked_gen && \
+     (mac_msg)->sync_op == (op) && \
+     ((op) == MAC_SYNC_DEL || ((mac_msg)->sync_fdb_type == (mac_msg)->fdb_type && \
+      strcmp((mac_msg)->sync_ifname, (mac_msg)->origin_ifname) == 0)))
+
+/* Stamp MAC sent to peer with next generation */
+static void mlacp_mac_sync_stamp(struct CSM* csm, struct MACMsg* mac_msg)
+{
+    mac_msg->sync_gen = ++MLACP(csm).mac_sync_gen;
+    mac_msg->sync_op = mac_msg->op_type;
+    mac_msg->sync_fdb_type = mac_msg->fdb_type;
+    memcpy(mac_msg->sync_ifname, mac_msg->origin_ifname, MAX_L_PORT_NAME);
+
+    MLACP(csm).dbg_counters.mac_sync.gen = MLACP(csm).mac_sync_gen;
+    ++MLACP(csm).dbg_counters.mac_sync.tx_entries;
+    return;
+}
+
+/* Release MAC removed from MAC table. MAC known to peer is kept as
+ * tombstone until peer acks its delete, so that delta resync can delete it.
+ */
+void mlacp_mac_sync_release(struct CSM* csm, struct MACMsg* mac_msg)
+{
+    if (!csm || !mac_msg)
+        return;
+
+    /* Still owned by MAC table */
+    if (RB_FIND(mac_rb_tree, &MLACP(csm).mac_rb, mac_msg) == mac_msg)
+        return;
+
+    if (mac_msg->sync_gen == 0 || !MLACP(csm).mac_sync_peer_capable
+        || (mac_msg->sync_op == MAC_SYNC_DEL && mac_msg->sync_gen <= MLACP(csm).mac_sync_acked_gen))
+    {
+        free(mac_msg);
+        return;
+    }
+
+    if (MLACP(csm).mac_tombstone_count >= MAC_SYNC_TOMBSTONE_MAX)
+    {
+        MLACP(csm).mac_sync_full_needed = 1;
+        ++MLACP(csm).dbg_counters.mac_sync.tombstone_drops;
+        free(mac_msg);
+        return;
+    }
+
+    mac_msg->op_type = MAC_SYNC_DEL;
+    CLEAR_MAC_IN_MSG_LIST(&(MLACP(csm).mac_msg_list), mac_msg, tail);
+    TAILQ_INSERT_TAIL(&(MLACP(csm).mac_tombstone_list), mac_msg, sync_tail);
+    ++MLACP(csm).mac_tombstone_count;
+    MLACP(csm).dbg_counters.mac_sync.tombstones = MLACP(csm).mac_tombstone_count;
+    return;
+}
+
+/* Free tombstones whose delete is acked by peer */
+static void mlacp_mac_sync_prune(struct CSM* csm)
+{
+    struct MACMsg* mac_msg = NULL, *mac_temp = NULL;
+
+    for (mac_msg = TAILQ_FIRST(&(MLACP(csm).mac_tombstone_list)); mac_msg != NULL; mac_msg = mac_temp)
+    {
+        mac_temp = TAILQ_NEXT(mac_msg, sync_tail);
+        /* Pending in MAC msg list, released again after sent */
+        if (MAC_IN_MSG_LIST(&(MLACP(csm).mac_msg_list), mac_msg, tail))
+            continue;
+
+        if (mac_msg->sync_op == MAC_SYNC_DEL && mac_msg->sync_gen <= MLACP(csm).mac_sync_acked_gen)
+        {
+            TAILQ_REMOVE(&(MLACP(csm).mac_tombstone_list), mac_msg, sync_tail);
+            --MLACP(csm).mac_tombstone_count;
+            free(mac_msg);
+        }
+    }
+    MLACP(csm).dbg_counters.mac_sync.tombstones = MLACP(csm).mac_tombstone_count;
+    return;
+}
+
+/* Queue MACs changed since generation acked by peer */
+static int mlacp_sync_mac_delta(struct CSM* csm)
+{
+    struct MACMsg* mac_msg = NULL, *mac_temp = NULL;
+    struct MACMsg* mac_entry = NULL;
+    int count = 0;
+
+    /* Deletes first, a MAC may be deleted & learnt again */
+    for (mac_msg = TAILQ_FIRST(&(MLACP(csm).mac_tombstone_list)); mac_msg != NULL; mac_msg = mac_temp)
+    {
+        mac_temp = TAILQ_NEXT(mac_msg, sync_tail);
+        if (MAC_IN_MSG_LIST(&(MLACP(csm).mac_msg_list), mac_msg, tail))
+            continue;
+
+        TAILQ_REMOVE(&(MLACP(csm).mac_tombstone_list), mac_msg, sync_tail);
+        --MLACP(csm).mac_tombstone_count;
+
+        mac_entry = RB_FIND(mac_rb_tree, &MLACP(csm).mac_rb, mac_msg);
+        if (mac_entry && mac_entry->sync_gen == 0)
+        {
+            /* Relearnt, the entry takes over what peer holds */
+            mac_entry->sync_gen = mac_msg->sync_gen;
+            mac_entry->sync_op = mac_msg->sync_op;
+            mac_entry->sync_fdb_type = mac_msg->sync_fdb_type;
+            memcpy(mac_entry->sync_ifname, mac_msg->sync_ifname, MAX_L_PORT_NAME);
+            free(mac_msg);
+        }
+        else if (!mac_entry && !MAC_SYNC_PEER_HOLDS(csm, mac_msg, MAC_SYNC_DEL))
+        {
+            mac_msg->op_type = MAC_SYNC_DEL;
+            TAILQ_INSERT_TAIL(&(MLACP(csm).mac_msg_list), mac_msg, tail);
+            count++;
+        }
+        else
+        {
+            free(mac_msg);
+        }
+    }
+    MLACP(csm).dbg_counters.mac_sync.tombstones = MLACP(csm).mac_tombstone_count;
+
+    RB_FOREACH (mac_msg, mac_rb_tree, &MLACP(csm).mac_rb)
+    {
+        if (MAC_IN_MSG_LIST(&(MLACP(csm).mac_msg_list), mac_msg, tail))
+        {
+            count++;
+            continue;
+        }
+
+        if (!(mac_msg->age_flag & MAC_AGE_LOCAL))
+        {
+            if (MAC_SYNC_PEER_HOLDS(csm, mac_msg, MAC_SYNC_ADD))
+                continue;
+            mac_msg->op_type = MAC_SYNC_ADD;
+        }
+        else
+        {
+            /* Not advertised now, delete if peer holds it */
+            if (mac_msg->sync_gen == 0 || MAC_SYNC_PEER_HOLDS(csm, mac_msg, MAC_SYNC_DEL))
+                continue;
+            mac_msg->op_type = MAC_SYNC_DEL;
+        }
+
+        TAILQ_INSERT_TAIL(&(MLACP(csm).mac_msg_list), mac_msg, tail);
+        count++;
+
+        ICCPD_LOG_DEBUG("ICCP_FDB", "Sync MAC delta: MAC-msg-list enqueue interface %s, "
+            "MAC %s vlan %d, age_flag %d, op_type %d", mac_msg->ifname,
+            mac_addr_to_str(mac_msg->mac_addr), mac_msg->vid, mac_msg->age_flag, mac_msg->op_type);
+    }
+
+    return count;
+}
+
 void mlacp_sync_mac(struct CSM* csm)
 {
     struct MACMsg* mac_msg = NULL;
+    int delta = 0;
+    int count = 0;
+    int total = 0;
+
+    /* Peer did not resume the MACs retained for it */
+    if (MLACP(csm).peer_mac_retain_time && !MLACP(csm).mac_sync_peer_capable)
+        mlacp_mac_sync_retain_end(csm, 1);
+
+    delta = MLACP(csm).mac_sync_peer_capable && !MLACP(csm).mac_sync_full_needed
+        && MLACP(csm).mac_sync_acked_gen != 0;
+
+    if (MLACP(csm).mac_sync_peer_capable)
+        mlacp_sync_send_macSync(csm, TLV_T_MLACP_MAC_SYNC_MARK,
+            delta ? MAC_SYNC_MARK_FLAG_DELTA : MAC_SYNC_MARK_FLAG_FULL,
+            MLACP(csm).mac_sync_epoch, MLACP(csm).mac_sync_gen);
+
+    if (delta)
+    {
+        count = mlacp_sync_mac_delta(csm);
+        RB_FOREACH (mac_msg, mac_rb_tree, &MLACP(csm).mac_rb)
+            total++;
+
+        ++MLACP(csm).dbg_counters.mac_sync.delta_sync;
+        MLACP(csm).dbg_counters.mac_sync.last_sync_entries = count;
+        MLACP(csm).dbg_counters.mac_sync.last_sync_total = total;
+        ICCPD_LOG_NOTICE("ICCP_FDB", "Sync MAC delta from generation %llu: %d of %d MACs",
+            (unsigned long long)MLACP(csm).mac_sync_acked_gen, count, total);
+        return;
+    }
+
+    /* Peer holds nothing, tombstones are moot */
+    MAC_TOMBSTONE_QUEUE_REINIT(csm);
+    MLACP(csm).mac_sync_full_needed = 0;
+
     RB_FOREACH (mac_msg, mac_rb_tree, &MLACP(csm).mac_rb)
     {
+        total++;
+        mac_msg->sync_gen = 0;
+
         /*If MAC with local age flag, dont sync to peer. Such MAC only exist when peer is warm-reboot.
           If peer is warm-reboot, peer age flag is not set when connection is lost.
           When MAC is aged in local switch, this MAC is not deleted for no peer age flag.
@@ -1030,6 +1401,7 @@ void mlacp_sync_mac(struct CSM* csm)
             {
                 TAILQ_INSERT_TAIL(&(MLACP(csm).mac_msg_list), mac_msg, tail);
             }
+            count++;
 
             ICCPD_LOG_DEBUG("ICCP_FDB", "Sync MAC: MAC-msg-list enqueue interface %s, "
                 "MAC %s vlan %d, age_flag %d", mac_msg->ifname,
@@ -1049,6 +1421,29 @@ void mlacp_sync_mac(struct CSM* csm)
             }
         }
     }
+
+    ++MLACP(csm).dbg_counters.mac_sync.full_sync;
+    MLACP(csm).dbg_counters.mac_sync.last_sync_entries = count;
+    MLACP(csm).dbg_counters.mac_sync.last_sync_total = total;
+    return;
+}
+
+/* End retention of peer MACs upon disconnect; flush ages them as if
+ * the session had gone down without retention.
+ */
+static void mlacp_mac_sync_retain_end(struct CSM* csm, int flush)
+{
+    if (MLACP(csm).peer_mac_retain_time == 0)
+        return;
+
+    MLACP(csm).peer_mac_retain_time = 0;
+    if (flush)
+    {
+        MLACP(csm).peer_mac_epoch = 0;
+        MLACP(csm).peer_mac_gen = 0;
+        MLACP(csm).dbg_counters.mac_sync.peer_gen = 0;
+        mlacp_peer_disconn_fdb_handler(csm);
+    }
     return;
 }
 
@@ -1074,7 +1469,7 @@ void mlacp_local_lif_clear_pending_mac(struct CSM* csm, struct LocalInterface *l
                 mac_msg->op_type = MAC_SYNC_DEL;
                 if (!MAC_IN_MSG_LIST(&(MLACP(csm).mac_msg_list), mac_msg, tail))
                 {
-                    free(mac_msg);
+                    mlacp_mac_sync_release(csm, mac_msg);
                 }
             }
             else
@@ -1661,6 +2056,12 @@ ICCP_DBG_CNTR_MSG_e mlacp_fsm_iccp_to_dbg_msg_type(uint32_t tlv_type)
         case TLV_T_MLACP_IF_UP_ACK:
             return ICCP_DBG_CNTR_MSG_IF_UP_ACK;
 
+        case TLV_T_MLACP_MAC_SYNC_MARK:
+            return ICCP_DBG_CNTR_MSG_MAC_SYNC_MARK;
+
+        case TLV_T_MLACP_MAC_SYNC_ACK:
+            return ICCP_DBG_CNTR_MSG_MAC_SYNC_ACK;
+
         default:
             ICCPD_LOG_DEBUG(__FUNCTION__, "No debug counter for TLV type %u",
                 tlv_type);
@@ -29,6 +29,7 @@
 #include <arpa/inet.h>
 #include <sys/queue.h>
 #include <sys/epoll.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include <linux/un.h>
 #include <linux/if_arp.h>
@@ -67,12 +68,12 @@ char g_ipv4_str[INET_ADDRSTRLEN];
 char g_ipv6_str[INET6_ADDRSTRLEN];
 char g_iccp_mlagsyncd_recv_buf[ICCP_MLAGSYNCD_RECV_MSG_BUFFER_SIZE] = { 0 };
 char g_iccp_mlagsyncd_send_buf[ICCP_MLAGSYNCD_SEND_MSG_BUFFER_SIZE] = { 0 };
+/* FDB entries coalesced into one MCLAG_MSG_TYPE_SET_FDB message */
+static char g_iccp_mlagsyncd_fdb_buf[ICCP_MLAGSYNCD_SEND_MSG_BUFFER_SIZE] = { 0 };
 
 
 extern void mlacp_sync_mac(struct CSM* csm);
 
-#define SYNCD_SEND_RETRY_INTERVAL_USEC    50000 //50 mseconds
-#define SYNCD_SEND_RETRY_MAX              5
 
 #define SYNCD_RECV_RETRY_INTERVAL_USEC    50000 //50 mseconds
 #define SYNCD_RECV_RETRY_MAX              5
@@ -361,14 +362,119 @@ static int peer_po_is_alive(struct CSM *csm, int po_ifindex)
     return pif_active;
 }
 
+/*****************************************
+* Tool : Queue bytes to mclagsyncd
+*
+* ***************************************/
+static int iccp_mclagsyncd_tx_enqueue(struct System *sys, char *buf, size_t len)
+{
+    size_t size;
+    char *new_buf = NULL;
+
+    /* Reclaim space of bytes already sent */
+    if (sys->sync_tx_start > 0)
+    {
+        memmove(sys->sync_tx_buf, &sys->sync_tx_buf[sys->sync_tx_start], sys->sync_tx_len - sys->sync_tx_start);
+        sys->sync_tx_len -= sys->sync_tx_start;
+        sys->sync_tx_start = 0;
+    }
+
+    if (sys->sync_tx_len + len > sys->sync_tx_size)
+    {
+        if (sys->sync_tx_len + len > ICCP_MLAGSYNCD_TX_QUEUE_MAX_SIZE)
+            return MCLAG_ERROR;
+
+        size = sys->sync_tx_size ? sys->sync_tx_size : ICCP_MLAGSYNCD_SEND_MSG_BUFFER_SIZE;
+        while (size < sys->sync_tx_len + len)
+            size *= 2;
+
+        new_buf = (char *)realloc(sys->sync_tx_buf, size);
+        if (!new_buf)
+            return MCLAG_ERROR;
+
+        sys->sync_tx_buf = new_buf;
+        sys->sync_tx_size = size;
+    }
+
+    memcpy(&sys->sync_tx_buf[sys->sync_tx_len], buf, len);
+    sys->sync_tx_len += len;
+
+    return 0;
+}
+
+static void iccp_mclagsyncd_tx_set_pollout(struct System *sys, int enable)
+{
+    struct epoll_event event;
+
+    if (sys->sync_tx_pollout == enable)
+        return;
+
+    event.data.fd = sys->sync_fd;
+    event.events = enable ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+    if (epoll_ctl(sys->epoll_fd, EPOLL_CTL_MOD, sys->sync_fd, &event) != 0)
+    {
+        ICCPD_LOG_ERR(__FUNCTION__, "Failed to %s EPOLLOUT on mclagsyncd socket, errno %d",
+            enable ? "set" : "clear", errno);
+        return;
+    }
+    sys->sync_tx_pollout = enable;
+}
+
+static void iccp_mclagsyncd_tx_reset(struct System *sys)
+{
+    sys->sync_tx_start = 0;
+    sys->sync_tx_len = 0;
+    sys->sync_tx_pollout = 0;
+}
+
+/*****************************************
+* Tool : Send queued bytes to mclagsyncd
+*
+* Sends as much as socket takes w/o blocking.
+* Rest is sent once socket is writable (EPOLLOUT).
+* ***************************************/
+int iccp_mclagsyncd_tx_flush(struct System *sys)
+{
+    ssize_t send_len = 0;
+
+    if (sys == NULL)
+        return MCLAG_ERROR;
+
+    while (sys->sync_tx_start < sys->sync_tx_len)
+    {
+        send_len = send(sys->sync_fd, &sys->sync_tx_buf[sys->sync_tx_start],
+                        sys->sync_tx_len - sys->sync_tx_start, MSG_DONTWAIT);
+        if (send_len == -1)
+        {
+            if (errno == EINTR)
+                continue;
+
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+            {
+                iccp_mclagsyncd_tx_set_pollout(sys, 1);
+                return 0;
+            }
+
+            ICCPD_LOG_ERR("ICCP_FSM", "Send to mclagsyncd Non-blocking send() failed, errno %d, drop %zu bytes",
+                    errno, sys->sync_tx_len - sys->sync_tx_start);
+            iccp_mclagsyncd_tx_set_pollout(sys, 0);
+            iccp_mclagsyncd_tx_reset(sys);
+            return MCLAG_ERROR;
+        }
+        sys->sync_tx_start += send_len;
+    }
+
+    sys->sync_tx_start = 0;
+    sys->sync_tx_len = 0;
+    iccp_mclagsyncd_tx_set_pollout(sys, 0);
+
+    return 0;
+}
+
 // return -1 if failed
 ssize_t iccp_send_to_mclagsyncd(uint8_t msg_type, char *send_buff, uint16_t msg_len)
 {
     struct System *sys;
-    ssize_t write = 0;
-    int num_retry = 0;
-    size_t pos = 0;
-    int send_len = 0;
 
     sys = system_get_instance();
     if (sys == NULL)
@@ -377,55 +483,55 @@ ssize_t iccp_send_to_mclagsyncd(uint8_t msg_type, char *send_buff, uint16_t msg_
         return MCLAG_ERROR;
     }
 
-    if (sys->sync_fd)
+    if (sys->sync_fd <= 0)
+        return 0;
+
+    /* FDB entries batched so far go first, to keep the order */
+    if (send_buff != g_iccp_mlagsyncd_fdb_buf)
+        iccp_mclagsyncd_fdb_flush();
+
+    /* Queue behind pending bytes, if any, and send what socket takes */
+    if (iccp_mclagsyncd_tx_enqueue(sys, send_buff, msg_len) != 0)
     {
-        while (msg_len > 0)
-        {
-            send_len = send(sys->sync_fd, &send_buff[pos], msg_len, MSG_DONTWAIT);
+        ICCPD_LOG_ERR("ICCP_FSM", "Send to mclagsyncd queue full, msg_type: %d msg_len %d queued %zu",
+                msg_type, msg_len, sys->sync_tx_len - sys->sync_tx_start);
+        SYSTEM_SET_SYNCD_TX_DBG_COUNTER(sys, msg_type, ICCP_DBG_CNTR_STS_ERR);
+        return MCLAG_ERROR;
+    }
 
-            if (send_len == -1)
-            {
-                if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
-                {
-                    ++num_retry;
-                    if (num_retry > SYNCD_SEND_RETRY_MAX)
-                    {
-                        ICCPD_LOG_ERR("ICCP_FSM", "Send to mclagsyncd Non-blocking send() retry failed,msg_type: %d msg_len/send_len %d/%d",
-                                msg_type, msg_len, send_len);
-                        SYSTEM_SET_SYNCD_TX_DBG_COUNTER(
-                                            sys, msg_type, ICCP_DBG_CNTR_STS_ERR);
-                        return MCLAG_ERROR;
-                    }
-                    else
-                    {
-                        usleep(SYNCD_SEND_RETRY_INTERVAL_USEC);
-                        send_len = 0;
-                    }
-                }
-                else
-                {
-                    ICCPD_LOG_ERR("ICCP_FSM", "Send to mclagsyncd Non-blocking send() failed, msg_type: %d errno %d",
-                            msg_type, errno);
-                    SYSTEM_SET_SYNCD_TX_DBG_COUNTER(sys, msg_type, ICCP_DBG_CNTR_STS_ERR);
-                    return MCLAG_ERROR;
-                }
-            }
-            else if (send_len == 0)
-            {
-                ICCPD_LOG_ERR("ICCP_FSM", "Send to mclagsyncd Non-blocking send() failed socket closed msg_type: %d errno %d",
-                        msg_type, errno);
-                SYSTEM_SET_SYNCD_TX_DBG_COUNTER(
-                                    sys, msg_type, ICCP_DBG_CNTR_STS_ERR);
-                return MCLAG_ERROR;
-            }
-            msg_len -= send_len;
-            pos += send_len;
-        }
-        SYSTEM_SET_SYNCD_TX_DBG_COUNTER(sys, msg_type, ICCP_DBG_CNTR_STS_OK);
+    if (!sys->sync_tx_pollout && iccp_mclagsyncd_tx_flush(sys) != 0)
+    {
+        SYSTEM_SET_SYNCD_TX_DBG_COUNTER(sys, msg_type, ICCP_DBG_CNTR_STS_ERR);
+        return MCLAG_ERROR;
     }
+    SYSTEM_SET_SYNCD_TX_DBG_COUNTER(sys, msg_type, ICCP_DBG_CNTR_STS_OK);
 
-    return pos;
+    return msg_len;
+}
+
+/*****************************************
+* Tool : Send batched FDB entries to mclagsyncd
+*
+* Called at the end of each event loop iteration,
+* and before any other message to mclagsyncd.
+* ***************************************/
+void iccp_mclagsyncd_fdb_flush()
+{
+    struct IccpSyncdHDr *msg_hdr = (struct IccpSyncdHDr *)g_iccp_mlagsyncd_fdb_buf;
+    ssize_t rc;
 
+    if (msg_hdr->len <= sizeof(struct IccpSyncdHDr))
+        return;
+
+    rc = iccp_send_to_mclagsyncd(msg_hdr->type, g_iccp_mlagsyncd_fdb_buf, msg_hdr->len);
+    if (rc <= 0)
+    {
+        ICCPD_LOG_WARN(__FUNCTION__, "Send %d FDB entries to Mclagsyncd failed rc: %d",
+            (int)((msg_hdr->len - sizeof(struct IccpSyncdHDr)) / sizeof(struct mclag_fdb_info)), rc);
+    }
+    msg_hdr->len = 0;
+
+    return;
 }
 
 #if 0
@@ -507,19 +613,12 @@ void set_peerlink_mlag_port_learn(struct LocalInterface *lif, int enable)
     /*send msg*/
     if (sys->sync_fd)
     {
-        rc = write(sys->sync_fd,msg_buf, msg_hdr->len);
+        rc = iccp_send_to_mclagsyncd(msg_hdr->type, msg_buf, msg_hdr->len);
         if ((rc <= 0) || (rc != msg_hdr->len))
         {
-            SYSTEM_SET_SYNCD_TX_DBG_COUNTER(
-                sys, msg_hdr->type, ICCP_DBG_CNTR_STS_ERR);
             ICCPD_LOG_ERR(__FUNCTION__, "Failed to write for %s, rc %d",
                 lif->name, rc);
         }
-        else
-        {
-            SYSTEM_SET_SYNCD_TX_DBG_COUNTER(
-                sys, msg_hdr->type, ICCP_DBG_CNTR_STS_OK);
-        }
     }
     return;
 }
@@ -808,7 +907,7 @@ int mlacp_link_del_iccp_info(
     msg_hdr->len += (sizeof(mclag_sub_option_hdr_t) + sub_msg->op_len);
 
     if (sys->sync_fd)
-        rc = send(sys->sync_fd,msg_buf, msg_hdr->len, MSG_DONTWAIT);
+        rc = iccp_send_to_mclagsyncd(msg_hdr->type, msg_buf, msg_hdr->len);
 
     if ((rc <= 0) || (rc != msg_hdr->len))
     {
@@ -818,7 +917,6 @@ int mlacp_link_del_iccp_info(
     }
     else
     {
-        SYSTEM_SET_SYNCD_TX_DBG_COUNTER(sys, msg_hdr->type, ICCP_DBG_CNTR_STS_OK);
         ICCPD_LOG_DEBUG("ICCP_FSM", "Delete mlag %d", mlag_id);
         return 0;
     }
@@ -1168,18 +1266,11 @@ void update_peerlink_isolate_from_all_csm_lif(
     /*send msg*/
     if (sys->sync_fd)
     {
-        rc = write(sys->sync_fd,msg_buf, msg_hdr->len);
+        rc = iccp_send_to_mclagsyncd(msg_hdr->type, msg_buf, msg_hdr->len);
         if ((rc <= 0) || (rc != msg_hdr->len))
         {
-            SYSTEM_SET_SYNCD_TX_DBG_COUNTER(
-                sys, msg_hdr->type, ICCP_DBG_CNTR_STS_ERR);
             ICCPD_LOG_ERR(__FUNCTION__, "Failed to write, rc %d", rc);
         }
-        else
-        {
-            SYSTEM_SET_SYNCD_TX_DBG_COUNTER(
-                sys, msg_hdr->type, ICCP_DBG_CNTR_STS_OK);
-        }
     }
 
     return;
@@ -1602,10 +1693,9 @@ void update_stp_peer_link(struct CSM *csm,
 void iccp_send_fdb_entry_to_syncd( struct MACMsg* mac_msg, uint8_t mac_type, uint8_t oper)
 {
     struct IccpSyncdHDr * msg_hdr;
-    char *msg_buf = g_iccp_mlagsyncd_send_buf;
+    char *msg_buf = g_iccp_mlagsyncd_fdb_buf;
     struct System *sys;
     struct mclag_fdb_info * mac_info;
-    ssize_t rc;
     uint8_t null_mac[] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
 
     sys = system_get_instance();
@@ -1621,37 +1711,38 @@ void iccp_send_fdb_entry_to_syncd( struct MACMsg* mac_msg, uint8_t mac_type, uin
         return;
     }
 
-    memset(msg_buf, 0, ICCP_MLAGSYNCD_SEND_MSG_BUFFER_SIZE);
-
-    msg_hdr = (struct IccpSyncdHDr *)msg_buf;
-    msg_hdr->ver = ICCPD_TO_MCLAGSYNCD_HDR_VERSION;
-    msg_hdr->type = MCLAG_MSG_TYPE_SET_FDB;
-
-    /*mac msg */
-    mac_info = (struct mclag_fdb_info *)&msg_buf[sizeof(struct IccpSyncdHDr)];
-    mac_info->vid = mac_msg->vid;
-    memcpy(mac_info->port_name, mac_msg->ifname, MAX_L_PORT_NAME);
-    memcpy(mac_info->mac, mac_msg->mac_addr, ETHER_ADDR_LEN);
-    mac_info->type = mac_type;
-    mac_info->op_type = oper;
-    msg_hdr->len = sizeof(struct IccpSyncdHDr) + sizeof(struct mclag_fdb_info);
-
-    ICCPD_LOG_DEBUG("ICCP_FDB", "Send fdb to syncd: write mac msg vid : %d ; ifname %s ; mac %s fdb type %d ; op type %s",
-        mac_info->vid, mac_info->port_name, mac_addr_to_str(mac_info->mac), mac_info->type,
-        oper == MAC_SYNC_ADD ? "add" : "del");
-
-    /*send msg*/
     if (sys->sync_fd > 0 )
     {
-        rc = iccp_send_to_mclagsyncd(msg_hdr->type, msg_buf, msg_hdr->len);
-        if (rc <= 0)
+        msg_hdr = (struct IccpSyncdHDr *)msg_buf;
+
+        /* Send batch if full */
+        if (msg_hdr->len + sizeof(struct mclag_fdb_info) > ICCP_MLAGSYNCD_SEND_MSG_BUFFER_SIZE)
+            iccp_mclagsyncd_fdb_flush();
+
+        if (msg_hdr->len < sizeof(struct IccpSyncdHDr))
         {
-            ICCPD_LOG_WARN(__FUNCTION__, "Send to Mclagsyncd failed rc: %d",rc);
+            msg_hdr->ver = ICCPD_TO_MCLAGSYNCD_HDR_VERSION;
+            msg_hdr->type = MCLAG_MSG_TYPE_SET_FDB;
+            msg_hdr->len = sizeof(struct IccpSyncdHDr);
         }
+
+        /*mac msg, appended to batch */
+        mac_info = (struct mclag_fdb_info *)&msg_buf[msg_hdr->len];
+        memset(mac_info, 0, sizeof(struct mclag_fdb_info));
+        mac_info->vid = mac_msg->vid;
+        memcpy(mac_info->port_name, mac_msg->ifname, MAX_L_PORT_NAME);
+        memcpy(mac_info->mac, mac_msg->mac_addr, ETHER_ADDR_LEN);
+        mac_info->type = mac_type;
+        mac_info->op_type = oper;
+        msg_hdr->len += sizeof(struct mclag_fdb_info);
+
+        ICCPD_LOG_DEBUG("ICCP_FDB", "Send fdb to syncd: write mac msg vid : %d ; ifname %s ; mac %s fdb type %d ; op type %s",
+            mac_info->vid, mac_info->port_name, mac_addr_to_str(mac_info->mac), mac_info->type,
+            oper == MAC_SYNC_ADD ? "add" : "del");
     }
     else
     {
-        SYSTEM_SET_SYNCD_TX_DBG_COUNTER(sys, msg_hdr->type, ICCP_DBG_CNTR_STS_ERR);
+        SYSTEM_SET_SYNCD_TX_DBG_COUNTER(sys, MCLAG_MSG_TYPE_SET_FDB, ICCP_DBG_CNTR_STS_ERR);
         ICCPD_LOG_ERR(__FUNCTION__, "Invalid sync_fd Failed to write, fd %d", sys->sync_fd);
     }
 
@@ -1819,7 +1910,7 @@ static void update_l2_mac_state(struct CSM *csm,
                 // else free is taken care after sending the update to peer
                 if (!MAC_IN_MSG_LIST(&(MLACP(csm).mac_msg_list), mac_msg, tail))
                 {
-                    free(mac_msg);
+                    mlacp_mac_sync_release(csm, mac_msg);
                 }
             }
             else
@@ -1908,7 +1999,7 @@ static void update_l2_mac_state(struct CSM *csm,
                         mac_msg->op_type = MAC_SYNC_DEL;
                         if (!MAC_IN_MSG_LIST(&(MLACP(csm).mac_msg_list), mac_msg, tail))
                         {
-                            free(mac_msg);
+                            mlacp_mac_sync_release(csm, mac_msg);
                         }
                     }
                     else
@@ -2318,7 +2409,7 @@ void mlacp_peer_disconn_fdb_handler(struct CSM* csm)
                 // else free is taken care after sending the update to peer
                 if (!MAC_IN_MSG_LIST(&(MLACP(csm).mac_msg_list), mac_msg, tail))
                 {
-                    free(mac_msg);
+                    mlacp_mac_sync_release(csm, mac_msg);
                 }
             }
         }
@@ -2388,7 +2479,22 @@ void mlacp_peer_disconn_handler(struct CSM* csm)
         return;
     }
 
-    mlacp_peer_disconn_fdb_handler(csm);
+    /* Keep peer MACs for peer to resume MAC sync upon reconnect,
+     * aged if peer does not resume within the window
+     */
+    if (sys->mac_sync_window > 0 && MLACP(csm).mac_sync_peer_capable && MLACP(csm).peer_mac_epoch != 0)
+    {
+        time(&MLACP(csm).peer_mac_retain_time);
+        ++MLACP(csm).dbg_counters.mac_sync.retain_count;
+        ICCPD_LOG_NOTICE("ICCP_FDB", "ICCP session down: retain peer MACs upto generation %llu for %d secs",
+            (unsigned long long)MLACP(csm).peer_mac_gen, sys->mac_sync_window);
+    }
+    else
+    {
+        MLACP(csm).peer_mac_epoch = 0;
+        MLACP(csm).peer_mac_gen = 0;
+        mlacp_peer_disconn_fdb_handler(csm);
+    }
 
     /* Send ICCP down update to Mclagsyncd before clearing all port isolation
      * so that mclagsync can differentiate between session down and all remote
@@ -2505,7 +2611,7 @@ void mlacp_peerlink_down_handler(struct CSM* csm)
             // else free is taken care after sending the update to peer
             if (!MAC_IN_MSG_LIST(&(MLACP(csm).mac_msg_list), mac_msg, tail))
             {
-                free(mac_msg);
+                mlacp_mac_sync_release(csm, mac_msg);
             }
         }
     }
@@ -2641,6 +2747,8 @@ void syncd_info_close()
         close(sys->sync_fd);
         sys->sync_fd = -1;
     }
+    iccp_mclagsyncd_tx_reset(sys);
+    ((struct IccpSyncdHDr *)g_iccp_mlagsyncd_fdb_buf)->len = 0;
 
     return;
 }
@@ -2750,6 +2858,7 @@ void do_mac_update_from_syncd(uint8_t mac_addr[ETHER_ADDR_LEN], uint16_t vid, ch
     if(mac_info)
     {
         mac_exist = 1;
+        mac_info->restored = 0;
         ICCPD_LOG_DEBUG("ICCP_FDB", "MAC update from mclagsyncd: RB_FIND success for the MAC entry : %s, "
             " vid: %d , ifname %s, type: %d, age flag: %d", mac_addr_to_str(mac_info->mac_addr),
             mac_info->vid, mac_info->ifname, mac_info->fdb_type, mac_info->age_flag );
@@ -2976,7 +3085,7 @@ void do_mac_update_from_syncd(uint8_t mac_addr[ETHER_ADDR_LEN], uint16_t vid, ch
                     // else free is taken care after sending the update to peer
                     if (!MAC_IN_MSG_LIST(&(MLACP(csm).mac_msg_list), mac_info, tail))
                     {
-                        free(mac_info);
+                        mlacp_mac_sync_release(csm, mac_info);
                     }
                 }
                 else if (csm->peer_link_if && csm->peer_link_if->state != PORT_STATE_DOWN)
@@ -3013,7 +3122,7 @@ void do_mac_update_from_syncd(uint8_t mac_addr[ETHER_ADDR_LEN], uint16_t vid, ch
                 // else free is taken care after sending the update to peer
                 if (!MAC_IN_MSG_LIST(&(MLACP(csm).mac_msg_list), mac_info, tail))
                 {
-                    free(mac_info);
+                    mlacp_mac_sync_release(csm, mac_info);
                 }
             }
             else
@@ -3841,124 +3950,225 @@ void mclagd_ctl_handle_dump_state(int client_fd, int mclag_id)
     return;
 }
 
-void mclagd_ctl_handle_dump_arp(int client_fd, int mclag_id)
+/*****************************************
+* MAC/ARP/ND dump is streamed to mclagdctl in chunks, one chunk
+* each time the socket is writable, so that the event loop is
+* not held for the whole table.
+* ***************************************/
+#define MCLAGD_CTL_DUMP_MAX_SESSIONS 4
+#define MCLAGD_CTL_DUMP_CHUNK_SIZE   16384
+/* Dump of a client not reading for that long is dropped */
+#define MCLAGD_CTL_DUMP_IDLE_TIMEOUT 30
+
+struct mclagd_ctl_dump
+{
+    int fd;
+    int info_type;
+    struct iccp_dump_cursor cursor;
+    char tx_buf[MCLAGD_CTL_DUMP_CHUNK_SIZE];
+    int tx_start;
+    int tx_len;
+    time_t last_active;
+    LIST_ENTRY(mclagd_ctl_dump) next;
+};
+
+static LIST_HEAD(mclagd_ctl_dump_list, mclagd_ctl_dump) mclagd_ctl_dumps = LIST_HEAD_INITIALIZER(mclagd_ctl_dumps);
+static int mclagd_ctl_dump_num = 0;
+
+static void mclagd_ctl_dump_close(struct System *sys, struct mclagd_ctl_dump *dump)
+{
+    epoll_ctl(sys->epoll_fd, EPOLL_CTL_DEL, dump->fd, NULL);
+    close(dump->fd);
+    LIST_REMOVE(dump, next);
+    free(dump);
+    mclagd_ctl_dump_num--;
+}
+
+/* Fill next chunk; 0 if no entry found yet within scan limit */
+static int mclagd_ctl_dump_fill(struct mclagd_ctl_dump *dump)
 {
-    char * Pbuf = NULL;
-    char buf[512] = { 0 };
-    int arp_num = 0;
-    int ret = 0;
     struct mclagd_reply_hdr *hd = NULL;
+    char *data = dump->tx_buf + MCLAGD_REPLY_INFO_HDR;
+    int data_size = MCLAGD_CTL_DUMP_CHUNK_SIZE - MCLAGD_REPLY_INFO_HDR;
+    int entry_size = 0;
+    int num = 0;
+    int ret = 0;
     int len_tmp = 0;
 
-    ret = iccp_arp_dump(&Pbuf, &arp_num, mclag_id);
-    if (ret != EXEC_TYPE_SUCCESS)
+    switch (dump->info_type)
     {
-        len_tmp = sizeof(struct mclagd_reply_hdr);
-        memcpy(buf, &len_tmp, sizeof(int));
-        hd = (struct mclagd_reply_hdr *)(buf + sizeof(int));
-        hd->exec_result = ret;
-        hd->info_type = INFO_TYPE_DUMP_ARP;
-        hd->data_len = 0;
-        mclagd_ctl_sock_write(client_fd, buf, MCLAGD_REPLY_INFO_HDR);
+        case INFO_TYPE_DUMP_ARP:
+            entry_size = sizeof(struct mclagd_arp_msg);
+            ret = iccp_arp_dump(&dump->cursor, data, data_size / entry_size, &num);
+            break;
 
-        if (Pbuf)
-            free(Pbuf);
+        case INFO_TYPE_DUMP_NDISC:
+            entry_size = sizeof(struct mclagd_ndisc_msg);
+            ret = iccp_ndisc_dump(&dump->cursor, data, data_size / entry_size, &num);
+            break;
 
-        return;
+        default:
+            entry_size = sizeof(struct mclagd_mac_msg);
+            ret = iccp_mac_dump(&dump->cursor, data, data_size / entry_size, &num);
+            break;
     }
 
-    hd = (struct mclagd_reply_hdr *)(Pbuf + sizeof(int));
-    hd->exec_result = EXEC_TYPE_SUCCESS;
-    hd->info_type = INFO_TYPE_DUMP_ARP;
-    hd->data_len = arp_num * sizeof(struct mclagd_arp_msg);
-    len_tmp = (hd->data_len + sizeof(struct mclagd_reply_hdr));
-    memcpy(Pbuf, &len_tmp, sizeof(int));
-    mclagd_ctl_sock_write(client_fd, Pbuf, MCLAGD_REPLY_INFO_HDR + hd->data_len);
+    if (ret != EXEC_TYPE_SUCCESS)
+        dump->cursor.done = 1;
+    else if (num == 0 && !dump->cursor.done)
+        return 0;
 
-    if (Pbuf)
-        free(Pbuf);
+    hd = (struct mclagd_reply_hdr *)(dump->tx_buf + sizeof(int));
+    hd->info_type = dump->info_type;
+    hd->data_len = num * entry_size;
+    if (ret != EXEC_TYPE_SUCCESS)
+        hd->exec_result = ret;
+    else
+        hd->exec_result = dump->cursor.done ? EXEC_TYPE_SUCCESS : EXEC_TYPE_CONTINUE;
 
-    return;
+    len_tmp = hd->data_len + sizeof(struct mclagd_reply_hdr);
+    memcpy(dump->tx_buf, &len_tmp, sizeof(int));
+    dump->tx_start = 0;
+    dump->tx_len = MCLAGD_REPLY_INFO_HDR + hd->data_len;
+
+    return dump->tx_len;
 }
 
-void mclagd_ctl_handle_dump_ndisc(int client_fd, int mclag_id)
+static int mclagd_ctl_dump_start(int client_fd, struct mclagdctl_req_hdr *req)
 {
-    char *Pbuf = NULL;
-    char buf[512] = { 0 };
-    int ndisc_num = 0;
-    int ret = 0;
+    struct System *sys = NULL;
+    struct mclagd_ctl_dump *dump = NULL;
     struct mclagd_reply_hdr *hd = NULL;
+    struct epoll_event event;
+    char buf[512] = { 0 };
     int len_tmp = 0;
+    int flags;
+
+    if ((sys = system_get_instance()) != NULL && mclagd_ctl_dump_num < MCLAGD_CTL_DUMP_MAX_SESSIONS)
+        dump = (struct mclagd_ctl_dump *)calloc(1, sizeof(struct mclagd_ctl_dump));
+
+    if (dump)
+    {
+        dump->fd = client_fd;
+        dump->info_type = req->info_type;
+        dump->last_active = time(NULL);
+        dump->cursor.mclag_id = req->mclag_id;
+        memcpy(&dump->cursor.filter, &req->filter, sizeof(struct mclagdctl_dump_filter));
+        dump->cursor.filter.ifname[MCLAGDCTL_MAX_L_PORT_NANE - 1] = '\0';
+        if (dump->cursor.filter.mac_prefix_len > ETHER_ADDR_LEN)
+            dump->cursor.filter.mac_prefix_len = ETHER_ADDR_LEN;
+
+        flags = fcntl(client_fd, F_GETFL, 0);
+        event.data.fd = client_fd;
+        event.events = EPOLLOUT;
+        if (flags != -1 && fcntl(client_fd, F_SETFL, flags | O_NONBLOCK) != -1
+            && epoll_ctl(sys->epoll_fd, EPOLL_CTL_ADD, client_fd, &event) == 0)
+        {
+            LIST_INSERT_HEAD(&mclagd_ctl_dumps, dump, next);
+            mclagd_ctl_dump_num++;
+            return 1;
+        }
 
-    ret = iccp_ndisc_dump(&Pbuf, &ndisc_num, mclag_id);
-    if (ret != EXEC_TYPE_SUCCESS)
-    {
-        len_tmp = sizeof(struct mclagd_reply_hdr);
-        memcpy(buf, &len_tmp, sizeof(int));
-        hd = (struct mclagd_reply_hdr *)(buf + sizeof(int));
-        hd->exec_result = ret;
-        hd->info_type = INFO_TYPE_DUMP_NDISC;
-        hd->data_len = 0;
-        mclagd_ctl_sock_write(client_fd, buf, MCLAGD_REPLY_INFO_HDR);
-
-        if (Pbuf)
-            free(Pbuf);
-
-        return;
+        if (flags != -1)
+            fcntl(client_fd, F_SETFL, flags);
+        free(dump);
     }
 
-    hd = (struct mclagd_reply_hdr *)(Pbuf + sizeof(int));
-    hd->exec_result = EXEC_TYPE_SUCCESS;
-    hd->info_type = INFO_TYPE_DUMP_NDISC;
-    hd->data_len = ndisc_num * sizeof(struct mclagd_ndisc_msg);
-    len_tmp = (hd->data_len + sizeof(struct mclagd_reply_hdr));
-    memcpy(Pbuf, &len_tmp, sizeof(int));
-    mclagd_ctl_sock_write(client_fd, Pbuf, MCLAGD_REPLY_INFO_HDR + hd->data_len);
-
-    if (Pbuf)
-        free(Pbuf);
+    ICCPD_LOG_WARN(__FUNCTION__, "Failed to start %s dump, %d dumps in progress",
+                   mclagd_ctl_cmd_str(req->info_type), mclagd_ctl_dump_num);
+    len_tmp = sizeof(struct mclagd_reply_hdr);
+    memcpy(buf, &len_tmp, sizeof(int));
+    hd = (struct mclagd_reply_hdr *)(buf + sizeof(int));
+    hd->exec_result = EXEC_TYPE_FAILED;
+    hd->info_type = req->info_type;
+    hd->data_len = 0;
+    mclagd_ctl_sock_write(client_fd, buf, MCLAGD_REPLY_INFO_HDR);
 
-    return;
+    return 0;
 }
 
-void mclagd_ctl_handle_dump_mac(int client_fd, int mclag_id)
+/*****************************************
+* Send next chunk of dump on fd, once it is writable.
+* Returns MCLAG_ERROR if fd is not of a dump.
+* ***************************************/
+int mclagd_ctl_dump_handler(struct System *sys, int fd, uint32_t events)
 {
-    char * Pbuf = NULL;
-    char buf[512] = { 0 };
-    int mac_num = 0;
-    int ret = 0;
-    struct mclagd_reply_hdr *hd = NULL;
-    int len_tmp = 0;
+    struct mclagd_ctl_dump *dump = NULL;
+    ssize_t send_len = 0;
 
-    ret = iccp_mac_dump(&Pbuf, &mac_num, mclag_id);
-    if (ret != EXEC_TYPE_SUCCESS)
+    LIST_FOREACH(dump, &mclagd_ctl_dumps, next)
     {
-        len_tmp = sizeof(struct mclagd_reply_hdr);
-        memcpy(buf, &len_tmp, sizeof(int));
-        hd = (struct mclagd_reply_hdr *)(buf + sizeof(int));
-        hd->exec_result = ret;
-        hd->info_type = INFO_TYPE_DUMP_MAC;
-        hd->data_len = 0;
-        mclagd_ctl_sock_write(client_fd, buf, MCLAGD_REPLY_INFO_HDR);
+        if (dump->fd == fd)
+            break;
+    }
 
-        if (Pbuf)
-            free(Pbuf);
+    if (!dump)
+        return MCLAG_ERROR;
 
-        return;
+    /*fd is writable: client is reading*/
+    dump->last_active = time(NULL);
+
+    if (events & (EPOLLERR | EPOLLHUP))
+    {
+        mclagd_ctl_dump_close(sys, dump);
+        return 0;
     }
 
-    hd = (struct mclagd_reply_hdr *)(Pbuf + sizeof(int));
-    hd->exec_result = EXEC_TYPE_SUCCESS;
-    hd->info_type = INFO_TYPE_DUMP_MAC;
-    hd->data_len = mac_num * sizeof(struct mclagd_mac_msg);
+    if (dump->tx_start == dump->tx_len && mclagd_ctl_dump_fill(dump) == 0)
+        return 0;
 
-    len_tmp = (hd->data_len + sizeof(struct mclagd_reply_hdr));
-    memcpy(Pbuf, &len_tmp, sizeof(int));
+    while (dump->tx_start < dump->tx_len)
+    {
+        send_len = send(fd, dump->tx_buf + dump->tx_start, dump->tx_len - dump->tx_start,
+                        MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (send_len == -1)
+        {
+            if (errno == EINTR)
+                continue;
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+                return 0;
 
-    mclagd_ctl_sock_write(client_fd, Pbuf, MCLAGD_REPLY_INFO_HDR + hd->data_len);
+            ICCPD_LOG_WARN(__FUNCTION__, "Failed to send %s dump, errno %d",
+                           mclagd_ctl_cmd_str(dump->info_type), errno);
+            mclagd_ctl_dump_close(sys, dump);
+            return 0;
+        }
+        dump->tx_start += send_len;
+    }
 
-    if (Pbuf)
-        free(Pbuf);
+    if (dump->cursor.done)
+        mclagd_ctl_dump_close(sys, dump);
+
+    return 0;
+}
+
+/*****************************************
+* Drop dumps of clients which stopped reading, so that they
+* do not hold the dump sessions.
+* ***************************************/
+void mclagd_ctl_dump_expire()
+{
+    struct System *sys = NULL;
+    struct mclagd_ctl_dump *dump = NULL;
+    struct mclagd_ctl_dump *dump_next = NULL;
+    time_t now;
+
+    if (mclagd_ctl_dump_num == 0 || (sys = system_get_instance()) == NULL)
+        return;
+
+    now = time(NULL);
+    dump = LIST_FIRST(&mclagd_ctl_dumps);
+    while (dump)
+    {
+        dump_next = LIST_NEXT(dump, next);
+        if ((now - dump->last_active) > MCLAGD_CTL_DUMP_IDLE_TIMEOUT)
+        {
+            ICCPD_LOG_WARN(__FUNCTION__, "Drop idle %s dump, %d entries sent",
+                           mclagd_ctl_cmd_str(dump->info_type), dump->cursor.count);
+            mclagd_ctl_dump_close(sys, dump);
+        }
+        dump = dump_next;
+    }
 
     return;
 }
@@ -4139,6 +4349,7 @@ void mclagd_ctl_handle_config_loglevel(int client_fd, int log_level)
     return;
 }
 
+/* Returns 1 if client_fd is kept open to stream a dump */
 int mclagd_ctl_interactive_process(int client_fd)
 {
     char buf[512] = { 0 };
@@ -4165,16 +4376,9 @@ int mclagd_ctl_interactive_process(int client_fd)
             break;
 
         case INFO_TYPE_DUMP_ARP:
-            mclagd_ctl_handle_dump_arp(client_fd, req->mclag_id);
-            break;
-
         case INFO_TYPE_DUMP_NDISC:
-            mclagd_ctl_handle_dump_ndisc(client_fd, req->mclag_id);
-            break;
-
         case INFO_TYPE_DUMP_MAC:
-            mclagd_ctl_handle_dump_mac(client_fd, req->mclag_id);
-            break;
+            return mclagd_ctl_dump_start(client_fd, req);
 
         case INFO_TYPE_DUMP_LOCAL_PORTLIST:
             mclagd_ctl_handle_dump_local_portlist(client_fd, req->mclag_id);
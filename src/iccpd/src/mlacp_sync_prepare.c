@@ -25,6 +25,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <endian.h>
 
 #include <sys/queue.h>
 
@@ -723,6 +724,56 @@ int mlacp_prepare_for_if_up_ack(
     return msg_len;
 }
 
+/*****************************************
+* Prepare MAC sync mark or ack message
+*
+* ***************************************/
+int mlacp_prepare_for_mac_sync(
+    struct CSM        *csm,
+    char              *buf,
+    size_t            max_buf_size,
+    uint16_t          tlv_type,
+    uint8_t           flags,
+    uint32_t          epoch,
+    uint64_t          gen)
+{
+    ICCHdr* icc_hdr = NULL;
+    struct mLACPMACSyncTLV* tlv = NULL;
+    size_t msg_len = sizeof(ICCHdr) + sizeof(struct mLACPMACSyncTLV);
+
+    if (csm == NULL)
+        return MCLAG_ERROR;
+
+    if (buf == NULL)
+        return MCLAG_ERROR;
+
+    if (msg_len > max_buf_size)
+        return MCLAG_ERROR;
+
+    memset(buf, 0, max_buf_size);
+
+    icc_hdr = (ICCHdr*)buf;
+    tlv = (struct mLACPMACSyncTLV*)&buf[sizeof(ICCHdr)];
+
+    /* ICC header */
+    mlacp_fill_icc_header(csm, icc_hdr, msg_len);
+
+    /* MAC sync TLV */
+    tlv->icc_parameter.u_bit = 0;
+    tlv->icc_parameter.f_bit = 0;
+    tlv->icc_parameter.type = htons(tlv_type);
+
+    tlv->icc_parameter.len = htons(sizeof(struct mLACPMACSyncTLV) - sizeof(ICCParameter));
+    tlv->flags = flags;
+    tlv->epoch = htonl(epoch);
+    tlv->gen = htobe64(gen);
+
+    ICCPD_LOG_DEBUG("ICCP_FDB", "TX %s: flags 0x%x, epoch 0x%x, gen %llu",
+        (tlv_type == TLV_T_MLACP_MAC_SYNC_MARK) ? "mac_sync_mark" : "mac_sync_ack",
+        flags, epoch, (unsigned long long)gen);
+    return msg_len;
+}
+
 /*****************************************
 * Tool : Prepare ICC Header
 *
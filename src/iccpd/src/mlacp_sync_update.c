@@ -132,7 +132,7 @@ int mlacp_fsm_update_Agg_conf(struct CSM* csm, mLACPAggConfigTLV* portconf)
     }
 
     pif->po_id = ntohs(portconf->agg_id);
-    memcpy(pif->name, portconf->agg_name, portconf->agg_name_len);
+    peer_if_set_name(pif, portconf->agg_name, portconf->agg_name_len);
     memcpy(pif->mac_addr, portconf->mac_addr, ETHER_ADDR_LEN);
 
     po_active = (pif->state == PORT_STATE_UP);
@@ -261,6 +261,7 @@ int mlacp_fsm_update_mac_entry_from_peer( struct CSM* csm, struct mLACPMACData *
 
         if (MacData->type == MAC_SYNC_ADD)
         {
+            mac_msg->restored = 0;
             mac_msg->age_flag &= ~MAC_AGE_PEER;
 
             if (from_mclag_intf && mac_msg->pending_local_del)
@@ -361,7 +362,7 @@ int mlacp_fsm_update_mac_entry_from_peer( struct CSM* csm, struct mLACPMACData *
                             // else free is taken care after sending the update to peer
                             if (!MAC_IN_MSG_LIST(&(MLACP(csm).mac_msg_list), mac_msg, tail))
                             {
-                                free(mac_msg);
+                                mlacp_mac_sync_release(csm, mac_msg);
                             }
 
                             ICCPD_LOG_ERR(__FUNCTION__, "Ignore Recv MAC ADD "
@@ -467,7 +468,7 @@ int mlacp_fsm_update_mac_entry_from_peer( struct CSM* csm, struct mLACPMACData *
             // else free is taken care after sending the update to peer
             if (!MAC_IN_MSG_LIST(&(MLACP(csm).mac_msg_list), mac_msg, tail))
             {
-                free(mac_msg);
+                mlacp_mac_sync_release(csm, mac_msg);
             }
         }
         else
@@ -568,6 +569,102 @@ int mlacp_fsm_update_mac_info_from_peer(struct CSM* csm, struct mLACPMACInfoTLV*
     }
 }
 
+/*****************************************
+ * Tool : ARP/ND list index by IP address & interface
+ *
+ ****************************************/
+static struct NeighIndex* mlacp_neigh_index_find(struct neigh_rb_tree* tree, char* ifname, uint32_t* addr)
+{
+    struct NeighIndex neigh_find;
+    struct NeighIndex* neigh = NULL;
+
+    memset(&neigh_find, 0, sizeof(neigh_find));
+    memcpy(neigh_find.addr, addr, sizeof(neigh_find.addr));
+    if (ifname)
+    {
+        snprintf(neigh_find.ifname, sizeof(neigh_find.ifname), "%s", ifname);
+        return RB_FIND(neigh_rb_tree, tree, &neigh_find);
+    }
+
+    /* Any interface: the first entry of the address */
+    neigh = RB_NFIND(neigh_rb_tree, tree, &neigh_find);
+    if (neigh && memcmp(neigh->addr, addr, sizeof(neigh->addr)) != 0)
+        neigh = NULL;
+
+    return neigh;
+}
+
+static void mlacp_neigh_index_add(struct neigh_rb_tree* tree, char* ifname, uint32_t* addr, struct Msg* msg)
+{
+    struct NeighIndex* neigh = NULL;
+
+    neigh = (struct NeighIndex*)calloc(1, sizeof(struct NeighIndex));
+    if (!neigh)
+    {
+        ICCPD_LOG_WARN(__FUNCTION__, "Failed to allocate neighbor index entry");
+        return;
+    }
+    memcpy(neigh->addr, addr, sizeof(neigh->addr));
+    snprintf(neigh->ifname, sizeof(neigh->ifname), "%s", ifname);
+    neigh->msg = msg;
+
+    /* Keep the first entry indexed, as scan of list would find it */
+    if (RB_INSERT(neigh_rb_tree, tree, neigh) != NULL)
+    {
+        ICCPD_LOG_WARN(__FUNCTION__, "Duplicate neighbor entry in list");
+        free(neigh);
+    }
+}
+
+static void mlacp_neigh_index_del(struct neigh_rb_tree* tree, char* ifname, uint32_t* addr, struct Msg* msg)
+{
+    struct NeighIndex* neigh = NULL;
+
+    neigh = mlacp_neigh_index_find(tree, ifname, addr);
+    if (neigh && neigh->msg == msg)
+    {
+        RB_REMOVE(neigh_rb_tree, tree, neigh);
+        free(neigh);
+    }
+}
+
+static void mlacp_arp_index_addr(struct ARPMsg* arp_msg, uint32_t* addr)
+{
+    addr[0] = arp_msg->ipv4_addr;
+    addr[1] = addr[2] = addr[3] = 0;
+}
+
+/*****************************************
+ * Tool : Find ARP Info in ARP list
+ * ifname NULL finds the address on any interface
+ ****************************************/
+struct Msg* mlacp_find_arp(struct CSM* csm, char* ifname, uint32_t ipv4_addr)
+{
+    struct NeighIndex* neigh = NULL;
+    uint32_t addr[4] = { ipv4_addr, 0, 0, 0 };
+
+    if (!csm)
+        return NULL;
+
+    neigh = mlacp_neigh_index_find(&MLACP(csm).arp_rb, ifname, addr);
+    return neigh ? neigh->msg : NULL;
+}
+
+/*****************************************
+ * Tool : Find Ndisc Info in ndisc list
+ * ifname NULL finds the address on any interface
+ ****************************************/
+struct Msg* mlacp_find_ndisc(struct CSM* csm, char* ifname, uint32_t* ipv6_addr)
+{
+    struct NeighIndex* neigh = NULL;
+
+    if (!csm)
+        return NULL;
+
+    neigh = mlacp_neigh_index_find(&MLACP(csm).ndisc_rb, ifname, ipv6_addr);
+    return neigh ? neigh->msg : NULL;
+}
+
 /*****************************************
  * Tool : Add ARP Info into ARP list
  *
@@ -575,6 +672,7 @@ int mlacp_fsm_update_mac_info_from_peer(struct CSM* csm, struct mLACPMACInfoTLV*
 void mlacp_enqueue_arp(struct CSM* csm, struct Msg* msg)
 {
     struct ARPMsg *arp_msg = NULL;
+    uint32_t addr[4];
 
     if (!csm)
     {
@@ -589,6 +687,8 @@ void mlacp_enqueue_arp(struct CSM* csm, struct Msg* msg)
     if (arp_msg->op_type != NEIGH_SYNC_DEL)
     {
         TAILQ_INSERT_TAIL(&(MLACP(csm).arp_list), msg, tail);
+        mlacp_arp_index_addr(arp_msg, addr);
+        mlacp_neigh_index_add(&MLACP(csm).arp_rb, arp_msg->ifname, addr, msg);
     }
 
     return;
@@ -615,11 +715,54 @@ void mlacp_enqueue_ndisc(struct CSM *csm, struct Msg *msg)
     if (ndisc_msg->op_type != NEIGH_SYNC_DEL)
     {
         TAILQ_INSERT_TAIL(&(MLACP(csm).ndisc_list), msg, tail);
+        mlacp_neigh_index_add(&MLACP(csm).ndisc_rb, ndisc_msg->ifname, ndisc_msg->ipv6_addr, msg);
     }
 
     return;
 }
 
+/*****************************************
+ * Tool : Remove & free ARP Info from ARP list
+ *
+ ****************************************/
+void mlacp_dequeue_arp(struct CSM* csm, struct Msg* msg)
+{
+    struct ARPMsg *arp_msg = NULL;
+    uint32_t addr[4];
+
+    if (!csm || !msg)
+        return;
+
+    arp_msg = (struct ARPMsg*)msg->buf;
+    mlacp_arp_index_addr(arp_msg, addr);
+    mlacp_neigh_index_del(&MLACP(csm).arp_rb, arp_msg->ifname, addr, msg);
+    TAILQ_REMOVE(&(MLACP(csm).arp_list), msg, tail);
+    free(msg->buf);
+    free(msg);
+
+    return;
+}
+
+/*****************************************
+ * Tool : Remove & free Ndisc Info from ndisc list
+ *
+ ****************************************/
+void mlacp_dequeue_ndisc(struct CSM *csm, struct Msg *msg)
+{
+    struct NDISCMsg *ndisc_msg = NULL;
+
+    if (!csm || !msg)
+        return;
+
+    ndisc_msg = (struct NDISCMsg *)msg->buf;
+    mlacp_neigh_index_del(&MLACP(csm).ndisc_rb, ndisc_msg->ifname, ndisc_msg->ipv6_addr, msg);
+    TAILQ_REMOVE(&(MLACP(csm).ndisc_list), msg, tail);
+    free(msg->buf);
+    free(msg);
+
+    return;
+}
+
 /*****************************************
 * ARP-Info Update
 * ***************************************/
@@ -841,24 +984,20 @@ int mlacp_fsm_update_arp_entry(struct CSM* csm, struct ARPMsg *arp_entry)
     }
 
     /* update ARP list*/
-    TAILQ_FOREACH(msg, &(MLACP(csm).arp_list), tail)
+    msg = mlacp_find_arp(csm, arp_entry->ifname, arp_entry->ipv4_addr);
+    if (msg)
     {
+        msg->restored = 0;
         arp_msg = (struct ARPMsg*)msg->buf;
-        if (arp_msg->ipv4_addr == arp_entry->ipv4_addr)
-        {
-            /*arp_msg->op_type = tlv->type;*/
-            sprintf(arp_msg->ifname, "%s", arp_entry->ifname);
-            memcpy(arp_msg->mac_addr, arp_entry->mac_addr, ETHER_ADDR_LEN);
-            break;
-        }
+        /*arp_msg->op_type = tlv->type;*/
+        sprintf(arp_msg->ifname, "%s", arp_entry->ifname);
+        memcpy(arp_msg->mac_addr, arp_entry->mac_addr, ETHER_ADDR_LEN);
     }
 
     /* delete/add ARP list*/
     if (msg && arp_entry->op_type == NEIGH_SYNC_DEL)
     {
-        TAILQ_REMOVE(&(MLACP(csm).arp_list), msg, tail);
-        free(msg->buf);
-        free(msg);
+        mlacp_dequeue_arp(csm, msg);
         /*ICCPD_LOG_INFO(__FUNCTION__, "Del arp queue successfully");*/
     }
     else if (!msg && arp_entry->op_type == NEIGH_SYNC_ADD)
@@ -1163,24 +1302,20 @@ int mlacp_fsm_update_ndisc_entry(struct CSM *csm, struct NDISCMsg *ndisc_entry)
     }
 
     /* update NDISC list */
-    TAILQ_FOREACH(msg, &(MLACP(csm).ndisc_list), tail)
+    msg = mlacp_find_ndisc(csm, ndisc_entry->ifname, ndisc_entry->ipv6_addr);
+    if (msg)
     {
+        msg->restored = 0;
         ndisc_msg = (struct NDISCMsg *)msg->buf;
-        if (memcmp((char *)ndisc_msg->ipv6_addr, (char *)ndisc_entry->ipv6_addr, 16) == 0)
-        {
-            /* ndisc_msg->op_type = tlv->type; */
-            sprintf(ndisc_msg->ifname, "%s", ndisc_entry->ifname);
-            memcpy(ndisc_msg->mac_addr, ndisc_entry->mac_addr, ETHER_ADDR_LEN);
-            break;
-        }
+        /* ndisc_msg->op_type = tlv->type; */
+        sprintf(ndisc_msg->ifname, "%s", ndisc_entry->ifname);
+        memcpy(ndisc_msg->mac_addr, ndisc_entry->mac_addr, ETHER_ADDR_LEN);
     }
 
     /* delete/add NDISC list */
     if (msg && ndisc_entry->op_type == NEIGH_SYNC_DEL)
     {
-        TAILQ_REMOVE(&(MLACP(csm).ndisc_list), msg, tail);
-        free(msg->buf);
-        free(msg);
+        mlacp_dequeue_ndisc(csm, msg);
         /* ICCPD_LOG_INFO(__FUNCTION__, "Del ndisc queue successfully"); */
     }
     else if (!msg && ndisc_entry->op_type == NEIGH_SYNC_ADD)
@@ -46,6 +46,156 @@ static int vlan_node_compare(const struct VLAN_ID *p_vlan_node1, const struct VL
 }
 RB_GENERATE(vlan_rb_tree, VLAN_ID, vlan_entry, vlan_node_compare);
 
+static int lif_name_compare(const struct LocalInterface *lif1, const struct LocalInterface *lif2)
+{
+    return strcmp(lif1->name, lif2->name);
+}
+RB_GENERATE(lif_name_rb_tree, LocalInterface, name_entry_rb, lif_name_compare);
+
+static int lif_ifindex_compare(const struct LocalInterface *lif1, const struct LocalInterface *lif2)
+{
+    if (lif1->ifindex < lif2->ifindex)
+        return -1;
+
+    if (lif1->ifindex > lif2->ifindex)
+        return 1;
+
+    return 0;
+}
+RB_GENERATE(lif_ifindex_rb_tree, LocalInterface, ifindex_entry_rb, lif_ifindex_compare);
+
+static int lif_po_compare(const struct LocalInterface *lif1, const struct LocalInterface *lif2)
+{
+    if (lif1->po_id < lif2->po_id)
+        return -1;
+
+    if (lif1->po_id > lif2->po_id)
+        return 1;
+
+    return 0;
+}
+RB_GENERATE(lif_po_rb_tree, LocalInterface, po_entry_rb, lif_po_compare);
+
+static int pif_name_compare(const struct PeerInterface *pif1, const struct PeerInterface *pif2)
+{
+    return strcmp(pif1->name, pif2->name);
+}
+RB_GENERATE(pif_name_rb_tree, PeerInterface, name_entry_rb, pif_name_compare);
+
+/* Index newest lif of a key, same as lookup of lif_list (inserted at head) would return */
+#define LIF_INDEX_INSERT(name, head, lif) do {                 \
+    struct LocalInterface* lif_old = RB_INSERT(name, head, lif); \
+    if (lif_old) {                                             \
+        RB_REMOVE(name, head, lif_old);                        \
+        RB_INSERT(name, head, lif);                            \
+    }                                                          \
+} while (0)
+
+static int local_if_is_indexed_by_ifindex(struct LocalInterface* lif)
+{
+    return lif->ifindex > 0;
+}
+
+static int local_if_is_indexed_by_po_id(struct LocalInterface* lif)
+{
+    return lif->type == IF_T_PORT_CHANNEL && lif->po_id >= 0;
+}
+
+static void local_if_index_add(struct System* sys, struct LocalInterface* lif)
+{
+    LIF_INDEX_INSERT(lif_name_rb_tree, &(sys->lif_name_rb), lif);
+    if (local_if_is_indexed_by_ifindex(lif))
+        LIF_INDEX_INSERT(lif_ifindex_rb_tree, &(sys->lif_ifindex_rb), lif);
+    if (local_if_is_indexed_by_po_id(lif))
+        LIF_INDEX_INSERT(lif_po_rb_tree, &(sys->lif_po_rb), lif);
+
+    return;
+}
+
+/* Index lif by its new ifindex, unless a lif ahead of it in lif_list has the same one */
+static void local_if_index_add_ifindex(struct System* sys, struct LocalInterface* lif)
+{
+    struct LocalInterface* lif_old = NULL;
+    struct LocalInterface* lif_other = NULL;
+
+    lif_old = RB_INSERT(lif_ifindex_rb_tree, &(sys->lif_ifindex_rb), lif);
+    if (!lif_old)
+        return;
+
+    LIST_FOREACH(lif_other, &(sys->lif_list), system_next)
+    {
+        if (lif_other == lif_old)
+            break;
+
+        if (lif_other == lif)
+        {
+            RB_REMOVE(lif_ifindex_rb_tree, &(sys->lif_ifindex_rb), lif_old);
+            RB_INSERT(lif_ifindex_rb_tree, &(sys->lif_ifindex_rb), lif);
+            break;
+        }
+    }
+
+    return;
+}
+
+/* lif is removed from lif_list already. Another lif of same key, if any, takes its place */
+static void local_if_index_del_ifindex(struct System* sys, struct LocalInterface* lif)
+{
+    struct LocalInterface* lif_other = NULL;
+
+    if (!local_if_is_indexed_by_ifindex(lif)
+        || RB_FIND(lif_ifindex_rb_tree, &(sys->lif_ifindex_rb), lif) != lif)
+        return;
+
+    RB_REMOVE(lif_ifindex_rb_tree, &(sys->lif_ifindex_rb), lif);
+    LIST_FOREACH(lif_other, &(sys->lif_list), system_next)
+    {
+        if (lif_other != lif && lif_other->ifindex == lif->ifindex)
+        {
+            RB_INSERT(lif_ifindex_rb_tree, &(sys->lif_ifindex_rb), lif_other);
+            break;
+        }
+    }
+
+    return;
+}
+
+static void local_if_index_del(struct System* sys, struct LocalInterface* lif)
+{
+    struct LocalInterface* lif_other = NULL;
+
+    if (RB_FIND(lif_name_rb_tree, &(sys->lif_name_rb), lif) == lif)
+    {
+        RB_REMOVE(lif_name_rb_tree, &(sys->lif_name_rb), lif);
+        LIST_FOREACH(lif_other, &(sys->lif_list), system_next)
+        {
+            if (strcmp(lif_other->name, lif->name) == 0)
+            {
+                RB_INSERT(lif_name_rb_tree, &(sys->lif_name_rb), lif_other);
+                break;
+            }
+        }
+    }
+
+    local_if_index_del_ifindex(sys, lif);
+
+    if (local_if_is_indexed_by_po_id(lif)
+        && RB_FIND(lif_po_rb_tree, &(sys->lif_po_rb), lif) == lif)
+    {
+        RB_REMOVE(lif_po_rb_tree, &(sys->lif_po_rb), lif);
+        LIST_FOREACH(lif_other, &(sys->lif_list), system_next)
+        {
+            if (local_if_is_indexed_by_po_id(lif_other) && lif_other->po_id == lif->po_id)
+            {
+                RB_INSERT(lif_po_rb_tree, &(sys->lif_po_rb), lif_other);
+                break;
+            }
+        }
+    }
+
+    return;
+}
+
 void local_if_init(struct LocalInterface* local_if)
 {
     if (local_if == NULL)
@@ -165,6 +315,7 @@ struct LocalInterface* local_if_create(int ifindex, char* ifname, int type, uint
                    local_if->mac_addr[3], local_if->mac_addr[4], local_if->mac_addr[5], local_if->state ? "down" : "up");
 
     LIST_INSERT_HEAD(&(sys->lif_list), local_if, system_next);
+    local_if_index_add(sys, local_if);
 
     //if there is pending vlan membership for this interface move to system lif
     move_pending_vlan_mbr_to_lif(sys, local_if);
@@ -194,7 +345,7 @@ struct LocalInterface* local_if_create(int ifindex, char* ifname, int type, uint
 struct LocalInterface* local_if_find_by_name(const char* ifname)
 {
     struct System* sys = NULL;
-    struct LocalInterface* local_if = NULL;
+    struct LocalInterface lif_key;
 
     if (!ifname)
         return NULL;
@@ -202,23 +353,28 @@ struct LocalInterface* local_if_find_by_name(const char* ifname)
     if (!(sys = system_get_instance()))
         return NULL;
 
-    LIST_FOREACH(local_if, &(sys->lif_list), system_next)
-    {
-        if (strcmp(local_if->name, ifname) == 0)
-            return local_if;
-    }
+    snprintf(lif_key.name, MAX_L_PORT_NAME, "%s", ifname);
+    /* Name longer than any lif name, would not match */
+    if (strcmp(lif_key.name, ifname) != 0)
+        return NULL;
 
-    return NULL;
+    return RB_FIND(lif_name_rb_tree, &(sys->lif_name_rb), &lif_key);
 }
 
 struct LocalInterface* local_if_find_by_ifindex(int ifindex)
 {
     struct System* sys = NULL;
     struct LocalInterface* local_if = NULL;
+    struct LocalInterface lif_key;
 
     if ((sys = system_get_instance()) == NULL)
         return NULL;
 
+    lif_key.ifindex = ifindex;
+    if (local_if_is_indexed_by_ifindex(&lif_key))
+        return RB_FIND(lif_ifindex_rb_tree, &(sys->lif_ifindex_rb), &lif_key);
+
+    /* Not indexed, e.g. VLAN interface before its ifindex is known */
     LIST_FOREACH(local_if, &(sys->lif_list), system_next)
     {
         if (local_if->ifindex == ifindex)
@@ -231,18 +387,31 @@ struct LocalInterface* local_if_find_by_ifindex(int ifindex)
 struct LocalInterface* local_if_find_by_po_id(int po_id)
 {
     struct System* sys = NULL;
-    struct LocalInterface* local_if = NULL;
+    struct LocalInterface lif_key;
 
     if ((sys = system_get_instance()) == NULL)
         return NULL;
 
-    LIST_FOREACH(local_if, &(sys->lif_list), system_next)
-    {
-        if (local_if->type == IF_T_PORT_CHANNEL && local_if->po_id == po_id)
-            return local_if;
-    }
+    lif_key.po_id = po_id;
+    return RB_FIND(lif_po_rb_tree, &(sys->lif_po_rb), &lif_key);
+}
 
-    return NULL;
+void local_if_set_ifindex(struct LocalInterface* local_if, int ifindex)
+{
+    struct System* sys = NULL;
+
+    if (!local_if || local_if->ifindex == ifindex)
+        return;
+
+    if ((sys = system_get_instance()) == NULL)
+        return;
+
+    local_if_index_del_ifindex(sys, local_if);
+    local_if->ifindex = ifindex;
+    if (local_if_is_indexed_by_ifindex(local_if))
+        local_if_index_add_ifindex(sys, local_if);
+
+    return;
 }
 
  void local_if_vlan_remove(struct LocalInterface *lif_vlan)
@@ -365,6 +534,7 @@ void local_if_destroy(char *ifname)
 to_sys_purge:
     /* sys purge */
     LIST_REMOVE(lif, system_next);
+    local_if_index_del(sys, lif);
     if (lif->csm)
         LIST_REMOVE(lif, mlacp_next);
     LIST_INSERT_HEAD(&(sys->lif_purge_list), lif, system_purge_next);
@@ -373,6 +543,7 @@ to_sys_purge:
 to_mlacp_purge:
     /* sys & mlacp purge */
     LIST_REMOVE(lif, system_next);
+    local_if_index_del(sys, lif);
     LIST_REMOVE(lif, mlacp_next);
     LIST_INSERT_HEAD(&(sys->lif_purge_list), lif, system_purge_next);
     LIST_INSERT_HEAD(&(MLACP(csm).lif_purge_list), lif, mlacp_purge_next);
@@ -507,13 +678,14 @@ struct PeerInterface* peer_if_create(struct CSM* csm,
     {
         peer_if->ifindex = peer_if_number;
         peer_if->type = IF_T_PORT;
-        peer_if->csm = csm;
     }
     else if (type == IF_T_PORT_CHANNEL)
     {
         peer_if->ifindex = peer_if_number;
         peer_if->type = IF_T_PORT_CHANNEL;
     }
+    /* Owner of pif_name_rb, upon name set */
+    peer_if->csm = csm;
 
     LIST_INSERT_HEAD(&(MLACP(csm).pif_list), peer_if, mlacp_next);
 
@@ -523,7 +695,7 @@ struct PeerInterface* peer_if_create(struct CSM* csm,
 struct PeerInterface* peer_if_find_by_name(struct CSM* csm, char* name)
 {
     struct System* sys = NULL;
-    struct PeerInterface* peer_if = NULL;
+    struct PeerInterface pif_key;
 
     if ((sys = system_get_instance()) == NULL)
         return NULL;
@@ -531,13 +703,66 @@ struct PeerInterface* peer_if_find_by_name(struct CSM* csm, char* name)
     if (csm == NULL)
         return NULL;
 
-    LIST_FOREACH(peer_if, &(csm->app_csm.mlacp.pif_list), mlacp_next)
+    snprintf(pif_key.name, MAX_L_PORT_NAME, "%s", name);
+    if (strcmp(pif_key.name, name) != 0)
+        return NULL;
+
+    return RB_FIND(pif_name_rb_tree, &(MLACP(csm).pif_name_rb), &pif_key);
+}
+
+/* Unindex by name; another peer interface of the name, if any, takes its place */
+static void peer_if_index_del(struct PeerInterface* pif)
+{
+    struct CSM* csm = pif->csm;
+    struct PeerInterface* pif_other = NULL;
+
+    if (pif->name[0] == '\0'
+        || RB_FIND(pif_name_rb_tree, &(MLACP(csm).pif_name_rb), pif) != pif)
+        return;
+
+    RB_REMOVE(pif_name_rb_tree, &(MLACP(csm).pif_name_rb), pif);
+    LIST_FOREACH(pif_other, &(MLACP(csm).pif_list), mlacp_next)
+    {
+        if (pif_other != pif && strcmp(pif_other->name, pif->name) == 0)
+        {
+            RB_INSERT(pif_name_rb_tree, &(MLACP(csm).pif_name_rb), pif_other);
+            break;
+        }
+    }
+
+    return;
+}
+
+/* Name of peer interface is known after it is created, upon aggregator config */
+void peer_if_set_name(struct PeerInterface* pif, const char* name, int len)
+{
+    struct CSM* csm = NULL;
+    struct PeerInterface* pif_old = NULL;
+
+    if (!pif || !(csm = pif->csm))
+        return;
+
+    if (len >= MAX_L_PORT_NAME)
+        len = MAX_L_PORT_NAME - 1;
+
+    if (strncmp(pif->name, name, len) == 0 && pif->name[len] == '\0')
+        return;
+
+    peer_if_index_del(pif);
+    memcpy(pif->name, name, len);
+    pif->name[len] = '\0';
+    if (pif->name[0] == '\0')
+        return;
+
+    /* Newest wins, same as lookup of pif_list (inserted at head) would return */
+    pif_old = RB_INSERT(pif_name_rb_tree, &(MLACP(csm).pif_name_rb), pif);
+    if (pif_old)
     {
-        if (strcmp(peer_if->name, name) == 0)
-            return peer_if;
+        RB_REMOVE(pif_name_rb_tree, &(MLACP(csm).pif_name_rb), pif_old);
+        RB_INSERT(pif_name_rb_tree, &(MLACP(csm).pif_name_rb), pif);
     }
 
-    return NULL;
+    return;
 }
 
 void peer_if_del_all_vlan(struct PeerInterface* pif)
@@ -561,6 +786,8 @@ void peer_if_destroy(struct PeerInterface* pif)
 
     /* destroy if*/
     LIST_REMOVE(pif, mlacp_next);
+    if (pif->csm)
+        peer_if_index_del(pif);
     peer_if_del_all_vlan(pif);
 
     free(pif);
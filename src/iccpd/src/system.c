@@ -71,6 +71,9 @@ void system_init(struct System* sys)
     sys->warmboot_exit = 0;
     LIST_INIT(&(sys->csm_list));
     LIST_INIT(&(sys->lif_list));
+    RB_INIT(lif_name_rb_tree, &(sys->lif_name_rb));
+    RB_INIT(lif_ifindex_rb_tree, &(sys->lif_ifindex_rb));
+    RB_INIT(lif_po_rb_tree, &(sys->lif_po_rb));
     LIST_INIT(&(sys->lif_purge_list));
     LIST_INIT(&(sys->unq_ip_if_list));
     LIST_INIT(&(sys->pending_vlan_mbr_if_list));
@@ -154,6 +157,8 @@ void system_finalize()
         close(sys->server_fd);
     if (sys->sync_fd > 0)
         close(sys->sync_fd);
+    if (sys->sync_tx_buf != NULL)
+        free(sys->sync_tx_buf);
     if (sys->sync_ctrl_fd > 0)
         close(sys->sync_ctrl_fd);
     if (sys->arp_receive_fd > 0)
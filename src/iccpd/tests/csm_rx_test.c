@@ -0,0 +1,241 @@
+/*
+ * csm_rx_test.c
+ *
+ * Framing of peer messages by scheduler_csm_read_callback over a socketpair:
+ * header split, body split, several messages in one read, byte by byte and
+ * a burst larger than the socket buffer. Error & disconnect paths need the
+ * daemon's system instance and are not covered.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+
+#include "../include/iccp_csm.h"
+#include "../include/msg_format.h"
+#include "../include/scheduler.h"
+
+#include "test_util.h"
+
+#define BURST_MSG_NUM   200
+#define BURST_BODY_LEN  1500
+
+/* Message on the wire: LDP header, msg_id, then body_len pattern bytes */
+static size_t build_msg(char *buf, uint32_t msg_id, size_t body_len)
+{
+    LDPHdr *hdr = (LDPHdr *)buf;
+    size_t i;
+
+    *(uint16_t *)hdr = htons(MSG_T_RG_CONNECT);
+    hdr->msg_len = htons(sizeof(uint32_t) + body_len);
+    hdr->msg_id = htonl(msg_id);
+    for (i = 0; i < body_len; i++)
+        buf[sizeof(LDPHdr) + i] = (char)(msg_id + i);
+
+    return sizeof(LDPHdr) + body_len;
+}
+
+/* Next received message is msg_id with body_len pattern bytes */
+static void check_msg(struct CSM *csm, uint32_t msg_id, size_t body_len)
+{
+    struct Msg *msg = NULL;
+    LDPHdr *hdr = NULL;
+    size_t i;
+
+    msg = iccp_csm_dequeue_msg(csm);
+    CHECK(msg != NULL);
+    if (!msg)
+        return;
+
+    hdr = (LDPHdr *)msg->buf;
+    CHECK(hdr->msg_type == MSG_T_RG_CONNECT);
+    CHECK(ntohl(hdr->msg_id) == msg_id);
+    CHECK(msg->len == (int)(sizeof(LDPHdr) + body_len));
+    for (i = 0; i < body_len && msg->len == (int)(sizeof(LDPHdr) + body_len); i++)
+    {
+        if (msg->buf[sizeof(LDPHdr) + i] != (char)(msg_id + i))
+        {
+            CHECK(!"body mismatch");
+            break;
+        }
+    }
+
+    free(msg->buf);
+    free(msg);
+}
+
+static void send_all(int fd, const char *buf, size_t len)
+{
+    CHECK(send(fd, buf, len, 0) == (ssize_t)len);
+}
+
+static void read_cb(struct CSM *csm)
+{
+    CHECK(scheduler_csm_read_callback(csm) == 1);
+}
+
+static void test_partial_header(struct CSM *csm, int fd)
+{
+    char buf[256];
+    size_t len = build_msg(buf, 1, 100);
+
+    send_all(fd, buf, 3);
+    read_cb(csm);
+    CHECK(csm->rx_len == 3);
+    CHECK(iccp_csm_dequeue_msg(csm) == NULL);
+
+    send_all(fd, buf + 3, sizeof(LDPHdr) - 3);
+    read_cb(csm);
+    CHECK(csm->rx_len == sizeof(LDPHdr));
+    CHECK(iccp_csm_dequeue_msg(csm) == NULL);
+
+    send_all(fd, buf + sizeof(LDPHdr), len - sizeof(LDPHdr));
+    read_cb(csm);
+    CHECK(csm->rx_len == 0);
+    check_msg(csm, 1, 100);
+    CHECK(iccp_csm_dequeue_msg(csm) == NULL);
+}
+
+static void test_partial_body(struct CSM *csm, int fd)
+{
+    char buf[4096];
+    size_t len = build_msg(buf, 2, 3000);
+
+    send_all(fd, buf, 1000);
+    read_cb(csm);
+    CHECK(csm->rx_len == 1000);
+    CHECK(iccp_csm_dequeue_msg(csm) == NULL);
+
+    send_all(fd, buf + 1000, len - 1000 - 1);
+    read_cb(csm);
+    CHECK(csm->rx_len == len - 1);
+    CHECK(iccp_csm_dequeue_msg(csm) == NULL);
+
+    send_all(fd, buf + len - 1, 1);
+    read_cb(csm);
+    CHECK(csm->rx_len == 0);
+    check_msg(csm, 2, 3000);
+}
+
+/* Several messages, then the head of one more, in one read */
+static void test_several_in_read(struct CSM *csm, int fd)
+{
+    char buf[4096];
+    size_t len = 0;
+    size_t tail_len;
+    uint32_t id;
+
+    for (id = 10; id < 15; id++)
+        len += build_msg(buf + len, id, id * 7);
+    tail_len = build_msg(buf + len, 15, 50);
+
+    send_all(fd, buf, len + 5);
+    read_cb(csm);
+    CHECK(csm->rx_len == 5);
+    for (id = 10; id < 15; id++)
+        check_msg(csm, id, id * 7);
+    CHECK(iccp_csm_dequeue_msg(csm) == NULL);
+
+    send_all(fd, buf + len + 5, tail_len - 5);
+    read_cb(csm);
+    check_msg(csm, 15, 50);
+}
+
+/* Empty body, & every split point of a message */
+static void test_byte_by_byte(struct CSM *csm, int fd)
+{
+    char buf[256];
+    size_t len;
+    size_t i;
+
+    len = build_msg(buf, 20, 0);
+    len += build_msg(buf + len, 21, 33);
+    for (i = 0; i < len; i++)
+    {
+        send_all(fd, buf + i, 1);
+        read_cb(csm);
+        if (i + 1 == sizeof(LDPHdr))
+            check_msg(csm, 20, 0);
+    }
+    check_msg(csm, 21, 33);
+    CHECK(csm->rx_len == 0);
+}
+
+/* More than the socket buffer, received over several wakeups */
+static void test_burst(struct CSM *csm, int fd)
+{
+    char *buf = NULL;
+    size_t len = 0;
+    size_t sent = 0;
+    ssize_t n;
+    uint32_t id;
+    int wakeups = 0;
+
+    buf = malloc(BURST_MSG_NUM * (sizeof(LDPHdr) + BURST_BODY_LEN));
+    if (!buf)
+        return;
+    for (id = 0; id < BURST_MSG_NUM; id++)
+        len += build_msg(buf + len, 100 + id, BURST_BODY_LEN - id);
+
+    while (sent < len)
+    {
+        n = send(fd, buf + sent, len - sent, MSG_DONTWAIT);
+        if (n > 0)
+            sent += n;
+        else if (errno != EAGAIN && errno != EWOULDBLOCK)
+            break;
+        read_cb(csm);
+        wakeups++;
+    }
+    CHECK(sent == len);
+    read_cb(csm);
+    CHECK(csm->rx_len == 0);
+
+    for (id = 0; id < BURST_MSG_NUM; id++)
+        check_msg(csm, 100 + id, BURST_BODY_LEN - id);
+    CHECK(iccp_csm_dequeue_msg(csm) == NULL);
+    printf("Burst of %zu bytes received in %d wakeups\n", len, wakeups);
+    free(buf);
+}
+
+int main(void)
+{
+    struct CSM *csm = NULL;
+    int fds[2];
+    int sndbuf = 16384;
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0)
+    {
+        perror("socketpair");
+        return 1;
+    }
+    setsockopt(fds[1], SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+
+    csm = (struct CSM *)calloc(1, sizeof(struct CSM));
+    if (!csm)
+        return 1;
+    iccp_csm_init(csm);
+    csm->sock_fd = fds[0];
+
+    test_partial_header(csm, fds[1]);
+    test_partial_body(csm, fds[1]);
+    test_several_in_read(csm, fds[1]);
+    test_byte_by_byte(csm, fds[1]);
+    test_burst(csm, fds[1]);
+
+    CHECK(csm->icc_msg_in_count == 1 + 1 + 6 + 2 + BURST_MSG_NUM);
+    close(fds[0]);
+    close(fds[1]);
+    free(csm);
+
+    return test_result();
+}
@@ -0,0 +1,381 @@
+/*
+ * lif_index_test.c
+ *
+ * Local interface indexes by name, ifindex & po_id: random create, destroy
+ * and set_ifindex, with each index checked after every step against the
+ * lif_list scan it replaced. Then lookup benchmark of a large system,
+ * run with -b for more rounds.
+ *
+ * port.c is built in with stubs of the daemon around it, so the system
+ * instance is a bare one, w/o the sockets of the daemon's.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../src/port.c"
+#include "../src/openbsd_tree.c"
+
+#include "test_util.h"
+
+#define CHURN_STEPS     5000
+#define CHURN_NAMES     24      /*per interface type*/
+#define CHURN_IFINDEX   120     /*small, for ifindex collisions*/
+#define BENCH_LIF_NUM   4096
+#define BENCH_LOOKUPS   200000
+#define SCAN_LOOKUPS    2000    /*lookups by list scan, it is slow*/
+#define ABSENT_KEY      1000000
+
+static struct System test_sys;
+static int test_sys_ready = 0;
+
+static unsigned int rand_state = 1;
+
+static unsigned int next_rand(void)
+{
+    rand_state = rand_state * 1103515245 + 12345;
+    return (rand_state >> 16) & 0x7fff;
+}
+
+static double now_sec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Daemon stubs: no CSM, peer-link or pending VLAN membership */
+struct System* system_get_instance()
+{
+    if (!test_sys_ready)
+    {
+        LIST_INIT(&(test_sys.csm_list));
+        LIST_INIT(&(test_sys.lif_list));
+        RB_INIT(lif_name_rb_tree, &(test_sys.lif_name_rb));
+        RB_INIT(lif_ifindex_rb_tree, &(test_sys.lif_ifindex_rb));
+        RB_INIT(lif_po_rb_tree, &(test_sys.lif_po_rb));
+        LIST_INIT(&(test_sys.lif_purge_list));
+        LIST_INIT(&(test_sys.unq_ip_if_list));
+        LIST_INIT(&(test_sys.pending_vlan_mbr_if_list));
+        test_sys_ready = 1;
+    }
+
+    return &test_sys;
+}
+
+struct CSM* system_get_csm_by_peer_ifname(char *ifname)
+{
+    return NULL;
+}
+
+int mlacp_bind_port_channel_to_csm(struct CSM* csm, const char *ifname)
+{
+    return 0;
+}
+
+int mlacp_unbind_local_if(struct LocalInterface* lif)
+{
+    return 0;
+}
+
+void move_pending_vlan_mbr_to_lif(struct System *sys, struct LocalInterface* lif)
+{
+}
+
+int is_unique_ip_configured(char *ifname)
+{
+    return 0;
+}
+
+void scheduler_session_disconnect_handler(struct CSM* csm)
+{
+}
+
+void set_peerlink_learn_kernel(struct CSM* csm, int enable, int dir)
+{
+}
+
+void update_vlan_if_mac_on_standby(struct LocalInterface* lif_vlan, int dir)
+{
+}
+
+void write_log(const int level, const char* tag, const char *format, ...)
+{
+}
+
+/* Lookups as done before the indexes: first match in lif_list */
+static struct LocalInterface *scan_by_name(struct System *sys, const char *ifname)
+{
+    struct LocalInterface *lif = NULL;
+
+    LIST_FOREACH(lif, &(sys->lif_list), system_next)
+    {
+        if (strcmp(lif->name, ifname) == 0)
+            return lif;
+    }
+
+    return NULL;
+}
+
+static struct LocalInterface *scan_by_ifindex(struct System *sys, int ifindex)
+{
+    struct LocalInterface *lif = NULL;
+
+    LIST_FOREACH(lif, &(sys->lif_list), system_next)
+    {
+        if (lif->ifindex == ifindex)
+            return lif;
+    }
+
+    return NULL;
+}
+
+static struct LocalInterface *scan_by_po_id(struct System *sys, int po_id)
+{
+    struct LocalInterface *lif = NULL;
+
+    LIST_FOREACH(lif, &(sys->lif_list), system_next)
+    {
+        if (lif->type == IF_T_PORT_CHANNEL && lif->po_id == po_id)
+            return lif;
+    }
+
+    return NULL;
+}
+
+/* Each index has one entry per key in lif_list, the lif a scan finds */
+static void check_indexes(struct System *sys)
+{
+    struct LocalInterface *lif = NULL;
+    int name_num = 0, ifindex_num = 0, po_num = 0;
+    int num;
+
+    LIST_FOREACH(lif, &(sys->lif_list), system_next)
+    {
+        CHECK(local_if_find_by_name(lif->name) == scan_by_name(sys, lif->name));
+        if (scan_by_name(sys, lif->name) == lif)
+            name_num++;
+
+        if (lif->ifindex > 0)
+        {
+            CHECK(local_if_find_by_ifindex(lif->ifindex) == scan_by_ifindex(sys, lif->ifindex));
+            if (scan_by_ifindex(sys, lif->ifindex) == lif)
+                ifindex_num++;
+        }
+
+        if (lif->type == IF_T_PORT_CHANNEL && lif->po_id >= 0)
+        {
+            CHECK(local_if_find_by_po_id(lif->po_id) == scan_by_po_id(sys, lif->po_id));
+            if (scan_by_po_id(sys, lif->po_id) == lif)
+                po_num++;
+        }
+    }
+
+    num = 0;
+    RB_FOREACH(lif, lif_name_rb_tree, &(sys->lif_name_rb))
+        num++;
+    CHECK(num == name_num);
+
+    num = 0;
+    RB_FOREACH(lif, lif_ifindex_rb_tree, &(sys->lif_ifindex_rb))
+        num++;
+    CHECK(num == ifindex_num);
+
+    num = 0;
+    RB_FOREACH(lif, lif_po_rb_tree, &(sys->lif_po_rb))
+        num++;
+    CHECK(num == po_num);
+
+    CHECK(local_if_find_by_name("Unknown0") == NULL);
+    CHECK(local_if_find_by_ifindex(ABSENT_KEY) == NULL);
+    CHECK(local_if_find_by_po_id(ABSENT_KEY) == NULL);
+}
+
+static void lif_name(int type, int i, char *ifname)
+{
+    if (type == IF_T_PORT_CHANNEL)
+        snprintf(ifname, MAX_L_PORT_NAME, "PortChannel%d", i + 1);
+    else if (type == IF_T_VLAN)
+        snprintf(ifname, MAX_L_PORT_NAME, "Vlan%d", i + 1);
+    else
+        snprintf(ifname, MAX_L_PORT_NAME, "Ethernet%d", i);
+}
+
+static int random_type(void)
+{
+    static const int types[] = { IF_T_PORT, IF_T_PORT_CHANNEL, IF_T_VLAN };
+
+    return types[next_rand() % 3];
+}
+
+static struct LocalInterface *random_lif(struct System *sys)
+{
+    struct LocalInterface *lif = NULL;
+    int num = 0;
+    int n;
+
+    LIST_FOREACH(lif, &(sys->lif_list), system_next)
+        num++;
+    if (num == 0)
+        return NULL;
+
+    n = next_rand() % num;
+    LIST_FOREACH(lif, &(sys->lif_list), system_next)
+    {
+        if (n-- == 0)
+            break;
+    }
+
+    return lif;
+}
+
+static void destroy_all(struct System *sys)
+{
+    char ifname[MAX_L_PORT_NAME];
+
+    while (!LIST_EMPTY(&(sys->lif_list)))
+    {
+        snprintf(ifname, sizeof(ifname), "%s", LIST_FIRST(&(sys->lif_list))->name);
+        local_if_destroy(ifname);
+    }
+    local_if_purge_clear();
+}
+
+/* Creation of a name already known (new ifindex), VLAN w/o ifindex yet,
+ * ifindex moved onto another lif's, ... all keep indexes in sync. */
+static void churn(struct System *sys)
+{
+    char ifname[MAX_L_PORT_NAME];
+    struct LocalInterface *lif = NULL;
+    int step;
+    int op;
+    int type;
+
+    for (step = 0; step < CHURN_STEPS; step++)
+    {
+        op = next_rand() % 20;
+        if (op < 8)
+        {
+            type = random_type();
+            lif_name(type, next_rand() % CHURN_NAMES, ifname);
+            local_if_create((type == IF_T_VLAN && next_rand() % 2) ? 0 : (int)(next_rand() % CHURN_IFINDEX) + 1,
+                            ifname, type, PORT_STATE_UP);
+        }
+        else if (op < 13)
+        {
+            type = random_type();
+            lif_name(type, next_rand() % CHURN_NAMES, ifname);
+            local_if_destroy(ifname);
+        }
+        else if (op < 19)
+        {
+            lif = random_lif(sys);
+            if (lif)
+                local_if_set_ifindex(lif, next_rand() % 4 ? (int)(next_rand() % CHURN_IFINDEX) + 1 : 0);
+        }
+        else
+        {
+            local_if_purge_clear();
+        }
+
+        check_indexes(sys);
+        if (failures)
+        {
+            fprintf(stderr, "Indexes out of sync at step %d\n", step);
+            return;
+        }
+    }
+
+    destroy_all(sys);
+    check_indexes(sys);
+    CHECK(RB_EMPTY(lif_name_rb_tree, &(sys->lif_name_rb)));
+    CHECK(RB_EMPTY(lif_ifindex_rb_tree, &(sys->lif_ifindex_rb)));
+    CHECK(RB_EMPTY(lif_po_rb_tree, &(sys->lif_po_rb)));
+}
+
+static void bench(struct System *sys, int rounds)
+{
+    char names[BENCH_LIF_NUM][MAX_L_PORT_NAME];
+    struct LocalInterface *lif = NULL;
+    double start, name_ns, ifindex_ns, po_ns, scan_ns;
+    long found = 0;
+    int type;
+    int i, n;
+
+    for (i = 0; i < BENCH_LIF_NUM; i++)
+    {
+        type = (i % 4 == 0) ? IF_T_PORT_CHANNEL : (i % 4 == 1) ? IF_T_VLAN : IF_T_PORT;
+        lif_name(type, i, names[i]);
+        local_if_create(i + 1, names[i], type, PORT_STATE_UP);
+    }
+    check_indexes(sys);
+
+    start = now_sec();
+    for (n = 0; n < rounds * BENCH_LOOKUPS; n++)
+    {
+        lif = local_if_find_by_name(names[n % BENCH_LIF_NUM]);
+        found += (lif != NULL);
+    }
+    name_ns = (now_sec() - start) * 1e9 / ((double)rounds * BENCH_LOOKUPS);
+
+    start = now_sec();
+    for (n = 0; n < rounds * BENCH_LOOKUPS; n++)
+    {
+        lif = local_if_find_by_ifindex(n % BENCH_LIF_NUM + 1);
+        found += (lif != NULL);
+    }
+    ifindex_ns = (now_sec() - start) * 1e9 / ((double)rounds * BENCH_LOOKUPS);
+
+    start = now_sec();
+    for (n = 0; n < rounds * BENCH_LOOKUPS; n++)
+    {
+        /* PortChannel of every 4th lif, po_id i + 1 */
+        lif = local_if_find_by_po_id((n % (BENCH_LIF_NUM / 4)) * 4 + 1);
+        found += (lif != NULL);
+    }
+    po_ns = (now_sec() - start) * 1e9 / ((double)rounds * BENCH_LOOKUPS);
+
+    start = now_sec();
+    for (n = 0; n < SCAN_LOOKUPS; n++)
+    {
+        lif = scan_by_name(sys, names[(long)n * BENCH_LIF_NUM / SCAN_LOOKUPS]);
+        found += (lif != NULL);
+    }
+    scan_ns = (now_sec() - start) * 1e9 / SCAN_LOOKUPS;
+
+    CHECK(found == 3L * rounds * BENCH_LOOKUPS + SCAN_LOOKUPS);
+    printf("%d lifs: by name %.0f ns, by ifindex %.0f ns, by po_id %.0f ns, list scan by name %.0f ns\n",
+           BENCH_LIF_NUM, name_ns, ifindex_ns, po_ns, scan_ns);
+
+    destroy_all(sys);
+}
+
+int main(int argc, char *argv[])
+{
+    struct System *sys = NULL;
+    int rounds = 1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "b")) != -1)
+    {
+        if (opt == 'b')
+            rounds = 20;
+    }
+
+    if (!(sys = system_get_instance()))
+        return 1;
+
+    churn(sys);
+    if (!failures)
+        bench(sys, rounds);
+
+    return test_result();
+}
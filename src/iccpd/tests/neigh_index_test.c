@@ -0,0 +1,251 @@
+/*
+ * neigh_index_test.c
+ *
+ * ARP/ND list index check & benchmark: 100k neighbors, some of an address
+ * on two interfaces, looked up by the index and by the list scan it replaced.
+ * Run with -b for a larger lookup benchmark.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+
+#include "../include/iccp_csm.h"
+#include "../include/mlacp_tlv.h"
+#include "../include/mlacp_fsm.h"
+#include "../include/mlacp_sync_update.h"
+
+#include "test_util.h"
+
+#define NEIGH_NUM       100000
+#define NEIGH_DUAL_STEP 10      /*every 10th address also on a 2nd interface*/
+#define SCAN_NUM        1000    /*lookups by list scan, it is slow*/
+
+static double now_sec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint32_t arp_addr(int i)
+{
+    return htonl(0x0a000000 + i);
+}
+
+static void ndisc_addr(int i, uint32_t *addr)
+{
+    addr[0] = htonl(0xfc000000);
+    addr[1] = 0;
+    addr[2] = 0;
+    addr[3] = htonl(i);
+}
+
+static void neigh_ifname(int i, int second, char *ifname)
+{
+    snprintf(ifname, MAX_L_PORT_NAME, "Vlan%d", (i % 4000) + 1 + (second ? 4000 : 0));
+}
+
+/* Lookup as done before the index */
+static struct Msg *scan_arp(struct CSM *csm, char *ifname, uint32_t ipv4_addr)
+{
+    struct Msg *msg = NULL;
+    struct ARPMsg *arp_msg = NULL;
+
+    TAILQ_FOREACH(msg, &(MLACP(csm).arp_list), tail)
+    {
+        arp_msg = (struct ARPMsg *)msg->buf;
+        if (arp_msg->ipv4_addr == ipv4_addr && strcmp(arp_msg->ifname, ifname) == 0)
+            return msg;
+    }
+
+    return NULL;
+}
+
+static void add_arp(struct CSM *csm, int i, int second)
+{
+    struct ARPMsg arp_msg;
+    struct Msg *msg = NULL;
+
+    memset(&arp_msg, 0, sizeof(arp_msg));
+    arp_msg.op_type = NEIGH_SYNC_LIF;
+    arp_msg.ipv4_addr = arp_addr(i);
+    neigh_ifname(i, second, arp_msg.ifname);
+    if (iccp_csm_init_msg(&msg, (char *)&arp_msg, sizeof(arp_msg)) == 0)
+        mlacp_enqueue_arp(csm, msg);
+}
+
+static void add_ndisc(struct CSM *csm, int i, int second)
+{
+    struct NDISCMsg ndisc_msg;
+    struct Msg *msg = NULL;
+
+    memset(&ndisc_msg, 0, sizeof(ndisc_msg));
+    ndisc_msg.op_type = NEIGH_SYNC_LIF;
+    ndisc_addr(i, ndisc_msg.ipv6_addr);
+    neigh_ifname(i, second, ndisc_msg.ifname);
+    if (iccp_csm_init_msg(&msg, (char *)&ndisc_msg, sizeof(ndisc_msg)) == 0)
+        mlacp_enqueue_ndisc(csm, msg);
+}
+
+static int count_tree(struct neigh_rb_tree *tree)
+{
+    struct NeighIndex *neigh = NULL;
+    int num = 0;
+
+    RB_FOREACH(neigh, neigh_rb_tree, tree)
+        num++;
+
+    return num;
+}
+
+static void check_lookup(struct CSM *csm)
+{
+    char ifname[MAX_L_PORT_NAME];
+    char other[MAX_L_PORT_NAME];
+    uint32_t addr[4];
+    struct Msg *msg = NULL;
+    int i;
+
+    for (i = 0; i < NEIGH_NUM; i++)
+    {
+        neigh_ifname(i, 0, ifname);
+        neigh_ifname(i, 1, other);
+
+        msg = mlacp_find_arp(csm, ifname, arp_addr(i));
+        CHECK(msg && strcmp(((struct ARPMsg *)msg->buf)->ifname, ifname) == 0);
+        CHECK(mlacp_find_arp(csm, NULL, arp_addr(i)) != NULL);
+
+        msg = mlacp_find_arp(csm, other, arp_addr(i));
+        if (i % NEIGH_DUAL_STEP == 0)
+            CHECK(msg && strcmp(((struct ARPMsg *)msg->buf)->ifname, other) == 0);
+        else
+            CHECK(msg == NULL);
+
+        ndisc_addr(i, addr);
+        msg = mlacp_find_ndisc(csm, ifname, addr);
+        CHECK(msg && strcmp(((struct NDISCMsg *)msg->buf)->ifname, ifname) == 0);
+        CHECK(mlacp_find_ndisc(csm, NULL, addr) != NULL);
+        CHECK((mlacp_find_ndisc(csm, other, addr) != NULL) == (i % NEIGH_DUAL_STEP == 0));
+    }
+
+    neigh_ifname(0, 0, ifname);
+    CHECK(mlacp_find_arp(csm, ifname, arp_addr(NEIGH_NUM)) == NULL);
+    CHECK(mlacp_find_arp(csm, NULL, arp_addr(NEIGH_NUM)) == NULL);
+}
+
+/* Removing one interface's entry keeps the other's */
+static void check_dequeue(struct CSM *csm)
+{
+    char ifname[MAX_L_PORT_NAME];
+    char other[MAX_L_PORT_NAME];
+    struct Msg *msg = NULL;
+    int i;
+
+    for (i = 0; i < NEIGH_NUM; i += NEIGH_DUAL_STEP)
+    {
+        neigh_ifname(i, 0, ifname);
+        neigh_ifname(i, 1, other);
+        msg = mlacp_find_arp(csm, ifname, arp_addr(i));
+        CHECK(msg != NULL);
+        if (msg)
+            mlacp_dequeue_arp(csm, msg);
+        CHECK(mlacp_find_arp(csm, ifname, arp_addr(i)) == NULL);
+        msg = mlacp_find_arp(csm, NULL, arp_addr(i));
+        CHECK(msg && strcmp(((struct ARPMsg *)msg->buf)->ifname, other) == 0);
+    }
+}
+
+static void bench(struct CSM *csm, int rounds)
+{
+    char ifname[MAX_L_PORT_NAME];
+    struct Msg *msg = NULL;
+    double start, index_ns, scan_ns;
+    int found = 0;
+    int i, r;
+
+    start = now_sec();
+    for (r = 0; r < rounds; r++)
+    {
+        for (i = 0; i < NEIGH_NUM; i++)
+        {
+            neigh_ifname(i, 0, ifname);
+            msg = mlacp_find_arp(csm, ifname, arp_addr(i));
+            found += (msg != NULL);
+        }
+    }
+    index_ns = (now_sec() - start) * 1e9 / ((double)rounds * NEIGH_NUM);
+
+    start = now_sec();
+    for (i = 0; i < SCAN_NUM; i++)
+    {
+        /* Spread over the list, as the average position */
+        int n = (int)((long)i * NEIGH_NUM / SCAN_NUM);
+
+        neigh_ifname(n, 0, ifname);
+        msg = scan_arp(csm, ifname, arp_addr(n));
+        found += (msg != NULL);
+    }
+    scan_ns = (now_sec() - start) * 1e9 / SCAN_NUM;
+
+    CHECK(found == rounds * NEIGH_NUM + SCAN_NUM);
+    printf("%d ARP entries: index lookup %.0f ns, list scan %.0f ns\n",
+           count_tree(&MLACP(csm).arp_rb), index_ns, scan_ns);
+}
+
+int main(int argc, char *argv[])
+{
+    struct CSM *csm = NULL;
+    double start;
+    int rounds = 1;
+    int opt;
+    int i;
+
+    while ((opt = getopt(argc, argv, "b")) != -1)
+    {
+        if (opt == 'b')
+            rounds = 20;
+    }
+
+    csm = (struct CSM *)calloc(1, sizeof(struct CSM));
+    if (!csm)
+        return 1;
+    iccp_csm_init(csm);
+
+    start = now_sec();
+    for (i = 0; i < NEIGH_NUM; i++)
+    {
+        add_arp(csm, i, 0);
+        add_ndisc(csm, i, 0);
+        if (i % NEIGH_DUAL_STEP == 0)
+        {
+            add_arp(csm, i, 1);
+            add_ndisc(csm, i, 1);
+        }
+    }
+    printf("Enqueued %d ARP & ND entries in %.3f s\n",
+           count_tree(&MLACP(csm).arp_rb) + count_tree(&MLACP(csm).ndisc_rb),
+           now_sec() - start);
+
+    CHECK(count_tree(&MLACP(csm).arp_rb) == NEIGH_NUM + NEIGH_NUM / NEIGH_DUAL_STEP);
+    CHECK(count_tree(&MLACP(csm).ndisc_rb) == NEIGH_NUM + NEIGH_NUM / NEIGH_DUAL_STEP);
+
+    check_lookup(csm);
+    bench(csm, rounds);
+    check_dequeue(csm);
+    CHECK(count_tree(&MLACP(csm).arp_rb) == NEIGH_NUM);
+
+    mlacp_finalize(csm);
+    CHECK(RB_EMPTY(neigh_rb_tree, &MLACP(csm).arp_rb) && TAILQ_EMPTY(&(MLACP(csm).arp_list)));
+    free(csm);
+
+    return test_result();
+}
@@ -1,6 +1,7 @@
 #include <iostream>
 #include <memory>
 #include <unistd.h>
+#include <cstdlib>
 #include "rsyslog_plugin.h"
 
 #define SUCCESS_CODE 0
@@ -12,6 +13,8 @@ void showUsage() {
     cout << "Usage for rsyslog_plugin: \n" << "options\n"
         << "\t-r,required,type=string\t\tPath to regex file\n"
         << "\t-m,required,type=string\t\tYANG module name of source generating syslog message\n"
+        << "\t-b,optional,type=int\t\tMax events batched before publish; default 1, no batching\n"
+        << "\t-l,optional,type=int\t\tMax milliseconds an event is held in batch; default " << BATCH_LATENCY_MS << "\n"
         << "\t-h                     \t\tHelp"
         << endl;
 }
@@ -19,9 +22,11 @@ void showUsage() {
 int main(int argc, char** argv) {
     string regexPath;
     string moduleName;
+    int batchSize = 1;
+    int batchLatencyMs = BATCH_LATENCY_MS;
     int optionVal;
 
-    while((optionVal = getopt(argc, argv, "r:m:h")) != -1) {
+    while((optionVal = getopt(argc, argv, "r:m:b:l:h")) != -1) {
         switch(optionVal) {
             case 'r':
                 regexPath = optarg;
@@ -29,6 +34,12 @@ int main(int argc, char** argv) {
             case 'm':
                 moduleName = optarg;
                 break;
+            case 'b':
+                batchSize = atoi(optarg);
+                break;
+            case 'l':
+                batchLatencyMs = atoi(optarg);
+                break;
             case 'h':
             case '?':
             default:
@@ -42,7 +53,11 @@ int main(int argc, char** argv) {
         return MISSING_ARGS_ERROR_CODE;
     }
 
+    // stdin is read only via cin; buffered reads let batching see pending input
+    ios::sync_with_stdio(false);
+
     unique_ptr<RsyslogPlugin> plugin(new RsyslogPlugin(moduleName, regexPath));
+    plugin->setBatchMode(batchSize, batchLatencyMs);
     int returnCode = plugin->onInit();
     if(returnCode == INVALID_REGEX_ERROR_CODE) {
         SWSS_LOG_ERROR("Rsyslog plugin was not able to be initialized due to invalid regex file provided.\n");
@@ -0,0 +1,311 @@
+#include <cctype>
+#include <queue>
+#include "regex_prefilter.h"
+
+/**
+ * Returns index past the group or class starting at pos, or end if unterminated
+ *
+ */
+
+static size_t skipClass(const string& re, size_t pos, size_t end) {
+    pos++; // '['
+    if(pos < end && re[pos] == '^') {
+        pos++;
+    }
+    if(pos < end && re[pos] == ']') { // leading ] is literal
+        pos++;
+    }
+    while(pos < end && re[pos] != ']') {
+        pos += (re[pos] == '\\') ? 2 : 1;
+    }
+    return (pos < end) ? pos + 1 : end;
+}
+
+static size_t skipGroup(const string& re, size_t pos, size_t end) {
+    int depth = 0;
+    while(pos < end) {
+        if(re[pos] == '\\') {
+            pos += 2;
+            continue;
+        } else if(re[pos] == '[') {
+            pos = skipClass(re, pos, end);
+            continue;
+        } else if(re[pos] == '(') {
+            depth++;
+        } else if(re[pos] == ')') {
+            if(--depth == 0) {
+                return pos + 1;
+            }
+        }
+        pos++;
+    }
+    return end;
+}
+
+/**
+ * Skips quantifier at pos if any
+ *
+ * @return true if quantifier allows zero occurrences
+ *
+ */
+
+static bool skipQuantifier(const string& re, size_t& pos, size_t end, bool& repeats) {
+    bool optional = false;
+    repeats = false;
+    if(pos >= end) {
+        return false;
+    }
+    if(re[pos] == '?' || re[pos] == '*') {
+        optional = true;
+        repeats = (re[pos] == '*');
+        pos++;
+    } else if(re[pos] == '+') {
+        repeats = true;
+        pos++;
+    } else if(re[pos] == '{') {
+        size_t close = re.find('}', pos);
+        if(close == string::npos || close >= end) {
+            return false;
+        }
+        optional = (re[pos + 1] == '0' && (re[pos + 2] == ',' || re[pos + 2] == '}'));
+        repeats = true;
+        pos = close + 1;
+    } else {
+        return false;
+    }
+    if(pos < end && re[pos] == '?') { // lazy
+        pos++;
+    }
+    return optional;
+}
+
+/* Set of literals of which one is required; prefers the one with longest shortest literal */
+static bool isBetterFactor(const vector<string>& factor, const vector<string>& best) {
+    size_t factorMin = string::npos, bestMin = string::npos;
+    if(factor.empty() || best.empty()) {
+        return !factor.empty();
+    }
+    for(const auto& s : factor) {
+        factorMin = min(factorMin, s.size());
+    }
+    for(const auto& s : best) {
+        bestMin = min(bestMin, s.size());
+    }
+    return factorMin > bestMin || (factorMin == bestMin && factor.size() < best.size());
+}
+
+static vector<string> parseAlternation(const string& re, size_t pos, size_t end);
+
+static vector<string> parseSequence(const string& re, size_t pos, size_t end) {
+    vector<string> best;
+    string run;
+    bool repeats;
+
+    auto flush = [&]() {
+        if(!run.empty() && isBetterFactor({ run }, best)) {
+            best = { run };
+        }
+        run.clear();
+    };
+
+    while(pos < end) {
+        char c = re[pos];
+        if(c == '\\' && pos + 1 < end) {
+            char e = re[pos + 1];
+            pos += 2;
+            if(!isalnum((unsigned char)e)) { // escaped literal
+                if(skipQuantifier(re, pos, end, repeats)) {
+                    flush();
+                } else {
+                    run += e;
+                    if(repeats) {
+                        flush();
+                    }
+                }
+                continue;
+            }
+            // class, assertion, backreference or character code; not literal
+            if(e == 'x') {
+                pos += 2;
+            } else if(e == 'u') {
+                pos += 4;
+            } else if(e == 'c') {
+                pos += 1;
+            } else if(isdigit((unsigned char)e)) {
+                while(pos < end && isdigit((unsigned char)re[pos])) {
+                    pos++;
+                }
+            }
+            pos = min(pos, end);
+            flush();
+            skipQuantifier(re, pos, end, repeats);
+        } else if(c == '[') {
+            flush();
+            pos = skipClass(re, pos, end);
+            skipQuantifier(re, pos, end, repeats);
+        } else if(c == '(') {
+            size_t close = skipGroup(re, pos, end);
+            size_t bodyStart = pos + 1;
+            bool lookahead = false;
+            if(re.compare(pos, 3, "(?:") == 0) {
+                bodyStart = pos + 3;
+            } else if(re.compare(pos, 3, "(?=") == 0 || re.compare(pos, 3, "(?!") == 0) {
+                lookahead = true;
+            }
+            flush();
+            pos = close;
+            bool optional = skipQuantifier(re, pos, end, repeats);
+            if(!lookahead && !optional && close > bodyStart) {
+                vector<string> factor = parseAlternation(re, bodyStart, close - 1);
+                if(isBetterFactor(factor, best)) {
+                    best = factor;
+                }
+            }
+        } else if(c == '.' || c == '^' || c == '$' || c == ')') {
+            flush();
+            pos++;
+            skipQuantifier(re, pos, end, repeats);
+        } else {
+            pos++;
+            if(skipQuantifier(re, pos, end, repeats)) {
+                flush();
+            } else {
+                run += c;
+                if(repeats) {
+                    flush();
+                }
+            }
+        }
+    }
+    flush();
+    return best;
+}
+
+static vector<string> parseAlternation(const string& re, size_t pos, size_t end) {
+    vector<string> literals;
+    size_t branchStart = pos;
+    bool lastBranch = false;
+
+    while(!lastBranch) {
+        size_t branchEnd = branchStart;
+        while(branchEnd < end && re[branchEnd] != '|') {
+            if(re[branchEnd] == '\\') {
+                branchEnd += 2;
+            } else if(re[branchEnd] == '[') {
+                branchEnd = skipClass(re, branchEnd, end);
+            } else if(re[branchEnd] == '(') {
+                branchEnd = skipGroup(re, branchEnd, end);
+            } else {
+                branchEnd++;
+            }
+        }
+        branchEnd = min(branchEnd, end);
+        lastBranch = (branchEnd >= end);
+
+        // One of the branches matches; any branch w/o literal makes the whole optional
+        vector<string> factor = parseSequence(re, branchStart, branchEnd);
+        if(factor.empty()) {
+            return {};
+        }
+        literals.insert(literals.end(), factor.begin(), factor.end());
+        branchStart = branchEnd + 1;
+    }
+    return literals;
+}
+
+vector<string> RegexPrefilter::getRequiredLiterals(const string& regexString) {
+    return parseAlternation(regexString, 0, regexString.size());
+}
+
+RegexPrefilter::RegexPrefilter() {
+    clear();
+}
+
+void RegexPrefilter::clear() {
+    m_nodes.assign(1, Node());
+    m_nodes[0].next.fill(-1);
+    m_nodes[0].fail = 0;
+    m_literals.clear();
+    m_literalRegexes.clear();
+    m_alwaysCandidate.clear();
+}
+
+void RegexPrefilter::addLiteral(const string& literal, uint32_t regexIndex) {
+    int32_t state = 0;
+    for(unsigned char c : literal) {
+        if(m_nodes[state].next[c] < 0) {
+            m_nodes[state].next[c] = (int32_t)m_nodes.size();
+            m_nodes.push_back(Node());
+            m_nodes.back().next.fill(-1);
+            m_nodes.back().fail = 0;
+        }
+        state = m_nodes[state].next[c];
+    }
+    if(m_nodes[state].literals.empty()) {
+        m_nodes[state].literals.push_back((uint32_t)m_literals.size());
+        m_literals.push_back(literal);
+        m_literalRegexes.push_back({});
+    }
+    vector<uint32_t>& regexes = m_literalRegexes[m_nodes[state].literals[0]];
+    if(regexes.empty() || regexes.back() != regexIndex) {
+        regexes.push_back(regexIndex);
+    }
+}
+
+size_t RegexPrefilter::addRegex(const string& regexString) {
+    uint32_t regexIndex = (uint32_t)m_alwaysCandidate.size();
+    vector<string> literals = getRequiredLiterals(regexString);
+
+    m_alwaysCandidate.push_back(literals.empty());
+    for(const auto& literal : literals) {
+        addLiteral(literal, regexIndex);
+    }
+    return regexIndex;
+}
+
+void RegexPrefilter::build() {
+    queue<int32_t> pending;
+
+    // Complete goto function, so that scan is one lookup per byte
+    for(int c = 0; c < 256; c++) {
+        int32_t child = m_nodes[0].next[c];
+        if(child < 0) {
+            m_nodes[0].next[c] = 0;
+        } else {
+            m_nodes[child].fail = 0;
+            pending.push(child);
+        }
+    }
+    while(!pending.empty()) {
+        int32_t state = pending.front();
+        pending.pop();
+
+        int32_t fail = m_nodes[state].fail;
+        const vector<uint32_t>& failLiterals = m_nodes[fail].literals;
+        m_nodes[state].literals.insert(m_nodes[state].literals.end(), failLiterals.begin(), failLiterals.end());
+
+        for(int c = 0; c < 256; c++) {
+            int32_t child = m_nodes[state].next[c];
+            if(child < 0) {
+                m_nodes[state].next[c] = m_nodes[fail].next[c];
+            } else {
+                m_nodes[child].fail = m_nodes[fail].next[c];
+                pending.push(child);
+            }
+        }
+    }
+}
+
+void RegexPrefilter::getCandidates(const string& message, vector<bool>& candidates) const {
+    int32_t state = 0;
+
+    candidates = m_alwaysCandidate;
+    for(unsigned char c : message) {
+        state = m_nodes[state].next[c];
+        for(uint32_t literal : m_nodes[state].literals) {
+            for(uint32_t regexIndex : m_literalRegexes[literal]) {
+                candidates[regexIndex] = true;
+            }
+        }
+    }
+}
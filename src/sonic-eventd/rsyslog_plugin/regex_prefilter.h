@@ -0,0 +1,60 @@
+#ifndef REGEX_PREFILTER_H
+#define REGEX_PREFILTER_H
+
+#include <string>
+#include <vector>
+#include <array>
+#include <cstdint>
+
+using namespace std;
+
+/**
+ * Regex Prefilter picks the candidate regexes for a syslog message, so only those
+ * run the full regex.
+ *
+ * Each regex is reduced to a set of literals of which at least one must be present in
+ * any message the regex matches. e.g. "(write failed|Write protected)" reduces to
+ * { "write failed", "Write protected" } and ".* %ADJCHANGE: neighbor (.*)" to
+ * { " %ADJCHANGE: neighbor " }. A regex w/o such literals, like ".*", is always a candidate.
+ *
+ * All literals are compiled into one Aho-Corasick automaton, so a message is scanned
+ * once irrespective of count of regexes.
+ *
+ */
+
+class RegexPrefilter {
+public:
+    RegexPrefilter();
+
+    /* Adds regex in order; returns its index */
+    size_t addRegex(const string& regexString);
+
+    /* Builds automaton; call after all regexes are added */
+    void build();
+
+    /* Sets candidates[i] for every regex i that could match the message */
+    void getCandidates(const string& message, vector<bool>& candidates) const;
+
+    void clear();
+
+    /* Returns the literals of which at least one is required by the regex; empty if none */
+    static vector<string> getRequiredLiterals(const string& regexString);
+
+private:
+    struct Node {
+        array<int32_t, 256> next;
+        int32_t fail;
+        vector<uint32_t> literals;
+    };
+
+    vector<Node> m_nodes;
+    vector<string> m_literals;
+
+    /* Regex indices requiring each literal */
+    vector<vector<uint32_t>> m_literalRegexes;
+    vector<bool> m_alwaysCandidate;
+
+    void addLiteral(const string& literal, uint32_t regexIndex);
+};
+
+#endif
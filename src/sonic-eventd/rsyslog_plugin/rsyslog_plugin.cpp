@@ -17,6 +17,15 @@ bool RsyslogPlugin::onMessage(string msg, lua_State* luaState) {
     if(!m_parser->parseMessage(msg, tag, paramDict, luaState)) {
         SWSS_LOG_DEBUG("%s was not able to be parsed into a structured event\n", msg.c_str());
         return false;
+    } else if(m_batchSize > 1) {
+        if(m_pendingEvents.empty()) {
+            m_batchStart = chrono::steady_clock::now();
+        }
+        m_pendingEvents.emplace_back(move(tag), move(paramDict));
+        if(m_pendingEvents.size() >= m_batchSize) {
+            return publishEvents();
+        }
+        return true;
     } else {
         int returnCode = event_publish(m_eventHandle, tag, &paramDict);
         if(returnCode != 0) {
@@ -27,6 +36,26 @@ bool RsyslogPlugin::onMessage(string msg, lua_State* luaState) {
     }
 }
 
+/**
+ * Publishes events batched by onMessage
+ *
+ * @return false if any event failed to publish
+ *
+ */
+
+bool RsyslogPlugin::publishEvents() {
+    bool success = true;
+    for(auto& event : m_pendingEvents) {
+        int returnCode = event_publish(m_eventHandle, event.first, &event.second);
+        if(returnCode != 0) {
+            SWSS_LOG_ERROR("rsyslog_plugin was not able to publish event for %s.\n", event.first.c_str());
+            success = false;
+        }
+    }
+    m_pendingEvents.clear();
+    return success;
+}
+
 void parseParams(vector<string> params, vector<EventParam>& eventParams) {
     for(long unsigned int i = 0; i < params.size(); i++) {
         if(params[i].empty()) {
@@ -64,7 +93,7 @@ bool RsyslogPlugin::createRegexList() {
     }
 
     string regexString;
-    string timestampRegex = "^([a-zA-Z]{3})?\\s*([0-9]{1,2})?\\s*([0-9]{2}:[0-9]{2}:[0-9]{2}.[0-9]{0,6})?\\s*";
+    string timestampRegex = TIMESTAMP_REGEX;
     regex expression;
     vector<RegexStruct> regexList;
 
@@ -84,6 +113,7 @@ bool RsyslogPlugin::createRegexList() {
             rs.params = eventParams;
             rs.tag = tag;
             rs.regexExpression = expression;
+            rs.eventRegex = eventRegex;
             regexList.push_back(rs);
         } catch (nlohmann::detail::type_error& deException) {
             SWSS_LOG_ERROR("Missing required key, throws exception: %s\n", deException.what());
@@ -99,7 +129,10 @@ bool RsyslogPlugin::createRegexList() {
         return false;
     }
 
-    m_parser->m_regexList = regexList;
+    m_parser->setRegexList(regexList);
+    if(!m_parser->loadLuaCode(m_luaState)) {
+        SWSS_LOG_ERROR("Invalid lua code in %s; such params are published as matched\n", m_regexPath.c_str());
+    }
 
     regexFile.close();
     return true;
@@ -107,16 +140,29 @@ bool RsyslogPlugin::createRegexList() {
 
 void RsyslogPlugin::run() {
     signal(SIGTERM, RsyslogPlugin::signalHandler);
-    lua_State* luaState = luaL_newstate();
-    luaL_openlibs(luaState);
     string line;
     while(RsyslogPlugin::g_running && getline(cin, line)) {
-        if(line.empty()) {
-            continue;
+        if(!line.empty()) {
+            onMessage(line, m_luaState);
+        }
+        // Publish batch before waiting for more input, or when it is held too long
+        if(!m_pendingEvents.empty() && (cin.rdbuf()->in_avail() <= 0 ||
+                    chrono::steady_clock::now() - m_batchStart >= chrono::milliseconds(m_batchLatencyMs))) {
+            publishEvents();
         }
-        onMessage(line, luaState);
     }
-    lua_close(luaState);
+    publishEvents();
+}
+
+/**
+ * Batches upto batchSize parsed events, published together before waiting for more input
+ * or upon batchLatencyMs, whichever first. Batch size of 1 publishes every event as parsed.
+ *
+ */
+
+void RsyslogPlugin::setBatchMode(size_t batchSize, int batchLatencyMs) {
+    m_batchSize = (batchSize > 0) ? batchSize : 1;
+    m_batchLatencyMs = batchLatencyMs;
 }
 
 int RsyslogPlugin::onInit() {
@@ -134,5 +180,14 @@ RsyslogPlugin::RsyslogPlugin(string moduleName, string regexPath) {
     m_parser = unique_ptr<SyslogParser>(new SyslogParser());
     m_moduleName = moduleName;
     m_regexPath = regexPath;
+    m_luaState = luaL_newstate();
+    luaL_openlibs(m_luaState);
+    m_batchSize = 1;
+    m_batchLatencyMs = BATCH_LATENCY_MS;
     RsyslogPlugin::g_running = true;
 }
+
+RsyslogPlugin::~RsyslogPlugin() {
+    publishEvents();
+    lua_close(m_luaState);
+}
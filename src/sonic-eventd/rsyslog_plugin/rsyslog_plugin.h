@@ -10,6 +10,8 @@ extern "C"
 #include <string>
 #include <memory>
 #include <csignal>
+#include <chrono>
+#include <vector>
 #include "syslog_parser.h"
 #include "events.h"
 #include "logger.h"
@@ -17,6 +19,8 @@ extern "C"
 using namespace std;
 using namespace swss;
 
+#define BATCH_LATENCY_MS 100
+
 /**
  * Rsyslog Plugin will utilize an instance of a syslog parser to read syslog messages from rsyslog.d and will continuously read from stdin
  * A plugin instance is created for each container/host.
@@ -29,7 +33,10 @@ public:
     int onInit();
     bool onMessage(string msg, lua_State* luaState);
     void run();
+    void setBatchMode(size_t batchSize, int batchLatencyMs = BATCH_LATENCY_MS);
+    bool publishEvents();
     RsyslogPlugin(string moduleName, string regexPath);
+    ~RsyslogPlugin();
     static void signalHandler(int signum) {
         if (signum == SIGTERM) {
             SWSS_LOG_INFO("Rsyslog plugin received SIGTERM, shutting down");
@@ -41,6 +48,11 @@ private:
     event_handle_t m_eventHandle;
     string m_regexPath;
     string m_moduleName;
+    lua_State* m_luaState;
+    size_t m_batchSize;
+    int m_batchLatencyMs;
+    vector<pair<string, event_params_t>> m_pendingEvents;
+    chrono::steady_clock::time_point m_batchStart;
     bool createRegexList();
 };
 
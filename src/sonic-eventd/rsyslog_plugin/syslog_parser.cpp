@@ -1,8 +1,103 @@
 #include <iostream>
 #include <ctime>
+#include <cctype>
+#include <atomic>
 #include "syslog_parser.h"
 #include "logger.h"
 
+/* Unique across parsers, so that stale lua functions in a lua state are never reused */
+static atomic<int> g_luaGeneration(0);
+
+/**
+ * Parses the timestamp prefix of syslog message, as TIMESTAMP_REGEX would on its first try
+ *
+ * @param message is syslog message
+ * @param timestamp is set to month, day & time; empty if missing
+ * @return offset of the message after the timestamp prefix
+ *
+ */
+
+size_t SyslogParser::parseTimestampPrefix(const string& message, vector<string>& timestamp) {
+    size_t pos = 0;
+    size_t len = message.size();
+    const char* msg = message.c_str();
+    auto skipSpace = [&]() {
+        while(pos < len && isspace((unsigned char)msg[pos])) {
+            pos++;
+        }
+    };
+
+    timestamp.assign(TIMESTAMP_PARAM_COUNT, "");
+    if(len >= 3 && isalpha((unsigned char)msg[0]) && isalpha((unsigned char)msg[1]) && isalpha((unsigned char)msg[2])) {
+        timestamp[0].assign(msg, 3);
+        pos = 3;
+    }
+    skipSpace();
+    size_t dayPos = pos;
+    while(pos < len && pos - dayPos < 2 && isdigit((unsigned char)msg[pos])) {
+        pos++;
+    }
+    timestamp[1].assign(msg + dayPos, pos - dayPos);
+    skipSpace();
+
+    // hh:mm:ss followed by any char and upto 6 digits
+    const char* pattern = "dd:dd:dd";
+    size_t timePos = pos;
+    bool validTime = (len - pos > 8);
+    for(size_t i = 0; validTime && i < 8; i++) {
+        char c = msg[pos + i];
+        validTime = (pattern[i] == 'd') ? isdigit((unsigned char)c) : (c == ':');
+    }
+    if(validTime && msg[pos + 8] != '\n' && msg[pos + 8] != '\r') {
+        pos += 9;
+        while(pos < len && pos - timePos < 15 && isdigit((unsigned char)msg[pos])) {
+            pos++;
+        }
+        timestamp[2].assign(msg + timePos, pos - timePos);
+        skipSpace();
+    }
+    return pos;
+}
+
+/**
+ * Matches regex, filling values of its params
+ *
+ * Compiled regex is matched after the timestamp prefix parsed upfront. If that fails, the
+ * full regex is tried as the timestamp prefix could have taken the start of the message.
+ *
+ */
+
+bool SyslogParser::matchRegex(const string& message, RegexStruct& rs, const vector<string>& timestamp, size_t eventPos, vector<string>& values) {
+    smatch matchResults;
+    if(rs.compiled) {
+        auto flags = regex_constants::match_continuous;
+        if(eventPos != 0) {
+            flags |= regex_constants::match_prev_avail;
+        }
+        if(regex_search(message.cbegin() + eventPos, message.cend(), matchResults, rs.eventExpression, flags)) {
+            if(rs.params.size() != matchResults.size() - 1 + TIMESTAMP_PARAM_COUNT) {
+                return false;
+            }
+            values = timestamp;
+            for(size_t i = 1; i < matchResults.size(); i++) {
+                values.push_back(matchResults[i].str());
+            }
+            return true;
+        }
+        if(eventPos == 0) { // no other way to split the timestamp prefix
+            return false;
+        }
+    }
+    if(!regex_search(message, matchResults, rs.regexExpression) || rs.params.size() != matchResults.size() - 1 || matchResults.size() < 4) {
+        return false;
+    }
+    values.clear();
+    for(size_t i = 1; i < matchResults.size(); i++) {
+        values.push_back(matchResults[i].str());
+    }
+    return true;
+}
+
 /**
  * Parses syslog message and returns structured event
  *
@@ -12,54 +107,201 @@
 */
 
 bool SyslogParser::parseMessage(string message, string& eventTag, event_params_t& paramMap, lua_State* luaState) {
+    vector<string> timestamp;
+    vector<string> values;
+    size_t eventPos = parseTimestampPrefix(message, timestamp);
+    bool usePrefilter = m_prefilterReady && (m_candidates.size() == m_regexList.size());
+
+    if(usePrefilter) {
+        m_prefilter.getCandidates(message, m_candidates);
+    }
     for(long unsigned int i = 0; i < m_regexList.size(); i++) {
-        smatch matchResults;
-        if(!regex_search(message, matchResults, m_regexList[i].regexExpression) || m_regexList[i].params.size() != matchResults.size() - 1 || matchResults.size() < 4) {
+        if(usePrefilter && !m_candidates[i]) {
             continue;
         }
-        string formattedTimestamp;
-        if(!matchResults[1].str().empty() && !matchResults[2].str().empty() && !matchResults[3].str().empty()) { // found timestamp components
-            formattedTimestamp = m_timestampFormatter->changeTimestampFormat({ matchResults[1].str(), matchResults[2].str(), matchResults[3].str() });
+        if(!matchRegex(message, m_regexList[i], timestamp, eventPos, values)) {
+            continue;
+        }
+        char formattedTimestamp[TIMESTAMP_BUFFER_SIZE];
+        size_t timestampLen = 0;
+        if(!values[0].empty() && !values[1].empty() && !values[2].empty()) { // found timestamp components
+            timestampLen = m_timestampFormatter->formatTimestamp(values[0], values[1], values[2], formattedTimestamp, sizeof(formattedTimestamp));
 	}
-        if(!formattedTimestamp.empty()) {
-            paramMap["timestamp"] = formattedTimestamp;
+        if(timestampLen != 0) {
+            paramMap["timestamp"].assign(formattedTimestamp, timestampLen);
 	} else {
             SWSS_LOG_INFO("Timestamp is invalid and is not able to be formatted");
 	}
 
         // found matching regex
         eventTag = m_regexList[i].tag;
+        int luaTop = (luaState != NULL) ? lua_gettop(luaState) : 0;
+        bool luaLoaded = false;
 	// check params for lua code
         for(long unsigned int j = 3; j < m_regexList[i].params.size(); j++) {
-	    string resultValue = matchResults[j + 1].str();
-	    string paramName = m_regexList[i].params[j].paramName;
-	    const char* luaCode = m_regexList[i].params[j].luaCode.c_str();
+            const EventParam& param = m_regexList[i].params[j];
 
-            if(luaCode == NULL || *luaCode == 0) {
+            if(param.luaCode.empty()) {
                 SWSS_LOG_INFO("Invalid lua code, empty or missing");
-                paramMap[paramName] = resultValue;
+                paramMap[param.paramName] = values[j];
 		continue;
 	    }
-
-	    // execute lua code
-            lua_pushstring(luaState, resultValue.c_str());
-            lua_setglobal(luaState, "arg");
-            if(luaL_dostring(luaState, luaCode) == 0) {
-                lua_pop(luaState, lua_gettop(luaState));
-	    } else { // error in lua code
-		SWSS_LOG_ERROR("Invalid lua code, unable to do operation.\n");
-		paramMap[paramName] = resultValue;
-		continue;
+            if(!luaLoaded && luaState != NULL) {
+                pushLuaFunctions(luaState);
+                luaLoaded = true;
             }
-            lua_getglobal(luaState, "ret");
-            paramMap[paramName] = lua_tostring(luaState, -1);
-            lua_pop(luaState, 1);
+            paramMap[param.paramName] = luaLoaded ? runLuaCode(luaState, param, values[j]) : values[j];
 	}
+        if(luaLoaded) {
+            lua_settop(luaState, luaTop);
+        }
         return true;
     }
     return false;
 }
 
+/**
+ * Compiles lua code of params into functions, held in a table in registry of lua state
+ *
+ * Lua code is wrapped in a function taking arg & returning ret, so it is compiled once and
+ * called w/o globals. Code that can't be wrapped is compiled as is and run with globals.
+ *
+ * @param luaState to compile into
+ * @return false if any lua code is invalid; such params take the matched value as is
+ *
+ */
+
+bool SyslogParser::loadLuaCode(lua_State* luaState) {
+    bool success = true;
+    int luaIndex = 0;
+
+    lua_pushlightuserdata(luaState, this);
+    lua_newtable(luaState);
+    lua_pushinteger(luaState, m_luaGeneration);
+    lua_rawseti(luaState, -2, 0);
+
+    for(auto& rs : m_regexList) {
+        for(auto& param : rs.params) {
+            param.luaIndex = 0;
+            if(param.luaCode.empty()) {
+                continue;
+            }
+            param.luaIndex = ++luaIndex;
+            param.luaGlobals = false;
+
+            // ret is an upvalue, so that code may return early as it could as a chunk
+            string wrappedCode = "local ret\nlocal code = function(arg)\n" + param.luaCode +
+                "\nend\nreturn function(arg) ret = nil code(arg) return ret end";
+            if(luaL_loadbuffer(luaState, wrappedCode.c_str(), wrappedCode.size(), param.paramName.c_str()) == 0 &&
+                    lua_pcall(luaState, 0, 1, 0) == 0 && lua_isfunction(luaState, -1)) {
+                lua_rawseti(luaState, -2, luaIndex);
+                continue;
+            }
+            lua_pop(luaState, 1);
+
+            if(luaL_loadbuffer(luaState, param.luaCode.c_str(), param.luaCode.size(), param.paramName.c_str()) == 0) {
+                param.luaGlobals = true;
+                lua_rawseti(luaState, -2, luaIndex);
+            } else {
+                SWSS_LOG_ERROR("Invalid lua code for %s: %s\n", param.paramName.c_str(), lua_tostring(luaState, -1));
+                lua_pop(luaState, 1);
+                success = false;
+            }
+        }
+    }
+
+    lua_rawset(luaState, LUA_REGISTRYINDEX);
+    return success;
+}
+
+/* Pushes table of lua functions of this parser, compiling them first if missing or stale */
+void SyslogParser::pushLuaFunctions(lua_State* luaState) {
+    lua_pushlightuserdata(luaState, this);
+    lua_rawget(luaState, LUA_REGISTRYINDEX);
+    if(lua_istable(luaState, -1)) {
+        lua_rawgeti(luaState, -1, 0);
+        bool current = (lua_tointeger(luaState, -1) == m_luaGeneration);
+        lua_pop(luaState, 1);
+        if(current) {
+            return;
+        }
+    }
+    lua_pop(luaState, 1);
+
+    loadLuaCode(luaState);
+    lua_pushlightuserdata(luaState, this);
+    lua_rawget(luaState, LUA_REGISTRYINDEX);
+}
+
+/* Runs lua code of param on value; expects table of lua functions on top of stack */
+string SyslogParser::runLuaCode(lua_State* luaState, const EventParam& param, const string& value) {
+    int rc;
+
+    lua_rawgeti(luaState, -1, param.luaIndex);
+    if(!lua_isfunction(luaState, -1)) {
+        SWSS_LOG_ERROR("Invalid lua code, unable to do operation.\n");
+        lua_pop(luaState, 1);
+        return value;
+    }
+    lua_pushlstring(luaState, value.data(), value.size());
+    if(param.luaGlobals) {
+        lua_setglobal(luaState, "arg");
+        rc = lua_pcall(luaState, 0, 0, 0);
+        if(rc == 0) {
+            lua_getglobal(luaState, "ret");
+        }
+    } else {
+        rc = lua_pcall(luaState, 1, 1, 0);
+    }
+    if(rc != 0) { // error in lua code
+        SWSS_LOG_ERROR("Invalid lua code, unable to do operation: %s\n", lua_tostring(luaState, -1));
+        lua_pop(luaState, 1);
+        return value;
+    }
+
+    size_t len = 0;
+    const char* ret = lua_tolstring(luaState, -1, &len);
+    string result = (ret != NULL) ? string(ret, len) : value;
+    if(ret == NULL) {
+        SWSS_LOG_ERROR("Lua code for %s did not set ret\n", param.paramName.c_str());
+    }
+    lua_pop(luaState, 1);
+    return result;
+}
+
+/**
+ * Sets regex list, compiling regex w/o timestamp prefix & the prefilter
+ *
+ * @param regexList with eventRegex set to regex w/o TIMESTAMP_REGEX
+ *
+ */
+
+void SyslogParser::setRegexList(const vector<RegexStruct>& regexList) {
+    static const regex backReference("\\\\[1-9]");
+
+    m_regexList = regexList;
+    m_prefilter.clear();
+    for(auto& rs : m_regexList) {
+        rs.compiled = false;
+        // back references are numbered after timestamp groups; leave those to full regex
+        if(!rs.eventRegex.empty() && !regex_search(rs.eventRegex, backReference)) {
+            try {
+                rs.eventExpression = regex(rs.eventRegex);
+                rs.compiled = true;
+            } catch (regex_error& reException) {
+                SWSS_LOG_INFO("Regex %s is matched w/o timestamp split: %s", rs.tag.c_str(), reException.what());
+            }
+        }
+        m_prefilter.addRegex(rs.eventRegex.empty() ? ".*" : rs.eventRegex);
+    }
+    m_prefilter.build();
+    m_candidates.assign(m_regexList.size(), true);
+    m_prefilterReady = true;
+    m_luaGeneration = ++g_luaGeneration;
+}
+
 SyslogParser::SyslogParser() {
+    m_prefilterReady = false;
+    m_luaGeneration = ++g_luaGeneration;
     m_timestampFormatter = unique_ptr<TimestampFormatter>(new TimestampFormatter());
 }
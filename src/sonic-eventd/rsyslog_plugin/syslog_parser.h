@@ -14,6 +14,7 @@ extern "C"
 #include <nlohmann/json.hpp>
 #include "events.h"
 #include "timestamp_formatter.h"
+#include "regex_prefilter.h"
 
 using namespace std;
 using json = nlohmann::json;
@@ -21,14 +22,23 @@ using json = nlohmann::json;
 struct EventParam {
     string paramName;
     string luaCode;
+    int luaIndex = 0; // index of compiled lua code in parser's table of lua functions
+    bool luaGlobals = false; // lua code is run as chunk with globals arg & ret
 };
 
 struct RegexStruct {
     regex regexExpression;
     vector<EventParam> params;
     string tag;
+    string eventRegex; // regex w/o timestamp prefix; empty if not known
+    regex eventExpression;
+    bool compiled = false;
 };
 
+/* Timestamp prefix prepended to every regex, captured as month, day & time */
+const string TIMESTAMP_REGEX = "^([a-zA-Z]{3})?\\s*([0-9]{1,2})?\\s*([0-9]{2}:[0-9]{2}:[0-9]{2}.[0-9]{0,6})?\\s*";
+const int TIMESTAMP_PARAM_COUNT = 3;
+
 /**
  * Syslog Parser is responsible for parsing log messages fed by rsyslog.d and returns
  * matched result to rsyslog_plugin to use with events publish API
@@ -40,7 +50,18 @@ public:
     unique_ptr<TimestampFormatter> m_timestampFormatter;
     vector<RegexStruct> m_regexList;
     bool parseMessage(string message, string& tag, event_params_t& paramDict, lua_State* luaState);
+    void setRegexList(const vector<RegexStruct>& regexList);
+    static size_t parseTimestampPrefix(const string& message, vector<string>& timestamp);
+    bool loadLuaCode(lua_State* luaState);
     SyslogParser();
+private:
+    RegexPrefilter m_prefilter;
+    vector<bool> m_candidates;
+    bool m_prefilterReady;
+    int m_luaGeneration;
+    void pushLuaFunctions(lua_State* luaState);
+    string runLuaCode(lua_State* luaState, const EventParam& param, const string& value);
+    bool matchRegex(const string& message, RegexStruct& rs, const vector<string>& timestamp, size_t eventPos, vector<string>& values);
 };
 
 #endif
@@ -1,4 +1,6 @@
 #include <iostream>
+#include <cstring>
+#include <cctype>
 #include "timestamp_formatter.h"
 #include "logger.h"
 #include "events.h"
@@ -14,61 +16,119 @@ using namespace std;
  *
  */
 
-static const unordered_map<string, string> g_monthDict {
-    { "Jan", "01" },
-    { "Feb", "02" },
-    { "Mar", "03" },
-    { "Apr", "04" },
-    { "May", "05" },
-    { "Jun", "06" },
-    { "Jul", "07" },
-    { "Aug", "08" },
-    { "Sep", "09" },
-    { "Oct", "10" },
-    { "Nov", "11" },
-    { "Dec", "12" }
-};
+static const char g_monthNames[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
 
-string TimestampFormatter::getYear(string timestamp) {
-    if(!m_storedTimestamp.empty()) {
-        if(m_storedTimestamp.compare(timestamp) <= 0) {
+static const uint64_t g_monthUnit = 100000000000000ULL; // month in encoded timestamp
+
+static int parseMonth(string_view month) {
+    if(month.size() != 3) {
+        return 0;
+    }
+    for(int i = 0; i < 12; i++) {
+        if(month.compare(0, 3, g_monthNames + (i * 3), 3) == 0) {
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+static inline char* writeDigits(char* out, unsigned int value, int width) {
+    for(int i = width - 1; i >= 0; i--) {
+        out[i] = (char)('0' + (value % 10));
+        value /= 10;
+    }
+    return out + width;
+}
+
+TimestampFormatter::TimestampFormatter() : m_storedTimestamp(0), m_storedYear(0) {
+}
+
+uint64_t TimestampFormatter::encodeTimestamp(int month, int day, string_view time) {
+    static const char* pattern = "dd:dd:dd";
+    uint64_t encoded = 0;
+
+    if(month < 1 || month > 12 || day < 1 || day > 31 || time.size() < 8) {
+        return 0;
+    }
+    for(int i = 0; i < 8; i++) {
+        if(pattern[i] == 'd') {
+            if(!isdigit((unsigned char)time[i])) {
+                return 0;
+            }
+            encoded = (encoded * 10) + (uint64_t)(time[i] - '0');
+        } else if(time[i] != ':') {
+            return 0;
+        }
+    }
+    // fraction upto micro seconds, padded
+    for(size_t i = 9; i < 15; i++) {
+        char c = (i < time.size()) ? time[i] : '0';
+        if(!isdigit((unsigned char)c)) {
+            return 0;
+        }
+        encoded = (encoded * 10) + (uint64_t)(c - '0');
+    }
+    return ((uint64_t)month * g_monthUnit) + ((uint64_t)day * (g_monthUnit / 100)) + encoded;
+}
+
+int TimestampFormatter::getYear(uint64_t timestamp) {
+    if(m_storedTimestamp != 0) {
+        if(m_storedTimestamp <= timestamp) {
             m_storedTimestamp = timestamp;
             return m_storedYear;
         }
+        if(m_storedTimestamp / g_monthUnit == timestamp / g_monthUnit) { // reordered message
+            return m_storedYear;
+        }
     }
     // no last timestamp or year change
     time_t currentTime = time(nullptr);
-    tm* const localTime = localtime(&currentTime);
-    stringstream ss;
-    auto currentYear = 1900 + localTime->tm_year;
-    ss << currentYear; // get current year
-    string year = ss.str();
+    struct tm localTime;
+    localtime_r(&currentTime, &localTime);
     m_storedTimestamp = timestamp;
-    m_storedYear = year;
-    return year;
+    m_storedYear = 1900 + localTime.tm_year;
+    return m_storedYear;
+}
+
+size_t TimestampFormatter::formatTimestamp(string_view month, string_view day, string_view time, char* buf, size_t bufSize) {
+    // need to change format of Mmm dd hh:mm:ss.SSSSSS to YYYY-mm-ddThh:mm:ss.SSSSSSZ
+    int monthNum = parseMonth(month);
+    if(monthNum == 0) {
+        SWSS_LOG_ERROR("Timestamp month was given in wrong format.\n");
+        return 0;
+    }
+    if(day.empty() || day.size() > 2 || !isdigit((unsigned char)day[0]) || (day.size() == 2 && !isdigit((unsigned char)day[1]))) {
+        SWSS_LOG_ERROR("Timestamp day was given in wrong format.\n");
+        return 0;
+    }
+    int dayNum = (day.size() == 1) ? (day[0] - '0') : (((day[0] - '0') * 10) + (day[1] - '0'));
+    uint64_t encoded = encodeTimestamp(monthNum, dayNum, time);
+    size_t len = 4 + 1 + 2 + 1 + 2 + 1 + time.size() + 1;
+    if(encoded == 0 || len >= bufSize) {
+        SWSS_LOG_ERROR("Timestamp time was given in wrong format.\n");
+        return 0;
+    }
+
+    char* out = buf;
+    out = writeDigits(out, (unsigned int)getYear(encoded), 4);
+    *out++ = '-';
+    out = writeDigits(out, (unsigned int)monthNum, 2);
+    *out++ = '-';
+    out = writeDigits(out, (unsigned int)dayNum, 2);
+    *out++ = 'T';
+    memcpy(out, time.data(), time.size());
+    out += time.size();
+    *out++ = 'Z';
+    *out = 0;
+    return len;
 }
 
-string TimestampFormatter::changeTimestampFormat(vector<string> dateComponents) {
+string TimestampFormatter::changeTimestampFormat(const vector<string>& dateComponents) {
     if(dateComponents.size() < 3) {
         SWSS_LOG_ERROR("Timestamp formatter unable to format due to invalid input");
         return "";
     }
-    string formattedTimestamp; // need to change format of Mmm dd hh:mm:ss.SSSSSS to YYYY-mm-ddThh:mm:ss.SSSSSSZ
-    string month;
-    auto it = g_monthDict.find(dateComponents[0]);
-    if(it != g_monthDict.end()) {
-        month = it->second;
-    } else {
-        SWSS_LOG_ERROR("Timestamp month was given in wrong format.\n");
-        return "";
-    }
-    string day = dateComponents[1];
-    if(day.size() == 1) { // convert 1 -> 01
-       day.insert(day.begin(), '0');
-    }
-    string time = dateComponents[2];
-    string currentTimestamp = month + day + time;
-    string year = getYear(currentTimestamp);
-    formattedTimestamp = year + "-" + month + "-" + day + "T" + time + "Z";
-    return formattedTimestamp;
+    char buf[TIMESTAMP_BUFFER_SIZE];
+    size_t len = formatTimestamp(dateComponents[0], dateComponents[1], dateComponents[2], buf, sizeof(buf));
+    return string(buf, len);
 }
@@ -3,25 +3,47 @@
 
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <regex>
 #include <ctime>
 #include <vector>
+#include <cstdint>
 
 using namespace std;
 
+/* Fits YYYY-mm-ddThh:mm:ss.SSSSSSZ with NUL */
+#define TIMESTAMP_BUFFER_SIZE 32
+
 /***
  *
  * TimestampFormatter is responsible for formatting the timestamps received in syslog messages and to format them into the type needed by YANG model
  *
+ * Syslog timestamps lack the year. The year of the first timestamp is the current year, and it is refreshed only on
+ * a rollover, i.e. when month goes backwards. A timestamp older than the last one in the same month is a reordered
+ * message and keeps the year.
+ *
  */
 
 class TimestampFormatter {
 public:
-    string changeTimestampFormat(vector<string> dateComponents);
-    string m_storedTimestamp;
-    string m_storedYear;
+    TimestampFormatter();
+
+    /**
+     * Formats Mmm, dd & hh:mm:ss.SSSSSS into buf as YYYY-mm-ddThh:mm:ss.SSSSSSZ w/o allocation
+     *
+     * @return length of formatted timestamp; 0 if invalid
+     */
+    size_t formatTimestamp(string_view month, string_view day, string_view time, char* buf, size_t bufSize);
+
+    string changeTimestampFormat(const vector<string>& dateComponents);
+
+    /* Encodes month, day & time as mmddhhmmssSSSSSS, so that timestamps compare as integers; 0 if invalid */
+    static uint64_t encodeTimestamp(int month, int day, string_view time);
+
+    uint64_t m_storedTimestamp; // last timestamp as encoded; 0 if none
+    int m_storedYear;
 private:
-    string getYear(string timestamp);
+    int getYear(uint64_t timestamp);
 };
 
 #endif
@@ -9,12 +9,14 @@ extern "C"
 #include <memory>
 #include <regex>
 #include <thread>
+#include <chrono>
 #include "gtest/gtest.h"
 #include <nlohmann/json.hpp>
 #include "events.h"
 #include "../rsyslog_plugin/rsyslog_plugin.h"
 #include "../rsyslog_plugin/syslog_parser.h"
 #include "../rsyslog_plugin/timestamp_formatter.h"
+#include "../rsyslog_plugin/regex_prefilter.h"
 
 using namespace std;
 using namespace swss;
@@ -96,8 +98,8 @@ TEST(syslog_parser, matching_regex_timestamp) {
     lua_State* luaState = luaL_newstate();
     luaL_openlibs(luaState);
 
-    parser->m_timestampFormatter->m_storedTimestamp = "010100:00:00.000000";
-    parser->m_timestampFormatter->m_storedYear = g_stored_year;
+    parser->m_timestampFormatter->m_storedTimestamp = TimestampFormatter::encodeTimestamp(1, 1, "00:00:00.000000");
+    parser->m_timestampFormatter->m_storedYear = stoi(g_stored_year);
     bool success = parser->parseMessage("Jul 21 02:10:00.000000 message test_message other_data test_data", tag, paramDict, luaState);
     EXPECT_EQ(true, success);
     EXPECT_EQ("test_tag", tag);
@@ -199,8 +201,8 @@ TEST(syslog_parser, lua_code_valid_2) {
     lua_State* luaState = luaL_newstate();
     luaL_openlibs(luaState);
 
-    parser->m_timestampFormatter->m_storedTimestamp = "010100:00:00.000000";
-    parser->m_timestampFormatter->m_storedYear = g_stored_year;
+    parser->m_timestampFormatter->m_storedTimestamp = TimestampFormatter::encodeTimestamp(1, 1, "00:00:00.000000");
+    parser->m_timestampFormatter->m_storedYear = stoi(g_stored_year);
     bool success = parser->parseMessage("Dec  3 12:36:24.503424 NOTIFICATION: received from neighbor 10.10.24.216 active 6/2 (Administrative Shutdown) 0 bytes", tag, paramDict, luaState);
     EXPECT_EQ(true, success);
     EXPECT_EQ("test_tag", tag);
@@ -209,6 +211,250 @@ TEST(syslog_parser, lua_code_valid_2) {
     lua_close(luaState);
 }
 
+vector<RegexStruct> createRegexList(const json& jList) {
+    vector<RegexStruct> regexList;
+    for(long unsigned int i = 0; i < jList.size(); i++) {
+        RegexStruct rs = RegexStruct();
+        vector<string> params = { "month", "day", "time" };
+        vector<string> eventParams = jList[i]["params"];
+        params.insert(params.end(), eventParams.begin(), eventParams.end());
+        rs.tag = jList[i]["tag"];
+        rs.eventRegex = jList[i]["regex"];
+        rs.regexExpression = regex(TIMESTAMP_REGEX + rs.eventRegex);
+        for(long unsigned int j = 0; j < params.size(); j++) {
+            EventParam ep = EventParam();
+            auto delimPos = params[j].find(':');
+            ep.paramName = params[j].substr(0, delimPos);
+            if(delimPos != string::npos) {
+                ep.luaCode = params[j].substr(delimPos + 1);
+            }
+            rs.params.push_back(ep);
+        }
+        regexList.push_back(rs);
+    }
+    return regexList;
+}
+
+TEST(syslog_parser, lua_code_compiled) {
+    json jList = json::parse(R"json([
+        { "tag": "test_tag", "regex": "(sent|received) ([0-9]*) (.*)", "params": [ "is-sent:ret=tostring(arg==\"sent\")", "code:if arg == \"0\" then ret = \"zero\" return end ret = arg", "rest:ret = (" ] }
+    ])json");
+
+    unique_ptr<SyslogParser> parser(new SyslogParser());
+    parser->setRegexList(createRegexList(jList));
+
+    // Invalid lua code is reported & the param takes the matched value
+    lua_State* luaState = luaL_newstate();
+    luaL_openlibs(luaState);
+    EXPECT_FALSE(parser->loadLuaCode(luaState));
+
+    string tag;
+    event_params_t paramDict;
+    event_params_t expectedDict = { { "is-sent", "true" }, { "code", "zero" }, { "rest", "data" } };
+    EXPECT_TRUE(parser->parseMessage("sent 0 data", tag, paramDict, luaState));
+    EXPECT_EQ(expectedDict, paramDict);
+    EXPECT_EQ(0, lua_gettop(luaState));
+
+    // Compiled in the state on first use
+    lua_State* otherState = luaL_newstate();
+    luaL_openlibs(otherState);
+    paramDict.clear();
+    expectedDict = { { "is-sent", "false" }, { "code", "12" }, { "rest", "more data" } };
+    EXPECT_TRUE(parser->parseMessage("received 12 more data", tag, paramDict, otherState));
+    EXPECT_EQ(expectedDict, paramDict);
+
+    paramDict.clear();
+    EXPECT_TRUE(parser->parseMessage("received 12 more data", tag, paramDict, luaState));
+    EXPECT_EQ(expectedDict, paramDict);
+
+    // No globals leak from functions
+    lua_getglobal(otherState, "ret");
+    EXPECT_TRUE(lua_isnil(otherState, -1));
+    lua_pop(otherState, 1);
+
+    // Compare with compiling lua code per message
+    const int lineCnt = 100000;
+    auto start = chrono::steady_clock::now();
+    for(int i = 0; i < lineCnt; i++) {
+        lua_pushstring(luaState, "sent");
+        lua_setglobal(luaState, "arg");
+        luaL_dostring(luaState, "ret=tostring(arg==\"sent\")");
+        lua_getglobal(luaState, "ret");
+        lua_pop(luaState, 1);
+    }
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    printf("Lua code per message: %.0f calls/s\n", lineCnt / secs);
+
+    EventParam param = parser->m_regexList[0].params[3];
+    lua_pushlightuserdata(luaState, parser.get());
+    lua_rawget(luaState, LUA_REGISTRYINDEX);
+    start = chrono::steady_clock::now();
+    for(int i = 0; i < lineCnt; i++) {
+        lua_rawgeti(luaState, -1, param.luaIndex);
+        lua_pushstring(luaState, "sent");
+        lua_pcall(luaState, 1, 1, 0);
+        lua_pop(luaState, 1);
+    }
+    secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    printf("Compiled lua code: %.0f calls/s\n", lineCnt / secs);
+    lua_pop(luaState, 1);
+
+    lua_close(otherState);
+    lua_close(luaState);
+}
+
+TEST(regex_prefilter, required_literals) {
+    EXPECT_EQ(vector<string>({ " %ADJCHANGE: neighbor " }), RegexPrefilter::getRequiredLiterals(".* %ADJCHANGE: neighbor (.*) (Up|Down) .*"));
+    EXPECT_EQ(vector<string>({ "write failed", "Write protected" }), RegexPrefilter::getRequiredLiterals("(write failed|Write protected)"));
+    EXPECT_EQ(vector<string>({ "NOTIFICATION: " }), RegexPrefilter::getRequiredLiterals(".*NOTIFICATION: (received|sent) (?:to|from) neighbor ([0-9a-f:.]*)\\s*.* (\\d*)\\/(\\d*)"));
+    EXPECT_EQ(vector<string>({ "% matches resource limit " }), RegexPrefilter::getRequiredLiterals(".([a-z]*). space usage (\\d+\\.\\d+)% matches resource limit .space usage.(\\d+\\.\\d+)%."));
+    EXPECT_EQ(vector<string>({ "ab" }), RegexPrefilter::getRequiredLiterals("abc?d*"));
+    EXPECT_EQ(vector<string>({ "x.y" }), RegexPrefilter::getRequiredLiterals("(?:opt)?x\\.y"));
+    EXPECT_TRUE(RegexPrefilter::getRequiredLiterals(".*").empty());
+    EXPECT_TRUE(RegexPrefilter::getRequiredLiterals("(abc|[0-9]+)").empty());
+
+    RegexPrefilter prefilter;
+    vector<bool> candidates;
+    prefilter.addRegex(".*invalid freelist");
+    prefilter.addRegex("(write failed|Write protected)");
+    prefilter.addRegex(".*");
+    prefilter.addRegex("SEU error was detected");
+    prefilter.build();
+
+    prefilter.getCandidates("Jul 21 02:10:00.000000 sda: Write protected", candidates);
+    EXPECT_EQ(vector<bool>({ false, true, true, false }), candidates);
+    prefilter.getCandidates("invalid freelist & SEU error was detected", candidates);
+    EXPECT_EQ(vector<bool>({ true, false, true, true }), candidates);
+    prefilter.getCandidates("", candidates);
+    EXPECT_EQ(vector<bool>({ false, false, true, false }), candidates);
+}
+
+TEST(syslog_parser, timestamp_prefix) {
+    vector<string> timestamp;
+    string message = "Dec  3 12:36:24.503424 NOTIFICATION";
+    EXPECT_EQ(message.find('N'), SyslogParser::parseTimestampPrefix(message, timestamp));
+    EXPECT_EQ(vector<string>({ "Dec", "3", "12:36:24.503424" }), timestamp);
+
+    EXPECT_EQ(3, (int)SyslogParser::parseTimestampPrefix("Discarding packet", timestamp));
+    EXPECT_EQ(vector<string>({ "Dis", "", "" }), timestamp);
+
+    EXPECT_EQ(0, (int)SyslogParser::parseTimestampPrefix("", timestamp));
+    EXPECT_EQ(vector<string>({ "", "", "" }), timestamp);
+}
+
+TEST(syslog_parser, prefilter_same_as_regex) {
+    json jList = json::parse(R"json([
+        { "tag": "discard", "regex": "Discarding packet received on ([a-zA-Z0-9-_]*) interface", "params": [ "ifname" ] },
+        { "tag": "bgp", "regex": ".* %ADJCHANGE: neighbor (.*) (Up|Down) .*", "params": [ "ip", "state" ] },
+        { "tag": "kernel", "regex": "(write failed|Write protected)", "params": [ "type" ] },
+        { "tag": "any", "regex": "12 (.*)", "params": [ "rest" ] }
+    ])json");
+    vector<string> messages = {
+        "Discarding packet received on Ethernet0 interface that has no IPv4 address assigned.",
+        "Jul 21 02:10:00.000000 Discarding packet received on Ethernet4 interface",
+        "Jul 21 02:10:00 bgpd[1]: %ADJCHANGE: neighbor 10.0.0.1 Down Peer closed",
+        "Write protected",
+        "Jan  1 00:00:00.1 write failed",
+        "Jul 123 no match here",
+        "no match here",
+    };
+
+    unique_ptr<SyslogParser> parser(new SyslogParser());
+    unique_ptr<SyslogParser> regexParser(new SyslogParser());
+    parser->setRegexList(createRegexList(jList));
+    regexParser->m_regexList = createRegexList(jList);
+    lua_State* luaState = luaL_newstate();
+    luaL_openlibs(luaState);
+
+    for(const auto& message : messages) {
+        string tag, regexTag;
+        event_params_t paramDict, regexParamDict;
+        bool success = parser->parseMessage(message, tag, paramDict, luaState);
+        EXPECT_EQ(regexParser->parseMessage(message, regexTag, regexParamDict, luaState), success);
+        EXPECT_EQ(regexTag, tag);
+        paramDict.erase("timestamp");
+        regexParamDict.erase("timestamp");
+        EXPECT_EQ(regexParamDict, paramDict);
+    }
+
+    string tag;
+    event_params_t paramDict;
+    EXPECT_TRUE(parser->parseMessage(messages[0], tag, paramDict, luaState));
+    EXPECT_EQ("discard", tag);
+    EXPECT_EQ("Ethernet0", paramDict["ifname"]);
+
+    lua_close(luaState);
+}
+
+TEST(syslog_parser, prefilter_benchmark) {
+    // Regex files shipped with docker-eventd
+    const string regexDir = "../../dockers/docker-eventd/";
+    const vector<string> regexFiles = { "bgp_regex.json", "bgpd_regex.json", "dhcp_relay_regex.json", "dockerd_regex.json",
+        "kernel_regex.json", "monit_regex.json", "seu_regex.json", "swss_regex.json", "syncd_regex.json", "systemd_regex.json" };
+    vector<RegexStruct> regexList;
+
+    for(const auto& regexFile : regexFiles) {
+        ifstream infile(regexDir + regexFile);
+        json jList;
+        if(!infile) {
+            printf("Skipping benchmark; %s not found\n", (regexDir + regexFile).c_str());
+            return;
+        }
+        infile >> jList;
+        vector<RegexStruct> fileList = createRegexList(jList);
+        regexList.insert(regexList.end(), fileList.begin(), fileList.end());
+    }
+
+    const string timestamp = "Jul 21 02:10:00.123456 ";
+    vector<string> matching = {
+        "Peer 'default|10.0.0.57' admin state is set to 'down'",
+        "bgpd[37]: NOTIFICATION: sent to neighbor 10.0.0.57 6/2 (Cease/Administrative Shutdown) 0 bytes",
+        "Discarding packet received on Ethernet4 interface that has no IPv4 address assigned.",
+        "invalid freelist",
+        "Remounting filesystem read-only",
+        "'root-overlay' space usage 92.5% matches resource limit [space usage>90.0%]",
+        "Received switch event",
+        "Stopped swss.service - switch state service container.",
+    };
+    vector<string> nonMatching = {
+        "bgpd[37]: %ADJCHANGE: neighbor 10.0.0.57(ARISTA01T2) in vrf default Up",
+        "swss#orchagent: :- doTask: Failed to process task",
+        "systemd[1]: Started Daily apt download activities.",
+        "kernel: [ 123.456] Ethernet4: link up",
+        "sshd[4242]: Accepted publickey for admin from 10.1.1.1 port 53000 ssh2",
+        "monit[1]: 'container_checker' status succeeded",
+    };
+
+    unique_ptr<SyslogParser> parser(new SyslogParser());
+    unique_ptr<SyslogParser> regexParser(new SyslogParser());
+    parser->setRegexList(regexList);
+    regexParser->m_regexList = regexList;
+    lua_State* luaState = luaL_newstate();
+    luaL_openlibs(luaState);
+
+    const int lineCnt = 5000;
+    for(auto* lines : { &matching, &nonMatching }) {
+        for(auto& line : *lines) {
+            line = timestamp + line;
+        }
+        for(auto* p : { regexParser.get(), parser.get() }) {
+            int matchCnt = 0;
+            auto start = chrono::steady_clock::now();
+            for(int i = 0; i < lineCnt; i++) {
+                string tag;
+                event_params_t paramDict;
+                matchCnt += p->parseMessage((*lines)[i % lines->size()], tag, paramDict, luaState);
+            }
+            double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            printf("%s traffic, %s: %.0f lines/s\n", (lines == &matching) ? "Matching" : "Non-matching",
+                    (p == parser.get()) ? "prefilter" : "regex only", lineCnt / secs);
+            EXPECT_EQ((lines == &matching) ? lineCnt : 0, matchCnt);
+        }
+    }
+
+    lua_close(luaState);
+}
+
 TEST(rsyslog_plugin, onInit_emptyJSON) {
     unique_ptr<RsyslogPlugin> plugin(new RsyslogPlugin("test_mod_name", "./rsyslog_plugin_tests/test_regex_1.rc.json"));
     EXPECT_NE(0, plugin->onInit());
@@ -264,6 +510,22 @@ TEST(rsyslog_plugin, run) {
     cin.rdbuf(cinbuf);
 }
 
+TEST(rsyslog_plugin, run_batched) {
+    unique_ptr<RsyslogPlugin> plugin(new RsyslogPlugin("test_mod_name", "./rsyslog_plugin_tests/test_regex_5.rc.json"));
+    EXPECT_EQ(0, plugin->onInit());
+    plugin->setBatchMode(3);
+    lua_State* luaState = luaL_newstate();
+    EXPECT_TRUE(plugin->onMessage("batched message", luaState));
+    EXPECT_TRUE(plugin->publishEvents());
+    lua_close(luaState);
+    istringstream ss("first\nsecond\n\nthird\nfourth\nfifth\n");
+    streambuf* cinbuf = cin.rdbuf();
+    cin.rdbuf(ss.rdbuf());
+    plugin->run();
+    cin.rdbuf(cinbuf);
+    EXPECT_TRUE(plugin->publishEvents());
+}
+
 TEST(rsyslog_plugin, run_SIGTERM) {
     unique_ptr<RsyslogPlugin> plugin(new RsyslogPlugin("test_mod_name", "./rsyslog_plugin_tests/test_regex_5.rc.json"));
     EXPECT_EQ(0, plugin->onInit());
@@ -286,30 +548,96 @@ TEST(timestampFormatter, changeTimestampFormat) {
     vector<string> timestampTwo = { "Jan", "1", "00:00:00.000000" };
     vector<string> timestampThree = { "Dec", "31", "23:59:59.000000" };
 
-    formatter->m_storedTimestamp = "010100:00:00.000000";
-    formatter->m_storedYear = g_stored_year;
+    formatter->m_storedTimestamp = TimestampFormatter::encodeTimestamp(1, 1, "00:00:00.000000");
+    formatter->m_storedYear = stoi(g_stored_year);
 
     string formattedTimestampOne = formatter->changeTimestampFormat(timestampOne);
     string expectedTimestampOne = g_stored_year + "-07-20T10:09:40.230874Z";
 
     EXPECT_EQ(expectedTimestampOne, formattedTimestampOne);
 
-    EXPECT_EQ("072010:09:40.230874", formatter->m_storedTimestamp);
+    EXPECT_EQ(TimestampFormatter::encodeTimestamp(7, 20, "10:09:40.230874"), formatter->m_storedTimestamp);
+    EXPECT_EQ(720100940230874ULL, formatter->m_storedTimestamp);
 
-    formatter->m_storedTimestamp = "010100:00:00.000000";
-    formatter->m_storedYear = g_stored_year;
+    formatter->m_storedTimestamp = TimestampFormatter::encodeTimestamp(1, 1, "00:00:00.000000");
+    formatter->m_storedYear = stoi(g_stored_year);
 
     string formattedTimestampTwo = formatter->changeTimestampFormat(timestampTwo);
     string expectedTimestampTwo = g_stored_year + "-01-01T00:00:00.000000Z";
     EXPECT_EQ(expectedTimestampTwo, formattedTimestampTwo);
 
-    formatter->m_storedTimestamp = "010100:00:00.000000";
-    formatter->m_storedYear = "2025";
+    formatter->m_storedTimestamp = TimestampFormatter::encodeTimestamp(1, 1, "00:00:00.000000");
+    formatter->m_storedYear = 2025;
 
     string formattedTimestampThree = formatter->changeTimestampFormat(timestampThree);
     EXPECT_EQ("2025-12-31T23:59:59.000000Z", formattedTimestampThree);
 }
 
+TEST(timestampFormatter, yearRollover) {
+    unique_ptr<TimestampFormatter> formatter(new TimestampFormatter());
+    time_t currentTime = time(nullptr);
+    struct tm localTime;
+    localtime_r(&currentTime, &localTime);
+    int currentYear = 1900 + localTime.tm_year;
+    string lastYear = to_string(currentYear - 1);
+    string thisYear = to_string(currentYear);
+
+    // First timestamp takes current year
+    EXPECT_EQ(thisYear + "-06-15T12:00:00.000000Z", formatter->changeTimestampFormat({ "Jun", "15", "12:00:00.000000" }));
+    EXPECT_EQ(currentYear, formatter->m_storedYear);
+
+    // Dec 31 to Jan 1 refreshes year
+    formatter->m_storedTimestamp = TimestampFormatter::encodeTimestamp(12, 31, "23:59:59.999999");
+    formatter->m_storedYear = currentYear - 1;
+    EXPECT_EQ(lastYear + "-12-31T23:59:59.999999Z", formatter->changeTimestampFormat({ "Dec", "31", "23:59:59.999999" }));
+    EXPECT_EQ(thisYear + "-01-01T00:00:00.000000Z", formatter->changeTimestampFormat({ "Jan", "1", "00:00:00.000000" }));
+    EXPECT_EQ(thisYear + "-01-01T00:00:00.5Z", formatter->changeTimestampFormat({ "Jan", "1", "00:00:00.5" }));
+
+    // Year is not refreshed for reordered message in same month, nor for later months
+    formatter->m_storedTimestamp = TimestampFormatter::encodeTimestamp(1, 5, "10:00:00.000000");
+    formatter->m_storedYear = 1999;
+    EXPECT_EQ("1999-01-05T09:59:59.999999Z", formatter->changeTimestampFormat({ "Jan", "5", "09:59:59.999999" }));
+    EXPECT_EQ(TimestampFormatter::encodeTimestamp(1, 5, "10:00:00.000000"), formatter->m_storedTimestamp);
+    EXPECT_EQ("1999-02-29T00:00:00Z", formatter->changeTimestampFormat({ "Feb", "29", "00:00:00" }));
+    EXPECT_EQ("1999-12-31T23:59:59.000001Z", formatter->changeTimestampFormat({ "Dec", "31", "23:59:59.000001" }));
+
+    // Fraction compares as micro seconds irrespective of digits
+    EXPECT_LT(TimestampFormatter::encodeTimestamp(12, 31, "23:59:59.09"), TimestampFormatter::encodeTimestamp(12, 31, "23:59:59.1"));
+    EXPECT_EQ("1999-12-31T23:59:59.1Z", formatter->changeTimestampFormat({ "Dec", "31", "23:59:59.1" }));
+
+    // Invalid components
+    EXPECT_EQ("", formatter->changeTimestampFormat({ "Foo", "1", "00:00:00.000000" }));
+    EXPECT_EQ("", formatter->changeTimestampFormat({ "Jan", "123", "00:00:00.000000" }));
+    EXPECT_EQ("", formatter->changeTimestampFormat({ "Jan", "1", "00:0x:00.000000" }));
+    EXPECT_EQ("", formatter->changeTimestampFormat({ "Jan", "1" }));
+    char buf[8];
+    EXPECT_EQ(0, (int)formatter->formatTimestamp("Jan", "1", "00:00:00.000000", buf, sizeof(buf)));
+}
+
+TEST(timestampFormatter, benchmark) {
+    unique_ptr<TimestampFormatter> formatter(new TimestampFormatter());
+    const char* months[] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+    char buf[TIMESTAMP_BUFFER_SIZE];
+    const int cnt = 1000000;
+    size_t total = 0;
+
+    auto start = chrono::steady_clock::now();
+    for(int i = 0; i < cnt; i++) {
+        total += formatter->formatTimestamp(months[(i / 100000) % 12], "21", "02:10:00.123456", buf, sizeof(buf));
+    }
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    printf("formatTimestamp: %.0f timestamps/s\n", cnt / secs);
+    EXPECT_EQ((size_t)cnt * 27, total);
+
+    vector<string> components = { "Jul", "21", "02:10:00.123456" };
+    start = chrono::steady_clock::now();
+    for(int i = 0; i < cnt; i++) {
+        total += formatter->changeTimestampFormat(components).size();
+    }
+    secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    printf("changeTimestampFormat: %.0f timestamps/s\n", cnt / secs);
+}
+
 int main(int argc, char* argv[]) {
     testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
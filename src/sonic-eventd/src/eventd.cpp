@@ -1,11 +1,12 @@
 #include <thread>
 #include <memory>
+#include <limits>
 #include "eventd.h"
 #include "dbconnector.h"
 #include "zmq.h"
 
 /*
- * There are 5 threads, including the main
+ * There are 5 threads, including the main, and an optional 6th
  *
  * (0) main thread -- Runs eventd service that accepts commands event_req_type_t
  *  This can be used to control caching events and a no-op echo service.
@@ -22,6 +23,9 @@
  *
  * (4) Thread to update counters from memory to redis periodically.
  *
+ * (5) Optional journal service, that persists all events off capture
+ *     end point, to replay upon request.
+ *
  */
 
 using namespace std;
@@ -40,6 +44,9 @@ using namespace swss;
 /* Sock read timeout in milliseconds, to enable look for control signals */
 #define CAPTURE_SOCK_TIMEOUT 800
 
+/* Max events read from capture socket w/o checking control signals */
+#define CAPTURE_READ_BATCH 1024
+
 #define HEARTBEAT_INTERVAL_SECS 2  /* Default: 2 seconds */
 
 /* Source & tag for heartbeat events */
@@ -52,8 +59,21 @@ const char *counter_keys[COUNTERS_EVENTS_TOTAL] = {
     COUNTERS_EVENTS_MISSED_CACHE
 };
 
+/* Fields of EVENTS_STATS_KEY */
+const char *stats_fields[STATS_TOTAL] = {
+    "deserialize_failed",
+    "cache_bytes",
+    "capture_batch",
+    "capture_batch_peak"
+};
+
+#define EVENTS_STATS_LATENCY_P50 "forward_latency_p50_ms"
+#define EVENTS_STATS_LATENCY_P99 "forward_latency_p99_ms"
+
 static bool s_unit_testing = false;
 
+static journal_config_t s_journal_cfg;
+
 int
 eventd_proxy::init()
 {
@@ -96,13 +116,66 @@ eventd_proxy::run()
 }
 
 
+void
+latency_histogram::reset()
+{
+    for (int i=0; i < BUCKETS; ++i) {
+        m_buckets[i] = 0;
+    }
+    m_cnt = 0;
+}
+
+
+void
+latency_histogram::add(int64_t val_ms)
+{
+    uint64_t val = val_ms > 0 ? (uint64_t)val_ms : 0;
+    int idx;
+
+    if (val < 16) {
+        idx = (int)val;
+    }
+    else {
+        int msb = 63 - __builtin_clzll(val);
+        idx = 16 + ((msb - 4) * 4) + (int)((val >> (msb - 2)) & 3);
+    }
+    m_buckets[idx]++;
+    m_cnt++;
+}
+
+
+int64_t
+latency_histogram::percentile(int pct) const
+{
+    counters_t rank = ((m_cnt * pct) + 99) / 100;
+    counters_t seen = 0;
+
+    for (int i=0; (m_cnt != 0) && (i < BUCKETS); ++i) {
+        seen += m_buckets[i];
+        if ((seen >= rank) && (m_buckets[i] != 0)) {
+            if (i < 16) {
+                return i;
+            }
+            return (int64_t)(4 + ((i - 16) % 4)) << (((i - 16) / 4) + 2);
+        }
+    }
+    return 0;
+}
+
+
 stats_collector::stats_collector() :
     m_shutdown(false), m_pause_heartbeat(false), m_heartbeats_published(0),
     m_heartbeats_interval_cnt(0)
 {
     set_heartbeat_interval(HEARTBEAT_INTERVAL_SECS);
-    for (int i=0; i < COUNTERS_EVENTS_TOTAL; ++i) {
-        m_lst_counters[i] = 0;
+    for (int i=0; i < STATS_COUNTER_SHARDS; ++i) {
+        for (int j=0; j < COUNTERS_EVENTS_TOTAL; ++j) {
+            m_shards[i].counters[j] = 0;
+        }
+        m_shards[i].deserialize_failed = 0;
+    }
+    for (int i=0; i < STATS_TOTAL; ++i) {
+        m_stats[i] = 0;
     }
     m_updated = false;
 }
@@ -154,8 +227,10 @@ stats_collector::start()
         }
         RET_ON_ERR(m_counters_db != NULL, "Failed to get COUNTERS_DB");
 
+        /* Buffered table; All counters are sent as one pipeline per write */
+        m_pipeline = make_shared<swss::RedisPipeline>(m_counters_db.get());
         m_stats_table = make_shared<swss::Table>(
-                m_counters_db.get(), COUNTERS_EVENTS_TABLE);
+                m_pipeline.get(), COUNTERS_EVENTS_TABLE, true);
         RET_ON_ERR(m_stats_table != NULL, "Failed to get events table");
 
         m_thr_writer = thread(&stats_collector::run_writer, this);
@@ -167,32 +242,108 @@ out:
 }
 
 void
-stats_collector::run_writer()
+stats_collector::update_key_stats(const event_receive_op_t &op)
 {
-    while (true) {
-        if (m_updated.exchange(false)) {
-            /* Update if there had been any update */
+    string source = op.key.substr(0, op.key.find(':'));
+    int64_t now_ms = chrono::duration_cast<chrono::milliseconds>(
+            chrono::system_clock::now().time_since_epoch()).count();
+
+    lock_guard<mutex> lock(m_key_stats_mtx);
+
+    m_published_by_source[source] += 1 + op.missed_cnt;
+    m_published_by_tag[op.key]++;
+    if (op.publish_epoch_ms > 0) {
+        /* Publish to receive via proxy */
+        m_latency.add(now_ms - op.publish_epoch_ms);
+    }
+}
+
+
+void
+stats_collector::write_counters()
+{
+    vector<FieldValueTuple> fv_stats, fv_src, fv_rate, fv_tag;
+    auto now = chrono::steady_clock::now();
+    int64_t elapsed_ms = chrono::duration_cast<chrono::milliseconds>(
+            now - m_last_write).count();
 
-            for (int i = 0; i < COUNTERS_EVENTS_TOTAL; ++i) {
-                vector<FieldValueTuple> fv;
+    for (int i = 0; i < COUNTERS_EVENTS_TOTAL; ++i) {
+        vector<FieldValueTuple> fv;
 
-                fv.emplace_back(EVENTS_STATS_FIELD_NAME, to_string(m_lst_counters[i]));
+        fv.emplace_back(EVENTS_STATS_FIELD_NAME,
+                to_string(read_counter((stats_counter_index_t)i)));
 
-                m_stats_table->set(counter_keys[i], fv);
+        m_stats_table->set(counter_keys[i], fv);
+    }
+
+    for (int i = 0; i < STATS_TOTAL; ++i) {
+        fv_stats.emplace_back(stats_fields[i], to_string(read_stat((stats_index_t)i)));
+    }
+
+    {
+        lock_guard<mutex> lock(m_key_stats_mtx);
+
+        if (m_latency.count() != 0) {
+            /* Latency over the last write interval */
+            fv_stats.emplace_back(EVENTS_STATS_LATENCY_P50, to_string(m_latency.percentile(50)));
+            fv_stats.emplace_back(EVENTS_STATS_LATENCY_P99, to_string(m_latency.percentile(99)));
+            m_latency.reset();
+        }
+
+        for (const auto &itc : m_published_by_source) {
+            counters_t &last = m_published_by_source_last[itc.first];
+
+            fv_src.emplace_back(itc.first, to_string(itc.second));
+            if (elapsed_ms > 0) {
+                fv_rate.emplace_back(itc.first,
+                        to_string((itc.second - last) * 1000 / elapsed_ms));
             }
+            last = itc.second;
+        }
+        for (const auto &itc : m_published_by_tag) {
+            fv_tag.emplace_back(itc.first, to_string(itc.second));
+        }
+    }
+    m_last_write = now;
+
+    m_stats_table->set(EVENTS_STATS_KEY, fv_stats);
+    if (!fv_src.empty()) {
+        m_stats_table->set(EVENTS_STATS_PUBLISHED_BY_SOURCE_KEY, fv_src);
+        m_stats_table->set(EVENTS_STATS_PUBLISH_RATE_BY_SOURCE_KEY, fv_rate);
+        m_stats_table->set(EVENTS_STATS_PUBLISHED_BY_TAG_KEY, fv_tag);
+    }
+    m_stats_table->flush();
+}
+
+
+void
+stats_collector::run_writer()
+{
+    m_last_write = chrono::steady_clock::now();
+
+    while (true) {
+        {
+            /* Sleep until any update or shutdown */
+            unique_lock<mutex> lock(m_writer_mtx);
+            m_writer_cv.wait(lock, [this]() { return m_updated || m_shutdown; });
+        }
+
+        if (m_updated.exchange(false)) {
+            /* Update if there had been any update */
+            write_counters();
         }
         if (m_shutdown) {
             break;
         }
-        this_thread::sleep_for(chrono::milliseconds(10));
         /*
-         * After sleep always do an update if needed before checking
-         * shutdown flag, as any counters collected during sleep
-         * needs to be updated.
+         * Rate limit writes. Any counters collected during sleep is
+         * written upon wake up, before checking shutdown flag.
          */
+        this_thread::sleep_for(chrono::milliseconds(STATS_WRITE_INTERVAL_MS));
     }
 
     m_stats_table.reset();
+    m_pipeline.reset();
     m_counters_db.reset();
 }
 
@@ -247,6 +398,7 @@ stats_collector::run_collector()
         if ((rc == 0) && (op.key != hb_key)) {
             /* TODO: Discount EVENT_STR_CTRL_DEINIT messages too */
             increment_published(1+op.missed_cnt);
+            update_key_stats(op);
 
             /* reset counter on receive to restart. */
             hb_cntr = 0;
@@ -255,7 +407,8 @@ stats_collector::run_collector()
             if (rc < 0) {
                 SWSS_LOG_ERROR(
                         "event_receive failed with rc=%d; stats:published(%lu)", rc,
-                        m_lst_counters[INDEX_COUNTERS_EVENTS_PUBLISHED]);
+                        read_counter(INDEX_COUNTERS_EVENTS_PUBLISHED));
+                increment_deserialize_failed(1);
             }
             if (!m_pause_heartbeat && (m_heartbeats_interval_cnt > 0) &&
                     ++hb_cntr >= m_heartbeats_interval_cnt) {
@@ -281,8 +434,134 @@ out:
     events_deinit_subscriber(subs_handle);
     events_deinit_publisher(pub_handle);
     m_shutdown = true;
+    notify_writer();
+}
+
+int
+event_ring_cache::init(size_t cap)
+{
+    release();
+
+    if (cap > 0) {
+        /*
+         * Not zero filled on purpose. Pages of a large malloc are mapped on
+         * first write, hence RSS grows with cached bytes, bounded by cap.
+         */
+        m_buf = (char *)malloc(cap);
+        if (m_buf == NULL) {
+            SWSS_LOG_ERROR("Failed to allocate event cache of %lu bytes", cap);
+            return -1;
+        }
+        m_cap = cap;
+    }
+    return 0;
+}
+
+
+void
+event_ring_cache::release()
+{
+    clear();
+    free(m_buf);
+    m_buf = NULL;
+    m_cap = 0;
+}
+
+
+bool
+event_ring_cache::push_back(const void *data, size_t len)
+{
+    const rec_len_t wrap_marker = numeric_limits<rec_len_t>::max();
+    size_t need = sizeof(rec_len_t) + len;
+    size_t offset;
+
+    if ((len >= wrap_marker) || (need > m_cap)) {
+        return false;
+    }
+    if (m_cnt == 0) {
+        /* Restart from arena start to get the most contiguous room */
+        clear();
+    }
+
+    if (!m_wrapped) {
+        if (need <= (m_cap - m_tail)) {
+            offset = m_tail;
+        }
+        else if (need <= m_head) {
+            /* Mark the unused tail, for reader to skip to arena start */
+            if ((m_cap - m_tail) >= sizeof(rec_len_t)) {
+                write_len(m_tail, wrap_marker);
+            }
+            m_wrapped = true;
+            offset = 0;
+        }
+        else {
+            return false;
+        }
+    }
+    else if (need <= (m_head - m_tail)) {
+        offset = m_tail;
+    }
+    else {
+        return false;
+    }
+
+    write_len(offset, (rec_len_t)len);
+    memcpy(m_buf + offset + sizeof(rec_len_t), data, len);
+    m_tail = offset + need;
+    m_bytes += need;
+    ++m_cnt;
+    return true;
+}
+
+
+bool
+event_ring_cache::front(string_view &evt) const
+{
+    if (m_cnt == 0) {
+        return false;
+    }
+    evt = string_view(m_buf + m_head + sizeof(rec_len_t), read_len(m_head));
+    return true;
 }
 
+
+void
+event_ring_cache::pop_front()
+{
+    if (m_cnt == 0) {
+        return;
+    }
+
+    size_t sz = sizeof(rec_len_t) + read_len(m_head);
+
+    m_head += sz;
+    m_bytes -= sz;
+    if (--m_cnt == 0) {
+        clear();
+    }
+    else if (m_wrapped && (((m_cap - m_head) < sizeof(rec_len_t)) ||
+                (read_len(m_head) == numeric_limits<rec_len_t>::max()))) {
+        /* Reached the point, where writer wrapped */
+        m_head = 0;
+        m_wrapped = false;
+    }
+}
+
+
+void
+event_ring_cache::swap(event_ring_cache &other)
+{
+    std::swap(m_buf, other.m_buf);
+    std::swap(m_cap, other.m_cap);
+    std::swap(m_head, other.m_head);
+    std::swap(m_tail, other.m_tail);
+    std::swap(m_wrapped, other.m_wrapped);
+    std::swap(m_cnt, other.m_cnt);
+    std::swap(m_bytes, other.m_bytes);
+}
+
+
 capture_service::~capture_service()
 {
     stop_capture();
@@ -323,6 +602,115 @@ validate_event(const internal_event_t &event, runtime_id_t &rid, sequence_t &seq
 }
 
 
+/* Reads a decimal number followed by single space delimiter */
+static bool
+scan_archive_num(const char *&p, const char *end, size_t &val)
+{
+    const char *st = p;
+
+    val = 0;
+    while ((p < end) && isdigit(*p) && ((p - st) < 18)) {
+        val = (val * 10) + (*p++ - '0');
+    }
+    if ((p == st) || (p >= end) || (*p != ' ')) {
+        return false;
+    }
+    ++p;
+    return true;
+}
+
+
+/*
+ * Get runtime ID & sequence of an event from its wire bytes, w/o
+ * deserializing the event. The bytes are internal_event_t saved as boost
+ * text archive, as below.
+ *
+ *  "22 serialization::archive <ver> 0 0 <cnt> 0 0 0 <len> <key> <len> <val> ..."
+ *
+ * Keys & values are skipped by length, only runtime ID & sequence are
+ * copied out. Any unexpected layout is treated as parse failure and
+ * caller falls back to deserialize.
+ */
+static bool
+parse_event_ids(const char *data, size_t len, runtime_id_t &rid, sequence_t &seq)
+{
+    static const char hdr[] = "22 serialization::archive ";
+    const char *p = data + sizeof(hdr) - 1;
+    const char *end = data + len;
+    size_t val, cnt;
+    bool has_rid = false, has_seq = false, has_data = false;
+
+    if ((len < (sizeof(hdr) - 1)) || (memcmp(data, hdr, sizeof(hdr) - 1) != 0)) {
+        return false;
+    }
+
+    /* Library version, class info, count & item version */
+    if (!scan_archive_num(p, end, val) || !scan_archive_num(p, end, val) ||
+            !scan_archive_num(p, end, val) || !scan_archive_num(p, end, cnt) ||
+            !scan_archive_num(p, end, val)) {
+        return false;
+    }
+
+    /* Class info of pair precedes the first element */
+    if ((cnt != 0) && (!scan_archive_num(p, end, val) || !scan_archive_num(p, end, val))) {
+        return false;
+    }
+
+    for (size_t i = 0; i < cnt; ++i) {
+        string_view key, value;
+        size_t klen, vlen;
+
+        if (!scan_archive_num(p, end, klen) || (klen >= (size_t)(end - p))) {
+            return false;
+        }
+        key = string_view(p, klen);
+        p += klen;
+        if (*p++ != ' ') {
+            return false;
+        }
+        if (!scan_archive_num(p, end, vlen) || (vlen > (size_t)(end - p))) {
+            return false;
+        }
+        value = string_view(p, vlen);
+        p += vlen;
+        /* Delimiter before next key or the archive end */
+        if ((p < end) && !isspace(*p++)) {
+            return false;
+        }
+
+        if (key == EVENT_RUNTIME_ID) {
+            rid.assign(value);
+            has_rid = true;
+        }
+        else if (key == EVENT_SEQUENCE) {
+            seq = str_to_seq(string(value));
+            has_seq = true;
+        }
+        else if (key == EVENT_STR_DATA) {
+            has_data = true;
+        }
+    }
+    return has_rid && has_seq && has_data;
+}
+
+
+/*
+ * Get runtime ID & sequence of a serialized event.
+ * Returns false for invalid event.
+ */
+static bool
+get_event_ids(const char *data, size_t len, runtime_id_t &rid, sequence_t &seq)
+{
+    internal_event_t event;
+
+    if (parse_event_ids(data, len, rid, seq)) {
+        return true;
+    }
+    return ((deserialize(string(data, len), event) == 0) &&
+            validate_event(event, rid, seq));
+}
+
+
 /*
  * Initialize cache with set of events provided.
  * Events read by cache service will be appended
@@ -336,45 +724,186 @@ capture_service::init_capture_cache(const event_serialized_lst_t &lst)
      * No check for max cache size here, as most likely not needed.
      */
     for (event_serialized_lst_t::const_iterator itc = lst.begin(); itc != lst.end(); ++itc) {
-        internal_event_t event;
-
-        if (deserialize(*itc, event) == 0) {
-            runtime_id_t rid;
-            sequence_t seq;
+        runtime_id_t rid;
+        sequence_t seq;
 
-            if (validate_event(event, rid, seq)) {
-                m_pre_exist_id[rid] = seq;
-                m_events.push_back(*itc);
+        if (get_event_ids(itc->data(), itc->size(), rid, seq)) {
+            m_pre_exist_id[rid] = seq;
+            if (!m_events.push_back(*itc)) {
+                SWSS_LOG_ERROR("Cache full with initial events size=%d bytes=%lu",
+                        VEC_SIZE(m_events), m_events.bytes());
+                break;
             }
         }
     }
 }
 
 
+/*
+ * Save the last event per runtime ID, upon cache overflow.
+ * Every event replaced here is lost to the consumer of the cache. Hence
+ * only replaces are counted as missed, which keeps the count exact.
+ * A replace reuses the string buffer of the previous event.
+ */
+void
+capture_service::save_last_event(const runtime_id_t &rid, const char *data, size_t len)
+{
+    pair<last_events_t::iterator, bool> res = m_last_events.emplace(rid, event_serialized_t());
+
+    res.first->second.assign(data, len);
+    if (!res.second) {
+        m_total_missed_cache++;
+        m_stats_instance->increment_missed_cache(1);
+    }
+}
+
+
 void
-capture_service::do_capture()
+capture_service::set_cap_state_last()
 {
-    int rc;
-    int block_ms=CAPTURE_SOCK_TIMEOUT;
-    int init_cnt;
-    void *cap_sub_sock = NULL;
-    counters_t total_overflow = 0;
+    m_cap_state = CAP_STATE_LAST;
+    /* Clear the map, created to ensure memory space available */
+    m_last_events.clear();
+    m_last_events_init = true;
+}
+
 
-    typedef enum {
+void
+capture_service::save_event(const runtime_id_t &rid, sequence_t seq,
+        const char *data, size_t len)
+{
+    switch(m_cap_state) {
+    case CAP_STATE_INIT:
         /*
-         * In this state every event read is compared with init cache given
-         * Only new events are saved.
+         * In this state check against cache, if duplicate
+         * When duplicate or new one seen, remove the entry from pre-exist map
+         * Stay in this state, until the pre-exist cache is empty or as many
+         * messages as in cache are seen, as in worst case even if you see
+         * duplicate of each, it will end with first m_events.size()
          */
-        CAP_STATE_INIT = 0,
+        {
+            bool add = true;
+            m_init_cnt--;
+            pre_exist_id_t::iterator it = m_pre_exist_id.find(rid);
+
+            if (it != m_pre_exist_id.end()) {
+                if (seq <= it->second) {
+                    /* Duplicate; Later/same seq in cache. */
+                    add = false;
+                }
+                if (seq >= it->second) {
+                    /* new one; This runtime ID need not be checked again */
+                    m_pre_exist_id.erase(it);
+                }
+            }
+            if (add && !m_events.push_back(data, len)) {
+                SWSS_LOG_ERROR("Cache full in init events:size=%d bytes=%lu",
+                        VEC_SIZE(m_events), m_events.bytes());
+                pre_exist_id_t().swap(m_pre_exist_id);
+                set_cap_state_last();
+                save_last_event(rid, data, len);
+                break;
+            }
+        }
+        if(m_pre_exist_id.empty() || (m_init_cnt <= 0)) {
+            /* Init check is no more needed. */
+            pre_exist_id_t().swap(m_pre_exist_id);
+            m_cap_state = CAP_STATE_ACTIVE;
+        }
+        break;
+
+    case CAP_STATE_ACTIVE:
+        /* Save until max allowed */
+        if (m_events.push_back(data, len)) {
+            if (VEC_SIZE(m_events) >= m_cache_max) {
+                set_cap_state_last();
+            }
+            break;
+        }
+        SWSS_LOG_ERROR("Cache full events:size=%d bytes=%lu",
+                VEC_SIZE(m_events), m_events.bytes());
+        set_cap_state_last();
+        /* fall through to save this event in last set. */
+
+    case CAP_STATE_LAST:
+        save_last_event(rid, data, len);
+        break;
+    }
+}
+
+
+/*
+ * Read one message from capture socket w/o blocking.
+ *
+ * Each event is 2 parts, source & serialized event. Only the second part
+ * is parsed for runtime ID & sequence. The event bytes are left in msg,
+ * for caller to copy as is. No deserialize/serialize of the event.
+ *
+ * Returns 0 on read, EAGAIN when socket is drained, else zmq errno.
+ * valid is set, when msg holds an event. Invalid events are counted in
+ * stats, if given.
+ */
+static int
+read_capture_event(void *sock, zmq_msg_t &msg, runtime_id_t &rid,
+        sequence_t &seq, bool &valid, stats_collector *stats)
+{
+    valid = false;
+
+    if (zmq_msg_recv(&msg, sock, ZMQ_DONTWAIT) == -1) {
+        return zmq_errno();
+    }
+    if (!zmq_msg_more(&msg)) {
+        /*
+         * The capture socket captures SUBSCRIBE requests too, which
+         * is single part. Skip.
+         */
+        return 0;
+    }
 
-        /* In this state, all events read are cached until max limit */
-        CAP_STATE_ACTIVE,
+    /* Parts of a message are delivered together; Hence won't block */
+    if (zmq_msg_recv(&msg, sock, 0) == -1) {
+        return zmq_errno();
+    }
+    if (zmq_msg_more(&msg)) {
+        SWSS_LOG_ERROR("Don't expect more than 2 parts in capture");
+        while (zmq_msg_more(&msg) && (zmq_msg_recv(&msg, sock, 0) != -1));
+        return 0;
+    }
+
+    valid = get_event_ids((const char *)zmq_msg_data(&msg), zmq_msg_size(&msg),
+            rid, seq);
+    if (!valid && (stats != NULL)) {
+        stats->increment_deserialize_failed(1);
+    }
+    return 0;
+}
+
+
+/* Read one message from capture socket & cache it, if valid. */
+int
+capture_service::read_capture_msg(void *sock, zmq_msg_t &msg)
+{
+    runtime_id_t rid;
+    sequence_t seq = 0;
+    bool valid;
+    int rc = read_capture_event(sock, msg, rid, seq, valid, m_stats_instance);
+
+    if ((rc == 0) && valid) {
+        save_event(rid, seq, (const char *)zmq_msg_data(&msg), zmq_msg_size(&msg));
+    }
+    return rc;
+}
 
-        /* Cache has hit max. Hence only save last event for each runime ID */
-        CAP_STATE_LAST
-    } cap_state_t;
 
-    cap_state_t cap_state = CAP_STATE_INIT;
+void
+capture_service::do_capture()
+{
+    int rc;
+    void *cap_sub_sock = NULL;
+    zmq_msg_t msg;
+    zmq_pollitem_t item;
+
+    zmq_msg_init(&msg);
 
     /*
      * Need subscription for publishers to publish.
@@ -390,9 +919,6 @@ capture_service::do_capture()
     rc = zmq_setsockopt(cap_sub_sock, ZMQ_SUBSCRIBE, "", 0);
     RET_ON_ERR(rc == 0, "Failing to ZMQ_SUBSCRIBE");
 
-    rc = zmq_setsockopt(cap_sub_sock, ZMQ_RCVTIMEO, &block_ms, sizeof (block_ms));
-    RET_ON_ERR(rc == 0, "Failed to ZMQ_RCVTIMEO to %d", block_ms);
-
     m_cap_run = true;
 
     while (m_ctrl != START_CAPTURE) {
@@ -413,98 +939,41 @@ capture_service::do_capture()
      * Hence until as many events as in initial stock or until the cached id map
      * is empty, do this check.
      */
-    init_cnt = (int)m_events.size();
+    m_init_cnt = (int)m_events.size();
+    m_cap_state = CAP_STATE_INIT;
+
+    item.socket = cap_sub_sock;
+    item.fd = 0;
+    item.events = ZMQ_POLLIN;
+    item.revents = 0;
 
     /* Read until STOP_CAPTURE */
     while(m_ctrl == START_CAPTURE) {
-        runtime_id_t rid;
-        sequence_t seq;
-        internal_event_t event;
-        string source, evt_str;
-
-        if ((rc = zmq_message_read(cap_sub_sock, 0, source, event)) != 0) {
-            /*
-             * The capture socket captures SUBSCRIBE requests too.
-             * The messge could contain subscribe filter strings and binary code.
-             * Empty string with binary code will fail to deserialize.
-             * Else would fail event validation.
-             */
-            RET_ON_ERR((rc == EAGAIN) || (rc == ERR_MESSAGE_INVALID),
-                "0:Failed to read from capture socket");
+        /* Block with timeout, to enable look for control signals */
+        rc = zmq_poll(&item, 1, CAPTURE_SOCK_TIMEOUT);
+        if (rc <= 0) {
+            RET_ON_ERR((rc == 0) || (zmq_errno() == EINTR),
+                    "0:Failed to poll capture socket err=%d", zmq_errno());
             continue;
         }
-        if (!validate_event(event, rid, seq)) {
-            continue;
-        }
-        serialize(event, evt_str);
 
-        switch(cap_state) {
-        case CAP_STATE_INIT:
-            /*
-             * In this state check against cache, if duplicate
-             * When duplicate or new one seen, remove the entry from pre-exist map
-             * Stay in this state, until the pre-exist cache is empty or as many
-             * messages as in cache are seen, as in worst case even if you see
-             * duplicate of each, it will end with first m_events.size()
-             */
-            {
-                bool add = true;
-                init_cnt--;
-                pre_exist_id_t::iterator it = m_pre_exist_id.find(rid);
-
-                if (it != m_pre_exist_id.end()) {
-                    if (seq <= it->second) {
-                        /* Duplicate; Later/same seq in cache. */
-                        add = false;
-                    }
-                    if (seq >= it->second) {
-                        /* new one; This runtime ID need not be checked again */
-                        m_pre_exist_id.erase(it);
-                    }
-                }
-                if (add) {
-                    m_events.push_back(evt_str);
-                }
-            }
-            if(m_pre_exist_id.empty() || (init_cnt <= 0)) {
-                /* Init check is no more needed. */
-                pre_exist_id_t().swap(m_pre_exist_id);
-                cap_state = CAP_STATE_ACTIVE;
-            }
-            break;
-
-        case CAP_STATE_ACTIVE:
-            /* Save until max allowed */
-            try
-            {
-                m_events.push_back(evt_str);
-                if (VEC_SIZE(m_events) >= m_cache_max) {
-                    cap_state = CAP_STATE_LAST;
-                    /* Clear the map, created to ensure memory space available */
-                    m_last_events.clear();
-                    m_last_events_init = true;
-                }
+        /* Drain in batches, w/o blocking per event */
+        int cnt = 0;
+        for (; (cnt < CAPTURE_READ_BATCH) && (m_ctrl == START_CAPTURE); ++cnt) {
+            rc = read_capture_msg(cap_sub_sock, msg);
+            if (rc == EAGAIN) {
                 break;
             }
-            catch (bad_alloc& e)
-            {
-                stringstream ss;
-                ss << e.what();
-                SWSS_LOG_ERROR("Cache save event failed with %s events:size=%d",
-                        ss.str().c_str(), VEC_SIZE(m_events));
-                cap_state = CAP_STATE_LAST;
-                // fall through to save this event in last set.
-            }
-
-        case CAP_STATE_LAST:
-            total_overflow++;
-            m_last_events[rid] = evt_str;
-            if (total_overflow > m_last_events.size()) {
-                m_total_missed_cache++;
-                m_stats_instance->increment_missed_cache(1);
-            }
-            break;
+            RET_ON_ERR((rc == 0) || (rc == EINTR),
+                    "0:Failed to read from capture socket err=%d", rc);
         }
+
+        /*
+         * Events read by this drain. ZMQ does not tell the SUB queue length;
+         * a batch of CAPTURE_READ_BATCH means at least that many were queued.
+         */
+        m_stats_instance->set_capture_batch(cnt);
+        m_stats_instance->set_stat(INDEX_STATS_CACHE_BYTES, m_events.bytes());
     }
 
 out:
@@ -512,12 +981,12 @@ out:
      * Capture stop will close the socket which fail the read
      * and hence bail out.
      */
+    zmq_msg_close(&msg);
     zmq_close(cap_sub_sock);
     m_cap_run = false;
     return;
 }
 
-
 int
 capture_service::set_control(capture_control_t ctrl, event_serialized_lst_t *lst)
 {
@@ -529,6 +998,8 @@ capture_service::set_control(capture_control_t ctrl, event_serialized_lst_t *lst
 
     switch(ctrl) {
         case INIT_CAPTURE:
+            RET_ON_ERR(m_events.init(m_cache_max_bytes) == 0,
+                    "Failed to allocate cache of %lu bytes", m_cache_max_bytes);
             m_thr = thread(&capture_service::do_capture, this);
             for(int i=0; !m_cap_run && (i < CAPTURE_SERVICE_POLLING_RETRIES); ++i) {
                 /* Poll to see if thread has been init, if so exit early. Add delay on every attempt */
@@ -580,7 +1051,7 @@ out:
 }
 
 int
-capture_service::read_cache(event_serialized_lst_t &lst_fifo,
+capture_service::read_cache(event_ring_cache &lst_fifo,
         last_events_t &lst_last, counters_t &overflow_cnt)
 {
     lst_fifo.swap(m_events);
@@ -590,27 +1061,161 @@ capture_service::read_cache(event_serialized_lst_t &lst_fifo,
         last_events_t().swap(lst_last);
     }
     last_events_t().swap(m_last_events);
-    event_serialized_lst_t().swap(m_events);
+    m_events.release();
+    m_stats_instance->set_stat(INDEX_STATS_CACHE_BYTES, 0);
     overflow_cnt = m_total_missed_cache;
     return 0;
 }
 
-static int
-process_options(stats_collector *stats, const event_serialized_lst_t &req_data,
+int
+capture_service::read_cache(event_serialized_lst_t &lst_fifo,
+        last_events_t &lst_last, counters_t &overflow_cnt)
+{
+    event_ring_cache ring;
+    string_view evt;
+
+    read_cache(ring, lst_last, overflow_cnt);
+
+    event_serialized_lst_t().swap(lst_fifo);
+    lst_fifo.reserve(ring.size());
+    while (ring.front(evt)) {
+        lst_fifo.emplace_back(evt);
+        ring.pop_front();
+    }
+    return 0;
+}
+
+int
+journal_service::start(const journal_config_t &cfg)
+{
+    int ret = -1;
+
+    RET_ON_ERR(m_journal.open(cfg) == 0, "Failed to open journal at %s",
+            cfg.dir.c_str());
+
+    m_sync_interval_ms = cfg.sync_interval_ms;
+    m_shutdown = false;
+    m_thr = thread(&journal_service::run, this);
+    ret = 0;
+out:
+    return ret;
+}
+
+
+void
+journal_service::stop()
+{
+    m_shutdown = true;
+
+    if (m_thr.joinable()) {
+        m_thr.join();
+    }
+    m_journal.close();
+}
+
+
+void
+journal_service::run()
+{
+    int rc;
+    void *sub_sock = NULL;
+    zmq_msg_t msg;
+    zmq_pollitem_t item;
+
+    zmq_msg_init(&msg);
+
+    sub_sock = zmq_socket(m_ctx, ZMQ_SUB);
+    RET_ON_ERR(sub_sock != NULL, "failing to get ZMQ_SUB socket for journal");
+
+    rc = zmq_connect(sub_sock, get_config(string(CAPTURE_END_KEY)).c_str());
+    RET_ON_ERR(rc == 0, "Failing to connect journal SUB to %s",
+            get_config(string(CAPTURE_END_KEY)).c_str());
+
+    rc = zmq_setsockopt(sub_sock, ZMQ_SUBSCRIBE, "", 0);
+    RET_ON_ERR(rc == 0, "Failing to ZMQ_SUBSCRIBE for journal");
+
+    item.socket = sub_sock;
+    item.fd = 0;
+    item.events = ZMQ_POLLIN;
+    item.revents = 0;
+
+    while (!m_shutdown) {
+        rc = zmq_poll(&item, 1, m_sync_interval_ms);
+        RET_ON_ERR((rc >= 0) || (zmq_errno() == EINTR),
+                "Failed to poll journal socket err=%d", zmq_errno());
+
+        for (int i = 0; (rc > 0) && (i < CAPTURE_READ_BATCH) && !m_shutdown; ++i) {
+            runtime_id_t rid;
+            sequence_t seq = 0;
+            bool valid;
+            /* Capture service counts invalid events */
+            int rc_rd = read_capture_event(sub_sock, msg, rid, seq, valid, NULL);
+
+            if (rc_rd == EAGAIN) {
+                break;
+            }
+            RET_ON_ERR((rc_rd == 0) || (rc_rd == EINTR),
+                    "Failed to read journal socket err=%d", rc_rd);
+            if (valid) {
+                m_journal.append(rid, seq, (const char *)zmq_msg_data(&msg),
+                        zmq_msg_size(&msg));
+            }
+        }
+
+        /* Sync upon interval, when idle */
+        m_journal.sync();
+    }
+
+out:
+    zmq_msg_close(&msg);
+    zmq_close(sub_sock);
+}
+
+
+int
+journal_service::replay(const runtime_id_t &rid, sequence_t last_seq,
         event_serialized_lst_t &resp_data)
+{
+    return m_journal.replay(rid, last_seq, READ_SET_SIZE, resp_data);
+}
+
+
+static int
+process_options(stats_collector *stats, journal_service *journal,
+        const event_serialized_lst_t &req_data, event_serialized_lst_t &resp_data)
 {
     int ret = -1;
     if (!req_data.empty()) {
         RET_ON_ERR(req_data.size() == 1, "Expect only one options string %d",
                 (int)req_data.size());
-        const auto &data = nlohmann::json::parse(*(req_data.begin()));
-        RET_ON_ERR(data.size() == 1, "Only one supported option. Expect 1. size=%d",
-                (int)data.size());
-        const auto it = data.find(GLOBAL_OPTION_HEARTBEAT);
-        RET_ON_ERR(it != data.end(), "Expect HEARTBEAT_INTERVAL; got %s",
-                data.begin().key().c_str());
-        stats->set_heartbeat_interval(it.value());
-        ret = 0;
+        try {
+            const auto &data = nlohmann::json::parse(*(req_data.begin()));
+            RET_ON_ERR(data.size() == 1, "Only one supported option. Expect 1. size=%d",
+                    (int)data.size());
+            const auto rit = data.find(JOURNAL_OPTION_REPLAY);
+            if (rit != data.end()) {
+                /*
+                 * Events of given runtime ID after given sequence, in chunks.
+                 * Caller repeats with sequence of last event returned.
+                 */
+                RET_ON_ERR(journal != NULL, "Journal is not enabled");
+                ret = journal->replay(
+                        rit->at(JOURNAL_REPLAY_RUNTIME_ID).get<string>(),
+                        rit->at(JOURNAL_REPLAY_SEQUENCE).get<sequence_t>(),
+                        resp_data);
+                goto out;
+            }
+            const auto it = data.find(GLOBAL_OPTION_HEARTBEAT);
+            RET_ON_ERR(it != data.end(), "Expect HEARTBEAT_INTERVAL; got %s",
+                    data.begin().key().c_str());
+            stats->set_heartbeat_interval(it.value());
+            ret = 0;
+        }
+        catch (exception &e)
+        {
+            SWSS_LOG_ERROR("Invalid options request (%s) e=(%s)",
+                    req_data.begin()->c_str(), e.what());
+        }
     }
     else {
         nlohmann::json msg = nlohmann::json::object();
@@ -634,7 +1239,9 @@ run_eventd_service()
     unique_ptr<capture_service> capture;
     bool skip_caching = false;
 
-    event_serialized_lst_t capture_fifo_events;
+    unique_ptr<journal_service> journal;
+
+    event_ring_cache capture_fifo_events;
     last_events_t capture_last_events;
 
     SWSS_LOG_INFO("Eventd service starting\n");
@@ -654,6 +1261,15 @@ run_eventd_service()
 
     RET_ON_ERR(stats_instance.start() == 0, "Failed to start stats collector");
 
+    if (!s_journal_cfg.dir.empty()) {
+        /* Journal is optional; eventd runs w/o it, upon failure */
+        journal = make_unique<journal_service>(zctx);
+        if (journal->start(s_journal_cfg) != 0) {
+            SWSS_LOG_ERROR("Failed to start journal at %s", s_journal_cfg.dir.c_str());
+            journal.reset();
+        }
+    }
+
     /* Pause heartbeat during caching */
     stats_instance.heartbeat_ctrl(true);
 
@@ -687,7 +1303,7 @@ run_eventd_service()
                 if (capture != NULL) {
                     capture.reset();
                 }
-                event_serialized_lst_t().swap(capture_fifo_events);
+                capture_fifo_events.release();
                 last_events_t().swap(capture_last_events);
 
                 capture = make_unique<capture_service>(zctx, cache_max, &stats_instance);
@@ -742,28 +1358,30 @@ run_eventd_service()
                 }
                 resp = 0;
 
-                if (capture_fifo_events.empty()) {
-                    for (last_events_t::iterator it = capture_last_events.begin();
-                            it != capture_last_events.end(); ++it) {
-                        capture_fifo_events.push_back(it->second);
+                /*
+                 * Serve events in order from cache ring, the last events
+                 * collected upon overflow follow after the ring is drained.
+                 */
+                if (!capture_fifo_events.empty()) {
+                    string_view evt;
+
+                    while ((VEC_SIZE(resp_data) < READ_SET_SIZE) &&
+                            capture_fifo_events.front(evt)) {
+                        resp_data.emplace_back(evt);
+                        capture_fifo_events.pop_front();
+                    }
+                    if (capture_fifo_events.empty()) {
+                        /* Give back the arena */
+                        capture_fifo_events.release();
                     }
-                    last_events_t().swap(capture_last_events);
                 }
+                else {
+                    last_events_t::iterator it = capture_last_events.begin();
 
-                {
-                    int sz = VEC_SIZE(capture_fifo_events) < READ_SET_SIZE ?
-                        VEC_SIZE(capture_fifo_events) : READ_SET_SIZE;
-
-                    if (sz != 0) {
-                        auto it = std::next(capture_fifo_events.begin(), sz);
-                        move(capture_fifo_events.begin(), capture_fifo_events.end(),
-                                back_inserter(resp_data));
-
-                        if (sz == VEC_SIZE(capture_fifo_events)) {
-                            event_serialized_lst_t().swap(capture_fifo_events);
-                        } else {
-                            capture_fifo_events.erase(capture_fifo_events.begin(), it);
-                        }
+                    while ((VEC_SIZE(resp_data) < READ_SET_SIZE) &&
+                            (it != capture_last_events.end())) {
+                        resp_data.push_back(move(it->second));
+                        it = capture_last_events.erase(it);
                     }
                 }
                 break;
@@ -775,7 +1393,7 @@ run_eventd_service()
                 break;
 
             case EVENT_OPTIONS:
-                resp = process_options(&stats_instance, req_data, resp_data);
+                resp = process_options(&stats_instance, journal.get(), req_data, resp_data);
                 break;
 
             case EVENT_EXIT:
@@ -793,6 +1411,7 @@ run_eventd_service()
 out:
     service.close_service();
     stats_instance.stop();
+    journal.reset();
 
     if (proxy != NULL) {
         delete proxy;
@@ -808,4 +1427,7 @@ void set_unit_testing(bool b)
     s_unit_testing = b;
 }
 
-
+void set_journal_config(const journal_config_t &cfg)
+{
+    s_journal_cfg = cfg;
+}
@@ -2,9 +2,11 @@
  * Header file for eventd daemon
  */
 #include "table.h"
+#include "redispipeline.h"
 #include "events_service.h"
 #include "events.h"
 #include "events_wrap.h"
+#include "eventd_journal.h"
 
 #define ARRAY_SIZE(l) (sizeof(l)/sizeof((l)[0]))
 
@@ -19,13 +21,40 @@ typedef enum {
     COUNTERS_EVENTS_TOTAL
 } stats_counter_index_t;
 
+/*
+ * Hot path stats, written as fields of EVENTS_STATS_KEY.
+ * Deserialize failures is a counter, rest are gauges.
+ */
+typedef enum {
+    INDEX_STATS_DESERIALIZE_FAILED,
+    INDEX_STATS_CACHE_BYTES,
+    INDEX_STATS_CAPTURE_BATCH,
+    INDEX_STATS_CAPTURE_BATCH_PEAK,
+    STATS_TOTAL
+} stats_index_t;
+
 #define EVENTS_STATS_FIELD_NAME "value"
+
+/* Keys in COUNTERS_EVENTS_TABLE for hot path stats */
+#define EVENTS_STATS_KEY "stats"
+#define EVENTS_STATS_PUBLISHED_BY_SOURCE_KEY "published_by_source"
+#define EVENTS_STATS_PUBLISH_RATE_BY_SOURCE_KEY "publish_rate_by_source"
+#define EVENTS_STATS_PUBLISHED_BY_TAG_KEY "published_by_tag"
+
+/* Min interval between writes to redis, in milliseconds */
+#define STATS_WRITE_INTERVAL_MS 100
+
+/* Count of per thread counter shards; threads beyond share */
+#define STATS_COUNTER_SHARDS 8
 #define STATS_HEARTBEAT_MIN 300
 #define CAPTURE_SERVICE_POLLING_DURATION 10
 #define CAPTURE_SERVICE_POLLING_INCREMENT 10
 #define CAPTURE_SERVICE_POLLING_MAX_DURATION 100
 #define CAPTURE_SERVICE_POLLING_RETRIES 100
 
+/* Upper bound in bytes of memory held by capture cache */
+#define CAPTURE_CACHE_MAX_BYTES (100 * 1024 * 1024)
+
 /*
  *  Started by eventd_service.
  *  Creates XPUB & XSUB end points.
@@ -62,6 +91,33 @@ class eventd_proxy
 };
 
 
+/*
+ * Histogram of latencies in milliseconds.
+ * Exact upto 16ms, beyond it has 4 buckets per power of 2, which bounds
+ * the error to 25%, like HDR histograms with 2 significant bits.
+ */
+class latency_histogram
+{
+    public:
+        latency_histogram() { reset(); }
+
+        void add(int64_t val_ms);
+
+        /* Lower bound of bucket holding the given percentile; 0 if empty */
+        int64_t percentile(int pct) const;
+
+        counters_t count() const { return m_cnt; }
+
+        void reset();
+
+    private:
+        static const int BUCKETS = 16 + (4 * (64 - 4));
+
+        counters_t m_buckets[BUCKETS];
+        counters_t m_cnt;
+};
+
+
 class stats_collector
 {
     public:
@@ -74,6 +130,7 @@ class stats_collector
         void stop() {
 
             m_shutdown = true;
+            notify_writer();
 
             if (m_thr_collector.joinable()) {
                 m_thr_collector.join();
@@ -92,13 +149,51 @@ class stats_collector
             _update_stats(INDEX_COUNTERS_EVENTS_MISSED_CACHE, val);
         }
 
+        void increment_deserialize_failed(counters_t val) {
+            shard().deserialize_failed.fetch_add(val, memory_order_relaxed);
+            mark_updated();
+        }
+
+        /* Gauges are set by the owning thread */
+        void set_stat(stats_index_t index, counters_t val) {
+            if ((index != INDEX_STATS_DESERIALIZE_FAILED) && (index != STATS_TOTAL)) {
+                if (m_stats[index].exchange(val, memory_order_relaxed) != val) {
+                    mark_updated();
+                }
+            }
+        }
+
+        /* Events read by one drain of capture socket, up to CAPTURE_READ_BATCH */
+        void set_capture_batch(counters_t val) {
+            set_stat(INDEX_STATS_CAPTURE_BATCH, val);
+            if (val > m_stats[INDEX_STATS_CAPTURE_BATCH_PEAK].load(memory_order_relaxed)) {
+                set_stat(INDEX_STATS_CAPTURE_BATCH_PEAK, val);
+            }
+        }
+
         counters_t read_counter(stats_counter_index_t index) {
+            counters_t val = 0;
+
             if (index != COUNTERS_EVENTS_TOTAL) {
-                return m_lst_counters[index];
+                for (int i = 0; i < STATS_COUNTER_SHARDS; ++i) {
+                    val += m_shards[i].counters[index].load(memory_order_relaxed);
+                }
             }
-            else {
-                return 0;
+            return val;
+        }
+
+        counters_t read_stat(stats_index_t index) {
+            counters_t val = 0;
+
+            if (index == INDEX_STATS_DESERIALIZE_FAILED) {
+                for (int i = 0; i < STATS_COUNTER_SHARDS; ++i) {
+                    val += m_shards[i].deserialize_failed.load(memory_order_relaxed);
+                }
+            }
+            else if (index != STATS_TOTAL) {
+                val = m_stats[index].load(memory_order_relaxed);
             }
+            return val;
         }
 
         /* Sets heartbeat interval in milliseconds */
@@ -127,30 +222,85 @@ class stats_collector
         }
 
     private:
+        /*
+         * Counters of a thread, in its own cache line, so that threads
+         * updating counters don't contend. Readers sum up all shards.
+         */
+        typedef struct alignas(64) {
+            atomic<counters_t> counters[COUNTERS_EVENTS_TOTAL];
+            atomic<counters_t> deserialize_failed;
+        } counters_shard_t;
+
+        counters_shard_t &shard() {
+            static atomic<int> s_next_shard(0);
+            thread_local int t_shard = s_next_shard++ % STATS_COUNTER_SHARDS;
+
+            return m_shards[t_shard];
+        }
+
         void _update_stats(stats_counter_index_t index, counters_t val) {
             if (index != COUNTERS_EVENTS_TOTAL) {
-                m_lst_counters[index] += val;
-                m_updated = true;
+                shard().counters[index].fetch_add(val, memory_order_relaxed);
+                mark_updated();
             }
             else {
                 SWSS_LOG_ERROR("Internal code error. Invalid index=%d", index);
             }
         }
 
+        /* Wakes up writer only on first update since its last write */
+        void mark_updated() {
+            if (!m_updated.exchange(true)) {
+                notify_writer();
+            }
+        }
+
+        void notify_writer() {
+            /* Lock ensures the writer is either waiting or sees the flag */
+            {
+                lock_guard<mutex> lock(m_writer_mtx);
+            }
+            m_writer_cv.notify_one();
+        }
+
+        /* Per source/tag counts & latency off received events */
+        void update_key_stats(const event_receive_op_t &op);
+
         void run_collector();
 
         void run_writer();
 
+        void write_counters();
+
         atomic<bool> m_updated;
 
-        counters_t m_lst_counters[COUNTERS_EVENTS_TOTAL];
+        counters_shard_t m_shards[STATS_COUNTER_SHARDS];
+
+        atomic<counters_t> m_stats[STATS_TOTAL];
+
+        /*
+         * Updated by collector thread & read by writer thread, once
+         * per write. Hence a lock, which is rarely contended.
+         */
+        mutex m_key_stats_mtx;
+        map<string, counters_t> m_published_by_source;
+        map<string, counters_t> m_published_by_tag;
+        latency_histogram m_latency;
+
+        /* Owned by writer to compute rate */
+        map<string, counters_t> m_published_by_source_last;
+        chrono::steady_clock::time_point m_last_write;
+
+        atomic<bool> m_shutdown;
 
-        bool m_shutdown;
+        mutex m_writer_mtx;
+        condition_variable m_writer_cv;
 
         thread m_thr_collector;
         thread m_thr_writer;
 
         shared_ptr<swss::DBConnector> m_counters_db;
+        shared_ptr<swss::RedisPipeline> m_pipeline;
         shared_ptr<swss::Table> m_stats_table;
 
         bool m_pause_heartbeat;
@@ -160,6 +310,98 @@ class stats_collector
         int m_heartbeats_interval_cnt;
 };
 
+/*
+ *  Byte bounded ring of serialized events.
+ *
+ *  One arena is allocated upfront and events are saved back to back as
+ *  [length][bytes] records. Hence caching does no allocation per event and
+ *  the memory held is bounded by arena size, irrespective of event sizes.
+ *  The arena is malloc'd, so pages not yet written do not add to RSS.
+ *
+ *  A record is never split across arena end. When it does not fit at the
+ *  tail, a wrap marker is written and the record goes to arena start, if
+ *  there is room ahead of the head.
+ *
+ *  Readers get a view of the oldest record, which stays valid until it is
+ *  popped. Not thread safe; the capture thread hands it over via swap
+ *  after it exits.
+ */
+class event_ring_cache
+{
+    public:
+        event_ring_cache() : m_buf(NULL), m_cap(0), m_head(0), m_tail(0),
+            m_wrapped(false), m_cnt(0), m_bytes(0)
+        {}
+
+        ~event_ring_cache() { release(); }
+
+        event_ring_cache(const event_ring_cache &) = delete;
+        event_ring_cache &operator=(const event_ring_cache &) = delete;
+
+        /* Allocate arena of cap bytes. Any cached event is dropped. */
+        int init(size_t cap);
+
+        /* Drop all events and free the arena */
+        void release();
+
+        /* Returns false, if there is no room for the event */
+        bool push_back(const void *data, size_t len);
+
+        bool push_back(const event_serialized_t &evt) {
+            return push_back(evt.data(), evt.size());
+        }
+
+        /* View of the oldest event. Returns false, if empty */
+        bool front(string_view &evt) const;
+
+        void pop_front();
+
+        void clear() {
+            m_head = m_tail = 0;
+            m_wrapped = false;
+            m_cnt = 0;
+            m_bytes = 0;
+        }
+
+        void swap(event_ring_cache &other);
+
+        size_t size() const { return m_cnt; }
+
+        bool empty() const { return m_cnt == 0; }
+
+        /* Bytes held by cached events including record headers */
+        size_t bytes() const { return m_bytes; }
+
+        size_t capacity() const { return m_cap; }
+
+    private:
+        typedef uint32_t rec_len_t;
+
+        rec_len_t read_len(size_t offset) const {
+            rec_len_t len;
+            memcpy(&len, m_buf + offset, sizeof(len));
+            return len;
+        }
+
+        void write_len(size_t offset, rec_len_t len) {
+            memcpy(m_buf + offset, &len, sizeof(len));
+        }
+
+        char *m_buf;
+        size_t m_cap;
+
+        /* Offset of oldest record & offset to write next record */
+        size_t m_head;
+        size_t m_tail;
+
+        /* Set when tail has wrapped to arena start, behind the head */
+        bool m_wrapped;
+
+        size_t m_cnt;
+        size_t m_bytes;
+};
+
+
 /*
  *  Capture/Cache service
  *
@@ -179,22 +421,22 @@ class stats_collector
  *  after thread exits.
  *  This thread ensures the cache is empty at the init.
  *
- *  Upon cache start, the thread is blocked in receive call with timeout.
+ *  Upon cache start, the thread is blocked in poll with timeout.
  *  Only upon receive/timeout, it would notice stop signal. Hence stop
  *  is not synchronous. The caller may wait for thread to terminate
  *  via thread.join().
+ *  Once readable, it drains the socket w/o blocking in batches.
  *
  *  Each event is 2 parts. It drops the first part, which is
- *  more for filtering events. It creates string from second part
- *  and saves it.
- *
- *  The string is the serialized version of internal_event_ref
+ *  more for filtering events. The second part is the serialized version
+ *  of internal_event_ref. It is parsed only for runtime id & sequence
+ *  and its bytes are saved as received.
  *
  *  It keeps two sets of data
- *      1) List of all events received in vector in same order as received
- *      2) Map of last event from each runtime id upon list overflow max size.
+ *      1) All events received in a byte bounded ring, in same order as received
+ *      2) Map of last event from each runtime id upon ring overflow.
  *
- *  We add to the vector as much as allowed by vector and max limit,
+ *  We add to the ring until its arena is full or the max count is hit,
  *  whichever comes first.
  *
  *  The sequence number in internal event will help assess the missed count
@@ -212,9 +454,12 @@ typedef enum {
 class capture_service
 {
     public:
-        capture_service(void *ctx, int cache_max, stats_collector *stats) :
+        capture_service(void *ctx, int cache_max, stats_collector *stats,
+                size_t cache_max_bytes = CAPTURE_CACHE_MAX_BYTES) :
             m_ctx(ctx), m_stats_instance(stats), m_cap_run(false),
-            m_ctrl(NEED_INIT), m_cache_max(cache_max),
+            m_ctrl(NEED_INIT), m_cap_state(CAP_STATE_INIT), m_init_cnt(0),
+            m_cache_max(cache_max),
+            m_cache_max_bytes(cache_max_bytes),
             m_last_events_init(false), m_total_missed_cache(0)
         {}
 
@@ -222,13 +467,40 @@ class capture_service
 
         int set_control(capture_control_t ctrl, event_serialized_lst_t *p=NULL);
 
+        /* Hands over the cache ring as is; No copy of events */
+        int read_cache(event_ring_cache &lst_fifo,
+                last_events_t &lst_last, counters_t &overflow_cnt);
+
         int read_cache(event_serialized_lst_t &lst_fifo,
                 last_events_t &lst_last, counters_t &overflow_cnt);
 
     private:
+        typedef enum {
+            /*
+             * In this state every event read is compared with init cache given
+             * Only new events are saved.
+             */
+            CAP_STATE_INIT = 0,
+
+            /* In this state, all events read are cached until max limit */
+            CAP_STATE_ACTIVE,
+
+            /* Cache has hit max. Hence only save last event for each runime ID */
+            CAP_STATE_LAST
+        } cap_state_t;
+
         void init_capture_cache(const event_serialized_lst_t &lst);
         void do_capture();
 
+        int read_capture_msg(void *sock, zmq_msg_t &msg);
+
+        void save_event(const runtime_id_t &rid, sequence_t seq,
+                const char *data, size_t len);
+
+        void save_last_event(const runtime_id_t &rid, const char *data, size_t len);
+
+        void set_cap_state_last();
+
         void stop_capture();
 
         void *m_ctx;
@@ -238,9 +510,15 @@ class capture_service
         capture_control_t m_ctrl;
         thread m_thr;
 
+        cap_state_t m_cap_state;
+
+        /* Count of events to check against initial stock for duplicates */
+        int m_init_cnt;
+
         int m_cache_max;
+        size_t m_cache_max_bytes;
 
-        event_serialized_lst_t m_events;
+        event_ring_cache m_events;
 
         last_events_t m_last_events;
         bool m_last_events_init;
@@ -253,6 +531,50 @@ class capture_service
 };
 
 
+/*
+ *  Journal service
+ *
+ *  Runs in a dedicated thread for eventd lifetime, when a journal dir is
+ *  configured. Like capture service, it reads all events off the capture
+ *  end point, but appends them to the persistent journal.
+ *
+ *  A reconnecting subscriber sends EVENT_OPTIONS as below, with its last
+ *  seen sequence for a runtime ID
+ *      {"JOURNAL_REPLAY": {"runtime_id": "<rid>", "sequence": <seq>}}
+ *  and gets the events it missed in chunks of READ_SET_SIZE. It repeats
+ *  with sequence of the last event received, until none returned.
+ */
+#define JOURNAL_OPTION_REPLAY "JOURNAL_REPLAY"
+#define JOURNAL_REPLAY_RUNTIME_ID "runtime_id"
+#define JOURNAL_REPLAY_SEQUENCE "sequence"
+
+class journal_service
+{
+    public:
+        journal_service(void *ctx) : m_ctx(ctx), m_shutdown(false),
+            m_sync_interval_ms(JOURNAL_SYNC_INTERVAL_MS) {}
+
+        ~journal_service() { stop(); }
+
+        int start(const journal_config_t &cfg);
+
+        void stop();
+
+        int replay(const runtime_id_t &rid, sequence_t last_seq,
+                event_serialized_lst_t &resp_data);
+
+    private:
+        void run();
+
+        void *m_ctx;
+        atomic<bool> m_shutdown;
+        int m_sync_interval_ms;
+        thread m_thr;
+
+        event_journal m_journal;
+};
+
+
 /*
  * Main server, that starts the zproxy service and honor
  * eventd service requests event_req_type_t
@@ -270,3 +592,6 @@ void run_eventd_service();
 
 /* To help skip redis access during unit testing */
 void set_unit_testing(bool b);
+
+/* Enables journal service, when dir is set. Call before run_eventd_service */
+void set_journal_config(const journal_config_t &cfg);
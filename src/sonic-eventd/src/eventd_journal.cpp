@@ -0,0 +1,453 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "eventd_journal.h"
+
+using namespace std;
+
+#define JOURNAL_SEG_MAGIC 0x4a564553     /* "SEVJ" */
+#define JOURNAL_REC_MAGIC 0x52564553     /* "SEVR" */
+#define JOURNAL_VERSION 1
+
+#define JOURNAL_FILE_PREFIX "events_"
+#define JOURNAL_FILE_SUFFIX ".jnl"
+
+#define JOURNAL_ALIGN(n) (((n) + 7) & ~((size_t)7))
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t id;
+    int64_t created_ms;
+    uint64_t rsvd;
+} journal_seg_hdr_t;
+
+typedef struct {
+    uint32_t magic;
+
+    /* crc32 of header from len onwards & the payload */
+    uint32_t crc;
+
+    /* Bytes of event & runtime id */
+    uint32_t len;
+    uint16_t rid_len;
+    uint16_t rsvd;
+
+    sequence_t seq;
+    int64_t ts_ms;
+} journal_rec_hdr_t;
+
+#define JOURNAL_REC_SIZE(rid_len, len) \
+    JOURNAL_ALIGN(sizeof(journal_rec_hdr_t) + (rid_len) + (len))
+
+
+static int64_t
+journal_now_ms()
+{
+    return chrono::duration_cast<chrono::milliseconds>(
+            chrono::system_clock::now().time_since_epoch()).count();
+}
+
+
+static uint32_t
+journal_crc32(uint32_t crc, const void *data, size_t len)
+{
+    static uint32_t table[256];
+    static once_flag init;
+    const uint8_t *p = (const uint8_t *)data;
+
+    call_once(init, []() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1);
+            }
+            table[i] = c;
+        }
+    });
+
+    crc = ~crc;
+    while (len-- > 0) {
+        crc = table[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+
+static uint32_t
+journal_rec_crc(const journal_rec_hdr_t *hdr)
+{
+    const char *p = (const char *)&hdr->len;
+    size_t sz = sizeof(journal_rec_hdr_t) - offsetof(journal_rec_hdr_t, len);
+
+    return journal_crc32(journal_crc32(0, p, sz), hdr + 1, hdr->rid_len + hdr->len);
+}
+
+
+int
+event_journal::open(const journal_config_t &cfg)
+{
+    int ret = -1;
+    DIR *dp = NULL;
+    struct dirent *ent;
+    vector<uint64_t> ids;
+
+    lock_guard<mutex> lock(m_mtx);
+
+    RET_ON_ERR(!cfg.dir.empty(), "Journal dir is not set");
+    RET_ON_ERR(!is_open(), "Journal is already open at %s", m_cfg.dir.c_str());
+    RET_ON_ERR(cfg.segment_size > (sizeof(journal_seg_hdr_t) + sizeof(journal_rec_hdr_t)),
+            "Journal segment size %lu is too small", cfg.segment_size);
+    RET_ON_ERR((mkdir(cfg.dir.c_str(), 0755) == 0) || (errno == EEXIST),
+            "Failed to create journal dir %s errno=%d", cfg.dir.c_str(), errno);
+
+    dp = opendir(cfg.dir.c_str());
+    RET_ON_ERR(dp != NULL, "Failed to open journal dir %s errno=%d",
+            cfg.dir.c_str(), errno);
+
+    while ((ent = readdir(dp)) != NULL) {
+        unsigned long id;
+        char suffix[8];
+
+        if ((sscanf(ent->d_name, JOURNAL_FILE_PREFIX "%lu%7s", &id, suffix) == 2) &&
+                (strcmp(suffix, JOURNAL_FILE_SUFFIX) == 0)) {
+            ids.push_back(id);
+        }
+    }
+    sort(ids.begin(), ids.end());
+
+    m_cfg = cfg;
+    m_total_cnt = 0;
+    for (size_t i = 0; i < ids.size(); ++i) {
+        /*
+         * Rotation syncs a segment before moving on. Hence only the last
+         * segment could have torn records to verify.
+         */
+        if (open_segment(ids[i], false, (i + 1) == ids.size()) != 0) {
+            string path = m_cfg.dir + "/" JOURNAL_FILE_PREFIX + to_string(ids[i]) +
+                JOURNAL_FILE_SUFFIX;
+            SWSS_LOG_ERROR("Removing unreadable journal segment %s", path.c_str());
+            unlink(path.c_str());
+        }
+        m_next_id = ids[i] + 1;
+    }
+
+    if (m_segments.empty()) {
+        if (open_segment(m_next_id++, true) != 0) {
+            m_cfg = journal_config_t();
+            RET_ON_ERR(false, "Failed to create journal segment in %s",
+                    cfg.dir.c_str());
+        }
+    }
+    trim();
+
+    m_unsynced_cnt = 0;
+    m_unsynced_offset = m_segments.back()->used;
+    m_last_sync_ms = journal_now_ms();
+
+    SWSS_LOG_NOTICE("Journal opened at %s segments=%d events=%lu",
+            m_cfg.dir.c_str(), (int)m_segments.size(), m_total_cnt);
+    ret = 0;
+out:
+    if (dp != NULL) {
+        closedir(dp);
+    }
+    return ret;
+}
+
+
+void
+event_journal::close()
+{
+    lock_guard<mutex> lock(m_mtx);
+
+    if (!m_segments.empty()) {
+        sync_locked(true);
+    }
+    for (size_t i = 0; i < m_segments.size(); ++i) {
+        close_segment(*m_segments[i]);
+    }
+    m_segments.clear();
+    m_total_cnt = 0;
+    m_cfg = journal_config_t();
+}
+
+
+int
+event_journal::open_segment(uint64_t id, bool create, bool verify)
+{
+    int ret = -1;
+    struct stat st;
+    unique_ptr<segment_t> seg(new segment_t());
+    journal_seg_hdr_t *hdr;
+
+    seg->id = id;
+    seg->path = m_cfg.dir + "/" JOURNAL_FILE_PREFIX + to_string(id) + JOURNAL_FILE_SUFFIX;
+
+    seg->fd = ::open(seg->path.c_str(), O_RDWR | O_CLOEXEC | (create ? (O_CREAT | O_EXCL) : 0), 0644);
+    RET_ON_ERR(seg->fd >= 0, "Failed to open %s errno=%d", seg->path.c_str(), errno);
+
+    if (create) {
+        /* Sparse & zero filled; blocks are allocated as written */
+        RET_ON_ERR(ftruncate(seg->fd, m_cfg.segment_size) == 0,
+                "Failed to size %s errno=%d", seg->path.c_str(), errno);
+        seg->size = m_cfg.segment_size;
+    }
+    else {
+        RET_ON_ERR(fstat(seg->fd, &st) == 0, "Failed to stat %s", seg->path.c_str());
+        RET_ON_ERR((size_t)st.st_size > sizeof(journal_seg_hdr_t),
+                "Truncated segment %s size=%ld", seg->path.c_str(), (long)st.st_size);
+        seg->size = st.st_size;
+    }
+
+    seg->base = (char *)mmap(NULL, seg->size, PROT_READ | PROT_WRITE, MAP_SHARED,
+            seg->fd, 0);
+    if (seg->base == MAP_FAILED) {
+        seg->base = NULL;
+        RET_ON_ERR(false, "Failed to mmap %s errno=%d", seg->path.c_str(), errno);
+    }
+    hdr = (journal_seg_hdr_t *)seg->base;
+
+    if (create) {
+        hdr->magic = JOURNAL_SEG_MAGIC;
+        hdr->version = JOURNAL_VERSION;
+        hdr->id = id;
+        hdr->created_ms = journal_now_ms();
+        seg->used = sizeof(journal_seg_hdr_t);
+    }
+    else {
+        RET_ON_ERR((hdr->magic == JOURNAL_SEG_MAGIC) && (hdr->version == JOURNAL_VERSION) &&
+                (hdr->id == id), "Invalid segment header in %s", seg->path.c_str());
+        RET_ON_ERR(recover_segment(*seg, verify) == 0, "Failed to recover %s",
+                seg->path.c_str());
+    }
+    seg->created_ms = hdr->created_ms;
+
+    m_total_cnt += seg->cnt;
+    m_segments.push_back(move(seg));
+    ret = 0;
+out:
+    if (ret != 0) {
+        close_segment(*seg);
+    }
+    return ret;
+}
+
+
+int
+event_journal::recover_segment(segment_t &seg, bool verify)
+{
+    size_t offset = sizeof(journal_seg_hdr_t);
+    runtime_id_t rid;
+
+    while ((offset + sizeof(journal_rec_hdr_t)) <= seg.size) {
+        const journal_rec_hdr_t *hdr = (const journal_rec_hdr_t *)(seg.base + offset);
+        size_t rec_sz;
+
+        if (hdr->magic != JOURNAL_REC_MAGIC) {
+            break;
+        }
+        rec_sz = JOURNAL_REC_SIZE(hdr->rid_len, hdr->len);
+        if (((offset + rec_sz) > seg.size) || (verify && (journal_rec_crc(hdr) != hdr->crc))) {
+            /* Torn record; Clear it, so that it is overwritten cleanly */
+            SWSS_LOG_WARN("Dropping torn record in %s offset=%lu",
+                    seg.path.c_str(), offset);
+            memset(seg.base + offset, 0, min(rec_sz, seg.size - offset));
+            break;
+        }
+
+        /* Reuse the string buffer across records */
+        rid.assign((const char *)(hdr + 1), hdr->rid_len);
+        index_record(seg, rid, hdr->seq, offset);
+        seg.cnt++;
+        offset += rec_sz;
+    }
+    seg.used = offset;
+    return 0;
+}
+
+
+void
+event_journal::index_record(segment_t &seg, const runtime_id_t &rid,
+        sequence_t seq, size_t offset)
+{
+    rid_index_t &idx = seg.index[rid];
+
+    if ((idx.cnt % JOURNAL_INDEX_STRIDE) == 0) {
+        idx.marks.emplace_back(seq, offset);
+    }
+    idx.cnt++;
+    idx.last_seq = seq;
+}
+
+
+void
+event_journal::close_segment(segment_t &seg)
+{
+    if (seg.base != NULL) {
+        munmap(seg.base, seg.size);
+        seg.base = NULL;
+    }
+    if (seg.fd >= 0) {
+        ::close(seg.fd);
+        seg.fd = -1;
+    }
+}
+
+
+int
+event_journal::rotate()
+{
+    /* Complete the current one, before moving on */
+    sync_locked(true);
+
+    if (open_segment(m_next_id, true) != 0) {
+        return -1;
+    }
+    m_next_id++;
+    m_unsynced_offset = 0;
+    trim();
+    return 0;
+}
+
+
+void
+event_journal::trim()
+{
+    while ((int)m_segments.size() > max(m_cfg.segment_max_cnt, 1)) {
+        segment_t &seg = *m_segments.front();
+
+        m_total_cnt -= seg.cnt;
+        close_segment(seg);
+        unlink(seg.path.c_str());
+        m_segments.erase(m_segments.begin());
+    }
+}
+
+
+int
+event_journal::append(const runtime_id_t &rid, sequence_t seq,
+        const char *data, size_t len)
+{
+    int ret = -1;
+    size_t rec_sz = JOURNAL_REC_SIZE(rid.size(), len);
+    segment_t *seg;
+    journal_rec_hdr_t *hdr;
+    int64_t now = journal_now_ms();
+
+    lock_guard<mutex> lock(m_mtx);
+
+    RET_ON_ERR(is_open() && !m_segments.empty(), "Journal is not open");
+    RET_ON_ERR((rid.size() <= UINT16_MAX) && (len <= UINT32_MAX) &&
+            ((sizeof(journal_seg_hdr_t) + rec_sz) <= m_cfg.segment_size),
+            "Event too large for journal len=%lu", len);
+
+    seg = m_segments.back().get();
+    if (((seg->used + rec_sz) > seg->size) || ((seg->cnt != 0) &&
+                (m_cfg.segment_max_age_secs > 0) &&
+                ((now - seg->created_ms) >= (m_cfg.segment_max_age_secs * 1000L)))) {
+        RET_ON_ERR(rotate() == 0, "Failed to rotate journal segment");
+        seg = m_segments.back().get();
+    }
+
+    hdr = (journal_rec_hdr_t *)(seg->base + seg->used);
+    hdr->len = (uint32_t)len;
+    hdr->rid_len = (uint16_t)rid.size();
+    hdr->rsvd = 0;
+    hdr->seq = seq;
+    hdr->ts_ms = now;
+    memcpy(hdr + 1, rid.data(), rid.size());
+    memcpy((char *)(hdr + 1) + rid.size(), data, len);
+    hdr->crc = journal_rec_crc(hdr);
+    /* Magic last, as it marks the record valid */
+    hdr->magic = JOURNAL_REC_MAGIC;
+
+    index_record(*seg, rid, seq, seg->used);
+    seg->used += rec_sz;
+    seg->cnt++;
+    m_total_cnt++;
+
+    m_unsynced_cnt++;
+    sync_locked(false);
+    ret = 0;
+out:
+    return ret;
+}
+
+
+void
+event_journal::sync(bool force)
+{
+    lock_guard<mutex> lock(m_mtx);
+
+    sync_locked(force);
+}
+
+
+void
+event_journal::sync_locked(bool force)
+{
+    static const size_t page_sz = (size_t)sysconf(_SC_PAGESIZE);
+    int64_t now;
+
+    if (m_segments.empty() || (m_unsynced_cnt == 0)) {
+        return;
+    }
+
+    now = journal_now_ms();
+    if (!force && (m_unsynced_cnt < m_cfg.sync_batch) &&
+            ((now - m_last_sync_ms) < m_cfg.sync_interval_ms)) {
+        return;
+    }
+
+    segment_t &seg = *m_segments.back();
+    size_t start = m_unsynced_offset & ~(page_sz - 1);
+
+    if (msync(seg.base + start, seg.used - start, MS_SYNC) != 0) {
+        SWSS_LOG_ERROR("Failed to sync journal %s errno=%d", seg.path.c_str(), errno);
+    }
+    m_unsynced_offset = seg.used;
+    m_unsynced_cnt = 0;
+    m_last_sync_ms = now;
+}
+
+
+int
+event_journal::replay(const runtime_id_t &rid, sequence_t last_seq,
+        size_t max_cnt, event_serialized_lst_t &lst)
+{
+    lock_guard<mutex> lock(m_mtx);
+
+    for (size_t i = 0; (i < m_segments.size()) && (lst.size() < max_cnt); ++i) {
+        const segment_t &seg = *m_segments[i];
+        unordered_map<runtime_id_t, rid_index_t>::const_iterator itc = seg.index.find(rid);
+
+        if ((itc == seg.index.end()) || (itc->second.last_seq <= last_seq)) {
+            continue;
+        }
+
+        /* Start from the last mark at or before last_seq */
+        const vector<pair<sequence_t, size_t>> &marks = itc->second.marks;
+        vector<pair<sequence_t, size_t>>::const_iterator itm = upper_bound(
+                marks.begin(), marks.end(), make_pair(last_seq, SIZE_MAX));
+        size_t offset = (itm == marks.begin()) ? itm->second : prev(itm)->second;
+
+        while ((offset < seg.used) && (lst.size() < max_cnt)) {
+            const journal_rec_hdr_t *hdr = (const journal_rec_hdr_t *)(seg.base + offset);
+            const char *p = (const char *)(hdr + 1);
+
+            if ((hdr->seq > last_seq) && (hdr->rid_len == rid.size()) &&
+                    (memcmp(p, rid.data(), rid.size()) == 0)) {
+                lst.emplace_back(p + hdr->rid_len, hdr->len);
+            }
+            offset += JOURNAL_REC_SIZE(hdr->rid_len, hdr->len);
+        }
+    }
+    return 0;
+}
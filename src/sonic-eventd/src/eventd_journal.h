@@ -0,0 +1,167 @@
+#ifndef EVENTD_JOURNAL_H
+#define EVENTD_JOURNAL_H
+
+/*
+ * Persistent journal of events for eventd.
+ *
+ * Events seen on the capture end point are appended to memory mapped
+ * segment files in a directory, to survive eventd/telemetry restarts.
+ * A subscriber that reconnects with its last seen (runtime_id, sequence)
+ * can be replayed exactly the events it missed.
+ *
+ * Segment file
+ *      [segment header][record][record]...
+ *  The file is sized upfront to segment size and zero filled. The first
+ *  slot w/o record magic marks the end of data.
+ *
+ * Record
+ *      [record header][runtime id bytes][event bytes][pad to 8 bytes]
+ *  Event bytes are the serialized internal_event_t, as received.
+ *
+ * A segment is rotated when full or older than max age. Rotation syncs
+ * the segment, hence only the last segment can have a torn record after
+ * a crash. Hence the recovery scan verifies checksum of last segment only
+ * and walks the others by record length.
+ *
+ * Each segment keeps a sparse index per runtime id of (sequence, offset),
+ * every JOURNAL_INDEX_STRIDE records of that runtime id. Replay seeks via
+ * the index and scans from there.
+ *
+ * Thread safe. Appended by journal thread & read by service thread.
+ */
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <memory>
+#include "events_common.h"
+
+#define JOURNAL_SEGMENT_SIZE (16 * 1024 * 1024)
+#define JOURNAL_SEGMENT_MAX_AGE_SECS 3600
+#define JOURNAL_SEGMENT_MAX_CNT 16
+#define JOURNAL_SYNC_BATCH 256
+#define JOURNAL_SYNC_INTERVAL_MS 200
+
+/* Every Nth record of a runtime id in a segment is indexed */
+#define JOURNAL_INDEX_STRIDE 32
+
+typedef struct journal_config {
+    /* Directory for segment files. Empty disables journal. */
+    string dir;
+
+    /* Max bytes in a segment */
+    size_t segment_size;
+
+    /* Segment older than this is rotated, upon next append */
+    int segment_max_age_secs;
+
+    /* Oldest segments beyond this count are removed */
+    int segment_max_cnt;
+
+    /* Sync upon these many appended events or interval, whichever first */
+    int sync_batch;
+    int sync_interval_ms;
+
+    journal_config() : segment_size(JOURNAL_SEGMENT_SIZE),
+        segment_max_age_secs(JOURNAL_SEGMENT_MAX_AGE_SECS),
+        segment_max_cnt(JOURNAL_SEGMENT_MAX_CNT),
+        sync_batch(JOURNAL_SYNC_BATCH),
+        sync_interval_ms(JOURNAL_SYNC_INTERVAL_MS)
+    {}
+} journal_config_t;
+
+
+class event_journal
+{
+    public:
+        event_journal() : m_next_id(0), m_unsynced_cnt(0), m_unsynced_offset(0),
+            m_last_sync_ms(0), m_total_cnt(0)
+        {}
+
+        ~event_journal() { close(); }
+
+        event_journal(const event_journal &) = delete;
+        event_journal &operator=(const event_journal &) = delete;
+
+        /* Opens the journal dir and recovers existing segments */
+        int open(const journal_config_t &cfg);
+
+        /* Syncs & unmaps all segments */
+        void close();
+
+        int append(const runtime_id_t &rid, sequence_t seq,
+                const char *data, size_t len);
+
+        /*
+         * Sync unsynced events, if batch count or interval is hit.
+         * force syncs irrespective.
+         */
+        void sync(bool force = false);
+
+        /*
+         * Collect events of rid with sequence > last_seq in order, upto
+         * max_cnt. Caller repeats with sequence of the last event returned,
+         * until none returned.
+         */
+        int replay(const runtime_id_t &rid, sequence_t last_seq,
+                size_t max_cnt, event_serialized_lst_t &lst);
+
+        bool is_open() const { return !m_cfg.dir.empty(); }
+
+        /* Count of events held across segments */
+        size_t size() const { return m_total_cnt; }
+
+        size_t segment_count() const { return m_segments.size(); }
+
+    private:
+        typedef struct {
+            sequence_t last_seq;
+            size_t cnt;
+
+            /* (sequence, offset) of every JOURNAL_INDEX_STRIDE record */
+            vector<pair<sequence_t, size_t>> marks;
+        } rid_index_t;
+
+        typedef struct segment {
+            uint64_t id;
+            string path;
+            int fd;
+            char *base;
+            size_t size;
+
+            /* Offset to write next record */
+            size_t used;
+
+            int64_t created_ms;
+            size_t cnt;
+            unordered_map<runtime_id_t, rid_index_t> index;
+
+            segment() : id(0), fd(-1), base(NULL), size(0), used(0),
+                created_ms(0), cnt(0)
+            {}
+        } segment_t;
+
+        int open_segment(uint64_t id, bool create, bool verify = false);
+        int recover_segment(segment_t &seg, bool verify);
+        void index_record(segment_t &seg, const runtime_id_t &rid,
+                sequence_t seq, size_t offset);
+        void close_segment(segment_t &seg);
+        int rotate();
+        void trim();
+        void sync_locked(bool force);
+
+        journal_config_t m_cfg;
+        vector<unique_ptr<segment_t>> m_segments;
+        uint64_t m_next_id;
+
+        int m_unsynced_cnt;
+        size_t m_unsynced_offset;
+        int64_t m_last_sync_ms;
+
+        size_t m_total_cnt;
+
+        mutex m_mtx;
+};
+
+#endif
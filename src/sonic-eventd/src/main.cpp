@@ -1,17 +1,41 @@
+#include <unistd.h>
 #include "logger.h"
 #include "eventd.h"
 
 void run_eventd_service();
 
-int main()
+static void
+usage(const char *prog)
 {
+    printf("Usage: %s [-j <journal dir>]\n", prog);
+    printf("  -j: Persist events in journal under given dir for replay\n");
+}
+
+int main(int argc, char **argv)
+{
+    journal_config_t journal_cfg;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "j:h")) != -1) {
+        switch(opt) {
+            case 'j':
+                journal_cfg.dir = optarg;
+                break;
+
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : -1;
+        }
+    }
+
     swss::Logger::setMinPrio(swss::Logger::SWSS_DEBUG);
     SWSS_LOG_INFO("The eventd service started"); 
 
+    set_journal_config(journal_cfg);
+
     run_eventd_service();
 
     SWSS_LOG_INFO("The eventd service exited");
 
     return 0;
 }
-
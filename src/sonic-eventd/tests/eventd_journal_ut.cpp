@@ -0,0 +1,225 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "gtest/gtest.h"
+#include "events_common.h"
+#include "../src/eventd_journal.h"
+
+using namespace std;
+
+static string
+make_journal_dir()
+{
+    char tmpl[] = "/tmp/eventd_journal_XXXXXX";
+    char *dir = mkdtemp(tmpl);
+
+    EXPECT_TRUE(dir != NULL);
+    return string(dir);
+}
+
+static void
+remove_journal_dir(const string &dir)
+{
+    DIR *dp = opendir(dir.c_str());
+    struct dirent *ent;
+
+    if (dp == NULL) {
+        return;
+    }
+    while ((ent = readdir(dp)) != NULL) {
+        if (ent->d_name[0] != '.') {
+            unlink((dir + "/" + ent->d_name).c_str());
+        }
+    }
+    closedir(dp);
+    rmdir(dir.c_str());
+}
+
+static string
+make_evt(const string &rid, sequence_t seq)
+{
+    return string("evt:") + rid + ":" + to_string(seq);
+}
+
+static void
+append_evts(event_journal &jnl, const string &rid, sequence_t from, sequence_t to)
+{
+    for (sequence_t seq = from; seq <= to; ++seq) {
+        string evt = make_evt(rid, seq);
+        EXPECT_EQ(0, jnl.append(rid, seq, evt.data(), evt.size()));
+    }
+}
+
+static event_serialized_lst_t
+replay_all(event_journal &jnl, const string &rid, sequence_t last_seq, size_t chunk)
+{
+    event_serialized_lst_t all;
+
+    while (true) {
+        event_serialized_lst_t lst;
+
+        EXPECT_EQ(0, jnl.replay(rid, last_seq, chunk, lst));
+        if (lst.empty()) {
+            break;
+        }
+        EXPECT_LE(lst.size(), chunk);
+        all.insert(all.end(), lst.begin(), lst.end());
+
+        /* Events are made as evt:<rid>:<seq> */
+        last_seq = stoull(lst.back().substr(lst.back().rfind(':') + 1));
+    }
+    return all;
+}
+
+TEST(eventd_journal, replayGap)
+{
+    string dir = make_journal_dir();
+    journal_config_t cfg;
+    event_journal jnl;
+
+    cfg.dir = dir;
+    EXPECT_EQ(0, jnl.open(cfg));
+
+    /* Interleave two publishers */
+    for (sequence_t seq = 1; seq <= 200; ++seq) {
+        append_evts(jnl, "rid-A", seq, seq);
+        append_evts(jnl, "rid-B", seq + 1000, seq + 1000);
+    }
+    EXPECT_EQ(400, (int)jnl.size());
+
+    /* Exactly the gap after last seen */
+    event_serialized_lst_t lst = replay_all(jnl, "rid-A", 150, 7);
+    EXPECT_EQ(50, (int)lst.size());
+    EXPECT_EQ(make_evt("rid-A", 151), lst.front());
+    EXPECT_EQ(make_evt("rid-A", 200), lst.back());
+
+    /* Nothing missed */
+    EXPECT_TRUE(replay_all(jnl, "rid-B", 1200, 10).empty());
+
+    /* Unknown runtime id */
+    EXPECT_TRUE(replay_all(jnl, "rid-C", 0, 10).empty());
+
+    jnl.close();
+    remove_journal_dir(dir);
+}
+
+TEST(eventd_journal, recover)
+{
+    string dir = make_journal_dir();
+    journal_config_t cfg;
+
+    cfg.dir = dir;
+    {
+        event_journal jnl;
+
+        EXPECT_EQ(0, jnl.open(cfg));
+        append_evts(jnl, "rid-A", 1, 100);
+    }
+
+    {
+        /* Reopen recovers events & appends after them */
+        event_journal jnl;
+
+        EXPECT_EQ(0, jnl.open(cfg));
+        EXPECT_EQ(100, (int)jnl.size());
+
+        append_evts(jnl, "rid-A", 101, 120);
+
+        event_serialized_lst_t lst = replay_all(jnl, "rid-A", 90, 100);
+        EXPECT_EQ(30, (int)lst.size());
+        EXPECT_EQ(make_evt("rid-A", 91), lst.front());
+        EXPECT_EQ(make_evt("rid-A", 120), lst.back());
+    }
+
+    remove_journal_dir(dir);
+}
+
+TEST(eventd_journal, tornRecord)
+{
+    string dir = make_journal_dir();
+    string path = dir + "/events_0.jnl";
+    journal_config_t cfg;
+    struct stat st;
+
+    cfg.dir = dir;
+    cfg.segment_size = 8192;
+    {
+        event_journal jnl;
+
+        EXPECT_EQ(0, jnl.open(cfg));
+        append_evts(jnl, "rid-A", 1, 10);
+    }
+
+    /* Corrupt the last byte of the last record */
+    {
+        event_journal jnl;
+        event_serialized_lst_t lst;
+        int fd = open(path.c_str(), O_RDWR);
+        off_t end = 0;
+
+        EXPECT_LE(0, fd);
+        EXPECT_EQ(0, fstat(fd, &st));
+
+        /* Find the end of data, as file is sized upfront */
+        for (off_t off = st.st_size - 1; off > 0; --off) {
+            char c;
+            EXPECT_EQ(1, pread(fd, &c, 1, off));
+            if (c != 0) {
+                end = off;
+                break;
+            }
+        }
+        EXPECT_LT(0, end);
+        EXPECT_EQ(1, pwrite(fd, "X", 1, end));
+        close(fd);
+
+        EXPECT_EQ(0, jnl.open(cfg));
+        EXPECT_EQ(9, (int)jnl.size());
+
+        /* Torn record is overwritten cleanly */
+        append_evts(jnl, "rid-A", 10, 12);
+        lst = replay_all(jnl, "rid-A", 0, 100);
+        EXPECT_EQ(12, (int)lst.size());
+        EXPECT_EQ(make_evt("rid-A", 12), lst.back());
+    }
+
+    remove_journal_dir(dir);
+}
+
+TEST(eventd_journal, rotate)
+{
+    string dir = make_journal_dir();
+    journal_config_t cfg;
+    event_journal jnl;
+
+    cfg.dir = dir;
+    cfg.segment_size = 4096;
+    cfg.segment_max_cnt = 3;
+    EXPECT_EQ(0, jnl.open(cfg));
+
+    append_evts(jnl, "rid-A", 1, 1000);
+
+    /* Oldest segments are removed */
+    EXPECT_EQ(3, (int)jnl.segment_count());
+    EXPECT_GT(1000, (int)jnl.size());
+
+    /* Replay returns what is retained, in order, across segments */
+    event_serialized_lst_t lst = replay_all(jnl, "rid-A", 0, 13);
+    EXPECT_EQ(jnl.size(), lst.size());
+    EXPECT_EQ(make_evt("rid-A", 1000), lst.back());
+    EXPECT_EQ(make_evt("rid-A", 1001 - lst.size()), lst.front());
+
+    /* Recovery honors the retained segments */
+    jnl.close();
+    EXPECT_EQ(0, jnl.open(cfg));
+    EXPECT_EQ(lst.size(), jnl.size());
+    EXPECT_EQ(lst, replay_all(jnl, "rid-A", 0, 100));
+
+    jnl.close();
+    remove_journal_dir(dir);
+}
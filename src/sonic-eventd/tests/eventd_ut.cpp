@@ -5,6 +5,7 @@
 #include <deque>
 #include <regex>
 #include <chrono>
+#include <unistd.h>
 #include "gtest/gtest.h"
 #include "events_common.h"
 #include "events.h"
@@ -556,6 +557,137 @@ TEST(eventd, captureCacheMax)
     printf("Capture TEST with matchinhg cache-max completed\n");
 }
 
+TEST(eventd, ringCache)
+{
+    printf("Ring cache TEST started\n");
+
+    event_ring_cache ring;
+    string_view evt;
+    string s1(10, 'a'), s2(20, 'b'), s3(30, 'c');
+    size_t rec = sizeof(uint32_t);
+
+    /* Not initialized; no room */
+    EXPECT_FALSE(ring.push_back(s1));
+    EXPECT_FALSE(ring.front(evt));
+
+    /* Room for s1 & s2 only */
+    EXPECT_EQ(0, ring.init(rec + s1.size() + rec + s2.size() + 8));
+
+    EXPECT_TRUE(ring.push_back(s1));
+    EXPECT_TRUE(ring.push_back(s2));
+    EXPECT_FALSE(ring.push_back(s3));
+    EXPECT_EQ(2, (int)ring.size());
+    EXPECT_EQ(rec + s1.size() + rec + s2.size(), ring.bytes());
+
+    EXPECT_TRUE(ring.front(evt));
+    EXPECT_EQ(s1, string(evt));
+    ring.pop_front();
+
+    /* s1 room at start is free; s1 fits by wrapping, s3 does not */
+    EXPECT_FALSE(ring.push_back(s3));
+    EXPECT_TRUE(ring.push_back(s1));
+    EXPECT_EQ(2, (int)ring.size());
+
+    /* Order is preserved across wrap */
+    EXPECT_TRUE(ring.front(evt));
+    EXPECT_EQ(s2, string(evt));
+    ring.pop_front();
+    EXPECT_TRUE(ring.front(evt));
+    EXPECT_EQ(s1, string(evt));
+    ring.pop_front();
+
+    EXPECT_TRUE(ring.empty());
+    EXPECT_EQ(0, (int)ring.bytes());
+    EXPECT_FALSE(ring.front(evt));
+
+    /* Swap hands over the arena as is */
+    {
+        event_ring_cache other;
+
+        EXPECT_TRUE(ring.push_back(s2));
+        other.swap(ring);
+        EXPECT_TRUE(ring.empty());
+        EXPECT_EQ(0, (int)ring.capacity());
+        EXPECT_TRUE(other.front(evt));
+        EXPECT_EQ(s2, string(evt));
+    }
+
+    printf("Ring cache TEST completed\n");
+}
+
+
+static long
+read_rss_kb()
+{
+    long pages = 0, rss = 0;
+    FILE *fp = fopen("/proc/self/statm", "r");
+
+    if (fp != NULL) {
+        if (fscanf(fp, "%ld %ld", &pages, &rss) != 2) {
+            rss = 0;
+        }
+        fclose(fp);
+    }
+    return rss * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+TEST(eventd, ringCacheBench)
+{
+    /*
+     * Micro benchmark of cache ring vs vector of strings, as used before.
+     * Reports events/s & RSS growth to hold the events. Ring is run first,
+     * as its arena is given back to OS on release, unlike the many small
+     * allocations of the vector.
+     */
+    printf("Ring cache benchmark started\n");
+
+    const int cnt = 100000;
+    vector<string> evts;
+
+    for (int i=0; i < (int)ARRAY_SIZE(ldata); ++i) {
+        string evt_str;
+        serialize(create_ev(ldata[i]), evt_str);
+        evts.push_back(evt_str);
+    }
+
+    {
+        event_ring_cache ring;
+        long rss = read_rss_kb();
+        auto st = chrono::steady_clock::now();
+
+        EXPECT_EQ(0, ring.init(CAPTURE_CACHE_MAX_BYTES));
+        for (int i=0; i < cnt; ++i) {
+            EXPECT_TRUE(ring.push_back(evts[i % evts.size()]));
+        }
+        auto us = chrono::duration_cast<chrono::microseconds>(
+                chrono::steady_clock::now() - st).count();
+
+        EXPECT_EQ(cnt, (int)ring.size());
+        printf("ring:   events=%d bytes=%lu events/s=%ld rss_growth=%ld KB\n",
+                cnt, ring.bytes(), (long)cnt * 1000000 / max((long)us, 1L),
+                read_rss_kb() - rss);
+    }
+
+    {
+        event_serialized_lst_t lst;
+        long rss = read_rss_kb();
+        auto st = chrono::steady_clock::now();
+
+        for (int i=0; i < cnt; ++i) {
+            lst.push_back(evts[i % evts.size()]);
+        }
+        auto us = chrono::duration_cast<chrono::microseconds>(
+                chrono::steady_clock::now() - st).count();
+
+        EXPECT_EQ(cnt, (int)lst.size());
+        printf("vector: events=%d events/s=%ld rss_growth=%ld KB\n",
+                cnt, (long)cnt * 1000000 / max((long)us, 1L),
+                read_rss_kb() - rss);
+    }
+
+    printf("Ring cache benchmark completed\n");
+}
+
 TEST(eventd, service)
 {
     /*
@@ -857,10 +989,14 @@ TEST(eventd, testDB)
     this_thread::sleep_for(chrono::milliseconds(200));
 
     EXPECT_EQ(0, pcap->set_control(STOP_CAPTURE));
+    EXPECT_LT(0, (int)stats_instance.read_stat(INDEX_STATS_CACHE_BYTES));
 
     /* Read the cache */
     EXPECT_EQ(0, pcap->read_cache(evts_read, last_evts_read, overflow));
 
+    /* The cache went to the caller */
+    EXPECT_EQ(0, (int)stats_instance.read_stat(INDEX_STATS_CACHE_BYTES));
+
     /*
      * Sent pub_count messages of different tags.
      * Upon cache max, only event per sender/runtime-id is saved. Hence
@@ -929,4 +1065,81 @@ TEST(eventd, testDB)
 }
 
 
-// TODO -- Add unit tests for stats
+TEST(eventd, stats)
+{
+    printf("Stats TEST started\n");
+
+    /* Writer is not started; Counters are read from memory */
+    stats_collector stats_instance;
+    const int thr_cnt = STATS_COUNTER_SHARDS + 2;
+    const int per_thr = 10000;
+    vector<thread> thrs;
+
+    for (int i = 0; i < thr_cnt; ++i) {
+        thrs.emplace_back([&stats_instance]() {
+            for (int j = 0; j < per_thr; ++j) {
+                stats_instance.increment_published(1);
+                stats_instance.increment_missed_cache(2);
+                stats_instance.increment_deserialize_failed(1);
+            }
+        });
+    }
+    for (auto &thr : thrs) {
+        thr.join();
+    }
+
+    /* Shards add up exact */
+    EXPECT_EQ((counters_t)(thr_cnt * per_thr),
+            stats_instance.read_counter(INDEX_COUNTERS_EVENTS_PUBLISHED));
+    EXPECT_EQ((counters_t)(2 * thr_cnt * per_thr),
+            stats_instance.read_counter(INDEX_COUNTERS_EVENTS_MISSED_CACHE));
+    EXPECT_EQ((counters_t)(thr_cnt * per_thr),
+            stats_instance.read_stat(INDEX_STATS_DESERIALIZE_FAILED));
+
+    /* Gauges; Peak holds the max seen */
+    stats_instance.set_capture_batch(50);
+    stats_instance.set_capture_batch(5);
+    EXPECT_EQ(5, (int)stats_instance.read_stat(INDEX_STATS_CAPTURE_BATCH));
+    EXPECT_EQ(50, (int)stats_instance.read_stat(INDEX_STATS_CAPTURE_BATCH_PEAK));
+
+    stats_instance.set_stat(INDEX_STATS_CACHE_BYTES, 1234);
+    EXPECT_EQ(1234, (int)stats_instance.read_stat(INDEX_STATS_CACHE_BYTES));
+
+    /* Deserialize failed is a counter; Can't be set */
+    stats_instance.set_stat(INDEX_STATS_DESERIALIZE_FAILED, 0);
+    EXPECT_EQ((counters_t)(thr_cnt * per_thr),
+            stats_instance.read_stat(INDEX_STATS_DESERIALIZE_FAILED));
+
+    printf("Stats TEST completed\n");
+}
+
+TEST(eventd, latencyHistogram)
+{
+    latency_histogram hist;
+
+    EXPECT_EQ(0, hist.percentile(50));
+
+    /* Exact upto 16ms */
+    for (int i = 1; i <= 10; ++i) {
+        hist.add(i);
+    }
+    EXPECT_EQ(5, hist.percentile(50));
+    EXPECT_EQ(10, hist.percentile(99));
+
+    /* Beyond, within 25% */
+    hist.reset();
+    for (int i = 0; i < 98; ++i) {
+        hist.add(2);
+    }
+    hist.add(1000);
+    hist.add(1000);
+    EXPECT_EQ(2, hist.percentile(50));
+    EXPECT_LE(hist.percentile(99), 1000);
+    EXPECT_GE(hist.percentile(99), 750);
+
+    /* Negative, as in clock skew, counts as 0 */
+    hist.reset();
+    hist.add(-5);
+    EXPECT_EQ(1, (int)hist.count());
+    EXPECT_EQ(0, hist.percentile(99));
+}
@@ -1,8 +1,8 @@
 CC := g++
 
-TEST_OBJS += ./tests/eventd_ut.o ./tests/main.o
+TEST_OBJS += ./tests/eventd_ut.o ./tests/eventd_journal_ut.o ./tests/main.o
 
-C_DEPS += ./tests/eventd_ut.d ./tests/main.d
+C_DEPS += ./tests/eventd_ut.d ./tests/eventd_journal_ut.d ./tests/main.d
 
 tests/%.o: tests/%.cpp
 	@echo 'Building file: $<'
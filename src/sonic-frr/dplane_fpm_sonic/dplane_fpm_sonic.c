@@ -31,6 +31,7 @@
 
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 
 #include <errno.h>
 #include <string.h>
@@ -45,6 +46,8 @@
 #include "lib/network.h"
 #include "lib/ns.h"
 #include "lib/frr_pthread.h"
+#include "lib/jhash.h"
+#include "lib/typesafe.h"
 #include "zebra/debug.h"
 #include "zebra/interface.h"
 #include "zebra/zebra_dplane.h"
@@ -162,18 +165,315 @@ enum custom_rtattr_srv6_localsid_action {
 
 static const char *prov_name = "dplane_fpm_sonic";
 
+/* Functions spreading the routes on FPM sessions. */
+enum fpm_shard_by {
+	FPM_SHARD_BY_TABLE,
+	FPM_SHARD_BY_AFI,
+	FPM_SHARD_BY_PREFIX,
+};
+
+static const char *const fpm_shard_by_str[] = {
+	[FPM_SHARD_BY_TABLE] = "table",
+	[FPM_SHARD_BY_AFI] = "afi",
+	[FPM_SHARD_BY_PREFIX] = "prefix",
+};
+
+DEFINE_MTYPE_STATIC(ZEBRA, FPM_COALESCE, "FPM coalescing entry");
+DEFINE_MTYPE_STATIC(ZEBRA, FPM_OBUF, "FPM output buffer chunk");
+DEFINE_MTYPE_STATIC(ZEBRA, FPM_STAMP, "FPM latency timestamps");
+DEFINE_MTYPE_STATIC(ZEBRA, FPM_WORK, "FPM session encode work");
+
+/*
+ * Output buffer:
+ * A chain of chunks the netlink encoders write into in place. Chunks are
+ * written with writev() and recycled once sent, data is never moved. The
+ * chunks in use are bounded by a high-water mark, which doubles (up to a
+ * configured maximum) when the encoders ran out of space but the socket
+ * then drained the whole buffer.
+ */
+#define FPM_OBUF_CHUNK_SIZE (NL_PKT_BUF_SIZE * 16)
+#define FPM_OBUF_HWM_DEFAULT (NL_PKT_BUF_SIZE * 128)
+#define FPM_OBUF_HWM_MAX_DEFAULT (FPM_OBUF_HWM_DEFAULT * 16)
+#define FPM_OBUF_IOV_MAX 64
+
+/* RIB walk slice default budget: routes sent and time spent. */
+#define FPM_RIB_SLICE_ROUTES_DEFAULT 2000
+#define FPM_RIB_SLICE_USEC_DEFAULT 5000
+
+/* Maximum amount of parallel FPM sessions. */
+#define FPM_SESSIONS_MAX 8
+
+/* Contexts queued for a session encoder before the queue stops. */
+#define FPM_ENCQ_MAX 4096
+
+/* Largest FPM message: header and one netlink buffer. */
+#define FPM_MSG_SIZE_MAX (FPM_HEADER_SIZE + NL_PKT_BUF_SIZE)
+
+PREDECL_DLIST(fpm_obuf);
+
+struct fpm_obuf_chunk {
+	struct fpm_obuf_item item;
+
+	/* Start of the data not sent yet. */
+	size_t getp;
+	/* End of the data. */
+	size_t endp;
+
+	uint8_t data[FPM_OBUF_CHUNK_SIZE];
+};
+
+DECLARE_DLIST(fpm_obuf, struct fpm_obuf_chunk, item);
+
+/*
+ * Session encoders:
+ * With several sessions, data plane contexts are encoded by the thread of
+ * every session they go to, from a queue per session. The context returns
+ * to zebra once the last of them is done with it.
+ */
+PREDECL_DLIST(fpm_encq);
+
+struct fpm_work;
+
+struct fpm_encq_entry {
+	struct fpm_encq_item item;
+	struct fpm_work *work;
+};
+
+DECLARE_DLIST(fpm_encq, struct fpm_encq_entry, item);
+
+enum fpm_coalesce_action {
+	/* Encode the context. */
+	FCA_SEND,
+	/* Encode the route install as an update (delete and install). */
+	FCA_SEND_UPDATE,
+	/* Context superseded, don't encode it. */
+	FCA_SKIP,
+};
+
+struct fpm_work {
+	struct zebra_dplane_ctx *ctx;
+	enum fpm_coalesce_action action;
+	/* Data plane enqueue time. */
+	int64_t enqueued;
+	/* Sessions still to encode it. */
+	_Atomic uint32_t refs;
+	struct fpm_encq_entry entries[FPM_SESSIONS_MAX];
+};
+
+/*
+ * Latency histograms:
+ * Log-linear buckets of microseconds, FPM_HIST_SUB per power of two (12.5%
+ * precision) up to 2^FPM_HIST_EXP_MAX. Updated with relaxed atomics by any
+ * thread, without locking.
+ */
+#define FPM_HIST_SUB_BITS 3
+#define FPM_HIST_SUB (1 << FPM_HIST_SUB_BITS)
+#define FPM_HIST_EXP_MAX 40
+#define FPM_HIST_BUCKETS                                                       \
+	((FPM_HIST_EXP_MAX - FPM_HIST_SUB_BITS + 2) * FPM_HIST_SUB)
+
+struct fpm_hist {
+	_Atomic uint64_t buckets[FPM_HIST_BUCKETS];
+	_Atomic uint64_t count;
+	_Atomic uint64_t sum;
+	_Atomic uint64_t max;
+};
+
+enum fpm_latency_stage {
+	/* Data plane enqueue to encode, or to the session encoders. */
+	FPM_LAT_QUEUE,
+	/* Encode to socket write. */
+	FPM_LAT_WRITE,
+	/* Data plane enqueue to socket write. */
+	FPM_LAT_TOTAL,
+	/* Socket write to route feedback from the peer. */
+	FPM_LAT_FEEDBACK,
+
+	FPM_LAT_MAX,
+};
+
+static const char *const fpm_latency_str[] = {
+	[FPM_LAT_QUEUE] = "queue",
+	[FPM_LAT_WRITE] = "write",
+	[FPM_LAT_TOTAL] = "total",
+	[FPM_LAT_FEEDBACK] = "feedback",
+};
+
+/* Timestamps (in microseconds) of a queued context or of a message. */
+struct fpm_stamp {
+	/* Output buffer offset the message ends at. */
+	uint64_t end;
+	/* Data plane enqueue time, zero for walks. */
+	int64_t enqueued;
+	/* Encode time. */
+	int64_t encoded;
+	/* Netlink sequence number, zero if not a route. */
+	uint32_t seq;
+};
+
+/* Timestamps FIFO, growing as needed. */
+struct fpm_stamp_ring {
+	struct fpm_stamp *stamps;
+	/* Power of two. */
+	uint32_t size;
+	uint32_t head;
+	uint32_t count;
+};
+
+#define FPM_STAMP_RING_SIZE 1024
+
+/*
+ * Write time of the routes by sequence number, for the peer route
+ * feedback (RTM_NEWROUTE) carrying it back. Older entries are overwritten.
+ */
+#define FPM_FEEDBACK_SLOTS 4096
+
+struct fpm_feedback_slot {
+	_Atomic uint32_t seq;
+	_Atomic int64_t stamp;
+};
+
+/*
+ * Queued update coalescing:
+ * Pending route and next hop group contexts are indexed by route (VRF,
+ * table and prefixes) or next hop group ID, so a newer update can
+ * supersede the pending one. Superseded contexts stay in the queue (the
+ * data plane context list can't drop items in the middle) and are returned
+ * to zebra without being encoded.
+ */
+PREDECL_HASH(fpm_coalesce);
+PREDECL_HASH(fpm_superseded);
+
+struct fpm_coalesce_entry {
+	struct fpm_coalesce_item item;
+
+	/* Key: next hop group ID, zero for routes. */
+	uint32_t nhg_id;
+	/* Key: route VRF, table and prefixes. */
+	vrf_id_t vrf_id;
+	uint32_t table_id;
+	struct prefix dest;
+	struct prefix src;
+
+	/* Latest pending context of this key. */
+	struct zebra_dplane_ctx *ctx;
+	/* Coalescing generation the context was queued in. */
+	uint32_t gen;
+	/* Next hop group referenced by a context queued after it. */
+	bool pinned;
+	/* Route install superseding a route delete: send both. */
+	bool need_delete;
+};
+
+struct fpm_superseded_entry {
+	struct fpm_superseded_item item;
+	struct zebra_dplane_ctx *ctx;
+};
+
+static int fpm_coalesce_cmp(const struct fpm_coalesce_entry *a,
+			    const struct fpm_coalesce_entry *b)
+{
+	int ret;
+
+	if (a->nhg_id != b->nhg_id)
+		return a->nhg_id < b->nhg_id ? -1 : 1;
+	if (a->vrf_id != b->vrf_id)
+		return a->vrf_id < b->vrf_id ? -1 : 1;
+	if (a->table_id != b->table_id)
+		return a->table_id < b->table_id ? -1 : 1;
+	if (a->dest.family != b->dest.family)
+		return a->dest.family < b->dest.family ? -1 : 1;
+	if (a->src.family != b->src.family)
+		return a->src.family < b->src.family ? -1 : 1;
+	if (a->src.family) {
+		ret = prefix_cmp(&a->src, &b->src);
+		if (ret)
+			return ret;
+	}
+	if (a->dest.family)
+		return prefix_cmp(&a->dest, &b->dest);
+
+	return 0;
+}
+
+static uint32_t fpm_coalesce_hash(const struct fpm_coalesce_entry *e)
+{
+	uint32_t key = 0;
+
+	if (e->dest.family)
+		key = prefix_hash_key(&e->dest);
+	if (e->src.family)
+		key = jhash_1word(prefix_hash_key(&e->src), key);
+
+	return jhash_3words(e->nhg_id, e->vrf_id, e->table_id, key);
+}
+
+DECLARE_HASH(fpm_coalesce, struct fpm_coalesce_entry, item, fpm_coalesce_cmp,
+	     fpm_coalesce_hash);
+
+static int fpm_superseded_cmp(const struct fpm_superseded_entry *a,
+			      const struct fpm_superseded_entry *b)
+{
+	return numcmp((uintptr_t)a->ctx, (uintptr_t)b->ctx);
+}
+
+static uint32_t fpm_superseded_hash(const struct fpm_superseded_entry *e)
+{
+	return jhash(&e->ctx, sizeof(e->ctx), 0);
+}
+
+DECLARE_HASH(fpm_superseded, struct fpm_superseded_entry, item,
+	     fpm_superseded_cmp, fpm_superseded_hash);
+
 struct fpm_nl_ctx {
+	/*
+	 * FPM sessions:
+	 * Routes are spread on the sessions by the sharding function. Next
+	 * hop groups, PIC contexts and SID lists, which routes depend on, are
+	 * sent on every session; anything else on the first one only.
+	 *
+	 * The first session is the data plane provider: it queues the
+	 * contexts, runs the walks and encodes into the output buffers of all
+	 * sessions in data plane order, so dependencies come first on every
+	 * session. Each session has its own connection (to the next port),
+	 * output buffer, I/O thread and counters.
+	 */
+	struct fpm_nl_ctx *primary;
+	uint32_t session_id;
+	struct fpm_nl_ctx *sessions[FPM_SESSIONS_MAX];
+	_Atomic uint32_t nsessions;
+	enum fpm_shard_by shard_by;
+	/* Configuration, applied by FNE_SET_SESSIONS. */
+	uint32_t nsessions_cfg;
+	enum fpm_shard_by shard_by_cfg;
+
 	/* data plane connection. */
 	int socket;
 	bool disabled;
 	bool connecting;
 	bool use_nhg;
+	bool coalesce;
 	struct sockaddr_storage addr;
 
 	/* data plane buffers. */
 	struct stream *ibuf;
-	struct stream *obuf;
+	struct fpm_obuf_head obuf;
+	struct fpm_obuf_head obuf_free;
 	pthread_mutex_t obuf_mutex;
+	/* Output buffer chunks allocated. */
+	size_t obuf_chunks;
+	/* Output buffer high-water mark: current, configured and maximum. */
+	size_t obuf_hwm;
+	size_t obuf_hwm_cfg;
+	size_t obuf_hwm_max;
+	/* Encoders ran out of output buffer space. */
+	bool obuf_starved;
+	/* RIB walk waiting for the output buffer to drain. */
+	bool obuf_rib_wait;
+	/* Messages timestamps and output buffer offsets. */
+	struct fpm_stamp_ring obuf_stamps;
+	uint64_t obuf_enqueued;
+	uint64_t obuf_written;
 
 	/*
 	 * data plane context queue:
@@ -183,6 +483,25 @@ struct fpm_nl_ctx {
 	struct dplane_ctx_list_head ctxqueue;
 	pthread_mutex_t ctxqueue_mutex;
 
+	/*
+	 * Session encoder queue, used with several sessions only. The first
+	 * session stops queueing to it when full until it drained by half.
+	 */
+	struct fpm_encq_head encq;
+	pthread_mutex_t encq_mutex;
+	bool encq_blocked;
+	/* Enqueue time of the queued contexts, in the same order. */
+	struct fpm_stamp_ring ctxqueue_stamps;
+
+	/*
+	 * Queued update coalescing, protected by ctxqueue_mutex. A delete of
+	 * an object that routes or groups may depend on starts a new
+	 * generation: updates are never coalesced across it.
+	 */
+	struct fpm_coalesce_head coalesce_index;
+	struct fpm_superseded_head superseded;
+	uint32_t coalesce_gen;
+
 	/* data plane events. */
 	struct zebra_dplane_provider *prov;
 	struct frr_pthread *fthread;
@@ -191,7 +510,10 @@ struct fpm_nl_ctx {
 	struct event *t_write;
 	struct event *t_event;
 	struct event *t_nhg;
+	struct event *t_coalesce;
+	struct event *t_sessions;
 	struct event *t_dequeue;
+	struct event *t_encode;
 
 	/* zebra events. */
 	struct event *t_lspreset;
@@ -203,6 +525,30 @@ struct fpm_nl_ctx {
 	struct event *t_rmacreset;
 	struct event *t_rmacwalk;
 
+	/*
+	 * RIB walk cursor, only used by the zebra thread: the walk is done
+	 * in slices and resumes at the route it stopped at.
+	 */
+	struct {
+		/* Walk in progress. */
+		bool active;
+		/* Send all routes, not only the ones not sent yet. */
+		bool full;
+		/* Walk again (not sent routes) once done. */
+		bool rewalk;
+		/* Table iterator before the current table. */
+		rib_tables_iter_t iter;
+		/* Current table iterator, valid if stopped in a table. */
+		rib_tables_iter_t table_iter;
+		bool in_table;
+		/* Route to resume at. */
+		struct prefix dst;
+		struct prefix src;
+	} rib_cursor;
+	/* RIB walk slice budget. */
+	uint32_t rib_slice_routes;
+	uint32_t rib_slice_usec;
+
 	/* Statistic counters. */
 	struct {
 		/* Amount of bytes read into ibuf. */
@@ -231,7 +577,28 @@ struct fpm_nl_ctx {
 
 		/* Amount of buffer full events. */
 		_Atomic uint32_t buffer_full;
+
+		/* Amount of queued updates superseded by newer ones. */
+		_Atomic uint32_t coalesced_updates;
+
+		/* Amount of routes sent by RIB walks. */
+		_Atomic uint32_t rib_walk_routes;
+		/* Amount of RIB walk slices. */
+		_Atomic uint32_t rib_walk_slices;
+		/* Amount of RIB walk waits for the output buffer. */
+		_Atomic uint32_t rib_walk_waits;
+		/* Amount of RIB walks completed. */
+		_Atomic uint32_t rib_walks;
 	} counters;
+
+	/*
+	 * Route programming latency of all sessions, kept by the first
+	 * session only.
+	 */
+	struct fpm_hist latency[FPM_LAT_MAX];
+	/* Last netlink sequence number stamped on routes. */
+	_Atomic uint32_t seq;
+	struct fpm_feedback_slot feedback[FPM_FEEDBACK_SLOTS];
 } *gfnc;
 
 struct seg6_iptunnel_encap_pri {
@@ -250,6 +617,10 @@ enum fpm_nl_events {
 	FNE_RESET_COUNTERS,
 	/* Toggle next hop group feature. */
 	FNE_TOGGLE_NHG,
+	/* Toggle queued update coalescing. */
+	FNE_TOGGLE_COALESCE,
+	/* Apply FPM sessions configuration. */
+	FNE_SET_SESSIONS,
 	/* Reconnect request by our own code to avoid races. */
 	FNE_INTERNAL_RECONNECT,
 
@@ -275,21 +646,274 @@ enum fpm_nl_events {
  * Prototypes.
  */
 static void fpm_process_event(struct event *t);
-static int fpm_nl_enqueue(struct fpm_nl_ctx *fnc, struct zebra_dplane_ctx *ctx);
+static int fpm_nl_enqueue(struct fpm_nl_ctx *fnc, struct zebra_dplane_ctx *ctx,
+			  int64_t enqueued);
 static void fpm_lsp_send(struct event *t);
 static void fpm_lsp_reset(struct event *t);
 static void fpm_nhg_send(struct event *t);
 static void fpm_nhg_reset(struct event *t);
 static void fpm_rib_send(struct event *t);
 static void fpm_rib_reset(struct event *t);
+static void fpm_rib_walk_start(struct fpm_nl_ctx *fnc, bool full);
 static void fpm_rmac_send(struct event *t);
 static void fpm_rmac_reset(struct event *t);
+static void fpm_session_encode(struct event *t);
+static void fpm_process_queue(struct event *t);
+
+/*
+ * Latency functions.
+ */
+static int64_t fpm_time_usec(void)
+{
+	struct timeval tv;
+
+	monotime(&tv);
+
+	return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static uint32_t fpm_hist_index(uint64_t value)
+{
+	uint32_t exp;
+
+	if (value < FPM_HIST_SUB)
+		return value;
+
+	exp = 63 - __builtin_clzll(value);
+	if (exp > FPM_HIST_EXP_MAX)
+		return FPM_HIST_BUCKETS - 1;
+
+	return (exp - FPM_HIST_SUB_BITS + 1) * FPM_HIST_SUB
+	       + ((value >> (exp - FPM_HIST_SUB_BITS)) & (FPM_HIST_SUB - 1));
+}
+
+/* Lowest value of a bucket. */
+static uint64_t fpm_hist_value(uint32_t idx)
+{
+	uint32_t exp;
+
+	if (idx < FPM_HIST_SUB)
+		return idx;
+
+	exp = idx / FPM_HIST_SUB + FPM_HIST_SUB_BITS - 1;
+
+	return (uint64_t)(FPM_HIST_SUB + idx % FPM_HIST_SUB)
+	       << (exp - FPM_HIST_SUB_BITS);
+}
+
+static void fpm_hist_add(struct fpm_hist *hist, int64_t usec)
+{
+	uint64_t value = usec > 0 ? (uint64_t)usec : 0;
+	uint64_t max;
+
+	atomic_fetch_add_explicit(&hist->buckets[fpm_hist_index(value)], 1,
+				  memory_order_relaxed);
+	atomic_fetch_add_explicit(&hist->count, 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&hist->sum, value, memory_order_relaxed);
+
+	max = atomic_load_explicit(&hist->max, memory_order_relaxed);
+	while (max < value
+	       && !atomic_compare_exchange_weak_explicit(&hist->max, &max, value,
+							 memory_order_relaxed,
+							 memory_order_relaxed))
+		;
+}
+
+static void fpm_hist_reset(struct fpm_hist *hist)
+{
+	int i;
+
+	for (i = 0; i < FPM_HIST_BUCKETS; i++)
+		atomic_store_explicit(&hist->buckets[i], 0,
+				      memory_order_relaxed);
+	atomic_store_explicit(&hist->count, 0, memory_order_relaxed);
+	atomic_store_explicit(&hist->sum, 0, memory_order_relaxed);
+	atomic_store_explicit(&hist->max, 0, memory_order_relaxed);
+}
+
+/* Latency summary, from a copy of the buckets. */
+struct fpm_hist_summary {
+	uint64_t count;
+	uint64_t mean;
+	uint64_t p50;
+	uint64_t p90;
+	uint64_t p99;
+	uint64_t p999;
+	uint64_t max;
+};
+
+static void fpm_hist_summarize(struct fpm_hist *hist,
+			       struct fpm_hist_summary *hs)
+{
+	static const uint32_t permille[] = {500, 900, 990, 999};
+	uint64_t *values[] = {&hs->p50, &hs->p90, &hs->p99, &hs->p999};
+	uint64_t buckets[FPM_HIST_BUCKETS];
+	uint64_t total = 0, seen = 0, sum, upper;
+	uint32_t i, q = 0;
+
+	memset(hs, 0, sizeof(*hs));
+	for (i = 0; i < FPM_HIST_BUCKETS; i++) {
+		buckets[i] = atomic_load_explicit(&hist->buckets[i],
+						  memory_order_relaxed);
+		total += buckets[i];
+	}
+	if (total == 0)
+		return;
+
+	sum = atomic_load_explicit(&hist->sum, memory_order_relaxed);
+	hs->count = total;
+	hs->mean = sum / total;
+	hs->max = atomic_load_explicit(&hist->max, memory_order_relaxed);
+
+	/* Report the highest value of the bucket the percentile falls in. */
+	for (i = 0; i < FPM_HIST_BUCKETS && q < array_size(permille); i++) {
+		seen += buckets[i];
+		upper = i + 1 < FPM_HIST_BUCKETS ? fpm_hist_value(i + 1) - 1
+						 : hs->max;
+		while (q < array_size(permille)
+		       && seen * 1000 >= total * permille[q])
+			*values[q++] = MIN(upper, hs->max);
+	}
+}
+
+/*
+ * Timestamps FIFO functions, must be called with the lock of the queue
+ * they describe held.
+ */
+static void fpm_stamp_push(struct fpm_stamp_ring *ring,
+			   const struct fpm_stamp *stamp)
+{
+	struct fpm_stamp *stamps;
+	uint32_t i, size;
+
+	if (ring->count == ring->size) {
+		size = ring->size ? ring->size * 2 : FPM_STAMP_RING_SIZE;
+		stamps = XMALLOC(MTYPE_FPM_STAMP, size * sizeof(*stamps));
+		for (i = 0; i < ring->count; i++)
+			stamps[i] = ring->stamps[(ring->head + i)
+						 & (ring->size - 1)];
+
+		XFREE(MTYPE_FPM_STAMP, ring->stamps);
+		ring->stamps = stamps;
+		ring->size = size;
+		ring->head = 0;
+	}
+
+	ring->stamps[(ring->head + ring->count) & (ring->size - 1)] = *stamp;
+	ring->count++;
+}
+
+static struct fpm_stamp *fpm_stamp_first(struct fpm_stamp_ring *ring)
+{
+	if (ring->count == 0)
+		return NULL;
+
+	return &ring->stamps[ring->head];
+}
+
+static void fpm_stamp_pop(struct fpm_stamp_ring *ring)
+{
+	ring->head = (ring->head + 1) & (ring->size - 1);
+	ring->count--;
+}
+
+static void fpm_stamp_reset(struct fpm_stamp_ring *ring)
+{
+	ring->head = 0;
+	ring->count = 0;
+}
+
+static void fpm_stamp_release(struct fpm_stamp_ring *ring)
+{
+	fpm_stamp_reset(ring);
+	XFREE(MTYPE_FPM_STAMP, ring->stamps);
+	ring->size = 0;
+}
+
+/* Remember the write time of a route for the peer feedback. */
+static void fpm_feedback_track(struct fpm_nl_ctx *fnc, uint32_t seq,
+			       int64_t now)
+{
+	struct fpm_feedback_slot *slot;
+
+	slot = &fnc->feedback[seq % FPM_FEEDBACK_SLOTS];
+	atomic_store_explicit(&slot->seq, 0, memory_order_relaxed);
+	atomic_store_explicit(&slot->stamp, now, memory_order_relaxed);
+	atomic_store_explicit(&slot->seq, seq, memory_order_release);
+}
+
+/* Route feedback from the peer: account the latency once. */
+static void fpm_feedback_done(struct fpm_nl_ctx *fnc, uint32_t seq)
+{
+	struct fpm_feedback_slot *slot;
+	uint32_t expected = seq;
+	int64_t stamp;
+
+	if (seq == 0)
+		return;
+
+	slot = &fnc->feedback[seq % FPM_FEEDBACK_SLOTS];
+	if (atomic_load_explicit(&slot->seq, memory_order_acquire) != seq)
+		return;
+
+	stamp = atomic_load_explicit(&slot->stamp, memory_order_relaxed);
+	if (!atomic_compare_exchange_strong_explicit(&slot->seq, &expected, 0,
+						     memory_order_relaxed,
+						     memory_order_relaxed))
+		return;
+
+	fpm_hist_add(&fnc->latency[FPM_LAT_FEEDBACK], fpm_time_usec() - stamp);
+}
+
+/*
+ * Account the latency of the messages written completely, must be called
+ * with obuf_mutex held.
+ */
+static void fpm_latency_written(struct fpm_nl_ctx *fnc, size_t len)
+{
+	struct fpm_nl_ctx *primary = fnc->primary;
+	struct fpm_stamp *stamp;
+	int64_t now = fpm_time_usec();
+
+	fnc->obuf_written += len;
+	while ((stamp = fpm_stamp_first(&fnc->obuf_stamps)) != NULL
+	       && stamp->end <= fnc->obuf_written) {
+		fpm_hist_add(&primary->latency[FPM_LAT_WRITE],
+			     now - stamp->encoded);
+		if (stamp->enqueued)
+			fpm_hist_add(&primary->latency[FPM_LAT_TOTAL],
+				     now - stamp->enqueued);
+		if (stamp->seq)
+			fpm_feedback_track(primary, stamp->seq, now);
+
+		fpm_stamp_pop(&fnc->obuf_stamps);
+	}
+}
 
 /*
  * CLI.
  */
 #define FPM_STR "Forwarding Plane Manager configuration\n"
 
+static void fpm_sessions_set_hwm(struct fpm_nl_ctx *fnc, size_t hwm,
+				 size_t hwm_max)
+{
+	struct fpm_nl_ctx *session;
+	int i;
+
+	for (i = 0; i < FPM_SESSIONS_MAX; i++) {
+		session = fnc->sessions[i];
+		if (session == NULL)
+			continue;
+
+		frr_with_mutex (&session->obuf_mutex) {
+			session->obuf_hwm = hwm;
+			session->obuf_hwm_cfg = hwm;
+			session->obuf_hwm_max = hwm_max;
+		}
+	}
+}
+
 DEFUN(fpm_set_address, fpm_set_address_cmd,
       "fpm address <A.B.C.D|X:X::X:X> [port (1-65535)]",
       FPM_STR
@@ -390,6 +1014,168 @@ DEFUN(no_fpm_use_nhg, no_fpm_use_nhg_cmd,
 	return CMD_SUCCESS;
 }
 
+DEFUN(fpm_coalesce_updates, fpm_coalesce_updates_cmd,
+      "fpm coalesce-updates",
+      FPM_STR
+      "Coalesce queued updates of the same route or next hop group\n")
+{
+	/* Already enabled. */
+	if (gfnc->coalesce)
+		return CMD_SUCCESS;
+
+	event_add_event(gfnc->fthread->master, fpm_process_event, gfnc,
+			 FNE_TOGGLE_COALESCE, &gfnc->t_coalesce);
+
+	return CMD_SUCCESS;
+}
+
+DEFUN(no_fpm_coalesce_updates, no_fpm_coalesce_updates_cmd,
+      "no fpm coalesce-updates",
+      NO_STR
+      FPM_STR
+      "Coalesce queued updates of the same route or next hop group\n")
+{
+	/* Already disabled. */
+	if (!gfnc->coalesce)
+		return CMD_SUCCESS;
+
+	event_add_event(gfnc->fthread->master, fpm_process_event, gfnc,
+			 FNE_TOGGLE_COALESCE, &gfnc->t_coalesce);
+
+	return CMD_SUCCESS;
+}
+
+DEFUN(fpm_obuf_hwm, fpm_obuf_hwm_cmd,
+      "fpm output-buffer high-water-mark (128-4194304) [maximum (128-4194304)]",
+      FPM_STR
+      "FPM output buffer\n"
+      "Amount of data buffered before holding off encoding\n"
+      "Initial high-water mark in KiB\n"
+      "Limit the high-water mark may grow to\n"
+      "Maximum high-water mark in KiB\n")
+{
+	size_t hwm, hwm_max;
+
+	hwm = strtoul(argv[3]->arg, NULL, 10) * 1024;
+	if (argc == 6)
+		hwm_max = strtoul(argv[5]->arg, NULL, 10) * 1024;
+	else
+		hwm_max = MAX(hwm, (size_t)FPM_OBUF_HWM_MAX_DEFAULT);
+
+	if (hwm_max < hwm) {
+		vty_out(vty,
+			"%% Maximum must not be lower than the high-water mark\n");
+		return CMD_WARNING_CONFIG_FAILED;
+	}
+
+	fpm_sessions_set_hwm(gfnc, hwm, hwm_max);
+
+	return CMD_SUCCESS;
+}
+
+DEFUN(no_fpm_obuf_hwm, no_fpm_obuf_hwm_cmd,
+      "no fpm output-buffer high-water-mark [(128-4194304) [maximum (128-4194304)]]",
+      NO_STR
+      FPM_STR
+      "FPM output buffer\n"
+      "Amount of data buffered before holding off encoding\n"
+      "Initial high-water mark in KiB\n"
+      "Limit the high-water mark may grow to\n"
+      "Maximum high-water mark in KiB\n")
+{
+	fpm_sessions_set_hwm(gfnc, FPM_OBUF_HWM_DEFAULT,
+			     FPM_OBUF_HWM_MAX_DEFAULT);
+
+	return CMD_SUCCESS;
+}
+
+DEFUN(fpm_rib_slice, fpm_rib_slice_cmd,
+      "fpm rib-walk slice routes (1-1000000) time (100-1000000)",
+      FPM_STR
+      "Walk sending the RIB routes to a new connection\n"
+      "Work done at once before yielding\n"
+      "Maximum routes sent per slice\n"
+      "Routes\n"
+      "Maximum time spent per slice\n"
+      "Time in microseconds\n")
+{
+	gfnc->rib_slice_routes = strtoul(argv[4]->arg, NULL, 10);
+	gfnc->rib_slice_usec = strtoul(argv[6]->arg, NULL, 10);
+
+	return CMD_SUCCESS;
+}
+
+DEFUN(no_fpm_rib_slice, no_fpm_rib_slice_cmd,
+      "no fpm rib-walk slice [routes (1-1000000) time (100-1000000)]",
+      NO_STR
+      FPM_STR
+      "Walk sending the RIB routes to a new connection\n"
+      "Work done at once before yielding\n"
+      "Maximum routes sent per slice\n"
+      "Routes\n"
+      "Maximum time spent per slice\n"
+      "Time in microseconds\n")
+{
+	gfnc->rib_slice_routes = FPM_RIB_SLICE_ROUTES_DEFAULT;
+	gfnc->rib_slice_usec = FPM_RIB_SLICE_USEC_DEFAULT;
+
+	return CMD_SUCCESS;
+}
+
+DEFUN(fpm_sessions, fpm_sessions_cmd,
+      "fpm sessions (1-8) [shard-by <table|afi|prefix>]",
+      FPM_STR
+      "Parallel FPM sessions, each one connecting to the next port\n"
+      "Number of sessions\n"
+      "Function spreading the routes on sessions\n"
+      "Route table ID\n"
+      "Address family, IPv4 and IPv6 on the first two sessions\n"
+      "Prefix hash\n")
+{
+	enum fpm_shard_by shard_by = FPM_SHARD_BY_TABLE;
+	uint32_t nsessions = strtoul(argv[2]->arg, NULL, 10);
+
+	if (argc == 5) {
+		if (strmatch(argv[4]->text, "afi"))
+			shard_by = FPM_SHARD_BY_AFI;
+		else if (strmatch(argv[4]->text, "prefix"))
+			shard_by = FPM_SHARD_BY_PREFIX;
+	}
+
+	/* The other sessions would never carry a route. */
+	if (shard_by == FPM_SHARD_BY_AFI && nsessions > 2) {
+		vty_out(vty,
+			"%% Sharding by address family uses at most 2 sessions\n");
+		return CMD_WARNING_CONFIG_FAILED;
+	}
+
+	gfnc->nsessions_cfg = nsessions;
+	gfnc->shard_by_cfg = shard_by;
+	event_add_event(gfnc->fthread->master, fpm_process_event, gfnc,
+			 FNE_SET_SESSIONS, &gfnc->t_sessions);
+
+	return CMD_SUCCESS;
+}
+
+DEFUN(no_fpm_sessions, no_fpm_sessions_cmd,
+      "no fpm sessions [(1-8) [shard-by <table|afi|prefix>]]",
+      NO_STR
+      FPM_STR
+      "Parallel FPM sessions, each one connecting to the next port\n"
+      "Number of sessions\n"
+      "Function spreading the routes on sessions\n"
+      "Route table ID\n"
+      "Address family\n"
+      "Prefix hash\n")
+{
+	gfnc->nsessions_cfg = 1;
+	gfnc->shard_by_cfg = FPM_SHARD_BY_TABLE;
+	event_add_event(gfnc->fthread->master, fpm_process_event, gfnc,
+			 FNE_SET_SESSIONS, &gfnc->t_sessions);
+
+	return CMD_SUCCESS;
+}
+
 DEFUN(fpm_reset_counters, fpm_reset_counters_cmd,
       "clear fpm counters",
       CLEAR_STR
@@ -407,11 +1193,18 @@ DEFUN(fpm_show_counters, fpm_show_counters_cmd,
       FPM_STR
       "FPM statistic counters\n")
 {
+	struct fpm_nl_ctx *session;
 	uint32_t curr_queue_len;
+	uint32_t obuf_hwm, obuf_chunks;
+	uint32_t i, nsessions;
 
 	frr_with_mutex (&gfnc->ctxqueue_mutex) {
 		curr_queue_len = dplane_ctx_queue_count(&gfnc->ctxqueue);
 	}
+	frr_with_mutex (&gfnc->obuf_mutex) {
+		obuf_hwm = gfnc->obuf_hwm;
+		obuf_chunks = gfnc->obuf_chunks;
+	}
 
 	vty_out(vty, "%30s\n%30s\n", "FPM counters", "============");
 
@@ -422,6 +1215,8 @@ DEFUN(fpm_show_counters, fpm_show_counters_cmd,
 	SHOW_COUNTER("Output bytes", gfnc->counters.bytes_sent);
 	SHOW_COUNTER("Output buffer current size", gfnc->counters.obuf_bytes);
 	SHOW_COUNTER("Output buffer peak size", gfnc->counters.obuf_peak);
+	SHOW_COUNTER("Output buffer high-water", obuf_hwm);
+	SHOW_COUNTER("Output buffer chunks", obuf_chunks);
 	SHOW_COUNTER("Connection closes", gfnc->counters.connection_closes);
 	SHOW_COUNTER("Connection errors", gfnc->counters.connection_errors);
 	SHOW_COUNTER("Data plane items processed",
@@ -430,9 +1225,32 @@ DEFUN(fpm_show_counters, fpm_show_counters_cmd,
 	SHOW_COUNTER("Data plane items queue peak",
 		     gfnc->counters.ctxqueue_len_peak);
 	SHOW_COUNTER("Buffer full hits", gfnc->counters.buffer_full);
+	SHOW_COUNTER("Coalesced updates", gfnc->counters.coalesced_updates);
+	SHOW_COUNTER("RIB walk routes sent", gfnc->counters.rib_walk_routes);
+	SHOW_COUNTER("RIB walk slices", gfnc->counters.rib_walk_slices);
+	SHOW_COUNTER("RIB walk buffer waits", gfnc->counters.rib_walk_waits);
+	SHOW_COUNTER("RIB walks completed", gfnc->counters.rib_walks);
 	SHOW_COUNTER("User FPM configurations", gfnc->counters.user_configures);
 	SHOW_COUNTER("User FPM disable requests", gfnc->counters.user_disables);
 
+	nsessions = atomic_load_explicit(&gfnc->nsessions,
+					 memory_order_acquire);
+	for (i = 1; i < nsessions; i++) {
+		session = gfnc->sessions[i];
+		vty_out(vty, "\n%28s %u\n", "FPM session", i);
+		SHOW_COUNTER("Input bytes", session->counters.bytes_read);
+		SHOW_COUNTER("Output bytes", session->counters.bytes_sent);
+		SHOW_COUNTER("Output buffer current size",
+			     session->counters.obuf_bytes);
+		SHOW_COUNTER("Output buffer peak size",
+			     session->counters.obuf_peak);
+		SHOW_COUNTER("Connection closes",
+			     session->counters.connection_closes);
+		SHOW_COUNTER("Connection errors",
+			     session->counters.connection_errors);
+		SHOW_COUNTER("Buffer full hits", session->counters.buffer_full);
+	}
+
 #undef SHOW_COUNTER
 
 	return CMD_SUCCESS;
@@ -445,32 +1263,132 @@ DEFUN(fpm_show_counters_json, fpm_show_counters_json_cmd,
       "FPM statistic counters\n"
       JSON_STR)
 {
-	uint32_t curr_queue_len;
-
-	frr_with_mutex (&gfnc->ctxqueue_mutex) {
-		curr_queue_len = dplane_ctx_queue_count(&gfnc->ctxqueue);
-	}
-
-	struct json_object *jo;
+	struct fpm_nl_ctx *session;
+	uint32_t curr_queue_len;
+	uint32_t obuf_hwm, obuf_chunks;
+	uint32_t i, nsessions;
+
+	frr_with_mutex (&gfnc->ctxqueue_mutex) {
+		curr_queue_len = dplane_ctx_queue_count(&gfnc->ctxqueue);
+	}
+	frr_with_mutex (&gfnc->obuf_mutex) {
+		obuf_hwm = gfnc->obuf_hwm;
+		obuf_chunks = gfnc->obuf_chunks;
+	}
+
+	struct json_object *jo, *jo_sessions, *jo_session;
+
+	jo = json_object_new_object();
+	json_object_int_add(jo, "bytes-read", gfnc->counters.bytes_read);
+	json_object_int_add(jo, "bytes-sent", gfnc->counters.bytes_sent);
+	json_object_int_add(jo, "obuf-bytes", gfnc->counters.obuf_bytes);
+	json_object_int_add(jo, "obuf-bytes-peak", gfnc->counters.obuf_peak);
+	json_object_int_add(jo, "obuf-high-water-mark", obuf_hwm);
+	json_object_int_add(jo, "obuf-chunks", obuf_chunks);
+	json_object_int_add(jo, "connection-closes",
+			    gfnc->counters.connection_closes);
+	json_object_int_add(jo, "connection-errors",
+			    gfnc->counters.connection_errors);
+	json_object_int_add(jo, "data-plane-contexts",
+			    gfnc->counters.dplane_contexts);
+	json_object_int_add(jo, "data-plane-contexts-queue", curr_queue_len);
+	json_object_int_add(jo, "data-plane-contexts-queue-peak",
+			    gfnc->counters.ctxqueue_len_peak);
+	json_object_int_add(jo, "buffer-full-hits", gfnc->counters.buffer_full);
+	json_object_int_add(jo, "coalesced-updates",
+			    gfnc->counters.coalesced_updates);
+	json_object_int_add(jo, "rib-walk-routes",
+			    gfnc->counters.rib_walk_routes);
+	json_object_int_add(jo, "rib-walk-slices",
+			    gfnc->counters.rib_walk_slices);
+	json_object_int_add(jo, "rib-walk-waits",
+			    gfnc->counters.rib_walk_waits);
+	json_object_int_add(jo, "rib-walks", gfnc->counters.rib_walks);
+	json_object_int_add(jo, "user-configures",
+			    gfnc->counters.user_configures);
+	json_object_int_add(jo, "user-disables", gfnc->counters.user_disables);
+
+	nsessions = atomic_load_explicit(&gfnc->nsessions,
+					 memory_order_acquire);
+	if (nsessions > 1) {
+		jo_sessions = json_object_new_array();
+		for (i = 1; i < nsessions; i++) {
+			session = gfnc->sessions[i];
+			jo_session = json_object_new_object();
+			json_object_int_add(jo_session, "session", i);
+			json_object_int_add(jo_session, "bytes-read",
+					    session->counters.bytes_read);
+			json_object_int_add(jo_session, "bytes-sent",
+					    session->counters.bytes_sent);
+			json_object_int_add(jo_session, "obuf-bytes",
+					    session->counters.obuf_bytes);
+			json_object_int_add(jo_session, "obuf-bytes-peak",
+					    session->counters.obuf_peak);
+			json_object_int_add(jo_session, "connection-closes",
+					    session->counters.connection_closes);
+			json_object_int_add(jo_session, "connection-errors",
+					    session->counters.connection_errors);
+			json_object_int_add(jo_session, "buffer-full-hits",
+					    session->counters.buffer_full);
+			json_object_array_add(jo_sessions, jo_session);
+		}
+		json_object_object_add(jo, "sessions", jo_sessions);
+	}
+
+	vty_json(vty, jo);
+
+	return CMD_SUCCESS;
+}
+
+DEFUN(fpm_show_latency, fpm_show_latency_cmd,
+      "show fpm latency",
+      SHOW_STR
+      FPM_STR
+      "FPM route programming latency\n")
+{
+	struct fpm_hist_summary hs;
+	int i;
+
+	vty_out(vty, "%s\n", "FPM route programming latency (usec):");
+	vty_out(vty, "%-8s %10s %10s %10s %10s %10s %10s %10s\n", "Stage",
+		"Samples", "Mean", "p50", "p90", "p99", "p99.9", "Max");
+	for (i = 0; i < FPM_LAT_MAX; i++) {
+		fpm_hist_summarize(&gfnc->latency[i], &hs);
+		vty_out(vty,
+			"%-8s %10" PRIu64 " %10" PRIu64 " %10" PRIu64
+			" %10" PRIu64 " %10" PRIu64 " %10" PRIu64
+			" %10" PRIu64 "\n",
+			fpm_latency_str[i], hs.count, hs.mean, hs.p50, hs.p90,
+			hs.p99, hs.p999, hs.max);
+	}
+
+	return CMD_SUCCESS;
+}
+
+DEFUN(fpm_show_latency_json, fpm_show_latency_json_cmd,
+      "show fpm latency json",
+      SHOW_STR
+      FPM_STR
+      "FPM route programming latency\n"
+      JSON_STR)
+{
+	struct fpm_hist_summary hs;
+	struct json_object *jo, *jo_stage;
+	int i;
 
 	jo = json_object_new_object();
-	json_object_int_add(jo, "bytes-read", gfnc->counters.bytes_read);
-	json_object_int_add(jo, "bytes-sent", gfnc->counters.bytes_sent);
-	json_object_int_add(jo, "obuf-bytes", gfnc->counters.obuf_bytes);
-	json_object_int_add(jo, "obuf-bytes-peak", gfnc->counters.obuf_peak);
-	json_object_int_add(jo, "connection-closes",
-			    gfnc->counters.connection_closes);
-	json_object_int_add(jo, "connection-errors",
-			    gfnc->counters.connection_errors);
-	json_object_int_add(jo, "data-plane-contexts",
-			    gfnc->counters.dplane_contexts);
-	json_object_int_add(jo, "data-plane-contexts-queue", curr_queue_len);
-	json_object_int_add(jo, "data-plane-contexts-queue-peak",
-			    gfnc->counters.ctxqueue_len_peak);
-	json_object_int_add(jo, "buffer-full-hits", gfnc->counters.buffer_full);
-	json_object_int_add(jo, "user-configures",
-			    gfnc->counters.user_configures);
-	json_object_int_add(jo, "user-disables", gfnc->counters.user_disables);
+	for (i = 0; i < FPM_LAT_MAX; i++) {
+		fpm_hist_summarize(&gfnc->latency[i], &hs);
+		jo_stage = json_object_new_object();
+		json_object_int_add(jo_stage, "samples", hs.count);
+		json_object_int_add(jo_stage, "mean-usec", hs.mean);
+		json_object_int_add(jo_stage, "p50-usec", hs.p50);
+		json_object_int_add(jo_stage, "p90-usec", hs.p90);
+		json_object_int_add(jo_stage, "p99-usec", hs.p99);
+		json_object_int_add(jo_stage, "p999-usec", hs.p999);
+		json_object_int_add(jo_stage, "max-usec", hs.max);
+		json_object_object_add(jo, fpm_latency_str[i], jo_stage);
+	}
 	vty_json(vty, jo);
 
 	return CMD_SUCCESS;
@@ -514,6 +1432,38 @@ static int fpm_write_config(struct vty *vty)
 		written = 1;
 	}
 
+	if (gfnc->coalesce) {
+		vty_out(vty, "fpm coalesce-updates\n");
+		written = 1;
+	}
+
+	if (gfnc->obuf_hwm_cfg != FPM_OBUF_HWM_DEFAULT
+	    || gfnc->obuf_hwm_max != FPM_OBUF_HWM_MAX_DEFAULT) {
+		vty_out(vty, "fpm output-buffer high-water-mark %zu",
+			gfnc->obuf_hwm_cfg / 1024);
+		if (gfnc->obuf_hwm_max
+		    != MAX(gfnc->obuf_hwm_cfg, (size_t)FPM_OBUF_HWM_MAX_DEFAULT))
+			vty_out(vty, " maximum %zu", gfnc->obuf_hwm_max / 1024);
+
+		vty_out(vty, "\n");
+		written = 1;
+	}
+
+	if (gfnc->nsessions_cfg > 1
+	    || gfnc->shard_by_cfg != FPM_SHARD_BY_TABLE) {
+		vty_out(vty, "fpm sessions %u shard-by %s\n",
+			gfnc->nsessions_cfg,
+			fpm_shard_by_str[gfnc->shard_by_cfg]);
+		written = 1;
+	}
+
+	if (gfnc->rib_slice_routes != FPM_RIB_SLICE_ROUTES_DEFAULT
+	    || gfnc->rib_slice_usec != FPM_RIB_SLICE_USEC_DEFAULT) {
+		vty_out(vty, "fpm rib-walk slice routes %u time %u\n",
+			gfnc->rib_slice_routes, gfnc->rib_slice_usec);
+		written = 1;
+	}
+
 	return written;
 }
 
@@ -524,6 +1474,138 @@ static struct cmd_node fpm_node = {
 	.config_write = fpm_write_config,
 };
 
+/*
+ * Output buffer functions, must be called with obuf_mutex held.
+ */
+static struct fpm_obuf_chunk *fpm_obuf_chunk_get(struct fpm_nl_ctx *fnc)
+{
+	struct fpm_obuf_chunk *chunk;
+
+	chunk = fpm_obuf_pop(&fnc->obuf_free);
+	if (chunk == NULL) {
+		chunk = XMALLOC(MTYPE_FPM_OBUF, sizeof(*chunk));
+		fnc->obuf_chunks++;
+	}
+
+	chunk->getp = 0;
+	chunk->endp = 0;
+
+	return chunk;
+}
+
+static void fpm_obuf_chunk_put(struct fpm_nl_ctx *fnc,
+			       struct fpm_obuf_chunk *chunk)
+{
+	/* Only keep the chunks the high-water mark allows. */
+	if ((fnc->obuf_chunks - 1) * FPM_OBUF_CHUNK_SIZE >= fnc->obuf_hwm) {
+		XFREE(MTYPE_FPM_OBUF, chunk);
+		fnc->obuf_chunks--;
+		return;
+	}
+
+	fpm_obuf_add_head(&fnc->obuf_free, chunk);
+}
+
+static bool fpm_obuf_has_room(struct fpm_nl_ctx *fnc)
+{
+	struct fpm_obuf_chunk *chunk = fpm_obuf_last(&fnc->obuf);
+
+	if (chunk && FPM_OBUF_CHUNK_SIZE - chunk->endp >= FPM_MSG_SIZE_MAX)
+		return true;
+
+	return fpm_obuf_count(&fnc->obuf) * FPM_OBUF_CHUNK_SIZE
+	       < fnc->obuf_hwm;
+}
+
+/* Output buffer drained enough to resume a RIB walk waiting for it. */
+static bool fpm_obuf_below_lowat(struct fpm_nl_ctx *fnc)
+{
+	return fpm_obuf_count(&fnc->obuf) * FPM_OBUF_CHUNK_SIZE
+	       <= fnc->obuf_hwm / 2;
+}
+
+/*
+ * Get the chunk to encode a message of up to FPM_MSG_SIZE_MAX bytes into,
+ * at its end pointer, or NULL if the high-water mark was reached.
+ */
+static struct fpm_obuf_chunk *fpm_obuf_reserve(struct fpm_nl_ctx *fnc)
+{
+	struct fpm_obuf_chunk *chunk;
+
+	if (!fpm_obuf_has_room(fnc)) {
+		fnc->obuf_starved = true;
+		return NULL;
+	}
+
+	chunk = fpm_obuf_last(&fnc->obuf);
+	if (chunk && FPM_OBUF_CHUNK_SIZE - chunk->endp >= FPM_MSG_SIZE_MAX)
+		return chunk;
+
+	chunk = fpm_obuf_chunk_get(fnc);
+	fpm_obuf_add_tail(&fnc->obuf, chunk);
+
+	return chunk;
+}
+
+/* Account sent data, recycling the chunks sent completely. */
+static void fpm_obuf_consume(struct fpm_nl_ctx *fnc, size_t len)
+{
+	struct fpm_obuf_chunk *chunk;
+	size_t clen;
+
+	while ((chunk = fpm_obuf_first(&fnc->obuf)) != NULL) {
+		clen = MIN(len, chunk->endp - chunk->getp);
+		chunk->getp += clen;
+		len -= clen;
+		if (chunk->getp < chunk->endp)
+			break;
+
+		fpm_obuf_del(&fnc->obuf, chunk);
+		fpm_obuf_chunk_put(fnc, chunk);
+	}
+}
+
+static void fpm_obuf_reset(struct fpm_nl_ctx *fnc)
+{
+	struct fpm_obuf_chunk *chunk;
+
+	while ((chunk = fpm_obuf_pop(&fnc->obuf)) != NULL)
+		fpm_obuf_chunk_put(fnc, chunk);
+
+	fpm_stamp_reset(&fnc->obuf_stamps);
+	fnc->obuf_enqueued = 0;
+	fnc->obuf_written = 0;
+}
+
+/* Output buffer drained: raise the high-water mark if it held us off. */
+static void fpm_obuf_grow(struct fpm_nl_ctx *fnc)
+{
+	if (!fnc->obuf_starved)
+		return;
+
+	fnc->obuf_starved = false;
+	if (fnc->obuf_hwm >= fnc->obuf_hwm_max)
+		return;
+
+	fnc->obuf_hwm = MIN(fnc->obuf_hwm * 2, fnc->obuf_hwm_max);
+	if (IS_ZEBRA_DEBUG_FPM)
+		zlog_debug("%s: output buffer high-water mark raised to %zu",
+			   __func__, fnc->obuf_hwm);
+}
+
+static void fpm_obuf_release(struct fpm_nl_ctx *fnc)
+{
+	struct fpm_obuf_chunk *chunk;
+
+	fpm_obuf_reset(fnc);
+	while ((chunk = fpm_obuf_pop(&fnc->obuf_free)) != NULL)
+		XFREE(MTYPE_FPM_OBUF, chunk);
+
+	fpm_obuf_fini(&fnc->obuf);
+	fpm_obuf_fini(&fnc->obuf_free);
+	fpm_stamp_release(&fnc->obuf_stamps);
+}
+
 /*
  * FPM functions.
  */
@@ -554,10 +1636,24 @@ static void fpm_reconnect(struct fpm_nl_ctx *fnc)
 	}
 
 	stream_reset(fnc->ibuf);
-	stream_reset(fnc->obuf);
+	fpm_obuf_reset(fnc);
+
+	/* Don't leave the first session RIB walk waiting for this one. */
+	if (fnc->obuf_rib_wait && fnc->primary != fnc)
+		event_add_event(zrouter.master, fpm_rib_send, fnc->primary, 0,
+				&fnc->primary->t_ribwalk);
+	fnc->obuf_rib_wait = false;
 	EVENT_OFF(fnc->t_read);
 	EVENT_OFF(fnc->t_write);
 
+	/* Queued contexts are skipped until connected again. */
+	frr_with_mutex (&fnc->encq_mutex) {
+		if (fpm_encq_count(&fnc->encq))
+			event_add_event(fnc->fthread->master,
+					fpm_session_encode, fnc, 0,
+					&fnc->t_encode);
+	}
+
 	/* FPM is disabled, don't attempt to connect. */
 	if (fnc->disabled)
 		return;
@@ -704,6 +1800,7 @@ static void fpm_read(struct event *t)
 
 		switch (hdr->nlmsg_type) {
 		case RTM_NEWROUTE:
+			fpm_feedback_done(fnc->primary, hdr->nlmsg_seq);
 			ctx = dplane_ctx_alloc();
 			dplane_ctx_route_init(ctx, DPLANE_OP_ROUTE_NOTIFY, NULL,
  					      NULL);
@@ -732,10 +1829,11 @@ static void fpm_read(struct event *t)
 static void fpm_write(struct event *t)
 {
 	struct fpm_nl_ctx *fnc = EVENT_ARG(t);
+	struct fpm_obuf_chunk *chunk;
+	struct iovec iov[FPM_OBUF_IOV_MAX];
 	socklen_t statuslen;
 	ssize_t bwritten;
-	int rv, status;
-	size_t btotal;
+	int rv, status, iovcnt;
 
 	if (fnc->connecting == true) {
 		status = 0;
@@ -763,10 +1861,10 @@ static void fpm_write(struct event *t)
 
 		/*
 		 * Starting with LSPs walk all FPM objects, marking them
-		 * as unsent and then replaying them.
+		 * as unsent and then replaying them (on all sessions).
 		 */
-		event_add_timer(zrouter.master, fpm_lsp_reset, fnc, 0,
-				 &fnc->t_lspreset);
+		event_add_timer(zrouter.master, fpm_lsp_reset, fnc->primary,
+				 0, &fnc->primary->t_lspreset);
 
 		/* Permit receiving messages now. */
 		event_add_read(fnc->fthread->master, fpm_read, fnc,
@@ -776,16 +1874,27 @@ static void fpm_write(struct event *t)
 	frr_mutex_lock_autounlock(&fnc->obuf_mutex);
 
 	while (true) {
-		/* Stream is empty: reset pointers and return. */
-		if (STREAM_READABLE(fnc->obuf) == 0) {
-			stream_reset(fnc->obuf);
+		/* Gather the chunks with data to write. */
+		iovcnt = 0;
+		frr_each (fpm_obuf, &fnc->obuf, chunk) {
+			if (chunk->getp == chunk->endp)
+				continue;
+
+			iov[iovcnt].iov_base = &chunk->data[chunk->getp];
+			iov[iovcnt].iov_len = chunk->endp - chunk->getp;
+			if (++iovcnt == FPM_OBUF_IOV_MAX)
+				break;
+		}
+
+		/* Buffer is empty: recycle chunks and return. */
+		if (iovcnt == 0) {
+			fpm_obuf_reset(fnc);
+			fpm_obuf_grow(fnc);
 			break;
 		}
 
 		/* Try to write all at once. */
-		btotal = stream_get_endp(fnc->obuf) -
-			stream_get_getp(fnc->obuf);
-		bwritten = write(fnc->socket, stream_pnt(fnc->obuf), btotal);
+		bwritten = writev(fnc->socket, iov, iovcnt);
 		if (bwritten == 0) {
 			atomic_fetch_add_explicit(
 				&fnc->counters.connection_closes, 1,
@@ -821,12 +1930,27 @@ static void fpm_write(struct event *t)
 		atomic_fetch_sub_explicit(&fnc->counters.obuf_bytes, bwritten,
 					  memory_order_relaxed);
 
-		stream_forward_getp(fnc->obuf, (size_t)bwritten);
+		fpm_obuf_consume(fnc, (size_t)bwritten);
+		fpm_latency_written(fnc, (size_t)bwritten);
+	}
+
+	/* Resume the RIB walk once the buffer drained enough. */
+	if (fnc->obuf_rib_wait && fpm_obuf_below_lowat(fnc)) {
+		fnc->obuf_rib_wait = false;
+		event_add_event(zrouter.master, fpm_rib_send, fnc->primary, 0,
+				&fnc->primary->t_ribwalk);
+	}
+
+	/* Resume the encoder waiting for buffer space. */
+	frr_with_mutex (&fnc->encq_mutex) {
+		if (fpm_encq_count(&fnc->encq))
+			event_add_event(fnc->fthread->master,
+					fpm_session_encode, fnc, 0,
+					&fnc->t_encode);
 	}
 
-	/* Stream is not empty yet, we must schedule more writes. */
-	if (STREAM_READABLE(fnc->obuf)) {
-		stream_pulldown(fnc->obuf);
+	/* Buffer is not empty yet, we must schedule more writes. */
+	if (fpm_obuf_count(&fnc->obuf)) {
 		event_add_write(fnc->fthread->master, fpm_write, fnc,
 				 fnc->socket, &fnc->t_write);
 		return;
@@ -892,8 +2016,8 @@ static void fpm_connect(struct event *t)
 	 * If we are not connected, then delay the objects reset/send.
 	 */
 	if (!fnc->connecting)
-		event_add_timer(zrouter.master, fpm_lsp_reset, fnc, 0,
-				 &fnc->t_lspreset);
+		event_add_timer(zrouter.master, fpm_lsp_reset, fnc->primary,
+				 0, &fnc->primary->t_lspreset);
 }
 
 static struct zebra_vrf *vrf_lookup_by_table_id(uint32_t table_id)
@@ -953,7 +2077,7 @@ static void fpm_srv6_route_reset(struct event *t)
 	}
 
 	/* Schedule next step: send RIB routes. */
-	event_add_event(zrouter.master, fpm_rib_send, fnc, 0, &fnc->t_ribwalk);
+	fpm_rib_walk_start(fnc, false);
 }
 
 /*
@@ -2132,16 +3256,22 @@ static ssize_t netlink_sidlist_msg_encode(int cmd,
 
 /**
  * Encode data plane operation context into netlink and enqueue it in the FPM
- * output buffer.
+ * session output buffer.
  *
- * @param fnc the netlink FPM context.
+ * @param fnc the netlink FPM session.
  * @param ctx the data plane operation context data.
+ * @param stamp the context timestamps.
  * @return 0 on success or -1 on not enough space.
  */
-static int fpm_nl_enqueue(struct fpm_nl_ctx *fnc, struct zebra_dplane_ctx *ctx)
+static int fpm_nl_encode(struct fpm_nl_ctx *fnc, struct zebra_dplane_ctx *ctx,
+			 const struct fpm_stamp *stamp)
 {
-	uint8_t nl_buf[NL_PKT_BUF_SIZE];
-	size_t nl_buf_len;
+	struct fpm_obuf_chunk *chunk;
+	struct fpm_stamp mstamp;
+	struct nlmsghdr *hdr;
+	uint8_t *nl_buf;
+	size_t nl_buf_len, off;
+	uint16_t msg_len;
 	ssize_t rv;
 	uint64_t obytes, obytes_peak;
 	enum dplane_op_e op = dplane_ctx_get_op(ctx);
@@ -2171,13 +3301,31 @@ static int fpm_nl_enqueue(struct fpm_nl_ctx *fnc, struct zebra_dplane_ctx *ctx)
 
 	frr_mutex_lock_autounlock(&fnc->obuf_mutex);
 
+	/* Check if we have enough buffer space. */
+	chunk = fpm_obuf_reserve(fnc);
+	if (chunk == NULL) {
+		atomic_fetch_add_explicit(&fnc->counters.buffer_full, 1,
+					  memory_order_relaxed);
+
+		if (IS_ZEBRA_DEBUG_FPM)
+			zlog_debug("%s: buffer full: %zu bytes buffered",
+				   __func__,
+				   fpm_obuf_count(&fnc->obuf)
+					   * FPM_OBUF_CHUNK_SIZE);
+
+		return -1;
+	}
+
+	/* Encode in place, after room for the FPM header. */
+	nl_buf = &chunk->data[chunk->endp + FPM_HEADER_SIZE];
+
 	switch (op) {
 	case DPLANE_OP_ROUTE_UPDATE:
 	case DPLANE_OP_ROUTE_DELETE:
 		nexthop = dplane_ctx_get_ng(ctx)->nexthop;
 		if (nexthop && nexthop->nh_srv6) {
 			rv = netlink_srv6_msg_encode(RTM_DELROUTE, ctx,
-								nl_buf, sizeof(nl_buf),
+								nl_buf, NL_PKT_BUF_SIZE,
 								true, fnc->use_nhg);
 			if (rv <= 0) {
 				zlog_err(
@@ -2187,7 +3335,7 @@ static int fpm_nl_enqueue(struct fpm_nl_ctx *fnc, struct zebra_dplane_ctx *ctx)
 			}
 		} else {
 			rv = netlink_route_multipath_msg_encode(RTM_DELROUTE, ctx,
-								nl_buf, sizeof(nl_buf),
+								nl_buf, NL_PKT_BUF_SIZE,
 								true, fnc->use_nhg, false);
 			if (rv <= 0) {
 				zlog_err(
@@ -2209,7 +3357,7 @@ static int fpm_nl_enqueue(struct fpm_nl_ctx *fnc, struct zebra_dplane_ctx *ctx)
 		if (nexthop && nexthop->nh_srv6) {
 			rv = netlink_srv6_msg_encode(
 				RTM_NEWROUTE, ctx, &nl_buf[nl_buf_len],
-				sizeof(nl_buf) - nl_buf_len, true, fnc->use_nhg);
+				NL_PKT_BUF_SIZE - nl_buf_len, true, fnc->use_nhg);
 			if (rv <= 0) {
 				zlog_err(
 					"%s: netlink_srv6_msg_encode failed",
@@ -2219,7 +3367,7 @@ static int fpm_nl_enqueue(struct fpm_nl_ctx *fnc, struct zebra_dplane_ctx *ctx)
 		} else {
 			rv = netlink_route_multipath_msg_encode(
 				RTM_NEWROUTE, ctx, &nl_buf[nl_buf_len],
-				sizeof(nl_buf) - nl_buf_len, true, fnc->use_nhg, false);
+				NL_PKT_BUF_SIZE - nl_buf_len, true, fnc->use_nhg, false);
 			if (rv <= 0) {
 				zlog_err(
 					"%s: netlink_route_multipath_msg_encode failed",
@@ -2234,7 +3382,7 @@ static int fpm_nl_enqueue(struct fpm_nl_ctx *fnc, struct zebra_dplane_ctx *ctx)
 
 	case DPLANE_OP_MAC_INSTALL:
 	case DPLANE_OP_MAC_DELETE:
-		rv = netlink_macfdb_update_ctx(ctx, nl_buf, sizeof(nl_buf));
+		rv = netlink_macfdb_update_ctx(ctx, nl_buf, NL_PKT_BUF_SIZE);
 		if (rv <= 0) {
 			zlog_err("%s: netlink_macfdb_update_ctx failed",
 				 __func__);
@@ -2246,7 +3394,7 @@ static int fpm_nl_enqueue(struct fpm_nl_ctx *fnc, struct zebra_dplane_ctx *ctx)
 
 	case DPLANE_OP_NH_DELETE:
 		rv = netlink_nexthop_msg_encode(RTM_DELNEXTHOP, ctx, nl_buf,
-						sizeof(nl_buf), true);
+						NL_PKT_BUF_SIZE, true);
 		if (rv <= 0) {
 			zlog_err("%s: netlink_nexthop_msg_encode failed",
 				 __func__);
@@ -2258,7 +3406,7 @@ static int fpm_nl_enqueue(struct fpm_nl_ctx *fnc, struct zebra_dplane_ctx *ctx)
 	case DPLANE_OP_NH_INSTALL:
 	case DPLANE_OP_NH_UPDATE:
 		rv = netlink_nexthop_msg_encode(RTM_NEWNEXTHOP, ctx, nl_buf,
-						sizeof(nl_buf), true);
+						NL_PKT_BUF_SIZE, true);
 		if (rv <= 0) {
 			zlog_err("%s: netlink_nexthop_msg_encode failed",
 				 __func__);
@@ -2269,7 +3417,7 @@ static int fpm_nl_enqueue(struct fpm_nl_ctx *fnc, struct zebra_dplane_ctx *ctx)
 		break;
 	case DPLANE_OP_SID_LIST_DELETE:
 		rv = netlink_sidlist_msg_encode(
-				RTM_DELSIDLIST, ctx, nl_buf, sizeof(nl_buf));
+				RTM_DELSIDLIST, ctx, nl_buf, NL_PKT_BUF_SIZE);
 		if (rv <= 0) {
 			zlog_err(
 				"%s: netlink_srv6_msg_encode failed",
@@ -2281,7 +3429,7 @@ static int fpm_nl_enqueue(struct fpm_nl_ctx *fnc, struct zebra_dplane_ctx *ctx)
 	case DPLANE_OP_SID_LIST_INSTALL:
 	case DPLANE_OP_SID_LIST_UPDATE:
 		rv = netlink_sidlist_msg_encode(
-				RTM_NEWSIDLIST, ctx, nl_buf, sizeof(nl_buf));
+				RTM_NEWSIDLIST, ctx, nl_buf, NL_PKT_BUF_SIZE);
 		if (rv <= 0) {
 			zlog_err(
 				"%s: netlink_srv6_msg_encode failed",
@@ -2293,7 +3441,7 @@ static int fpm_nl_enqueue(struct fpm_nl_ctx *fnc, struct zebra_dplane_ctx *ctx)
 
 	case DPLANE_OP_PIC_CONTEXT_DELETE:
 		rv = netlink_pic_context_msg_encode(RTM_DELNEXTHOP, ctx, nl_buf,
-						sizeof(nl_buf));
+						NL_PKT_BUF_SIZE);
 		if (rv <= 0) {
 			zlog_err("%s: netlink_nexthop_msg_encode failed",
 				 __func__);
@@ -2305,7 +3453,7 @@ static int fpm_nl_enqueue(struct fpm_nl_ctx *fnc, struct zebra_dplane_ctx *ctx)
 	case DPLANE_OP_PIC_CONTEXT_INSTALL:
 	case DPLANE_OP_PIC_CONTEXT_UPDATE:
 		rv = netlink_pic_context_msg_encode(RTM_NEWNEXTHOP, ctx, nl_buf,
-						sizeof(nl_buf));
+						NL_PKT_BUF_SIZE);
 		if (rv <= 0) {
 			zlog_err("%s: netlink_pic_context_msg_encode failed",
 				 __func__);
@@ -2317,7 +3465,7 @@ static int fpm_nl_enqueue(struct fpm_nl_ctx *fnc, struct zebra_dplane_ctx *ctx)
 	case DPLANE_OP_LSP_INSTALL:
 	case DPLANE_OP_LSP_UPDATE:
 	case DPLANE_OP_LSP_DELETE:
-		rv = netlink_lsp_msg_encoder(ctx, nl_buf, sizeof(nl_buf));
+		rv = netlink_lsp_msg_encoder(ctx, nl_buf, NL_PKT_BUF_SIZE);
 		if (rv <= 0) {
 			zlog_err("%s: netlink_lsp_msg_encoder failed",
 				 __func__);
@@ -2330,7 +3478,7 @@ static int fpm_nl_enqueue(struct fpm_nl_ctx *fnc, struct zebra_dplane_ctx *ctx)
 	case DPLANE_OP_ADDR_INSTALL:
 	case DPLANE_OP_ADDR_UNINSTALL:
 		if (strmatch(dplane_ctx_get_ifname(ctx), "lo"))
-			event_add_timer(fnc->fthread->master, fpm_srv6_route_reset,
+			event_add_timer(zrouter.master, fpm_srv6_route_reset,
 				 fnc, 0, &fnc->t_ribreset);
 		break;
 
@@ -2381,56 +3529,492 @@ static int fpm_nl_enqueue(struct fpm_nl_ctx *fnc, struct zebra_dplane_ctx *ctx)
 
 	}
 
-	/* Skip empty enqueues. */
-	if (nl_buf_len == 0)
-		return 0;
+	/* Skip empty enqueues. */
+	if (nl_buf_len == 0)
+		return 0;
+
+	/* We must know if someday a message goes beyond 65KiB. */
+	assert((nl_buf_len + FPM_HEADER_SIZE) <= UINT16_MAX);
+
+	/* Stamp the route for the peer feedback to refer to. */
+	if (stamp->seq) {
+		off = 0;
+		while (off + sizeof(*hdr) <= nl_buf_len) {
+			hdr = (struct nlmsghdr *)&nl_buf[off];
+			if (hdr->nlmsg_len < sizeof(*hdr))
+				break;
+
+			hdr->nlmsg_seq = stamp->seq;
+			off += NLMSG_ALIGN(hdr->nlmsg_len);
+		}
+	}
+
+	/*
+	 * Fill in the FPM header information.
+	 *
+	 * See FPM_HEADER_SIZE definition for more information.
+	 */
+	msg_len = htons(nl_buf_len + FPM_HEADER_SIZE);
+	chunk->data[chunk->endp] = 1;
+	chunk->data[chunk->endp + 1] = 1;
+	memcpy(&chunk->data[chunk->endp + 2], &msg_len, sizeof(msg_len));
+
+	/* Commit current data. */
+	chunk->endp += nl_buf_len + FPM_HEADER_SIZE;
+
+	/* Keep the timestamps until written. */
+	fnc->obuf_enqueued += nl_buf_len + FPM_HEADER_SIZE;
+	mstamp = *stamp;
+	mstamp.end = fnc->obuf_enqueued;
+	fpm_stamp_push(&fnc->obuf_stamps, &mstamp);
+
+	/* Account number of bytes waiting to be written. */
+	atomic_fetch_add_explicit(&fnc->counters.obuf_bytes,
+				  nl_buf_len + FPM_HEADER_SIZE,
+				  memory_order_relaxed);
+	obytes = atomic_load_explicit(&fnc->counters.obuf_bytes,
+				      memory_order_relaxed);
+	obytes_peak = atomic_load_explicit(&fnc->counters.obuf_peak,
+					   memory_order_relaxed);
+	if (obytes_peak < obytes)
+		atomic_store_explicit(&fnc->counters.obuf_peak, obytes,
+				      memory_order_relaxed);
+
+	/* Tell the thread to start writing. */
+	event_add_write(fnc->fthread->master, fpm_write, fnc, fnc->socket,
+			 &fnc->t_write);
+
+	return 0;
+}
+
+/*
+ * Session functions.
+ */
+static bool fpm_op_is_route(enum dplane_op_e op)
+{
+	return op == DPLANE_OP_ROUTE_INSTALL || op == DPLANE_OP_ROUTE_UPDATE
+	       || op == DPLANE_OP_ROUTE_DELETE;
+}
+
+/* Objects routes depend on: sent on every session. */
+static bool fpm_op_is_shared(enum dplane_op_e op)
+{
+	switch (op) {
+	case DPLANE_OP_NH_INSTALL:
+	case DPLANE_OP_NH_UPDATE:
+	case DPLANE_OP_NH_DELETE:
+	case DPLANE_OP_PIC_CONTEXT_INSTALL:
+	case DPLANE_OP_PIC_CONTEXT_UPDATE:
+	case DPLANE_OP_PIC_CONTEXT_DELETE:
+	case DPLANE_OP_SID_LIST_INSTALL:
+	case DPLANE_OP_SID_LIST_UPDATE:
+	case DPLANE_OP_SID_LIST_DELETE:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/* Session a route context is sent on. */
+static struct fpm_nl_ctx *fpm_route_session(struct fpm_nl_ctx *fnc,
+					    struct zebra_dplane_ctx *ctx)
+{
+	uint32_t nsessions, shard;
+
+	nsessions = atomic_load_explicit(&fnc->nsessions, memory_order_acquire);
+	if (nsessions <= 1)
+		return fnc;
+
+	switch (fnc->shard_by) {
+	case FPM_SHARD_BY_AFI:
+		shard = dplane_ctx_get_dest(ctx)->family == AF_INET6;
+		break;
+	case FPM_SHARD_BY_PREFIX:
+		shard = prefix_hash_key(dplane_ctx_get_dest(ctx));
+		break;
+	case FPM_SHARD_BY_TABLE:
+	default:
+		shard = dplane_ctx_get_table(ctx);
+		break;
+	}
+
+	return fnc->sessions[shard % nsessions];
+}
+
+/*
+ * Timestamps of a context about to be encoded. The queue latency is not
+ * recorded here: a context shared by sessions is encoded once per session.
+ */
+static void fpm_stamp_init(struct fpm_nl_ctx *fnc, struct zebra_dplane_ctx *ctx,
+			   int64_t enqueued, struct fpm_stamp *stamp)
+{
+	enum dplane_op_e op = dplane_ctx_get_op(ctx);
+
+	memset(stamp, 0, sizeof(*stamp));
+	stamp->enqueued = enqueued;
+	stamp->encoded = fpm_time_usec();
+
+	/* Sequence number zero means no feedback tracking. */
+	if (op == DPLANE_OP_ROUTE_INSTALL || op == DPLANE_OP_ROUTE_UPDATE) {
+		do {
+			stamp->seq = atomic_fetch_add_explicit(
+					     &fnc->seq, 1, memory_order_relaxed)
+				     + 1;
+		} while (stamp->seq == 0);
+	}
+}
+
+/* Check if all connected sessions have output buffer space. */
+static bool fpm_sessions_have_room(struct fpm_nl_ctx *fnc)
+{
+	struct fpm_nl_ctx *session;
+	uint32_t i, nsessions;
+	bool room = true;
+
+	nsessions = atomic_load_explicit(&fnc->nsessions, memory_order_acquire);
+	for (i = 0; i < nsessions && room; i++) {
+		session = fnc->sessions[i];
+		if (session->socket == -1)
+			continue;
+
+		frr_with_mutex (&session->obuf_mutex) {
+			room = fpm_obuf_has_room(session);
+			if (!room)
+				session->obuf_starved = true;
+		}
+		if (!room)
+			atomic_fetch_add_explicit(
+				&session->counters.buffer_full, 1,
+				memory_order_relaxed);
+	}
+
+	return room;
+}
+
+static bool fpm_sessions_connected(struct fpm_nl_ctx *fnc)
+{
+	struct fpm_nl_ctx *session;
+	uint32_t i, nsessions;
+
+	nsessions = atomic_load_explicit(&fnc->nsessions, memory_order_acquire);
+	for (i = 0; i < nsessions; i++) {
+		session = fnc->sessions[i];
+		if (session->socket != -1 && session->connecting == false)
+			return true;
+	}
+
+	return false;
+}
+
+/**
+ * Enqueue data plane operation context in the output buffer of the FPM
+ * sessions it goes to.
+ *
+ * @param fnc the netlink FPM context (first session).
+ * @param ctx the data plane operation context data.
+ * @param enqueued the data plane enqueue time, zero for walks.
+ * @return 0 on success or -1 on not enough space.
+ */
+static int fpm_nl_enqueue(struct fpm_nl_ctx *fnc, struct zebra_dplane_ctx *ctx,
+			  int64_t enqueued)
+{
+	enum dplane_op_e op = dplane_ctx_get_op(ctx);
+	struct fpm_nl_ctx *session;
+	struct fpm_stamp stamp;
+	uint32_t i, nsessions;
+	int rv = 0;
+
+	fpm_stamp_init(fnc, ctx, enqueued, &stamp);
+	if (enqueued)
+		fpm_hist_add(&fnc->latency[FPM_LAT_QUEUE],
+			     stamp.encoded - enqueued);
+
+	if (fpm_op_is_route(op))
+		session = fpm_route_session(fnc, ctx);
+	else
+		session = fnc;
+
+	nsessions = atomic_load_explicit(&fnc->nsessions, memory_order_acquire);
+	if (nsessions <= 1 || !fpm_op_is_shared(op)) {
+		if (session->socket == -1)
+			return 0;
+
+		return fpm_nl_encode(session, ctx, &stamp);
+	}
+
+	/*
+	 * Check all the sessions first: a retry after a partial send repeats
+	 * the object on some sessions, which is harmless but wasteful.
+	 */
+	if (!fpm_sessions_have_room(fnc))
+		return -1;
+
+	for (i = 0; i < nsessions; i++) {
+		session = fnc->sessions[i];
+		if (session->socket == -1)
+			continue;
+
+		if (fpm_nl_encode(session, ctx, &stamp) == -1)
+			rv = -1;
+	}
+
+	return rv;
+}
+
+static struct fpm_nl_ctx *fpm_session_new(struct fpm_nl_ctx *fnc,
+					  uint32_t session_id)
+{
+	struct fpm_nl_ctx *session;
+	char name[32], os_name[16];
+
+	session = calloc(1, sizeof(*session));
+	snprintf(name, sizeof(name), "%s-%u", prov_name, session_id);
+	snprintf(os_name, sizeof(os_name), "fpm_sonic-%u", session_id);
+	session->fthread = frr_pthread_new(NULL, name, os_name);
+	assert(frr_pthread_run(session->fthread, NULL) == 0);
+	session->ibuf = stream_new(NL_PKT_BUF_SIZE);
+	fpm_obuf_init(&session->obuf);
+	fpm_obuf_init(&session->obuf_free);
+	frr_with_mutex (&fnc->obuf_mutex) {
+		session->obuf_hwm = fnc->obuf_hwm_cfg;
+		session->obuf_hwm_cfg = fnc->obuf_hwm_cfg;
+		session->obuf_hwm_max = fnc->obuf_hwm_max;
+	}
+	pthread_mutex_init(&session->obuf_mutex, NULL);
+	fpm_encq_init(&session->encq);
+	pthread_mutex_init(&session->encq_mutex, NULL);
+	session->socket = -1;
+	session->disabled = true;
+	session->use_nhg = fnc->use_nhg;
+	session->prov = fnc->prov;
+	session->primary = fnc;
+	session->session_id = session_id;
+
+	return session;
+}
+
+/*
+ * Session encoder functions.
+ */
+
+/* Check if the encoder queues of all sessions have room. */
+static bool fpm_encq_have_room(struct fpm_nl_ctx *fnc, uint32_t nsessions)
+{
+	struct fpm_nl_ctx *session;
+	bool room = true;
+	uint32_t i;
+
+	for (i = 0; i < nsessions && room; i++) {
+		session = fnc->sessions[i];
+		frr_with_mutex (&session->encq_mutex) {
+			room = fpm_encq_count(&session->encq) < FPM_ENCQ_MAX;
+			if (!room)
+				session->encq_blocked = true;
+		}
+	}
+
+	return room;
+}
+
+/* Queue a context to the encoders of the sessions it goes to. */
+static void fpm_encq_dispatch(struct fpm_nl_ctx *fnc,
+			      struct zebra_dplane_ctx *ctx,
+			      enum fpm_coalesce_action action, int64_t enqueued,
+			      uint32_t nsessions)
+{
+	enum dplane_op_e op = dplane_ctx_get_op(ctx);
+	struct fpm_nl_ctx *targets[FPM_SESSIONS_MAX];
+	struct fpm_nl_ctx *session;
+	struct fpm_work *work;
+	uint32_t i, ntargets = 0;
+
+	/* Once per context, however many sessions encode it. */
+	if (enqueued)
+		fpm_hist_add(&fnc->latency[FPM_LAT_QUEUE],
+			     fpm_time_usec() - enqueued);
+
+	if (fpm_op_is_shared(op)) {
+		for (i = 0; i < nsessions; i++)
+			targets[ntargets++] = fnc->sessions[i];
+	} else if (fpm_op_is_route(op))
+		targets[ntargets++] = fpm_route_session(fnc, ctx);
+	else
+		targets[ntargets++] = fnc;
+
+	work = XCALLOC(MTYPE_FPM_WORK, sizeof(*work));
+	work->ctx = ctx;
+	work->action = action;
+	work->enqueued = enqueued;
+	/* All references first: encoders may finish before we are done. */
+	atomic_store_explicit(&work->refs, ntargets, memory_order_relaxed);
+
+	for (i = 0; i < ntargets; i++) {
+		session = targets[i];
+		work->entries[i].work = work;
+		frr_with_mutex (&session->encq_mutex) {
+			fpm_encq_add_tail(&session->encq, &work->entries[i]);
+		}
+		event_add_event(session->fthread->master, fpm_session_encode,
+				session, 0, &session->t_encode);
+	}
+}
+
+/* Drop a session reference, returning true if the context went back. */
+static bool fpm_work_put(struct fpm_nl_ctx *fnc, struct fpm_work *work)
+{
+	if (atomic_fetch_sub_explicit(&work->refs, 1, memory_order_acq_rel)
+	    != 1)
+		return false;
 
-	/* We must know if someday a message goes beyond 65KiB. */
-	assert((nl_buf_len + FPM_HEADER_SIZE) <= UINT16_MAX);
+	dplane_ctx_set_status(work->ctx, ZEBRA_DPLANE_REQUEST_SUCCESS);
+	dplane_provider_enqueue_out_ctx(fnc->prov, work->ctx);
+	XFREE(MTYPE_FPM_WORK, work);
 
-	/* Check if we have enough buffer space. */
-	if (STREAM_WRITEABLE(fnc->obuf) < (nl_buf_len + FPM_HEADER_SIZE)) {
-		atomic_fetch_add_explicit(&fnc->counters.buffer_full, 1,
-					  memory_order_relaxed);
+	return true;
+}
 
-		if (IS_ZEBRA_DEBUG_FPM)
-			zlog_debug(
-				"%s: buffer full: wants to write %zu but has %zu",
-				__func__, nl_buf_len + FPM_HEADER_SIZE,
-				STREAM_WRITEABLE(fnc->obuf));
+/* Encode the contexts queued for a session, in queue order. */
+static void fpm_session_encode(struct event *t)
+{
+	struct fpm_nl_ctx *session = EVENT_ARG(t);
+	struct fpm_nl_ctx *primary = session->primary;
+	struct fpm_encq_entry *entry;
+	struct zebra_dplane_ctx *ctx;
+	struct fpm_work *work;
+	struct fpm_stamp stamp;
+	bool room, wake = false, returned = false;
 
-		return -1;
+	while (true) {
+		/* Wait for fpm_write to make room, unless not connected. */
+		if (session->socket != -1) {
+			frr_with_mutex (&session->obuf_mutex) {
+				room = fpm_obuf_has_room(session);
+				if (!room)
+					session->obuf_starved = true;
+			}
+			if (!room) {
+				atomic_fetch_add_explicit(
+					&session->counters.buffer_full, 1,
+					memory_order_relaxed);
+				break;
+			}
+		}
+
+		frr_with_mutex (&session->encq_mutex) {
+			entry = fpm_encq_pop(&session->encq);
+			if (session->encq_blocked
+			    && fpm_encq_count(&session->encq)
+				       <= FPM_ENCQ_MAX / 2) {
+				session->encq_blocked = false;
+				wake = true;
+			}
+		}
+		if (entry == NULL)
+			break;
+
+		work = entry->work;
+		ctx = work->ctx;
+		if (session->socket != -1) {
+			fpm_stamp_init(primary, ctx, work->enqueued, &stamp);
+			if (work->action == FCA_SEND_UPDATE) {
+				/* Routes go to one session only. */
+				dplane_ctx_set_op(ctx, DPLANE_OP_ROUTE_UPDATE);
+				(void)fpm_nl_encode(session, ctx, &stamp);
+				dplane_ctx_set_op(ctx, DPLANE_OP_ROUTE_INSTALL);
+			} else
+				(void)fpm_nl_encode(session, ctx, &stamp);
+		}
+
+		if (fpm_work_put(primary, work))
+			returned = true;
 	}
 
-	/*
-	 * Fill in the FPM header information.
-	 *
-	 * See FPM_HEADER_SIZE definition for more information.
-	 */
-	stream_putc(fnc->obuf, 1);
-	stream_putc(fnc->obuf, 1);
-	stream_putw(fnc->obuf, nl_buf_len + FPM_HEADER_SIZE);
+	/* Resume queueing on the first session. */
+	if (wake)
+		event_add_event(primary->fthread->master, fpm_process_queue,
+				primary, 0, &primary->t_dequeue);
 
-	/* Write current data. */
-	stream_write(fnc->obuf, nl_buf, (size_t)nl_buf_len);
+	if (returned)
+		dplane_provider_work_ready();
+}
 
-	/* Account number of bytes waiting to be written. */
-	atomic_fetch_add_explicit(&fnc->counters.obuf_bytes,
-				  nl_buf_len + FPM_HEADER_SIZE,
-				  memory_order_relaxed);
-	obytes = atomic_load_explicit(&fnc->counters.obuf_bytes,
-				      memory_order_relaxed);
-	obytes_peak = atomic_load_explicit(&fnc->counters.obuf_peak,
-					   memory_order_relaxed);
-	if (obytes_peak < obytes)
-		atomic_store_explicit(&fnc->counters.obuf_peak, obytes,
-				      memory_order_relaxed);
+/* Release the contexts still queued, on shutdown. */
+static void fpm_encq_flush(struct fpm_nl_ctx *fnc)
+{
+	struct fpm_encq_entry *entry;
+	struct fpm_work *work;
+
+	while ((entry = fpm_encq_pop(&fnc->encq)) != NULL) {
+		work = entry->work;
+		if (atomic_fetch_sub_explicit(&work->refs, 1,
+					      memory_order_relaxed)
+		    != 1)
+			continue;
 
-	/* Tell the thread to start writing. */
-	event_add_write(fnc->fthread->master, fpm_write, fnc, fnc->socket,
-			 &fnc->t_write);
+		dplane_ctx_fini(&work->ctx);
+		XFREE(MTYPE_FPM_WORK, work);
+	}
 
-	return 0;
+	fpm_encq_fini(&fnc->encq);
+}
+
+/* Send an event to the other sessions. */
+static void fpm_sessions_event(struct fpm_nl_ctx *fnc, enum fpm_nl_events event)
+{
+	struct sockaddr_in *sin;
+	struct sockaddr_in6 *sin6;
+	struct fpm_nl_ctx *session;
+	uint32_t i, nsessions;
+
+	nsessions = atomic_load_explicit(&fnc->nsessions, memory_order_acquire);
+	for (i = 1; i < FPM_SESSIONS_MAX; i++) {
+		session = fnc->sessions[i];
+		if (session == NULL)
+			continue;
+
+		/* Sessions not in use any more are only disabled. */
+		if (i >= nsessions) {
+			if (event != FNE_RECONNECT && event != FNE_DISABLE)
+				continue;
+
+			event = FNE_DISABLE;
+		}
+
+		/* Session connects to the next port of the previous one. */
+		if (event == FNE_RECONNECT) {
+			session->addr = fnc->addr;
+			if (session->addr.ss_family == AF_INET) {
+				sin = (struct sockaddr_in *)&session->addr;
+				sin->sin_port = htons(ntohs(sin->sin_port) + i);
+			} else {
+				sin6 = (struct sockaddr_in6 *)&session->addr;
+				sin6->sin6_port =
+					htons(ntohs(sin6->sin6_port) + i);
+			}
+		}
+
+		session->use_nhg = fnc->use_nhg;
+		event_add_event(session->fthread->master, fpm_process_event,
+				 session, event, &session->t_event);
+	}
+}
+
+static void fpm_sessions_apply(struct fpm_nl_ctx *fnc)
+{
+	uint32_t i;
+
+	for (i = 1; i < fnc->nsessions_cfg; i++) {
+		if (fnc->sessions[i] == NULL)
+			fnc->sessions[i] = fpm_session_new(fnc, i);
+	}
+
+	fnc->shard_by = fnc->shard_by_cfg;
+	atomic_store_explicit(&fnc->nsessions, fnc->nsessions_cfg,
+			      memory_order_release);
+
+	/* Routes moved between sessions: replay them all. */
+	fpm_sessions_event(fnc, fnc->disabled ? FNE_DISABLE : FNE_RECONNECT);
+	fpm_reconnect(fnc);
 }
 
 /*
@@ -2454,7 +4038,7 @@ static int fpm_lsp_send_cb(struct hash_bucket *bucket, void *arg)
 	dplane_ctx_reset(fla->ctx);
 	dplane_ctx_lsp_init(fla->ctx, DPLANE_OP_LSP_INSTALL, lsp);
 
-	if (fpm_nl_enqueue(fla->fnc, fla->ctx) == -1) {
+	if (fpm_nl_enqueue(fla->fnc, fla->ctx, 0) == -1) {
 		fla->complete = false;
 		return HASHWALK_ABORT;
 	}
@@ -2512,7 +4096,7 @@ static int fpm_nhg_send_cb(struct hash_bucket *bucket, void *arg)
 	/* Reset ctx to reuse allocated memory, take a snapshot and send it. */
 	dplane_ctx_reset(fna->ctx);
 	dplane_ctx_nexthop_init(fna->ctx, DPLANE_OP_NH_INSTALL, nhe);
-	if (fpm_nl_enqueue(fna->fnc, fna->ctx) == -1) {
+	if (fpm_nl_enqueue(fna->fnc, fna->ctx, 0) == -1) {
 		/* Our buffers are full, lets give it some cycles. */
 		fna->complete = false;
 		return HASHWALK_ABORT;
@@ -2550,8 +4134,85 @@ static void fpm_nhg_send(struct event *t)
 				 &fnc->t_nhgwalk);
 }
 
+/*
+ * RIB walk: sends the RIB installed routes to the connected data plane in
+ * slices of bounded work, so zebra keeps running. The cursor keeps the
+ * table and the prefix of the route to resume at rather than the route
+ * node, which may be freed with its table in the meantime.
+ */
+static void fpm_rib_walk_start(struct fpm_nl_ctx *fnc, bool full)
+{
+	/* Walk again once done, for the routes before the cursor. */
+	if (fnc->rib_cursor.active) {
+		fnc->rib_cursor.rewalk = true;
+		return;
+	}
+
+	memset(&fnc->rib_cursor, 0, sizeof(fnc->rib_cursor));
+	fnc->rib_cursor.iter.state = RIB_TABLES_ITER_S_INIT;
+	fnc->rib_cursor.active = true;
+	fnc->rib_cursor.full = full;
+
+	event_add_event(zrouter.master, fpm_rib_send, fnc, 0, &fnc->t_ribwalk);
+}
+
+static void fpm_rib_cursor_save(struct fpm_nl_ctx *fnc,
+				const rib_tables_iter_t *iter,
+				const rib_tables_iter_t *table_iter,
+				struct route_node *rn)
+{
+	const struct prefix *dst_p, *src_p;
+
+	fnc->rib_cursor.iter = *iter;
+	fnc->rib_cursor.table_iter = *table_iter;
+	fnc->rib_cursor.in_table = true;
+
+	srcdest_rnode_prefixes(rn, &dst_p, &src_p);
+	prefix_copy(&fnc->rib_cursor.dst, dst_p);
+	if (src_p && src_p->prefixlen)
+		prefix_copy(&fnc->rib_cursor.src, src_p);
+	else
+		memset(&fnc->rib_cursor.src, 0, sizeof(fnc->rib_cursor.src));
+
+	/* Release the walk lock: the node is looked up again on resume. */
+	route_unlock_node(rn);
+}
+
+/* Get the (locked) route node to resume the walk of a table at. */
+static struct route_node *fpm_rib_cursor_node(struct fpm_nl_ctx *fnc,
+					      struct route_table *rt,
+					      const rib_tables_iter_t *iter)
+{
+	const struct prefix_ipv6 *src_p = NULL;
+	struct route_node *rn;
+
+	/* Stopped in another table, which went away: start over. */
+	if (!fnc->rib_cursor.in_table
+	    || iter->vrf_id != fnc->rib_cursor.table_iter.vrf_id
+	    || iter->afi_safi_ix != fnc->rib_cursor.table_iter.afi_safi_ix)
+		return route_top(rt);
+
+	if (fnc->rib_cursor.src.family)
+		src_p = (const struct prefix_ipv6 *)&fnc->rib_cursor.src;
+
+	/* The route we stopped at. */
+	rn = srcdest_rnode_lookup(rt, &fnc->rib_cursor.dst, src_p);
+	if (rn)
+		return rn;
+
+	/* Its destination, already sent source routes are skipped. */
+	if (src_p) {
+		rn = srcdest_rnode_lookup(rt, &fnc->rib_cursor.dst, NULL);
+		if (rn)
+			return rn;
+	}
+
+	/* Removed meanwhile: the route after it. */
+	return route_table_get_next(rt, &fnc->rib_cursor.dst);
+}
+
 /**
- * Send all RIB installed routes to the connected data plane.
+ * Send a slice of the RIB installed routes to the connected data plane.
  */
 static void fpm_rib_send(struct event *t)
 {
@@ -2560,50 +4221,111 @@ static void fpm_rib_send(struct event *t)
 	struct route_node *rn;
 	struct route_table *rt;
 	struct zebra_dplane_ctx *ctx;
-	rib_tables_iter_t rt_iter;
+	struct fpm_nl_ctx *session;
+	rib_tables_iter_t rt_iter, rt_iter_prev;
+	struct timeval start;
+	uint32_t routes = 0, visited = 0;
+	bool wait;
+
+	if (!fnc->rib_cursor.active)
+		return;
+
+	monotime(&start);
 
 	/* Allocate temporary context for all transactions. */
 	ctx = dplane_ctx_alloc();
 
-	rt_iter.state = RIB_TABLES_ITER_S_INIT;
-	while ((rt = rib_tables_iter_next(&rt_iter))) {
-		for (rn = route_top(rt); rn; rn = srcdest_route_next(rn)) {
+	rt_iter = fnc->rib_cursor.iter;
+	while (true) {
+		rt_iter_prev = rt_iter;
+		rt = rib_tables_iter_next(&rt_iter);
+		if (rt == NULL)
+			break;
+
+		rn = fpm_rib_cursor_node(fnc, rt, &rt_iter);
+		for (; rn; rn = srcdest_route_next(rn)) {
+			/* Slice budget used up: yield to other zebra events. */
+			if (routes >= fnc->rib_slice_routes
+			    || (visited % 64 == 63
+				&& monotime_since(&start, NULL)
+					   >= (int64_t)fnc->rib_slice_usec)) {
+				fpm_rib_cursor_save(fnc, &rt_iter_prev,
+						    &rt_iter, rn);
+				event_add_event(zrouter.master, fpm_rib_send,
+						fnc, 0, &fnc->t_ribwalk);
+				goto out;
+			}
+
+			visited++;
 			dest = rib_dest_from_rnode(rn);
 			/* Skip bad route entries. */
 			if (dest == NULL || dest->selected_fib == NULL)
 				continue;
 
 			/* Check for already sent routes. */
-			if (CHECK_FLAG(dest->flags, RIB_DEST_UPDATE_FPM))
+			if (!fnc->rib_cursor.full
+			    && CHECK_FLAG(dest->flags, RIB_DEST_UPDATE_FPM))
 				continue;
 
 			/* Enqueue route install. */
 			dplane_ctx_reset(ctx);
 			dplane_ctx_route_init(ctx, DPLANE_OP_ROUTE_INSTALL, rn,
 					      dest->selected_fib);
-			if (fpm_nl_enqueue(fnc, ctx) == -1) {
-				/* Free the temporary allocated context. */
-				dplane_ctx_fini(&ctx);
-
-				event_add_timer(zrouter.master, fpm_rib_send,
-						 fnc, 1, &fnc->t_ribwalk);
-				return;
+			if (fpm_nl_enqueue(fnc, ctx, 0) == -1) {
+				fpm_rib_cursor_save(fnc, &rt_iter_prev,
+						    &rt_iter, rn);
+
+				/* Wait for the output buffer to drain. */
+				session = fpm_route_session(fnc, ctx);
+				frr_with_mutex (&session->obuf_mutex) {
+					wait = !fpm_obuf_below_lowat(session);
+					session->obuf_rib_wait = wait;
+				}
+				if (wait)
+					atomic_fetch_add_explicit(
+						&fnc->counters.rib_walk_waits,
+						1, memory_order_relaxed);
+				else
+					event_add_event(zrouter.master,
+							fpm_rib_send, fnc, 0,
+							&fnc->t_ribwalk);
+				goto out;
 			}
 
 			/* Mark as sent. */
 			SET_FLAG(dest->flags, RIB_DEST_UPDATE_FPM);
+			routes++;
 		}
+
+		/* Table done: resume at the next one. */
+		fnc->rib_cursor.iter = rt_iter;
+		fnc->rib_cursor.in_table = false;
+	}
+
+	/* All RIB routes sent! */
+	fnc->rib_cursor.active = false;
+	atomic_fetch_add_explicit(&fnc->counters.rib_walks, 1,
+				  memory_order_relaxed);
+
+	if (fnc->rib_cursor.rewalk) {
+		/* Routes were reset behind the cursor: send them too. */
+		fpm_rib_walk_start(fnc, false);
+	} else {
+		WALK_FINISH(fnc, FNE_RIB_FINISHED);
+
+		/* Schedule next event: RMAC reset. */
+		event_add_event(zrouter.master, fpm_rmac_reset, fnc, 0,
+				 &fnc->t_rmacreset);
 	}
 
+out:
 	/* Free the temporary allocated context. */
 	dplane_ctx_fini(&ctx);
 
-	/* All RIB routes sent! */
-	WALK_FINISH(fnc, FNE_RIB_FINISHED);
-
-	/* Schedule next event: RMAC reset. */
-	event_add_event(zrouter.master, fpm_rmac_reset, fnc, 0,
-			 &fnc->t_rmacreset);
+	atomic_fetch_add_explicit(&fnc->counters.rib_walk_routes, routes,
+				  memory_order_relaxed);
+	atomic_fetch_add_explicit(&fnc->counters.rib_walk_slices, 1,
+				  memory_order_relaxed);
 }
 
 /*
@@ -2643,7 +4365,7 @@ static void fpm_enqueue_rmac_table(struct hash_bucket *bucket, void *arg)
 			zif->brslave_info.br_if, vid,
 			&zrmac->macaddr, vni->vni, zrmac->fwd_info.r_vtep_ip, sticky,
 			0 /*nhg*/, 0 /*update_flags*/);
-	if (fpm_nl_enqueue(fra->fnc, fra->ctx) == -1) {
+	if (fpm_nl_enqueue(fra->fnc, fra->ctx, 0) == -1) {
 		event_add_timer(zrouter.master, fpm_rmac_send,
 				 fra->fnc, 1, &fra->fnc->t_rmacwalk);
 		fra->complete = false;
@@ -2717,30 +4439,20 @@ static void fpm_lsp_reset(struct event *t)
 }
 
 /**
- * Resets the RIB FPM flags so we send all routes again.
+ * Restarts the RIB walk from the first table, sending all routes again.
  */
 static void fpm_rib_reset(struct event *t)
 {
 	struct fpm_nl_ctx *fnc = EVENT_ARG(t);
-	rib_dest_t *dest;
-	struct route_node *rn;
-	struct route_table *rt;
-	rib_tables_iter_t rt_iter;
-
-	rt_iter.state = RIB_TABLES_ITER_S_INIT;
-	while ((rt = rib_tables_iter_next(&rt_iter))) {
-		for (rn = route_top(rt); rn; rn = srcdest_route_next(rn)) {
-			dest = rib_dest_from_rnode(rn);
-			/* Skip bad route entries. */
-			if (dest == NULL)
-				continue;
 
-			UNSET_FLAG(dest->flags, RIB_DEST_UPDATE_FPM);
-		}
-	}
+	/*
+	 * A walk in progress belongs to the previous connection: the full
+	 * walk replaces it.
+	 */
+	fnc->rib_cursor.active = false;
 
 	/* Schedule next step: send RIB routes. */
-	event_add_event(zrouter.master, fpm_rib_send, fnc, 0, &fnc->t_ribwalk);
+	fpm_rib_walk_start(fnc, true);
 }
 
 /*
@@ -2771,16 +4483,210 @@ static void fpm_rmac_reset(struct event *t)
 			 &fnc->t_rmacwalk);
 }
 
+/*
+ * Queued update coalescing.
+ *
+ * A newer update of a route or next hop group supersedes the pending one,
+ * and keeps its own place at the tail of the queue: whatever it depends on
+ * was queued before it and is still sent first. A next hop group referenced
+ * by a context queued after it is pinned, so it is never moved after its
+ * users.
+ */
+static bool fpm_coalesce_key(struct fpm_coalesce_entry *key,
+			     struct zebra_dplane_ctx *ctx)
+{
+	enum dplane_op_e op = dplane_ctx_get_op(ctx);
+	const struct prefix *src;
+
+	memset(key, 0, sizeof(*key));
+
+	if (op == DPLANE_OP_ROUTE_INSTALL || op == DPLANE_OP_ROUTE_UPDATE
+	    || op == DPLANE_OP_ROUTE_DELETE) {
+		key->vrf_id = dplane_ctx_get_vrf(ctx);
+		key->table_id = dplane_ctx_get_table(ctx);
+		prefix_copy(&key->dest, dplane_ctx_get_dest(ctx));
+		src = dplane_ctx_get_src(ctx);
+		if (src && src->family)
+			prefix_copy(&key->src, src);
+
+		return true;
+	}
+
+	if (op == DPLANE_OP_NH_INSTALL || op == DPLANE_OP_NH_UPDATE
+	    || op == DPLANE_OP_NH_DELETE) {
+		key->nhg_id = dplane_ctx_get_nhe_id(ctx);
+		return key->nhg_id != 0;
+	}
+
+	return false;
+}
+
+static void fpm_coalesce_pin(struct fpm_nl_ctx *fnc, uint32_t nhg_id)
+{
+	struct fpm_coalesce_entry key = {}, *entry;
+
+	if (nhg_id == 0)
+		return;
+
+	key.nhg_id = nhg_id;
+	entry = fpm_coalesce_find(&fnc->coalesce_index, &key);
+	if (entry)
+		entry->pinned = true;
+}
+
+static void fpm_coalesce_pin_users(struct fpm_nl_ctx *fnc,
+				   struct zebra_dplane_ctx *ctx)
+{
+	const struct nh_grp *grp;
+	int i;
+
+	switch (dplane_ctx_get_op(ctx)) {
+	case DPLANE_OP_ROUTE_INSTALL:
+	case DPLANE_OP_ROUTE_UPDATE:
+		fpm_coalesce_pin(fnc, dplane_ctx_get_nhe_id(ctx));
+		break;
+	case DPLANE_OP_NH_INSTALL:
+	case DPLANE_OP_NH_UPDATE:
+		grp = dplane_ctx_get_nhe_nh_grp(ctx);
+		for (i = 0; i < dplane_ctx_get_nhe_nh_grp_count(ctx); i++)
+			fpm_coalesce_pin(fnc, grp[i].id);
+		break;
+	default:
+		break;
+	}
+}
+
+static bool fpm_coalesce_sends_delete(enum dplane_op_e op)
+{
+	return op == DPLANE_OP_ROUTE_UPDATE || op == DPLANE_OP_ROUTE_DELETE;
+}
+
+static bool fpm_coalesce_barrier(enum dplane_op_e op)
+{
+	return op == DPLANE_OP_NH_DELETE || op == DPLANE_OP_PIC_CONTEXT_DELETE
+	       || op == DPLANE_OP_SID_LIST_DELETE;
+}
+
+/* Index a context being queued. Must be called with ctxqueue_mutex held. */
+static void fpm_coalesce_enqueue(struct fpm_nl_ctx *fnc,
+				 struct zebra_dplane_ctx *ctx)
+{
+	struct fpm_coalesce_entry key, *entry;
+	struct fpm_superseded_entry *sentry;
+	enum dplane_op_e op = dplane_ctx_get_op(ctx);
+	bool need_delete = false;
+
+	fpm_coalesce_pin_users(fnc, ctx);
+
+	if (!fpm_coalesce_key(&key, ctx))
+		goto out;
+
+	entry = fpm_coalesce_find(&fnc->coalesce_index, &key);
+	if (entry == NULL) {
+		entry = XCALLOC(MTYPE_FPM_COALESCE, sizeof(*entry));
+		*entry = key;
+		fpm_coalesce_add(&fnc->coalesce_index, entry);
+	} else if (entry->gen == fnc->coalesce_gen && !entry->pinned) {
+		/*
+		 * Route install replacing a route update or delete: the
+		 * downstream route must still be deleted before.
+		 */
+		need_delete = op == DPLANE_OP_ROUTE_INSTALL
+			      && (entry->need_delete
+				  || fpm_coalesce_sends_delete(
+					  dplane_ctx_get_op(entry->ctx)));
+
+		sentry = XCALLOC(MTYPE_FPM_COALESCE, sizeof(*sentry));
+		sentry->ctx = entry->ctx;
+		fpm_superseded_add(&fnc->superseded, sentry);
+
+		atomic_fetch_add_explicit(&fnc->counters.coalesced_updates, 1,
+					  memory_order_relaxed);
+	}
+
+	/*
+	 * An entry of a previous generation or a pinned one just moves on to
+	 * the new context: the old one is still sent when dequeued.
+	 */
+	entry->ctx = ctx;
+	entry->gen = fnc->coalesce_gen;
+	entry->pinned = false;
+	entry->need_delete = need_delete;
+
+out:
+	/* Don't coalesce updates across deletes they may depend on. */
+	if (fpm_coalesce_barrier(op))
+		fnc->coalesce_gen++;
+}
+
+/* Unindex a dequeued context. Must be called with ctxqueue_mutex held. */
+static enum fpm_coalesce_action
+fpm_coalesce_dequeue(struct fpm_nl_ctx *fnc, struct zebra_dplane_ctx *ctx)
+{
+	struct fpm_coalesce_entry key, *entry;
+	struct fpm_superseded_entry skey, *sentry;
+	bool need_delete;
+
+	if (fpm_superseded_count(&fnc->superseded)) {
+		skey.ctx = ctx;
+		sentry = fpm_superseded_find(&fnc->superseded, &skey);
+		if (sentry) {
+			fpm_superseded_del(&fnc->superseded, sentry);
+			XFREE(MTYPE_FPM_COALESCE, sentry);
+			return FCA_SKIP;
+		}
+	}
+
+	if (fpm_coalesce_count(&fnc->coalesce_index) == 0
+	    || !fpm_coalesce_key(&key, ctx))
+		return FCA_SEND;
+
+	/* Not the latest context of its key: sent before a newer one. */
+	entry = fpm_coalesce_find(&fnc->coalesce_index, &key);
+	if (entry == NULL || entry->ctx != ctx)
+		return FCA_SEND;
+
+	need_delete = entry->need_delete;
+	fpm_coalesce_del(&fnc->coalesce_index, entry);
+	XFREE(MTYPE_FPM_COALESCE, entry);
+
+	return need_delete ? FCA_SEND_UPDATE : FCA_SEND;
+}
+
+static void fpm_coalesce_flush(struct fpm_nl_ctx *fnc)
+{
+	struct fpm_coalesce_entry *entry;
+	struct fpm_superseded_entry *sentry;
+
+	while ((entry = fpm_coalesce_pop(&fnc->coalesce_index)))
+		XFREE(MTYPE_FPM_COALESCE, entry);
+	while ((sentry = fpm_superseded_pop(&fnc->superseded)))
+		XFREE(MTYPE_FPM_COALESCE, sentry);
+
+	fpm_coalesce_fini(&fnc->coalesce_index);
+	fpm_superseded_fini(&fnc->superseded);
+}
+
 static void fpm_process_queue(struct event *t)
 {
 	struct fpm_nl_ctx *fnc = EVENT_ARG(t);
 	struct zebra_dplane_ctx *ctx;
+	enum fpm_coalesce_action action = FCA_SEND;
+	int64_t enqueued = 0;
 	bool no_bufs = false;
 	uint64_t processed_contexts = 0;
+	uint32_t nsessions;
+
+	/* Changed on this thread only. */
+	nsessions = atomic_load_explicit(&fnc->nsessions, memory_order_relaxed);
 
 	while (true) {
+		/* Several sessions: session encoders resume us once drained. */
+		if (nsessions > 1 && !fpm_encq_have_room(fnc, nsessions))
+			break;
+
 		/* No space available yet. */
-		if (STREAM_WRITEABLE(fnc->obuf) < NL_PKT_BUF_SIZE) {
+		if (nsessions <= 1 && !fpm_sessions_have_room(fnc)) {
 			no_bufs = true;
 			break;
 		}
@@ -2788,21 +4694,41 @@ static void fpm_process_queue(struct event *t)
 		/* Dequeue next item or quit processing. */
 		frr_with_mutex (&fnc->ctxqueue_mutex) {
 			ctx = dplane_ctx_dequeue(&fnc->ctxqueue);
+			if (ctx) {
+				action = fpm_coalesce_dequeue(fnc, ctx);
+				enqueued = fpm_stamp_first(
+						   &fnc->ctxqueue_stamps)
+						   ->enqueued;
+				fpm_stamp_pop(&fnc->ctxqueue_stamps);
+			}
 		}
 		if (ctx == NULL)
 			break;
 
+		/* Account the processed entries. */
+		processed_contexts++;
+
+		/* Encoded by the threads of the sessions it goes to. */
+		if (nsessions > 1 && action != FCA_SKIP) {
+			fpm_encq_dispatch(fnc, ctx, action, enqueued,
+					  nsessions);
+			continue;
+		}
+
 		/*
 		 * Intentionally ignoring the return value
 		 * as that we are ensuring that we can write to
-		 * the output data in the STREAM_WRITEABLE
+		 * the output data in the buffer space
 		 * check above, so we can ignore the return
 		 */
-		if (fnc->socket != -1)
-			(void)fpm_nl_enqueue(fnc, ctx);
-
-		/* Account the processed entries. */
-		processed_contexts++;
+		if (action == FCA_SEND)
+			(void)fpm_nl_enqueue(fnc, ctx, enqueued);
+		else if (action == FCA_SEND_UPDATE) {
+			/* Superseded a delete: send delete and install. */
+			dplane_ctx_set_op(ctx, DPLANE_OP_ROUTE_UPDATE);
+			(void)fpm_nl_enqueue(fnc, ctx, enqueued);
+			dplane_ctx_set_op(ctx, DPLANE_OP_ROUTE_INSTALL);
+		}
 
 		dplane_ctx_set_status(ctx, ZEBRA_DPLANE_REQUEST_SUCCESS);
 		dplane_provider_enqueue_out_ctx(fnc->prov, ctx);
@@ -2834,6 +4760,7 @@ static void fpm_process_event(struct event *t)
 {
 	struct fpm_nl_ctx *fnc = EVENT_ARG(t);
 	enum fpm_nl_events event = EVENT_VAL(t);
+	int i;
 
 	switch (event) {
 	case FNE_DISABLE:
@@ -2841,6 +4768,8 @@ static void fpm_process_event(struct event *t)
 		fnc->disabled = true;
 		atomic_fetch_add_explicit(&fnc->counters.user_disables, 1,
 					  memory_order_relaxed);
+		if (fnc->primary == fnc)
+			fpm_sessions_event(fnc, FNE_DISABLE);
 
 		/* Call reconnect to disable timers and clean up context. */
 		fpm_reconnect(fnc);
@@ -2851,20 +4780,47 @@ static void fpm_process_event(struct event *t)
 		fnc->disabled = false;
 		atomic_fetch_add_explicit(&fnc->counters.user_configures, 1,
 					  memory_order_relaxed);
+		if (fnc->primary == fnc)
+			fpm_sessions_event(fnc, FNE_RECONNECT);
 		fpm_reconnect(fnc);
 		break;
 
 	case FNE_RESET_COUNTERS:
 		zlog_info("%s: manual FPM counters reset event", __func__);
 		memset(&fnc->counters, 0, sizeof(fnc->counters));
+		for (i = 1; i < FPM_SESSIONS_MAX; i++) {
+			if (fnc->sessions[i])
+				memset(&fnc->sessions[i]->counters, 0,
+				       sizeof(fnc->sessions[i]->counters));
+		}
+		for (i = 0; i < FPM_LAT_MAX; i++)
+			fpm_hist_reset(&fnc->latency[i]);
 		break;
 
 	case FNE_TOGGLE_NHG:
 		zlog_info("%s: toggle next hop groups support", __func__);
 		fnc->use_nhg = !fnc->use_nhg;
+		if (!fnc->disabled)
+			fpm_sessions_event(fnc, FNE_RECONNECT);
 		fpm_reconnect(fnc);
 		break;
 
+	case FNE_TOGGLE_COALESCE:
+		zlog_info("%s: toggle queued updates coalescing", __func__);
+		/* Pending updates were not tracked while disabled. */
+		frr_with_mutex (&fnc->ctxqueue_mutex) {
+			fnc->coalesce = !fnc->coalesce;
+			fnc->coalesce_gen++;
+		}
+		break;
+
+	case FNE_SET_SESSIONS:
+		zlog_info("%s: %u FPM sessions sharded by %s", __func__,
+			  fnc->nsessions_cfg,
+			  fpm_shard_by_str[fnc->shard_by_cfg]);
+		fpm_sessions_apply(fnc);
+		break;
+
 	case FNE_INTERNAL_RECONNECT:
 		fpm_reconnect(fnc);
 		break;
@@ -2900,22 +4856,44 @@ static int fpm_nl_start(struct zebra_dplane_provider *prov)
 	fnc->fthread = frr_pthread_new(NULL, prov_name, prov_name);
 	assert(frr_pthread_run(fnc->fthread, NULL) == 0);
 	fnc->ibuf = stream_new(NL_PKT_BUF_SIZE);
-	fnc->obuf = stream_new(NL_PKT_BUF_SIZE * 128);
+	fpm_obuf_init(&fnc->obuf);
+	fpm_obuf_init(&fnc->obuf_free);
+	fnc->obuf_hwm = FPM_OBUF_HWM_DEFAULT;
+	fnc->obuf_hwm_cfg = FPM_OBUF_HWM_DEFAULT;
+	fnc->obuf_hwm_max = FPM_OBUF_HWM_MAX_DEFAULT;
 	pthread_mutex_init(&fnc->obuf_mutex, NULL);
+	fpm_encq_init(&fnc->encq);
+	pthread_mutex_init(&fnc->encq_mutex, NULL);
+	fnc->rib_slice_routes = FPM_RIB_SLICE_ROUTES_DEFAULT;
+	fnc->rib_slice_usec = FPM_RIB_SLICE_USEC_DEFAULT;
 	fnc->socket = -1;
 	fnc->disabled = true;
 	fnc->prov = prov;
 	dplane_ctx_q_init(&fnc->ctxqueue);
 	pthread_mutex_init(&fnc->ctxqueue_mutex, NULL);
+	fpm_coalesce_init(&fnc->coalesce_index);
+	fpm_superseded_init(&fnc->superseded);
 
 	/* Set default values. */
 	fnc->use_nhg = true;
+	fnc->primary = fnc;
+	fnc->sessions[0] = fnc;
+	fnc->nsessions = 1;
+	fnc->nsessions_cfg = 1;
 
 	return 0;
 }
 
 static int fpm_nl_finish_early(struct fpm_nl_ctx *fnc)
 {
+	int i;
+
+	/* Finish the other sessions first. */
+	for (i = 1; i < FPM_SESSIONS_MAX; i++) {
+		if (fnc->sessions[i])
+			fpm_nl_finish_early(fnc->sessions[i]);
+	}
+
 	/* Disable all events and close socket. */
 	EVENT_OFF(fnc->t_lspreset);
 	EVENT_OFF(fnc->t_lspwalk);
@@ -2927,6 +4905,9 @@ static int fpm_nl_finish_early(struct fpm_nl_ctx *fnc)
 	EVENT_OFF(fnc->t_rmacwalk);
 	EVENT_OFF(fnc->t_event);
 	EVENT_OFF(fnc->t_nhg);
+	EVENT_OFF(fnc->t_coalesce);
+	EVENT_OFF(fnc->t_sessions);
+	EVENT_OFF(fnc->t_encode);
 	event_cancel_async(fnc->fthread->master, &fnc->t_read, NULL);
 	event_cancel_async(fnc->fthread->master, &fnc->t_write, NULL);
 	event_cancel_async(fnc->fthread->master, &fnc->t_connect, NULL);
@@ -2939,16 +4920,39 @@ static int fpm_nl_finish_early(struct fpm_nl_ctx *fnc)
 	return 0;
 }
 
+static void fpm_session_free(struct fpm_nl_ctx *session)
+{
+	frr_pthread_stop(session->fthread, NULL);
+	frr_pthread_destroy(session->fthread);
+	pthread_mutex_destroy(&session->obuf_mutex);
+	pthread_mutex_destroy(&session->encq_mutex);
+	fpm_encq_flush(session);
+	stream_free(session->ibuf);
+	fpm_obuf_release(session);
+	free(session);
+}
+
 static int fpm_nl_finish_late(struct fpm_nl_ctx *fnc)
 {
+	int i;
+
+	for (i = 1; i < FPM_SESSIONS_MAX; i++) {
+		if (fnc->sessions[i])
+			fpm_session_free(fnc->sessions[i]);
+	}
+
 	/* Stop the running thread. */
 	frr_pthread_stop(fnc->fthread, NULL);
 
 	/* Free all allocated resources. */
 	pthread_mutex_destroy(&fnc->obuf_mutex);
 	pthread_mutex_destroy(&fnc->ctxqueue_mutex);
+	pthread_mutex_destroy(&fnc->encq_mutex);
+	fpm_encq_flush(fnc);
+	fpm_coalesce_flush(fnc);
+	fpm_stamp_release(&fnc->ctxqueue_stamps);
 	stream_free(fnc->ibuf);
-	stream_free(fnc->obuf);
+	fpm_obuf_release(fnc);
 	free(gfnc);
 	gfnc = NULL;
 
@@ -2970,6 +4974,7 @@ static int fpm_nl_process(struct zebra_dplane_provider *prov)
 {
 	struct zebra_dplane_ctx *ctx;
 	struct fpm_nl_ctx *fnc;
+	struct fpm_stamp stamp = {};
 	int counter, limit;
 	uint64_t cur_queue = 0, peak_queue = 0, stored_peak_queue;
 
@@ -3003,9 +5008,13 @@ static int fpm_nl_process(struct zebra_dplane_provider *prov)
 		 * Skip all notifications if not connected, we'll walk the RIB
 		 * anyway.
 		 */
-		if (fnc->socket != -1 && fnc->connecting == false) {
+		if (fpm_sessions_connected(fnc)) {
+			stamp.enqueued = fpm_time_usec();
 			frr_with_mutex (&fnc->ctxqueue_mutex) {
+				if (fnc->coalesce)
+					fpm_coalesce_enqueue(fnc, ctx);
 				dplane_ctx_enqueue_tail(&fnc->ctxqueue, ctx);
+				fpm_stamp_push(&fnc->ctxqueue_stamps, &stamp);
 				cur_queue =
 					dplane_ctx_queue_count(&fnc->ctxqueue);
 			}
@@ -3054,11 +5063,21 @@ static int fpm_nl_new(struct event_loop *tm)
 	install_node(&fpm_node);
 	install_element(ENABLE_NODE, &fpm_show_counters_cmd);
 	install_element(ENABLE_NODE, &fpm_show_counters_json_cmd);
+	install_element(ENABLE_NODE, &fpm_show_latency_cmd);
+	install_element(ENABLE_NODE, &fpm_show_latency_json_cmd);
 	install_element(ENABLE_NODE, &fpm_reset_counters_cmd);
 	install_element(CONFIG_NODE, &fpm_set_address_cmd);
 	install_element(CONFIG_NODE, &no_fpm_set_address_cmd);
 	install_element(CONFIG_NODE, &fpm_use_nhg_cmd);
 	install_element(CONFIG_NODE, &no_fpm_use_nhg_cmd);
+	install_element(CONFIG_NODE, &fpm_coalesce_updates_cmd);
+	install_element(CONFIG_NODE, &no_fpm_coalesce_updates_cmd);
+	install_element(CONFIG_NODE, &fpm_obuf_hwm_cmd);
+	install_element(CONFIG_NODE, &no_fpm_obuf_hwm_cmd);
+	install_element(CONFIG_NODE, &fpm_rib_slice_cmd);
+	install_element(CONFIG_NODE, &no_fpm_rib_slice_cmd);
+	install_element(CONFIG_NODE, &fpm_sessions_cmd);
+	install_element(CONFIG_NODE, &no_fpm_sessions_cmd);
 
 	return 0;
 }
@@ -0,0 +1,138 @@
+#!/usr/bin/env python3
+"""
+Loopback FPM server measuring the route programming rate of dplane_fpm_sonic.
+
+It listens on one port per FPM session (the configured port, then the next
+ones, as 'fpm sessions' connects), reads the FPM framed netlink messages and
+prints the rate of route messages per session and in total. Each session is
+read by its own process, so the server is not what limits the rate.
+
+Example, for 'fpm address 127.0.0.1 port 2620' and 'fpm sessions 4':
+
+    fpm_sink.py --port 2620 --sessions 4
+"""
+
+import argparse
+import multiprocessing
+import socket
+import struct
+import sys
+import time
+
+FPM_HEADER = struct.Struct('!BBH')
+NLMSG_HEADER = struct.Struct('=IHHII')
+
+RTM_NEWROUTE = 24
+RTM_DELROUTE = 25
+
+# Per session counters.
+ROUTES, OTHERS, BYTES, COUNTERS = range(4)
+
+
+def parse(buf, length, counters):
+    """Account the complete FPM messages in buf, return bytes consumed."""
+    routes = others = 0
+    off = 0
+    while length - off >= FPM_HEADER.size:
+        _, _, msg_len = FPM_HEADER.unpack_from(buf, off)
+        if msg_len < FPM_HEADER.size:
+            raise ValueError('invalid FPM message length %d' % msg_len)
+        if length - off < msg_len:
+            break
+
+        # An FPM message may carry several netlink messages (updates).
+        nl_off = off + FPM_HEADER.size
+        end = off + msg_len
+        while end - nl_off >= NLMSG_HEADER.size:
+            nl_len, nl_type, _, _, _ = NLMSG_HEADER.unpack_from(buf, nl_off)
+            if nl_len < NLMSG_HEADER.size:
+                break
+            if nl_type in (RTM_NEWROUTE, RTM_DELROUTE):
+                routes += 1
+            else:
+                others += 1
+            nl_off += (nl_len + 3) & ~3
+
+        off = end
+
+    with counters.get_lock():
+        counters[ROUTES] += routes
+        counters[OTHERS] += others
+        counters[BYTES] += off
+
+    return off
+
+
+def session(addr, port, counters):
+    family = socket.AF_INET6 if ':' in addr else socket.AF_INET
+    lsock = socket.socket(family, socket.SOCK_STREAM)
+    lsock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    lsock.bind((addr, port))
+    lsock.listen(1)
+
+    buf = bytearray(1 << 20)
+    view = memoryview(buf)
+    while True:
+        conn, _ = lsock.accept()
+        pending = 0
+        while True:
+            n = conn.recv_into(view[pending:])
+            if n == 0:
+                break
+            pending += n
+            used = parse(buf, pending, counters)
+            buf[:pending - used] = buf[used:pending]
+            pending -= used
+        conn.close()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[1])
+    parser.add_argument('-a', '--address', default='127.0.0.1',
+                        help='address to listen on (default: %(default)s)')
+    parser.add_argument('-p', '--port', type=int, default=2620,
+                        help='port of the first session (default: %(default)s)')
+    parser.add_argument('-n', '--sessions', type=int, default=1,
+                        help='number of sessions (default: %(default)s)')
+    parser.add_argument('-i', '--interval', type=float, default=1.0,
+                        help='report interval in seconds (default: %(default)s)')
+    parser.add_argument('-d', '--duration', type=float, default=0,
+                        help='stop after that many seconds, 0 for never')
+    args = parser.parse_args()
+
+    counters = [multiprocessing.Array('Q', COUNTERS)
+                for _ in range(args.sessions)]
+    procs = [multiprocessing.Process(target=session, daemon=True,
+                                     args=(args.address, args.port + i,
+                                           counters[i]))
+             for i in range(args.sessions)]
+    for proc in procs:
+        proc.start()
+
+    print('%8s %s %12s %12s' % (
+        'time', ' '.join('%10s' % ('s%d r/s' % i)
+                         for i in range(args.sessions)),
+        'routes/s', 'total'))
+    start = last = time.monotonic()
+    prev = [0] * args.sessions
+    try:
+        while not args.duration or last - start < args.duration:
+            time.sleep(args.interval)
+            now = time.monotonic()
+            routes = [c[ROUTES] for c in counters]
+            rates = [(r - p) / (now - last) for r, p in zip(routes, prev)]
+            print('%8.1f %s %12.0f %12d' % (
+                now - start, ' '.join('%10.0f' % r for r in rates),
+                sum(rates), sum(routes)))
+            sys.stdout.flush()
+            prev, last = routes, now
+    except KeyboardInterrupt:
+        pass
+
+    for i, c in enumerate(counters):
+        print('session %d: %d routes, %d other messages, %d bytes' % (
+            i, c[ROUTES], c[OTHERS], c[BYTES]))
+
+
+if __name__ == '__main__':
+    main()